@@ -26,10 +26,15 @@
 #include "till_commands.h"
 #include "till_common.h"
 #include "till_security.h"
+#include "till_status.h"
+#include "till_serve.h"
+#include "till_arena.h"
 #include "cJSON.h"
 
 /* Global flags */
 int g_interactive = 0;
+static int g_timings = 0;
+static double g_start_time;
 
 /* Command handler function type */
 typedef int (*command_handler_t)(int argc, char *argv[]);
@@ -45,6 +50,8 @@ typedef struct {
 /* Function prototypes */
 static void print_usage(const char *program);
 static void print_version(void);
+static double monotonic_seconds(void);
+static void print_timings(void);
 
 /* Command handlers are now in till_commands.c */
 
@@ -59,6 +66,7 @@ static const command_def_t commands[] = {
     {"host",      cmd_host,      "Manage remote hosts", 0},
     {"federate",  cmd_federate,  "Manage global federation", 0},
     {"status",    cmd_status,    "Show Till status", 0},
+    {"serve",     cmd_serve,     "Serve status queries from memory", 0},
     {"run",       cmd_run,       "Run component command", 1},  /* Special case: needs argc-2, argv+2 */
     {"update",    cmd_update,    "Update Till from git", 0},
     {"repair",    cmd_repair,    "Check and repair Till configuration", 0},
@@ -74,12 +82,13 @@ int get_absolute_path(const char *relative, char *absolute, size_t size);
 static int create_directory(const char *path);
 int get_till_parent_dir(char *parent_dir, size_t size);
 int check_till_updates(int quiet_mode);
-int self_update_till(void);
-static void rollback_till(const char *backup, const char *target);
 static int get_till_directory(char *till_dir, size_t size);
 
 /* Main entry point */
 int main(int argc, char *argv[]) {
+    /* cJSON's allocator hooks are global - set them before any threads */
+    till_arena_init();
+    
     /* First pass - look for global flags */
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interactive") == 0) {
@@ -91,6 +100,28 @@ int main(int argc, char *argv[]) {
             argc--;
             i--; /* Check same position again */
         }
+        else if (strcmp(argv[i], "--timings") == 0) {
+            g_timings = 1;
+            g_start_time = monotonic_seconds();
+            atexit(print_timings);
+            for (int j = i; j < argc - 1; j++) {
+                argv[j] = argv[j + 1];
+            }
+            argc--;
+            i--;
+        }
+        else if (till_output_flag(argv[i])) {
+            /* Commands strip it themselves; set here so discovery stays quiet */
+            g_output = strcmp(argv[i], "--jsonl") == 0 ? TILL_OUTPUT_JSONL : TILL_OUTPUT_JSON;
+        }
+    }
+    
+    /* Output flags before any command apply to the dry run */
+    while (argc > 1 && till_output_flag(argv[1])) {
+        for (int j = 1; j < argc - 1; j++) {
+            argv[j] = argv[j + 1];
+        }
+        argc--;
     }
     
     /* Parse help and version first (no setup needed) */
@@ -119,8 +150,13 @@ int main(int argc, char *argv[]) {
         till_log(LOG_INFO, "Starting: till (dry run)");
     }
     
-    /* Always run discovery and verify */
-    ensure_discovery();
+    /* Always run discovery and verify - unless a running "till serve"
+     * is keeping the registry current and will answer this query */
+    int status_query = (argc > 1 && strcmp(argv[1], "status") == 0) || g_output != TILL_OUTPUT_TEXT;
+    int completion = argc > 2 && strcmp(argv[1], "run") == 0 && strcmp(argv[2], "--complete") == 0;
+    if (!completion && (!status_query || !till_serve_running())) {
+        ensure_discovery();
+    }
     
     /* No arguments - show dry run */
     if (argc == 1) {
@@ -159,6 +195,25 @@ int main(int argc, char *argv[]) {
     return result;
 }
 
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --timings report, on stderr so JSON output stays clean */
+static void print_timings(void) {
+    till_arena_stats_t arena;
+    till_arena_stats(&arena);
+
+    fprintf(stderr, "\nTimings:\n");
+    fprintf(stderr, "  Elapsed:     %.3fs\n", monotonic_seconds() - g_start_time);
+    fprintf(stderr, "  JSON arena:  %lu scopes, %lu allocations (%.1f KiB), %lu frees absorbed\n",
+            arena.scopes, arena.allocations, arena.bytes / 1024.0, arena.frees);
+    fprintf(stderr, "               %lu chunks of %d KiB, peak %.1f KiB in use\n",
+            arena.chunks, TILL_ARENA_CHUNK / 1024, arena.peak / 1024.0);
+}
+
 /* Print usage information */
 static void print_usage(const char *program) {
     printf("Till - Tekton Lifecycle Manager v%s\n\n", TILL_VERSION);
@@ -167,13 +222,15 @@ static void print_usage(const char *program) {
     printf("  -h, --help          Show this help message\n");
     printf("  -v, --version       Show version information\n");
     printf("  -i, --interactive   Interactive mode for supported commands\n");
+    printf("  --json, --jsonl     Machine-readable output for status commands\n");
+    printf("  --timings           Report run time and JSON allocator use on exit\n");
     printf("\nCommands:\n");
     printf("  (none)              Dry run - show what sync would do\n");
     
     /* Print commands from table - sorted alphabetically */
     const char *sorted_commands[] = {
         "federate", "help", "hold", "host", "install", "release",
-        "repair", "run", "status", "sync", "uninstall", "update", "watch"
+        "repair", "run", "serve", "status", "sync", "uninstall", "update", "watch"
     };
 
     for (int i = 0; i < sizeof(sorted_commands)/sizeof(sorted_commands[0]); i++) {
@@ -386,199 +443,3 @@ int get_absolute_path(const char *relative, char *absolute, size_t size) {
     return 0;
 }
 
-/* Rollback till to backup version */
-static void rollback_till(const char *backup, const char *target) {
-    printf("   Rolling back to previous version...\n");
-    rename(backup, target);
-}
-
-/* Self-update till with backup and rollback */
-int self_update_till(void) {
-    char till_dir[TILL_MAX_PATH];
-    char backup_path[TILL_MAX_PATH];
-    char lock_file[TILL_MAX_PATH];
-    char cmd[TILL_MAX_PATH * 2];
-    int lock_fd;
-    
-    if (get_till_directory(till_dir, sizeof(till_dir)) != 0) {
-        till_error("Could not determine till directory");
-        return -1;
-    }
-    
-    /* 1. LOCK - Prevent concurrent updates */
-    snprintf(lock_file, sizeof(lock_file), "%s/.till-update.lock", till_dir);
-    lock_fd = acquire_lock_file(lock_file, 5000);  /* 5 second timeout */
-    if (lock_fd < 0) {
-        if (errno == ETIMEDOUT) {
-            printf("⚠️  Another till update in progress (timed out waiting)\n");
-        } else {
-            printf("⚠️  Could not acquire update lock\n");
-        }
-        return -1;
-    }
-    
-    /* 2. BACKUP - Save current executable */
-    char current_exe[TILL_MAX_PATH];
-    snprintf(current_exe, sizeof(current_exe), "%s/till", till_dir);
-    snprintf(backup_path, sizeof(backup_path), "%s/till.backup-%ld", 
-             till_dir, (long)time(NULL));
-    
-    printf("📦 Updating till...\n");
-    printf("   Backing up to: %s\n", backup_path);
-    
-    if (rename(current_exe, backup_path) != 0) {
-        printf("   ❌ Backup failed: %s\n", strerror(errno));
-        release_lock_file(lock_fd);
-        return -1;
-    }
-    
-    /* 3. CHECK - Ensure clean working directory */
-    snprintf(cmd, sizeof(cmd), 
-        "cd \"%s\" && git status --porcelain 2>/dev/null", till_dir);
-    
-    FILE *pipe = popen(cmd, "r");
-    char changes[256];
-    int has_changes = 0;
-    if (pipe) {
-        if (fgets(changes, sizeof(changes), pipe)) {
-            if (strlen(changes) > 0) {
-                has_changes = 1;
-            }
-        }
-        pclose(pipe);
-    }
-    
-    if (has_changes) {
-        printf("   ⚠️  Uncommitted changes detected\n");
-        printf("   Stashing changes...\n");
-        
-        /* Stash changes */
-        snprintf(cmd, sizeof(cmd),
-            "cd \"%s\" && git stash push -m 'till-auto-update-%ld' 2>&1",
-            till_dir, (long)time(NULL));
-        if (system(cmd) != 0) {
-            till_warn("Failed to stash changes");
-        }
-    }
-    
-    /* 4. UPDATE - Pull latest */
-    printf("   Pulling latest changes...\n");
-    snprintf(cmd, sizeof(cmd),
-        "cd \"%s\" && git pull --no-edit origin main 2>&1", till_dir);
-    
-    pipe = popen(cmd, "r");
-    if (!pipe) {
-        rollback_till(backup_path, current_exe);
-        release_lock_file(lock_fd);
-        return -1;
-    }
-    
-    char output[1024];
-    int success = 1;
-    while (fgets(output, sizeof(output), pipe)) {
-        /* Show important output */
-        if (strstr(output, "Fast-forward") || 
-            strstr(output, "files changed") ||
-            strstr(output, "insertions") ||
-            strstr(output, "deletions")) {
-            printf("   %s", output);
-        }
-        if (strstr(output, "error:") || strstr(output, "fatal:")) {
-            printf("   %s", output);
-            success = 0;
-        }
-    }
-    int status = pclose(pipe);
-    
-    if (status != 0 || !success) {
-        printf("   ❌ Git pull failed, rolling back\n");
-        rollback_till(backup_path, current_exe);
-        release_lock_file(lock_fd);
-        return -1;
-    }
-    
-    /* 5. BUILD - Compile new version and install */
-    printf("   Building and installing new version...\n");
-    snprintf(cmd, sizeof(cmd), "cd \"%s\" && make clean >/dev/null 2>&1 && make install 2>&1", till_dir);
-
-    pipe = popen(cmd, "r");
-    success = 1;
-    while (fgets(output, sizeof(output), pipe)) {
-        if (strstr(output, "error:") || strstr(output, "Error")) {
-            printf("   %s", output);
-            success = 0;
-        } else if (strstr(output, "Build complete") ||
-                   strstr(output, "Installation complete") ||
-                   strstr(output, "Prerequisites verified") ||
-                   strstr(output, "GitHub CLI authenticated") ||
-                   strstr(output, "Till installation complete")) {
-            printf("   %s", output);
-        }
-    }
-    status = pclose(pipe);
-
-    if (status != 0 || !success) {
-        printf("   ❌ Build/install failed, rolling back\n");
-        rollback_till(backup_path, current_exe);
-
-        /* Also revert git */
-        snprintf(cmd, sizeof(cmd), "cd \"%s\" && git reset --hard HEAD~1", till_dir);
-        if (system(cmd) != 0) {
-            till_error("Failed to reset git repository");
-        }
-
-        release_lock_file(lock_fd);
-        return -1;
-    }
-    
-    /* 6. VERIFY - Test new executable */
-    printf("   Verifying new version...\n");
-    snprintf(cmd, sizeof(cmd), "\"%s\" --version 2>&1", current_exe);
-    pipe = popen(cmd, "r");
-    if (!pipe) {
-        printf("   ❌ Verification failed, rolling back\n");
-        rollback_till(backup_path, current_exe);
-        release_lock_file(lock_fd);
-        return -1;
-    }
-    
-    /* Read version output */
-    if (fgets(output, sizeof(output), pipe)) {
-        printf("   New version: %s", output);
-    }
-    status = pclose(pipe);
-    
-    if (status != 0) {
-        printf("   ❌ Verification failed, rolling back\n");
-        rollback_till(backup_path, current_exe);
-        release_lock_file(lock_fd);
-        return -1;
-    }
-    
-    /* 7. CLEANUP - Remove backup after success */
-    printf("   ✅ Till updated successfully\n");
-    unlink(backup_path);
-    
-    /* Show what changed */
-    snprintf(cmd, sizeof(cmd), 
-        "cd \"%s\" && git log --oneline -5", till_dir);
-    printf("\n   Recent changes:\n");
-    pipe = popen(cmd, "r");
-    while (fgets(output, sizeof(output), pipe)) {
-        printf("     %s", output);
-    }
-    pclose(pipe);
-    
-    /* 8. UNLOCK */
-    close(lock_fd);
-    unlink(lock_file);
-    
-    /* 9. RE-EXEC - Run new version for the sync */
-    printf("\n   Restarting with new version...\n\n");
-    execl(current_exe, "till", "sync", NULL);
-    
-    /* If execl fails, return error */
-    till_error("Failed to restart with new version");
-    return -1;
-}
-
@@ -0,0 +1,217 @@
+/*
+ * till_arena.c - Arena allocation for cJSON trees
+ *
+ * Each thread has its own arena: chunks in a list, newest first, and a
+ * mark per open scope recording the newest chunk and how much of it was
+ * used. Ending the scope frees the chunks added since and rewinds that
+ * one. Frees of arena memory cost nothing, except that freeing the latest
+ * allocation gives its space back - a string printed and freed straight
+ * away, say. cJSON grows a print buffer by allocating a bigger one before
+ * freeing the old, so the old ones stay until the scope ends; cJSON
+ * doubles the size each time, so that's less than the final buffer again.
+ *
+ * The hooks are installed once per process and stay: cJSON's hooks are
+ * global and can't be swapped safely while other threads use cJSON.
+ * Outside a scope they pass straight through to malloc and free.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "till_config.h"
+#include "till_arena.h"
+#include "cJSON.h"
+
+#define ARENA_ALIGN 16
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;        /* Older chunk */
+    size_t size;
+    size_t used;
+    unsigned char data[];
+} arena_chunk_t;
+
+typedef struct {
+    arena_chunk_t *chunk;
+    size_t used;
+} arena_mark_t;
+
+/* One thread's arena */
+typedef struct {
+    arena_chunk_t *head;
+    arena_mark_t marks[TILL_ARENA_DEPTH];
+    int depth;
+    void *last;                      /* Latest allocation, can be given back */
+    size_t in_use;
+    till_arena_stats_t stats;
+} arena_t;
+
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+static pthread_key_t arena_key;
+
+/* The calling thread's arena while it has a scope open, else NULL */
+static arena_t *arena_active(void) {
+    arena_t *arena = pthread_getspecific(arena_key);
+    return arena && arena->depth > 0 ? arena : NULL;
+}
+
+/* Bump-allocate from chunk, NULL if it doesn't fit */
+static void *chunk_alloc(arena_t *arena, arena_chunk_t *chunk, size_t size) {
+    uintptr_t base = (uintptr_t)chunk->data;
+    uintptr_t start = (base + chunk->used + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1);
+    size_t end = (size_t)(start - base) + size;
+
+    if (end > chunk->size) {
+        return NULL;
+    }
+    arena->in_use += end - chunk->used;
+    chunk->used = end;
+    return (void *)start;
+}
+
+static void *arena_malloc(size_t size) {
+    arena_t *arena = arena_active();
+    if (!arena) {
+        return malloc(size);
+    }
+
+    void *ptr = arena->head ? chunk_alloc(arena, arena->head, size) : NULL;
+    if (!ptr) {
+        size_t capacity = size + ARENA_ALIGN > TILL_ARENA_CHUNK ? size + ARENA_ALIGN : TILL_ARENA_CHUNK;
+        arena_chunk_t *chunk = malloc(sizeof(*chunk) + capacity);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->head;
+        chunk->size = capacity;
+        chunk->used = 0;
+        arena->head = chunk;
+        arena->stats.chunks++;
+        ptr = chunk_alloc(arena, chunk, size);
+    }
+
+    arena->last = ptr;
+    arena->stats.allocations++;
+    arena->stats.bytes += size;
+    if (arena->in_use > arena->stats.peak) {
+        arena->stats.peak = arena->in_use;
+    }
+    return ptr;
+}
+
+static arena_chunk_t *owning_chunk(const arena_t *arena, const void *ptr) {
+    uintptr_t p = (uintptr_t)ptr;
+
+    for (arena_chunk_t *chunk = arena->head; chunk; chunk = chunk->next) {
+        uintptr_t base = (uintptr_t)chunk->data;
+        if (p >= base && p < base + chunk->size) {
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+static void arena_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    /* Trees built before the scope are still malloc'd */
+    arena_t *arena = arena_active();
+    arena_chunk_t *chunk = arena ? owning_chunk(arena, ptr) : NULL;
+    if (!chunk) {
+        free(ptr);
+        return;
+    }
+
+    if (ptr == arena->last) {
+        size_t used = (size_t)((uintptr_t)ptr - (uintptr_t)chunk->data);
+        arena->in_use -= chunk->used - used;
+        chunk->used = used;
+        arena->last = NULL;
+    }
+    arena->stats.frees++;
+}
+
+/* Release everything allocated since mark (NULL chunk: everything) */
+static void rewind_to(arena_t *arena, const arena_mark_t *mark) {
+    while (arena->head && arena->head != mark->chunk) {
+        arena_chunk_t *chunk = arena->head;
+        arena->head = chunk->next;
+        arena->in_use -= chunk->used;
+        free(chunk);
+    }
+    if (arena->head) {
+        arena->in_use -= arena->head->used - mark->used;
+        arena->head->used = mark->used;
+    }
+    arena->last = NULL;
+}
+
+/* A thread exiting with its arena */
+static void arena_destroy(void *state) {
+    arena_mark_t none = { NULL, 0 };
+    rewind_to(state, &none);
+    free(state);
+}
+
+static void arena_setup(void) {
+    cJSON_Hooks hooks = { arena_malloc, arena_free };
+
+    pthread_key_create(&arena_key, arena_destroy);
+    cJSON_InitHooks(&hooks);
+}
+
+void till_arena_init(void) {
+    pthread_once(&arena_once, arena_setup);
+}
+
+void till_arena_begin(void) {
+    till_arena_init();
+
+    arena_t *arena = pthread_getspecific(arena_key);
+    if (!arena) {
+        arena = calloc(1, sizeof(*arena));
+        if (!arena || pthread_setspecific(arena_key, arena) != 0) {
+            free(arena);
+            return;  /* No scope - cJSON stays on malloc */
+        }
+    }
+
+    /* Deeper scopes share their parent's */
+    if (arena->depth < TILL_ARENA_DEPTH) {
+        arena->marks[arena->depth].chunk = arena->head;
+        arena->marks[arena->depth].used = arena->head ? arena->head->used : 0;
+    }
+    arena->last = NULL;  /* Never give back space from below the mark */
+    arena->depth++;
+    arena->stats.scopes++;
+}
+
+void till_arena_end(void) {
+    till_arena_init();
+
+    arena_t *arena = pthread_getspecific(arena_key);
+    if (!arena || arena->depth == 0) {
+        return;
+    }
+
+    arena->depth--;
+    if (arena->depth < TILL_ARENA_DEPTH) {
+        rewind_to(arena, &arena->marks[arena->depth]);
+    }
+}
+
+void till_arena_stats(till_arena_stats_t *stats) {
+    till_arena_init();
+
+    arena_t *arena = pthread_getspecific(arena_key);
+    if (arena) {
+        *stats = arena->stats;
+    } else {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
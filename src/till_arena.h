@@ -0,0 +1,41 @@
+/*
+ * till_arena.h - Arena allocation for cJSON trees
+ *
+ * Between till_arena_begin() and till_arena_end(), cJSON takes its nodes
+ * and strings from large chunks with a bump pointer instead of one malloc
+ * each, freeing them is a no-op, and ending the scope releases the lot at
+ * once. Scopes nest; an inner one rewinds to where it started.
+ *
+ * Nothing allocated in a scope may outlive it or be handed to another
+ * thread, and JSON printed inside one must be released with cJSON_free.
+ * Scopes are per thread: a thread without one open gets malloc, whatever
+ * other threads are doing.
+ */
+
+#ifndef TILL_ARENA_H
+#define TILL_ARENA_H
+
+#include <stddef.h>
+
+/* Allocator statistics for the calling thread's arena */
+typedef struct {
+    unsigned long scopes;
+    unsigned long allocations;       /* Served from the arena */
+    unsigned long long bytes;        /* Requested from the arena */
+    unsigned long frees;             /* Absorbed by the arena */
+    unsigned long chunks;            /* Chunks malloc'd */
+    size_t peak;                     /* Most arena bytes in use at once */
+} till_arena_stats_t;
+
+/* Install the cJSON hooks; main calls it before any threads start.
+ * The first scope does it too, for programs that don't */
+void till_arena_init(void);
+
+/* Open and close a scope on the calling thread */
+void till_arena_begin(void);
+void till_arena_end(void);
+
+/* Statistics so far, for the calling thread */
+void till_arena_stats(till_arena_stats_t *stats);
+
+#endif /* TILL_ARENA_H */
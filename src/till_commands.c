@@ -22,6 +22,10 @@
 #include "till_registry.h"
 #include "till_common.h"
 #include "till_federation.h"
+#include "till_status.h"
+#include "till_serve.h"
+#include "till_update.h"
+#include "till_history.h"
 #include "cJSON.h"
 
 /* External functions from till.c */
@@ -30,7 +34,6 @@ extern int dir_exists(const char *path);
 extern int get_absolute_path(const char *relative, char *absolute, size_t size);
 extern int get_till_parent_dir(char *parent_dir, size_t size);
 extern int check_till_updates(int quiet_mode);
-extern int self_update_till(void);
 extern void till_log(int level, const char *format, ...);
 
 /* External globals */
@@ -40,23 +43,43 @@ extern int g_interactive;
 /* None needed currently */
 
 
+/* HEAD and object store size (KiB) of a checkout */
+static int repo_snapshot(const char *root, char *head, size_t size, long *kib) {
+    char output[256];
+    char sha[64];
+    
+    if (run_command_capture(output, sizeof(output),
+            "cd \"%s\" && git rev-parse HEAD 2>/dev/null && "
+            "git count-objects -v 2>/dev/null | awk '/^size(-pack)?:/ {k += $2} END {print k + 0}'",
+            root) != 0 || sscanf(output, "%63s %ld", sha, kib) != 2) {
+        return -1;
+    }
+    snprintf(head, size, "%s", sha);
+    return 0;
+}
+
 /* Command: sync - Pull updates for all Tekton installations */
 int cmd_sync(int argc, char *argv[]) {
     int dry_run = 0;
     int skip_till_update = 0;
+    int scheduled = 0;
     
-    /* Parse arguments */
-    for (int i = 1; i < argc; i++) {
+    /* Parse arguments (argv holds the options after "sync") */
+    for (int i = 0; i < argc; i++) {
         if (strcmp(argv[i], "--dry-run") == 0) {
             dry_run = 1;
         } else if (strcmp(argv[i], "--skip-till-update") == 0) {
             skip_till_update = 1;
+        } else if (strcmp(argv[i], "--scheduled") == 0) {
+            scheduled = 1;
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             printf("Till Sync - Update Till, Tekton installations, and federation\n\n");
             printf("Usage: till sync [options]\n\n");
             printf("Options:\n");
             printf("  --dry-run           Check for updates without applying\n");
             printf("  --skip-till-update  Don't update Till itself\n");
+            printf("  --scheduled         Started by the watch schedule: wait while the\n");
+            printf("                      machine is busy (see till watch --max-load)\n");
             printf("  --help, -h          Show this help message\n\n");
             printf("Sync performs:\n");
             printf("  1. Updates Till itself (unless --skip-till-update)\n");
@@ -66,13 +89,21 @@ int cmd_sync(int argc, char *argv[]) {
         }
     }
     
+    if (scheduled) {
+        till_watch_wait_for_load();
+    }
+    
+    sync_run_t run;
+    sync_history_begin(&run, scheduled);
+    
     /* Check for Till updates first */
     if (!skip_till_update) {
         int behind = check_till_updates(1);
         if (behind > 0 && !dry_run) {
-            return self_update_till();
+            return self_update_till();  /* The new till sync records the run */
         }
     }
+    sync_history_phase_end(&run, SYNC_PHASE_TILL_UPDATE);
     
     printf("Till Sync\n");
     printf("=========\n\n");
@@ -98,6 +129,7 @@ int cmd_sync(int argc, char *argv[]) {
     } else {
         /* Clean up expired holds first */
         cleanup_expired_holds();
+        sync_history_phase_begin(&run);
 
     /* Sync each installation */
     
@@ -129,6 +161,9 @@ int cmd_sync(int argc, char *argv[]) {
                 printf("  🔒 HELD\n");
             }
             held++;
+            if (!dry_run) {
+                sync_history_install(&run, name, "held", 0, 0);
+            }
             continue;
         }
         
@@ -144,13 +179,29 @@ int cmd_sync(int argc, char *argv[]) {
             }
         } else {
             /* Actually update */
+            char before[64] = "", after[64] = "";
+            long kib_before = 0, kib_after = 0;
+            const char *outcome;
+            double pull_start = sync_history_now();
+            
+            repo_snapshot(root, before, sizeof(before), &kib_before);
             if (run_command_logged("cd \"%s\" && git pull", root) == 0) {
-                printf("  ✓ Updated\n");
-                updated++;
+                repo_snapshot(root, after, sizeof(after), &kib_after);
+                if (strcmp(before, after) != 0) {
+                    printf("  ✓ Updated\n");
+                    outcome = "updated";
+                    updated++;
+                } else {
+                    printf("  ✓ Up to date\n");
+                    outcome = "current";
+                }
             } else {
                 printf("  ✗ Failed to update\n");
+                outcome = "failed";
                 failed++;
             }
+            sync_history_install(&run, name, outcome, sync_history_now() - pull_start,
+                kib_after > kib_before ? (kib_after - kib_before) * 1024 : 0);
         }
     }
 
@@ -171,15 +222,13 @@ int cmd_sync(int argc, char *argv[]) {
             }
         }
 
-        /* Record sync in schedule */
-        if (!dry_run) {
-            till_watch_record_sync(failed == 0, 0, updated, 0);
-        }
+        sync_history_phase_end(&run, SYNC_PHASE_INSTALLATIONS);
     }  /* End of else block for installations check */
 
     cJSON_Delete(registry);
     
     /* Process menu_of_the_day.json if federation is enabled */
+    sync_history_phase_begin(&run);
     if (!dry_run && file_exists(MENU_PATH)) {
         printf("\nProcessing menu of the day...\n");
         till_log(LOG_INFO, "Processing menu_of_the_day.json for auto-installation check");
@@ -208,6 +257,12 @@ int cmd_sync(int argc, char *argv[]) {
                             installations = cJSON_GetObjectItem(registry, "installations");
                         }
 
+                        /* Every container is looked up in both */
+                        till_json_index_t installed, holds;
+                        till_json_index_init(&installed, installations);
+                        holds_index_load(&holds);
+                        time_t now = time(NULL);
+
                         cJSON *containers = cJSON_GetObjectItem(menu, "containers");
                         if (containers && cJSON_IsObject(containers)) {
                             int count = 0;
@@ -229,12 +284,12 @@ int cmd_sync(int argc, char *argv[]) {
                                     const char *avail_mode = json_get_string(availability, fed_config.trust_level, "");
 
                                     /* Check if component is already installed */
-                                    cJSON *existing = cJSON_GetObjectItem(installations, comp_name);
+                                    cJSON *existing = till_json_index_get_nocase(&installed, comp_name);
 
                                     if (strcmp(avail_mode, "standard") == 0) {
                                         if (existing) {
                                             /* Update existing */
-                                            if (!is_component_held(comp_name)) {
+                                            if (!holds_index_held(&holds, comp_name, now)) {
                                                 printf("  Updating %s (standard)...\n", comp_name);
                                                 const char *root = json_get_string(existing, "root", NULL);
                                                 if (root) {
@@ -334,7 +389,7 @@ int cmd_sync(int argc, char *argv[]) {
                                         }
                                     } else if (strcmp(avail_mode, "optional") == 0 && existing) {
                                         /* Update only if already installed */
-                                        if (!is_component_held(comp_name)) {
+                                        if (!holds_index_held(&holds, comp_name, now)) {
                                             printf("  Updating %s (optional)...\n", comp_name);
                                             const char *root = json_get_string(existing, "root", NULL);
                                             if (root) {
@@ -346,6 +401,8 @@ int cmd_sync(int argc, char *argv[]) {
                                 container = container->next;
                             }
                         }
+                        till_json_index_free(&installed);
+                        holds_index_free(&holds);
                         cJSON_Delete(menu);
                         if (registry) {
                             cJSON_Delete(registry);
@@ -357,13 +414,19 @@ int cmd_sync(int argc, char *argv[]) {
             }
         }
     }
+    sync_history_phase_end(&run, SYNC_PHASE_MENU);
+
+    /* Record the run: log line, rolling index, schedule */
+    if (!dry_run) {
+        sync_history_record(&run, failed == 0);
+    }
 
     return failed > 0 ? 1 : 0;
 }
 
 /* Command: watch - Configure automatic sync */
 int cmd_watch(int argc, char *argv[]) {
-    return till_watch_configure(argc - 1, argv + 1);
+    return till_watch_configure(argc, argv);
 }
 
 /* Command: install - Install Tekton or components */
@@ -667,6 +730,15 @@ int cmd_install(int argc, char *argv[]) {
     return till_install_tekton(&opts);
 }
 
+static int forget_installation(cJSON *registry, void *ctx) {
+    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
+    if (!cJSON_GetObjectItem(installations, ctx)) {
+        return 1;
+    }
+    cJSON_DeleteItemFromObject(installations, ctx);
+    return 0;
+}
+
 /* Command: uninstall - Uninstall component */
 int cmd_uninstall(int argc, char *argv[]) {
     if (argc < 2) {
@@ -704,13 +776,16 @@ int cmd_uninstall(int argc, char *argv[]) {
         return 0;
     }
     
-    /* Remove from registry */
-    cJSON_DeleteItemFromObject(installations, name);
-    save_till_json("tekton/till-private.json", registry);
-    cJSON_Delete(registry);
+    /* Remove from the registry as it is now, not as it was read before
+     * the prompt */
+    if (till_json_transaction(TILL_REGISTRY_FILE, forget_installation, (void *)name) < 0) {
+        cJSON_Delete(registry);
+        return EXIT_FILE_ERROR;
+    }
     
     printf("Removed '%s' from registry\n", name);
     printf("Note: Directory %s was not deleted\n", path);
+    cJSON_Delete(registry);
     
     return 0;
 }
@@ -734,19 +809,28 @@ int cmd_host(int argc, char *argv[]) {
 
 /* Command: status - Show Till status */
 int cmd_status(int argc, char *argv[]) {
-    (void)argc;
-    (void)argv;
-    printf("Till Status\n");
-    printf("===========\n");
-    printf("Version: %s\n", TILL_VERSION);
-    printf("Platform: %s\n", PLATFORM_NAME);
-    printf("Config: %s\n", TILL_CONFIG_VERSION);
+    unsigned int sections = STATUS_ALL;
     
-    printf("\nComponents: [To be implemented]\n");
-    printf("Federation: [To be implemented]\n");
-    printf("Hosts: [To be implemented]\n");
+    argc = till_output_parse(argc, argv);
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            sections |= STATUS_CHECK_UPDATES;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printf("Usage: till status [--check] [--json | --jsonl]\n\n");
+            printf("Shows installations, holds, hosts, sync schedule and federation.\n");
+            printf("  --check   Also fetch to count available updates (slower)\n");
+            printf("  --json    One JSON document\n");
+            printf("  --jsonl   One JSON record per line, each with a \"type\"\n");
+            return 0;
+        }
+    }
     
-    return 0;
+    return till_status_show(sections);
+}
+
+/* Command: serve - Answer status queries from memory */
+int cmd_serve(int argc, char *argv[]) {
+    return till_serve_command(argc, argv);
 }
 
 /* Command: run - Run component command */
@@ -756,8 +840,10 @@ int cmd_run(int argc, char *argv[]) {
 
 /* Command: update - Update Till from git */
 int cmd_update(int argc, char *argv[]) {
-    (void)argc;  /* Unused */
-    (void)argv;  /* Unused */
+    if (argc > 0) {
+        return till_update_command(argc, argv);
+    }
+
     int behind = check_till_updates(1);
 
     if (behind == 0) {
@@ -1035,6 +1121,7 @@ int cmd_help(int argc, char *argv[]) {
     printf("  federate            Manage federation\n");
     printf("  menu                Manage menu of the day catalog\n");
     printf("  status              Show Till status\n");
+    printf("  serve               Serve status queries from memory\n");
     printf("  run                 Run component command\n");
     printf("  update              Update Till from git\n");
     printf("  help                Show help information\n");
@@ -1047,6 +1134,10 @@ int cmd_help(int argc, char *argv[]) {
 
 /* Dry run - show what sync would do */
 int cmd_dry_run(void) {
+    if (g_output != TILL_OUTPUT_TEXT) {
+        return till_status_show(STATUS_TILL | STATUS_INSTALLATIONS | STATUS_CHECK_UPDATES);
+    }
+    
     printf("Till v%s - Dry Run Mode\n", TILL_VERSION);
     printf("=====================================\n\n");
     
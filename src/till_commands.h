@@ -14,6 +14,7 @@ int cmd_release(int argc, char **argv);
 int cmd_host(int argc, char **argv);
 int cmd_federate(int argc, char **argv);
 int cmd_status(int argc, char **argv);
+int cmd_serve(int argc, char **argv);
 int cmd_run(int argc, char **argv);
 int cmd_update(int argc, char **argv);
 int cmd_repair(int argc, char **argv);
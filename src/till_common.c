@@ -15,6 +15,8 @@
 
 #include "till_config.h"
 #include "till_common.h"
+#include "till_snapshot.h"
+#include "till_security.h"
 #include "cJSON.h"
 
 static FILE *log_file = NULL;
@@ -207,7 +209,10 @@ int build_till_path(char *dest, size_t size, const char *filename) {
         return -1;
     }
     
-    snprintf(dest, size, "%s/%s", till_dir, filename);
+    if (snprintf(dest, size, "%s/%s", till_dir, filename) >= (int)size) {
+        till_log(LOG_ERROR, "Path too long: %s/%s", till_dir, filename);
+        return -1;
+    }
     return 0;
 }
 
@@ -282,8 +287,10 @@ cJSON* load_json_file(const char *path) {
     return json;
 }
 
-/* Save JSON to file */
-int save_json_file(const char *path, cJSON *json) {
+/* Write JSON to path through a temp file, flushed to disk first if sync
+ * is set; written, if given, gets the stat of the file as it was renamed
+ * into place */
+static int write_json_atomic(const char *path, cJSON *json, struct stat *written, int sync) {
     char *output = cJSON_Print(json);
     if (!output) {
         till_log(LOG_ERROR, "Cannot serialize JSON");
@@ -296,7 +303,7 @@ int save_json_file(const char *path, cJSON *json) {
     
     int fd = mkstemp(temp_path);
     if (fd == -1) {
-        free(output);
+        cJSON_free(output);
         till_error("Cannot create temp file for %s: %s", path, strerror(errno));
         return -1;
     }
@@ -305,23 +312,25 @@ int save_json_file(const char *path, cJSON *json) {
     if (!fp) {
         close(fd);
         unlink(temp_path);
-        free(output);
+        cJSON_free(output);
         till_error("Cannot open temp file for writing: %s", strerror(errno));
         return -1;
     }
     
-    if (fprintf(fp, "%s", output) < 0) {
+    if (fprintf(fp, "%s", output) < 0 || fflush(fp) != 0 ||
+        (sync && fsync(fileno(fp)) != 0) ||
+        (written && fstat(fileno(fp), written) != 0)) {
         till_error("Failed to write to temp file");
         fclose(fp);
         unlink(temp_path);
-        free(output);
+        cJSON_free(output);
         return -1;
     }
     
     if (fclose(fp) != 0) {
         till_error("Failed to close temp file: %s", strerror(errno));
         unlink(temp_path);
-        free(output);
+        cJSON_free(output);
         return -1;
     }
     
@@ -329,16 +338,21 @@ int save_json_file(const char *path, cJSON *json) {
     if (rename(temp_path, path) != 0) {
         till_error("Failed to rename %s to %s: %s", temp_path, path, strerror(errno));
         unlink(temp_path);
-        free(output);
+        cJSON_free(output);
         return -1;
     }
     
-    free(output);
+    cJSON_free(output);
     
     till_log(LOG_DEBUG, "Saved JSON to %s", path);
     return 0;
 }
 
+/* Save JSON to file */
+int save_json_file(const char *path, cJSON *json) {
+    return write_json_atomic(path, json, NULL, 0);
+}
+
 /* Load or create Till registry with installations object */
 cJSON* load_or_create_registry(void) {
     cJSON *registry = load_till_json("tekton/till-private.json");
@@ -368,10 +382,9 @@ cJSON* load_till_json(const char *filename) {
     return load_json_file(path);
 }
 
-/* Save JSON file to Till directory */
-int save_till_json(const char *filename, cJSON *json) {
-    char path[TILL_MAX_PATH];
-    if (build_till_path(path, sizeof(path), filename) != 0) {
+/* Path of a file in the Till directory, creating its parent directory */
+static int prepare_till_path(char *path, size_t size, const char *filename) {
+    if (build_till_path(path, size, filename) != 0) {
         till_error("Failed to build path for %s", filename);
         return -1;
     }
@@ -387,12 +400,90 @@ int save_till_json(const char *filename, cJSON *json) {
         }
         *last_slash = '/';
     }
+    return 0;
+}
+
+/* Writers of a Till file take <file>.lock for as long as they write it,
+ * or read, change and write it */
+static int lock_till_file(const char *path) {
+    char lock_path[TILL_MAX_PATH];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
     
+    int lock_fd = acquire_lock_file(lock_path, LOCK_TIMEOUT * 1000);
+    if (lock_fd < 0) {
+        till_error("Cannot lock %s: %s", path, strerror(errno));
+    }
+    return lock_fd;
+}
+
+/* Write with the lock held; the registry snapshot follows every save
+ * of the registry */
+static int save_locked(const char *filename, const char *path, cJSON *json) {
     till_debug("Saving JSON to path: %s", path);
-    int result = save_json_file(path, json);
+    struct stat written;
+    int result = write_json_atomic(path, json, &written, 1);
+    
+    if (result == 0 && strcmp(filename, TILL_REGISTRY_FILE) == 0) {
+        char snap_path[TILL_MAX_PATH];
+        if (build_till_path(snap_path, sizeof(snap_path), TILL_SNAPSHOT_FILE) != 0 ||
+            till_snapshot_write(snap_path, json, &written) != 0) {
+            till_log(LOG_WARN, "Cannot write registry snapshot, it will be rebuilt on next use");
+        }
+    }
     return result;
 }
 
+/* Save JSON file to Till directory */
+int save_till_json(const char *filename, cJSON *json) {
+    char path[TILL_MAX_PATH];
+    if (prepare_till_path(path, sizeof(path), filename) != 0) {
+        return -1;
+    }
+    
+    int lock_fd = lock_till_file(path);
+    if (lock_fd < 0) {
+        return -1;
+    }
+    int result = save_locked(filename, path, json);
+    release_lock_file(lock_fd);
+    return result;
+}
+
+/* Read, change and write a file in the Till directory under its lock,
+ * so concurrent tills each apply their change to the other's result */
+int till_json_transaction(const char *filename, till_json_mutation_t mutate, void *ctx) {
+    char path[TILL_MAX_PATH];
+    if (prepare_till_path(path, sizeof(path), filename) != 0) {
+        return -1;
+    }
+    
+    int lock_fd = lock_till_file(path);
+    if (lock_fd < 0) {
+        return -1;
+    }
+    
+    /* A missing or empty file starts out as {}; one that doesn't parse
+     * is left for someone to fix rather than overwritten */
+    struct stat st;
+    cJSON *json = load_json_file(path);
+    if (!json && stat(path, &st) == 0 && st.st_size > 0) {
+        till_error("Cannot parse %s, leaving it unchanged", path);
+        release_lock_file(lock_fd);
+        return -1;
+    }
+    if (!json) {
+        json = cJSON_CreateObject();
+    }
+    
+    int result = json ? mutate(json, ctx) : -1;
+    if (result == 0 && save_locked(filename, path, json) != 0) {
+        result = -1;
+    }
+    
+    cJSON_Delete(json);
+    release_lock_file(lock_fd);
+    return result;
+}
 /* Run command and capture output */
 int run_command(const char *cmd, char *output, size_t output_size) {
     till_log(LOG_DEBUG, "Running command: %s", cmd);
@@ -30,6 +30,13 @@ cJSON* load_json_file(const char *path);
 int save_json_file(const char *path, cJSON *json);
 cJSON* load_till_json(const char *filename);
 int save_till_json(const char *filename, cJSON *json);
+
+/* A change to a file in the Till directory, made under the file's lock
+ * to what is on disk at that moment (an empty object if it is missing).
+ * Return 0 to write the result, 1 to leave the file as it was, or -1
+ * to abort. Don't save the same file from inside a mutation */
+typedef int (*till_json_mutation_t)(cJSON *json, void *ctx);
+int till_json_transaction(const char *filename, till_json_mutation_t mutate, void *ctx);
 cJSON* load_or_create_registry(void);
 
 /* Command execution */
@@ -59,6 +66,7 @@ int path_make_absolute(char *dest, size_t size, const char *path);
 /* Command execution utilities */
 int run_command_logged(const char *fmt, ...);
 int run_command_capture(char *output, size_t size, const char *fmt, ...);
+int run_command_capture_all(const char *cmd, char **output, size_t limit);
 typedef int (*line_processor_fn)(const char *line, void *context);
 int run_command_foreach_line(line_processor_fn callback, void *context, const char *fmt, ...);
 
@@ -245,6 +245,49 @@ int run_command_capture(char *output, size_t size, const char *fmt, ...) {
     return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
 }
 
+/* Capture all output (up to limit bytes) into a malloc'd buffer.
+ * *output is always set, even on failure, and must be freed. */
+int run_command_capture_all(const char *cmd, char **output, size_t limit) {
+    *output = NULL;
+    
+    till_log(LOG_DEBUG, "Executing with capture: %s", cmd);
+    
+    FILE *fp = popen(cmd, "r");
+    if (!fp) {
+        till_log(LOG_ERROR, "Failed to execute: %s", cmd);
+        return -1;
+    }
+    
+    size_t cap = 8192;
+    size_t len = 0;
+    char *buf = malloc(cap);
+    if (!buf) {
+        pclose(fp);
+        return -1;
+    }
+    
+    size_t n;
+    while ((n = fread(buf + len, 1, cap - len - 1, fp)) > 0) {
+        len += n;
+        if (len >= cap - 1) {
+            if (cap >= limit) {
+                break;
+            }
+            char *grown = realloc(buf, cap * 2);
+            if (!grown) {
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+    }
+    buf[len] = '\0';
+    *output = buf;
+    
+    int status = pclose(fp);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
 int run_command_foreach_line(line_processor_fn callback, void *context, const char *fmt, ...) {
     if (!callback) return -1;
     
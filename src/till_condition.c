@@ -0,0 +1,640 @@
+/*
+ * till_condition.c - Directive condition expressions for Till
+ *
+ * Grammar (lowest precedence first):
+ *
+ *   or      := and  (("||" | "or")  and)*
+ *   and     := not  (("&&" | "and") not)*
+ *   not     := ("!" | "not") not | compare
+ *   compare := primary (("==" | "=" | "!=" | "<" | "<=" | ">" | ">=" | "=~") primary)?
+ *   primary := number | version | string | fact | "installed" "(" name ")"
+ *            | "true" | "false" | "always" | "never" | "(" or ")"
+ *
+ * The parser emits code for a stack machine directly; && and || jump
+ * over their right operand when the left decides the result. Strings
+ * that look like versions (1.5.0) compare component-wise, "=~" is a
+ * shell glob match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include "till_condition.h"
+#include "till_config.h"
+#include "till_common.h"
+#include "till_security.h"
+#include "cJSON.h"
+
+#define COND_MAX_STACK 32
+
+/* Facts by name */
+enum { FACT_STR, FACT_INT };
+
+static const struct {
+    const char *name;
+    int kind;
+    size_t offset;
+} fact_table[] = {
+    { "platform",           FACT_STR, offsetof(till_facts_t, platform) },
+    { "platform_version",   FACT_STR, offsetof(till_facts_t, platform_version) },
+    { "arch",               FACT_STR, offsetof(till_facts_t, arch) },
+    { "hostname",           FACT_STR, offsetof(till_facts_t, hostname) },
+    { "till_version",       FACT_STR, offsetof(till_facts_t, till_version) },
+    { "trust_level",        FACT_STR, offsetof(till_facts_t, trust_level) },
+    { "cpu_count",          FACT_INT, offsetof(till_facts_t, cpu_count) },
+    { "memory_mb",          FACT_INT, offsetof(till_facts_t, memory_mb) },
+    { "installation_count", FACT_INT, offsetof(till_facts_t, installation_count) },
+    { "has_launchd",        FACT_INT, offsetof(till_facts_t, caps.has_launchd) },
+    { "has_systemd",        FACT_INT, offsetof(till_facts_t, caps.has_systemd) },
+    { "has_cron",           FACT_INT, offsetof(till_facts_t, caps.has_cron) },
+    { "has_lsof",           FACT_INT, offsetof(till_facts_t, caps.has_lsof) },
+    { "has_netstat",        FACT_INT, offsetof(till_facts_t, caps.has_netstat) },
+    { "has_ss",             FACT_INT, offsetof(till_facts_t, caps.has_ss) },
+    { "has_timeout",        FACT_INT, offsetof(till_facts_t, caps.has_timeout_cmd) },
+};
+
+#define FACT_COUNT (int)(sizeof(fact_table) / sizeof(fact_table[0]))
+
+/* Instructions */
+typedef enum {
+    OP_CONST,                    /* push consts[arg] */
+    OP_FACT,                     /* push fact_table[arg] */
+    OP_INSTALLED,                /* push installed(consts[arg]) */
+    OP_CMP,                      /* pop 2, push comparison by cmp */
+    OP_NOT,                      /* replace top with its negation */
+    OP_JFALSE,                   /* top false: jump to arg, else pop */
+    OP_JTRUE                     /* top true: jump to arg, else pop */
+} cond_op_t;
+
+typedef enum { CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT, CMP_GE, CMP_MATCH } cond_cmp_t;
+
+typedef struct {
+    unsigned char op;
+    unsigned char cmp;
+    short arg;
+} cond_insn_t;
+
+typedef struct {
+    int is_str;
+    double num;
+    const char *str;
+} cond_value_t;
+
+struct till_condition {
+    cond_insn_t *code;
+    int code_count;
+    cond_value_t *consts;
+    int const_count;
+};
+
+/* Tokens */
+typedef enum {
+    TOK_END, TOK_NUM, TOK_STR, TOK_IDENT, TOK_LPAREN, TOK_RPAREN,
+    TOK_AND, TOK_OR, TOK_NOT, TOK_CMP, TOK_ERROR
+} cond_tok_t;
+
+typedef struct {
+    const char *src;
+    const char *pos;
+    cond_tok_t tok;
+    const char *start;           /* Token text */
+    size_t len;
+    double num;
+    cond_cmp_t cmp;
+
+    till_condition_t *cond;
+    int depth;
+    int failed;
+    char *error;
+    size_t error_size;
+} cond_parser_t;
+
+static void parse_error(cond_parser_t *p, const char *what) {
+    if (p->failed) {
+        return;
+    }
+    p->failed = 1;
+    if (p->tok == TOK_END) {
+        snprintf(p->error, p->error_size, "%s at end of condition", what);
+    } else {
+        snprintf(p->error, p->error_size, "%s at column %d ('%.*s')", what,
+                 (int)(p->start - p->src) + 1, (int)p->len, p->start);
+    }
+}
+
+static int is_word(const cond_parser_t *p, const char *word) {
+    return p->len == strlen(word) && strncasecmp(p->start, word, p->len) == 0;
+}
+
+static void next_token(cond_parser_t *p) {
+    const char *s = p->pos;
+    while (isspace((unsigned char)*s)) s++;
+
+    p->start = s;
+    p->len = 1;
+
+    if (*s == '\0') {
+        p->tok = TOK_END;
+        p->len = 0;
+    } else if (isdigit((unsigned char)*s)) {
+        /* 4 and 1.5 are numbers, 1.5.0 is a version string */
+        const char *e = s;
+        int dots = 0;
+        while (isdigit((unsigned char)*e) || *e == '.') {
+            if (*e == '.') dots++;
+            e++;
+        }
+        p->len = e - s;
+        p->tok = dots > 1 ? TOK_STR : TOK_NUM;
+        p->num = strtod(s, NULL);
+    } else if (*s == '"' || *s == '\'') {
+        const char *e = strchr(s + 1, *s);
+        if (!e) {
+            p->tok = TOK_ERROR;
+            p->len = strlen(s);
+        } else {
+            p->tok = TOK_STR;
+            p->start = s + 1;
+            p->len = e - s - 1;
+            p->pos = e + 1;
+            return;
+        }
+    } else if (isalpha((unsigned char)*s) || *s == '_') {
+        const char *e = s;
+        while (isalnum((unsigned char)*e) || *e == '_') e++;
+        p->len = e - s;
+        p->tok = TOK_IDENT;
+        if (is_word(p, "and")) p->tok = TOK_AND;
+        else if (is_word(p, "or")) p->tok = TOK_OR;
+        else if (is_word(p, "not")) p->tok = TOK_NOT;
+    } else if (s[0] == '&' && s[1] == '&') {
+        p->tok = TOK_AND;
+        p->len = 2;
+    } else if (s[0] == '|' && s[1] == '|') {
+        p->tok = TOK_OR;
+        p->len = 2;
+    } else if (s[0] == '=' && s[1] == '~') {
+        p->tok = TOK_CMP; p->cmp = CMP_MATCH; p->len = 2;
+    } else if (s[0] == '=') {
+        p->tok = TOK_CMP; p->cmp = CMP_EQ; p->len = s[1] == '=' ? 2 : 1;
+    } else if (s[0] == '!' && s[1] == '=') {
+        p->tok = TOK_CMP; p->cmp = CMP_NE; p->len = 2;
+    } else if (s[0] == '<') {
+        p->tok = TOK_CMP; p->cmp = s[1] == '=' ? CMP_LE : CMP_LT; p->len = s[1] == '=' ? 2 : 1;
+    } else if (s[0] == '>') {
+        p->tok = TOK_CMP; p->cmp = s[1] == '=' ? CMP_GE : CMP_GT; p->len = s[1] == '=' ? 2 : 1;
+    } else if (s[0] == '!') {
+        p->tok = TOK_NOT;
+    } else if (s[0] == '(') {
+        p->tok = TOK_LPAREN;
+    } else if (s[0] == ')') {
+        p->tok = TOK_RPAREN;
+    } else {
+        p->tok = TOK_ERROR;
+    }
+
+    p->pos = s + p->len;
+}
+
+/* Append an instruction, tracking stack depth; returns its index */
+static int emit(cond_parser_t *p, cond_op_t op, int arg, int stack_delta) {
+    till_condition_t *c = p->cond;
+    if (p->failed) {
+        return 0;
+    }
+
+    cond_insn_t *code = realloc(c->code, (c->code_count + 1) * sizeof(cond_insn_t));
+    if (!code) {
+        parse_error(p, "out of memory");
+        return 0;
+    }
+    c->code = code;
+    c->code[c->code_count].op = (unsigned char)op;
+    c->code[c->code_count].cmp = (unsigned char)p->cmp;
+    c->code[c->code_count].arg = (short)arg;
+
+    p->depth += stack_delta;
+    if (p->depth > COND_MAX_STACK) {
+        parse_error(p, "condition nested too deeply");
+    }
+    return c->code_count++;
+}
+
+/* Add a constant; str is copied (len bytes) when not NULL */
+static int add_const(cond_parser_t *p, const char *str, size_t len, double num) {
+    till_condition_t *c = p->cond;
+    cond_value_t *consts = realloc(c->consts, (c->const_count + 1) * sizeof(cond_value_t));
+    if (!consts) {
+        parse_error(p, "out of memory");
+        return 0;
+    }
+    c->consts = consts;
+
+    cond_value_t *v = &c->consts[c->const_count];
+    v->is_str = str != NULL;
+    v->num = num;
+    v->str = NULL;
+    if (str) {
+        char *copy = malloc(len + 1);
+        if (!copy) {
+            parse_error(p, "out of memory");
+            return 0;
+        }
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+        v->str = copy;
+    }
+    return c->const_count++;
+}
+
+static void parse_or(cond_parser_t *p);
+
+static void parse_primary(cond_parser_t *p) {
+    if (p->failed) {
+        return;
+    }
+
+    switch (p->tok) {
+    case TOK_NUM:
+        emit(p, OP_CONST, add_const(p, NULL, 0, p->num), 1);
+        next_token(p);
+        return;
+
+    case TOK_STR:
+        emit(p, OP_CONST, add_const(p, p->start, p->len, 0), 1);
+        next_token(p);
+        return;
+
+    case TOK_LPAREN:
+        next_token(p);
+        parse_or(p);
+        if (p->tok != TOK_RPAREN) {
+            parse_error(p, "expected ')'");
+            return;
+        }
+        next_token(p);
+        return;
+
+    case TOK_IDENT:
+        break;
+
+    default:
+        parse_error(p, "unexpected token");
+        return;
+    }
+
+    if (is_word(p, "true") || is_word(p, "always")) {
+        emit(p, OP_CONST, add_const(p, NULL, 0, 1), 1);
+        next_token(p);
+        return;
+    }
+    if (is_word(p, "false") || is_word(p, "never")) {
+        emit(p, OP_CONST, add_const(p, NULL, 0, 0), 1);
+        next_token(p);
+        return;
+    }
+
+    if (is_word(p, "installed")) {
+        next_token(p);
+        if (p->tok != TOK_LPAREN) {
+            parse_error(p, "expected '(' after installed");
+            return;
+        }
+        next_token(p);
+        if (p->tok != TOK_STR && p->tok != TOK_IDENT) {
+            parse_error(p, "expected component name");
+            return;
+        }
+
+        /* Installation names are matched case-insensitively */
+        int k = add_const(p, p->start, p->len, 0);
+        if (!p->failed) {
+            for (char *c = (char *)p->cond->consts[k].str; *c; c++) {
+                *c = tolower((unsigned char)*c);
+            }
+        }
+        emit(p, OP_INSTALLED, k, 1);
+
+        next_token(p);
+        if (p->tok != TOK_RPAREN) {
+            parse_error(p, "expected ')'");
+            return;
+        }
+        next_token(p);
+        return;
+    }
+
+    for (int i = 0; i < FACT_COUNT; i++) {
+        if (is_word(p, fact_table[i].name)) {
+            emit(p, OP_FACT, i, 1);
+            next_token(p);
+            return;
+        }
+    }
+    parse_error(p, "unknown fact");
+}
+
+static void parse_compare(cond_parser_t *p) {
+    parse_primary(p);
+    if (p->tok == TOK_CMP && !p->failed) {
+        cond_cmp_t cmp = p->cmp;
+        next_token(p);
+        parse_primary(p);
+        p->cmp = cmp;
+        emit(p, OP_CMP, 0, -1);
+    }
+}
+
+static void parse_not(cond_parser_t *p) {
+    if (p->tok == TOK_NOT) {
+        next_token(p);
+        parse_not(p);
+        emit(p, OP_NOT, 0, 0);
+        return;
+    }
+    parse_compare(p);
+}
+
+/* Left-associative short-circuit chain of op over operand */
+static void parse_chain(cond_parser_t *p, cond_tok_t tok, cond_op_t jump,
+                        void (*operand)(cond_parser_t *)) {
+    operand(p);
+    while (p->tok == tok && !p->failed) {
+        next_token(p);
+        int at = emit(p, jump, 0, -1);
+        operand(p);
+        if (!p->failed) {
+            p->cond->code[at].arg = (short)p->cond->code_count;
+        }
+    }
+}
+
+static void parse_and(cond_parser_t *p) {
+    parse_chain(p, TOK_AND, OP_JFALSE, parse_not);
+}
+
+static void parse_or(cond_parser_t *p) {
+    parse_chain(p, TOK_OR, OP_JTRUE, parse_and);
+}
+
+void till_condition_free(till_condition_t *cond) {
+    if (!cond) {
+        return;
+    }
+    for (int i = 0; i < cond->const_count; i++) {
+        free((char *)cond->consts[i].str);
+    }
+    free(cond->consts);
+    free(cond->code);
+    free(cond);
+}
+
+till_condition_t *till_condition_compile(const char *expr, char *error, size_t error_size) {
+    cond_parser_t p;
+    memset(&p, 0, sizeof(p));
+    p.src = p.pos = expr ? expr : "";
+    p.error = error;
+    p.error_size = error_size;
+    if (error_size > 0) {
+        error[0] = '\0';
+    }
+
+    p.cond = calloc(1, sizeof(till_condition_t));
+    if (!p.cond) {
+        snprintf(error, error_size, "out of memory");
+        return NULL;
+    }
+
+    next_token(&p);
+    if (p.tok == TOK_END) {
+        /* Empty condition always holds */
+        emit(&p, OP_CONST, add_const(&p, NULL, 0, 1), 1);
+    } else {
+        parse_or(&p);
+        if (p.tok != TOK_END) {
+            parse_error(&p, "unexpected token");
+        }
+    }
+
+    if (p.failed) {
+        till_condition_free(p.cond);
+        return NULL;
+    }
+    return p.cond;
+}
+
+static int truthy(const cond_value_t *v) {
+    return v->is_str ? v->str[0] != '\0' : v->num != 0;
+}
+
+/* Digits separated by dots, optionally prefixed with v */
+static int version_like(const char *s) {
+    if (*s == 'v' || *s == 'V') s++;
+    if (!isdigit((unsigned char)*s)) {
+        return 0;
+    }
+    for (; *s; s++) {
+        if (!isdigit((unsigned char)*s) && *s != '.') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int compare_versions(const char *a, const char *b) {
+    if (*a == 'v' || *a == 'V') a++;
+    if (*b == 'v' || *b == 'V') b++;
+
+    while (*a || *b) {
+        char *ea, *eb;
+        long x = strtol(a, &ea, 10);
+        long y = strtol(b, &eb, 10);
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+        if (ea == a && eb == b) {
+            break;  /* Neither side is a component */
+        }
+        a = *ea == '.' ? ea + 1 : ea;
+        b = *eb == '.' ? eb + 1 : eb;
+    }
+    return 0;
+}
+
+/* Order a against b; sets *ordered to 0 when they can't be compared */
+static int compare_values(const cond_value_t *a, const cond_value_t *b, int *ordered) {
+    *ordered = 1;
+
+    if (!a->is_str && !b->is_str) {
+        return (a->num > b->num) - (a->num < b->num);
+    }
+    if (a->is_str && b->is_str) {
+        if (version_like(a->str) && version_like(b->str)) {
+            return compare_versions(a->str, b->str);
+        }
+        return strcasecmp(a->str, b->str);
+    }
+
+    /* Number against string: as versions if the string is one, else numerically */
+    const cond_value_t *s = a->is_str ? a : b;
+    const cond_value_t *n = a->is_str ? b : a;
+    int sign = a->is_str ? 1 : -1;
+    char buf[32];
+    char *end;
+
+    if (version_like(s->str)) {
+        snprintf(buf, sizeof(buf), "%g", n->num);
+        return sign * compare_versions(s->str, buf);
+    }
+    double value = strtod(s->str, &end);
+    if (end != s->str && *end == '\0') {
+        return sign * ((value > n->num) - (value < n->num));
+    }
+
+    *ordered = 0;
+    return 1;
+}
+
+static int apply_cmp(cond_cmp_t cmp, const cond_value_t *a, const cond_value_t *b) {
+    if (cmp == CMP_MATCH) {
+        char buf[32];
+        const char *text = a->str;
+        if (!a->is_str) {
+            snprintf(buf, sizeof(buf), "%g", a->num);
+            text = buf;
+        }
+        return b->is_str && fnmatch(b->str, text, 0) == 0;
+    }
+
+    int ordered;
+    int c = compare_values(a, b, &ordered);
+    switch (cmp) {
+    case CMP_EQ: return ordered && c == 0;
+    case CMP_NE: return !ordered || c != 0;
+    case CMP_LT: return ordered && c < 0;
+    case CMP_LE: return ordered && c <= 0;
+    case CMP_GT: return ordered && c > 0;
+    case CMP_GE: return ordered && c >= 0;
+    default:     return 0;
+    }
+}
+
+int till_condition_eval(const till_condition_t *cond, const till_facts_t *facts) {
+    cond_value_t stack[COND_MAX_STACK];
+    int sp = 0;
+
+    for (int pc = 0; pc < cond->code_count; pc++) {
+        const cond_insn_t *in = &cond->code[pc];
+        cond_value_t *top = sp > 0 ? &stack[sp - 1] : stack;
+
+        switch (in->op) {
+        case OP_CONST:
+            stack[sp++] = cond->consts[in->arg];
+            break;
+
+        case OP_FACT: {
+            const char *field = (const char *)facts + fact_table[in->arg].offset;
+            cond_value_t *v = &stack[sp++];
+            v->is_str = fact_table[in->arg].kind == FACT_STR;
+            v->str = v->is_str ? field : NULL;
+            v->num = v->is_str ? 0 : *(const int *)field;
+            break;
+        }
+
+        case OP_INSTALLED: {
+            cond_value_t *v = &stack[sp++];
+            v->is_str = 0;
+            v->str = NULL;
+            v->num = till_hash_find(&facts->installed, cond->consts[in->arg].str) != NULL;
+            break;
+        }
+
+        case OP_CMP:
+            top[-1].num = apply_cmp((cond_cmp_t)in->cmp, &top[-1], top);
+            top[-1].is_str = 0;
+            top[-1].str = NULL;
+            sp--;
+            break;
+
+        case OP_NOT:
+            top->num = !truthy(top);
+            top->is_str = 0;
+            top->str = NULL;
+            break;
+
+        case OP_JFALSE:
+        case OP_JTRUE:
+            if (truthy(top) == (in->op == OP_JTRUE)) {
+                pc = in->arg - 1;
+            } else {
+                sp--;
+            }
+            break;
+        }
+    }
+
+    return sp > 0 && truthy(&stack[sp - 1]);
+}
+
+void till_facts_add_installed(till_facts_t *facts, const char *name) {
+    char key[256];
+    size_t i;
+    for (i = 0; name[i] && i < sizeof(key) - 1; i++) {
+        key[i] = tolower((unsigned char)name[i]);
+    }
+    key[i] = '\0';
+    till_hash_upsert(&facts->installed, key, NULL);
+}
+
+int till_facts_collect(till_facts_t *facts, const char *trust_level) {
+    memset(facts, 0, sizeof(*facts));
+    till_hash_init(&facts->installed);
+
+#if PLATFORM_MACOS
+    safe_strncpy(facts->platform, "darwin", sizeof(facts->platform));
+#elif PLATFORM_LINUX
+    safe_strncpy(facts->platform, "linux", sizeof(facts->platform));
+#else
+    safe_strncpy(facts->platform, "bsd", sizeof(facts->platform));
+#endif
+    safe_strncpy(facts->platform_version, platform_get_version(), sizeof(facts->platform_version));
+
+    struct utsname uts;
+    if (uname(&uts) == 0) {
+        safe_strncpy(facts->arch, uts.machine, sizeof(facts->arch));
+    }
+    if (gethostname(facts->hostname, sizeof(facts->hostname) - 1) != 0) {
+        safe_strncpy(facts->hostname, "unknown", sizeof(facts->hostname));
+    }
+
+    safe_strncpy(facts->till_version, TILL_VERSION, sizeof(facts->till_version));
+    safe_strncpy(facts->trust_level, trust_level ? trust_level : "", sizeof(facts->trust_level));
+    facts->cpu_count = platform_get_cpu_count();
+    facts->memory_mb = platform_get_memory_mb();
+    platform_get_capabilities(&facts->caps);
+
+    cJSON *registry = load_till_json("tekton/till-private.json");
+    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
+    cJSON *inst;
+    cJSON_ArrayForEach(inst, installations) {
+        if (inst->string) {
+            till_facts_add_installed(facts, inst->string);
+            facts->installation_count++;
+        }
+    }
+    cJSON_Delete(registry);
+
+    return 0;
+}
+
+void till_facts_free(till_facts_t *facts) {
+    till_hash_free(&facts->installed, NULL);
+}
@@ -0,0 +1,55 @@
+/*
+ * till_condition.h - Directive condition expressions for Till
+ *
+ * Conditions are compiled once into a small stack-machine program and
+ * evaluated against facts collected once per sync, e.g.
+ *
+ *   platform == "linux" && cpu_count >= 4
+ *   till_version < 1.5.0 || !installed("Tekton")
+ *   trust_level != "anonymous" and (has_systemd or has_launchd)
+ *
+ * Identifiers name facts (see till_condition.c for the list); an unknown
+ * identifier is a compile error, so a typo never silently matches.
+ */
+
+#ifndef TILL_CONDITION_H
+#define TILL_CONDITION_H
+
+#include <stddef.h>
+#include "till_hash.h"
+#include "till_platform.h"
+
+/* Facts conditions are evaluated against */
+typedef struct {
+    char platform[32];           /* darwin|linux|bsd */
+    char platform_version[128];
+    char arch[32];
+    char hostname[128];
+    char till_version[32];
+    char trust_level[32];
+    int cpu_count;
+    int memory_mb;
+    int installation_count;
+    platform_capabilities_t caps;
+    till_hash_t installed;       /* Lowercased installation names */
+} till_facts_t;
+
+/* Compiled condition (opaque) */
+typedef struct till_condition till_condition_t;
+
+/* Gather facts for this host; trust_level may be NULL */
+int till_facts_collect(till_facts_t *facts, const char *trust_level);
+void till_facts_free(till_facts_t *facts);
+
+/* Mark a component installed (also used by tests) */
+void till_facts_add_installed(till_facts_t *facts, const char *name);
+
+/* Compile expr; NULL on error with a message in error */
+till_condition_t *till_condition_compile(const char *expr, char *error, size_t error_size);
+
+/* 1 if the condition holds, 0 if not */
+int till_condition_eval(const till_condition_t *cond, const till_facts_t *facts);
+
+void till_condition_free(till_condition_t *cond);
+
+#endif /* TILL_CONDITION_H */
@@ -44,11 +44,45 @@
 #define TILL_FEDERATION_BRANCH "federation"
 #define TILL_REGISTRATION_PREFIX "registration-"
 #define TILL_DEREGISTRATION_PREFIX "deregistration-"
+#define FEDERATION_STATE_DIR TILL_HOME "/federation"  /* Relative to $HOME */
+#define FEDERATION_HEARTBEAT_HOURS 24   /* Re-announce an unchanged status */
+#define FEDERATION_FULL_PUSH_HOURS 168  /* Resend full status at least weekly */
+#define FEDERATION_GIST_MAX (64 * JSON_MAX_SIZE)  /* Largest gist file read */
+#define FEDERATION_STATUS_SCHEMA 2         /* Version of the pushed status document */
+#define FEDERATION_COMPRESS_MIN 16384      /* Statuses this large are gzip+base64'd */
+#define FEDERATION_DIRECTIVE_WORKERS 4     /* Directives run in parallel */
+#define FEDERATION_DIRECTIVE_TIMEOUT 300   /* Seconds, unless the directive sets one */
+#define FEDERATION_REPORT_FILE "directives.json"  /* report_back results in the site gist */
+#define FEDERATION_PROBE_TIMEOUT 10        /* Seconds for the GitHub connectivity check */
+
+/* Status Daemon (till serve) */
+#define TILL_SERVE_SOCKET TILL_HOME "/serve.sock"  /* Relative to $HOME */
+#define TILL_SERVE_TIMEOUT_MS 2000     /* Client wait for a daemon reply */
+
+/* Self-Update (versioned binaries) */
+#define TILL_VERSIONS_DIR TILL_HOME "/versions"  /* Relative to $HOME */
+#define TILL_VERSIONS_KEEP 3           /* Builds kept besides current/previous */
+#define TILL_HOST_DIST_WORKERS 8       /* Concurrent SSH probes/pushes in till host update */
+
+/* Progress Display */
+#define PROGRESS_MAX_TASKS 64          /* Tasks tracked at once */
+#define PROGRESS_MAX_LINES 8           /* Task lines drawn on a terminal */
+#define PROGRESS_REFRESH_MS 200        /* Minimum time between terminal redraws */
+#define PROGRESS_SUMMARY_SECONDS 30    /* One-line summaries when not on a terminal */
 
 /* Timing Configuration */
 #define TILL_DEFAULT_WATCH_HOURS 24
 #define TILL_DEFAULT_TTL_HOURS 72
 #define TILL_SYNC_INTERVAL_SECONDS 86400  /* 24 hours */
+#define TILL_WATCH_SPREAD_MINUTES 60   /* Window each site's daily sync is jittered over */
+#define TILL_WATCH_MAX_LOAD 1.5        /* Load per CPU above which a scheduled sync waits */
+#define TILL_WATCH_DEFER_MINUTES 5     /* How often a waiting sync rechecks the load */
+#define TILL_WATCH_DEFER_MAX_MINUTES 60  /* Then it runs anyway */
+#define TILL_WATCH_RETRY_MINUTES 15    /* First serve-mode retry after a failed sync; doubles, plus jitter */
+#define TILL_SYNC_HISTORY "logs/sync-history.jsonl"  /* Relative to the Till directory */
+#define TILL_SYNC_INDEX "sync-index.json"  /* Rolling index of recent runs */
+#define TILL_SYNC_INDEX_RUNS 512       /* Runs kept in the index */
+#define TILL_SYNC_STATS_DAYS 30        /* Window for till watch --status statistics */
 
 /* Port Configuration */
 #define DEFAULT_PORT_BASE 8000
@@ -103,6 +137,17 @@
 /* JSON Configuration */
 #define JSON_INDENT 2
 #define JSON_MAX_SIZE 1048576  /* 1MB max JSON file */
+#define TILL_ARENA_CHUNK 65536         /* Bytes per JSON arena chunk */
+#define TILL_ARENA_DEPTH 8             /* Nested arena scopes that rewind separately */
+#define TILL_JSON_INDEX_MIN 16         /* Members before an object index hashes */
+
+/* Registry Files */
+#define TILL_REGISTRY_FILE "tekton/till-private.json"
+#define TILL_SNAPSHOT_FILE "tekton/till-private.snap"   /* Mapped copy, see till_snapshot.h */
+#define TILL_SNAPSHOT_MAGIC "TILLSNAP"                  /* 8 bytes, no NUL */
+#define TILL_SNAPSHOT_VERSION 1
+#define TILL_RUN_INDEX "run-index.json"                 /* Cached till run command index */
+#define TILL_RUN_INDEX_VERSION 1
 
 /* Git Commands */
 #define GIT_CMD "git"
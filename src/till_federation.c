@@ -13,8 +13,10 @@
 #include <errno.h>
 
 #include "till_federation.h"
+#include "till_federation_transport.h"
 #include "till_config.h"
 #include "till_common.h"
+#include "till_status.h"
 #include "cJSON.h"
 
 /* Get federation config path in Till installation directory */
@@ -25,6 +27,22 @@ static int get_federation_config_path(char *path, size_t size) {
     return 0;
 }
 
+/* Per-user federation state directory, created on demand */
+int get_federation_state_dir(char *path, size_t size, const char *subdir) {
+    const char *home = getenv("HOME");
+    if (!home) {
+        return -1;
+    }
+    
+    if (subdir) {
+        snprintf(path, size, "%s/%s/%s", home, FEDERATION_STATE_DIR, subdir);
+    } else {
+        snprintf(path, size, "%s/%s", home, FEDERATION_STATE_DIR);
+    }
+    
+    return ensure_directory(path);
+}
+
 /* Check if federation is configured */
 int federation_is_joined(void) {
     char path[TILL_MAX_PATH];
@@ -76,6 +94,11 @@ int load_federation_config(federation_config_t *config) {
     strncpy(config->last_menu_date, last_menu, sizeof(config->last_menu_date) - 1);
 
     config->last_sync = (time_t)json_get_int(json, "last_sync", 0);
+    
+    const char *push_hash = json_get_string(json, "last_push_hash", "");
+    strncpy(config->last_push_hash, push_hash, sizeof(config->last_push_hash) - 1);
+    config->last_push = (time_t)json_get_int(json, "last_push", 0);
+    config->last_full_push = (time_t)json_get_int(json, "last_full_push", 0);
 
     /* Check both sync_enabled (new) and auto_sync (old) */
     if (cJSON_HasObjectItem(json, "sync_enabled")) {
@@ -106,6 +129,9 @@ int save_federation_config(const federation_config_t *config) {
     cJSON_AddNumberToObject(json, "last_sync", (double)config->last_sync);
     cJSON_AddBoolToObject(json, "auto_sync", config->auto_sync);
     cJSON_AddStringToObject(json, "last_menu_date", config->last_menu_date);
+    cJSON_AddStringToObject(json, "last_push_hash", config->last_push_hash);
+    cJSON_AddNumberToObject(json, "last_push", (double)config->last_push);
+    cJSON_AddNumberToObject(json, "last_full_push", (double)config->last_full_push);
     
     int result = save_json_file(path, json);
     cJSON_Delete(json);
@@ -351,7 +377,6 @@ static int create_manifest_json(char *json_out, size_t size, const federation_co
 /* Join the federation */
 int till_federate_join(const char *trust_level) {
     federation_config_t config = {0};
-    char token[256] = {0};
 
     /* Check if already joined */
     if (federation_is_joined()) {
@@ -393,8 +418,8 @@ int till_federate_join(const char *trust_level) {
 
     /* Named and Trusted need GitHub authentication via gh CLI */
     printf("Checking GitHub authentication...\n");
-    if (get_github_token(token, sizeof(token)) != 0) {
-        /* Error messages already printed by get_github_token */
+    if (federation_gists()->check_auth() != 0) {
+        /* Error messages already printed by the transport */
         return -1;
     }
 
@@ -453,34 +478,61 @@ int till_federate_leave(int delete_gist) {
     
     printf("Leaving federation...\n");
     
-    /* Delete gist if requested */
-    if (delete_gist && strlen(config.gist_id) > 0) {
+    /* Queue the delete; once the configuration is gone, queued statuses and
+     * reports for this site are dropped instead of being sent first */
+    int delete_queued = delete_gist && strlen(config.gist_id) > 0 &&
+                        federation_outbox_delete(config.gist_id) == 0;
+    
+    /* Remove global configuration */
+    char path[TILL_MAX_PATH];
+    if (get_federation_config_path(path, sizeof(path)) != 0 || unlink(path) != 0) {
+        till_error("Failed to remove federation configuration");
+        return -1;
+    }
+    
+    if (delete_queued) {
         printf("  Deleting gist: %s\n", config.gist_id);
-
-        /* Try to delete gist (will get token internally) */
-        if (delete_federation_gist(config.gist_id) == 0) {
+        if (federation_check_connectivity() &&
+            federation_outbox_flush_item("delete", config.gist_id) == 0) {
             printf("  ✓ Gist deleted\n");
         } else {
-            fprintf(stderr, "  Warning: Failed to delete gist\n");
-            fprintf(stderr, "  You may need to manually delete: https://gist.github.com/%s\n", config.gist_id);
+            fprintf(stderr, "  Warning: Gist not deleted yet - queued for the next federation command\n");
+            fprintf(stderr, "  Or delete it manually: https://gist.github.com/%s\n", config.gist_id);
         }
     }
     
-    /* Remove global configuration */
-    char path[TILL_MAX_PATH];
-    if (get_federation_config_path(path, sizeof(path)) == 0) {
-        if (unlink(path) == 0) {
-            printf("✓ Left federation successfully\n");
-            return 0;
-        }
-    }
+    printf("✓ Left federation successfully\n");
+    return 0;
+}
+
+/* Federation membership as a status model section */
+cJSON *till_federate_status_model(void) {
+    cJSON *model = cJSON_CreateObject();
+    federation_config_t config;
     
-    till_error("Failed to remove federation configuration");
-    return -1;
+    int joined = federation_is_joined() && load_federation_config(&config) == 0;
+    cJSON_AddBoolToObject(model, "joined", joined);
+    if (joined) {
+        cJSON_AddStringToObject(model, "site_id", config.site_id);
+        cJSON_AddStringToObject(model, "trust_level", config.trust_level);
+        cJSON_AddStringToObject(model, "gist_id", config.gist_id);
+        cJSON_AddNumberToObject(model, "last_sync", (double)config.last_sync);
+        cJSON_AddBoolToObject(model, "auto_sync", config.auto_sync);
+        cJSON_AddNumberToObject(model, "last_push", (double)config.last_push);
+        cJSON_AddNumberToObject(model, "last_full_push", (double)config.last_full_push);
+        cJSON_AddStringToObject(model, "last_push_hash", config.last_push_hash);
+        cJSON_AddStringToObject(model, "last_menu_date", config.last_menu_date);
+    }
+    cJSON_AddNumberToObject(model, "outbox_pending", federation_outbox_pending());
+    return model;
 }
 
 /* Show federation status */
 int till_federate_status(void) {
+    if (g_output != TILL_OUTPUT_TEXT) {
+        return till_status_show(STATUS_FEDERATION);
+    }
+    
     if (!federation_is_joined()) {
         printf("Federation Status: Not Joined\n");
         printf("\nTo join the federation, use:\n");
@@ -516,6 +568,12 @@ int till_federate_status(void) {
     
     printf("Auto Sync:   %s\n", config.auto_sync ? "Enabled" : "Disabled");
     
+    if (config.last_full_push > 0) {
+        char time_str[64];
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&config.last_full_push));
+        printf("Last Push:   %s (status %s)\n", time_str, config.last_push_hash);
+    }
+    
     if (strlen(config.last_menu_date) > 0) {
         printf("Last Menu:   %s\n", config.last_menu_date);
     }
@@ -523,6 +581,55 @@ int till_federate_status(void) {
     return 0;
 }
 
+/* Send all report_back results in one gist update */
+static void report_directive_results(const federation_config_t *config, const menu_t *menu,
+                                     const directive_result_t *results, int count) {
+    if (config->gist_id[0] == '\0' || strcmp(config->trust_level, TRUST_ANONYMOUS) == 0) {
+        return;  /* Nowhere to report to */
+    }
+
+    cJSON *report = cJSON_CreateObject();
+    cJSON_AddStringToObject(report, "site_id", config->site_id);
+    cJSON_AddStringToObject(report, "menu_date", menu->date);
+    cJSON_AddNumberToObject(report, "reported_at", (double)time(NULL));
+    cJSON *list = cJSON_AddArrayToObject(report, "results");
+
+    int reported = 0;
+    for (int i = 0; i < count; i++) {
+        const directive_result_t *r = &results[i];
+        if (!r->directive->report_back) {
+            continue;
+        }
+
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "id", r->directive->id);
+        cJSON_AddStringToObject(item, "status", r->status == 0 ? "ok" :
+                                r->status == DIRECTIVE_TIMED_OUT ? "timeout" : "failed");
+        cJSON_AddNumberToObject(item, "exit_code", r->exit_code);
+        cJSON_AddNumberToObject(item, "duration", r->duration);
+        cJSON_AddStringToObject(item, "output", r->output);
+        cJSON_AddItemToArray(list, item);
+        reported++;
+    }
+
+    char *json = reported ? cJSON_Print(report) : NULL;
+    cJSON_Delete(report);
+    if (!json) {
+        return;
+    }
+
+    /* Results queued earlier but not yet sent are merged in */
+    int queued = federation_outbox_report(config->site_id, json);
+    free(json);
+    if (queued != 0) {
+        fprintf(stderr, "Warning: Failed to queue directive results\n");
+    } else if (!federation_check_connectivity()) {
+        printf("  GitHub unreachable - %d directive result(s) queued\n", reported);
+    } else {
+        federation_outbox_flush();
+    }
+}
+
 /* Pull updates from federation (menu-of-the-day) */
 int till_federate_pull(void) {
     if (!federation_is_joined()) {
@@ -537,21 +644,76 @@ int till_federate_pull(void) {
     }
     
     printf("Pulling federation updates...\n");
-    
-    /* TODO: Implement menu-of-the-day fetching */
     printf("  Checking for menu-of-the-day...\n");
-    printf("  (Menu fetching not yet implemented)\n");
-    
-    /* For now, just update last sync time */
+
+    menu_t menu;
+    if (fetch_menu_of_the_day(&menu) != 0) {
+        return -1;
+    }
+
+    printf("  Menu %s (version %s): %d directive(s)\n",
+           menu.date[0] ? menu.date : "(undated)",
+           menu.version[0] ? menu.version : "-", menu.directive_count);
+
+    for (int i = 0; i < menu.announcement_count; i++) {
+        printf("  ▸ %s\n", menu.announcements[i]);
+    }
+
+    /* Everything due this sync runs as one batch */
+    const directive_t **pending = calloc(menu.directive_count + 1, sizeof(directive_t *));
+    directive_result_t *results = calloc(menu.directive_count + 1, sizeof(directive_result_t));
+    int count = 0;
+    int failed = 0;
+
+    for (int i = 0; pending && results && i < menu.directive_count; i++) {
+        const directive_t *d = &menu.directives[i];
+        if (!is_directive_completed(d->id) && evaluate_directive_condition(d)) {
+            pending[count++] = d;
+        }
+    }
+
+    if (count > 0) {
+        failed = execute_directives(pending, count, results);
+
+        for (int i = 0; i < count; i++) {
+            const directive_result_t *r = &results[i];
+            if (r->status == 0) {
+                printf("  ✓ %s (%.1fs)\n", r->directive->id, r->duration);
+                mark_directive_completed(r->directive->id);
+            } else if (r->status == DIRECTIVE_TIMED_OUT) {
+                fprintf(stderr, "  ✗ %s timed out after %.0fs\n", r->directive->id, r->duration);
+            } else {
+                fprintf(stderr, "  ✗ %s failed (exit %d): %s\n",
+                        r->directive->id, r->exit_code, r->output);
+            }
+        }
+        printf("  Directives: %d applied, %d failed\n", count - failed, failed);
+
+        report_directive_results(&config, &menu, results, count);
+    }
+    free(pending);
+    free(results);
+
+    if (menu.date[0]) {
+        snprintf(config.last_menu_date, sizeof(config.last_menu_date), "%s", menu.date);
+    }
     config.last_sync = time(NULL);
     save_federation_config(&config);
-    
+    free_menu(&menu);
+
     printf("✓ Pull complete\n");
-    return 0;
+    return failed ? -1 : 0;
 }
 
-/* Push status to federation gist */
-int till_federate_push(void) {
+/* Push status to federation gist
+ *
+ * Only a material change (anything but uptime/last_sync) triggers a full
+ * status upload. An unchanged status is skipped entirely until a heartbeat
+ * is due, and then only a small heartbeat document is sent, so the admin
+ * report keeps the site active without re-uploading identical data. A
+ * full status the admin hasn't read yet gets the new last_sync instead
+ * of being replaced by the heartbeat. */
+int till_federate_push(int force) {
     if (!federation_is_joined()) {
         till_error("Not joined to federation. Use 'till federate join' first");
         return -1;
@@ -570,16 +732,10 @@ int till_federate_push(void) {
     }
     
     printf("Pushing status to federation...\n");
-
-    /* Check GitHub authentication */
-    char token[256];
-    if (get_github_token(token, sizeof(token)) != 0) {
-        /* Error messages already printed by get_github_token */
-        return -1;
-    }
     
     /* Collect system status */
     federation_status_t status;
+    memset(&status, 0, sizeof(status));
     if (collect_system_status(&status) != 0) {
         till_error("Failed to collect system status");
         return -1;
@@ -589,39 +745,57 @@ int till_federate_push(void) {
     strncpy(status.site_id, config.site_id, sizeof(status.site_id) - 1);
     strncpy(status.trust_level, config.trust_level, sizeof(status.trust_level) - 1);
     
+    /* Decide between full push, heartbeat, or nothing */
+    char hash[sizeof(config.last_push_hash)];
+    status_content_hash(&status, hash, sizeof(hash));
+    
+    time_t now = time(NULL);
+    int changed = strcmp(hash, config.last_push_hash) != 0;
+    int full_due = now - config.last_full_push >= FEDERATION_FULL_PUSH_HOURS * 3600;
+    int heartbeat_due = now - config.last_push >= FEDERATION_HEARTBEAT_HOURS * 3600;
+    
+    if (!force && !changed && !heartbeat_due) {
+        printf("  Status unchanged since last push - nothing to send\n");
+        free_system_status(&status);
+        return 0;
+    }
+    
+    int heartbeat = !force && !changed && !full_due;
+    
     /* Create status JSON */
-    char json[4096];
-    if (create_status_json(&status, json, sizeof(json)) != 0) {
+    char *document = heartbeat ? create_heartbeat_json(&status, hash)
+                               : create_status_json(&status);
+    char *json = document ? pack_status_json(document) : NULL;
+    free(document);
+    free_system_status(&status);
+    if (!json) {
         till_error("Failed to create status JSON");
         return -1;
     }
     
-    /* Create or update gist */
-    if (strlen(config.gist_id) == 0) {
-        /* Need to create gist */
-        printf("  Creating GitHub gist...\n");
-        if (create_federation_gist(config.site_id, config.gist_id, sizeof(config.gist_id)) != 0) {
-            till_error("Failed to create gist");
-            return -1;
-        }
-        printf("  Created gist: %s\n", config.gist_id);
-
-        /* Save config with new gist ID */
-        save_federation_config(&config);
+    /* Queue first so the status survives an unreachable API; it replaces any older one */
+    int queued = federation_outbox_status(config.site_id, json, hash, heartbeat);
+    free(json);
+    if (queued != 0) {
+        till_error("Failed to queue status");
+        return -1;
     }
     
-    /* Update gist with current status */
-    printf("  Updating gist status...\n");
-    if (update_federation_gist(config.gist_id, json) != 0) {
-        till_error("Failed to update gist");
-        return -1;
+    if (!federation_check_connectivity()) {
+        printf("  GitHub unreachable - status queued for the next sync (%d pending)\n",
+               federation_outbox_pending());
+        printf("  If this persists, check: gh auth status\n");
+        return 0;
     }
     
-    /* Update last sync time */
-    config.last_sync = time(NULL);
-    save_federation_config(&config);
+    if (federation_outbox_flush_item("status", config.site_id) != 0) {
+        till_error("Failed to update gist - status kept in the outbox");
+        return -1;
+    }
     
-    printf("✓ Push complete\n");
+    /* The flush may have recreated the gist */
+    load_federation_config(&config);
+    printf("✓ Push complete%s\n", heartbeat ? " (heartbeat)" : "");
     printf("  Gist: https://gist.github.com/%s\n", config.gist_id);
     return 0;
 }
@@ -642,6 +816,12 @@ int till_federate_sync(void) {
     printf("Starting federation sync...\n");
     printf("========================\n\n");
     
+    /* Decide once whether GitHub is usable; nothing below waits on it if not */
+    if (!federation_check_connectivity()) {
+        printf("GitHub unreachable - gist updates will be queued (%d pending)\n\n",
+               federation_outbox_pending());
+    }
+    
     /* Step 1: Pull updates */
     printf("Step 1: Pulling menu-of-the-day...\n");
     if (till_federate_pull() != 0) {
@@ -651,7 +831,7 @@ int till_federate_sync(void) {
     /* Step 2: Push status (if not anonymous) */
     if (strcmp(config.trust_level, TRUST_ANONYMOUS) != 0) {
         printf("\nStep 2: Pushing status...\n");
-        if (till_federate_push() != 0) {
+        if (till_federate_push(0) != 0) {
             fprintf(stderr, "Warning: Push failed\n");
         }
     } else {
@@ -673,6 +853,9 @@ int cmd_federate(int argc, char *argv[]) {
         printf("  leave     Leave the federation\n");
         printf("  status    Show current federation status\n");
         printf("  set       Set federation configuration values\n");
+        printf("  pull      Fetch menu of the day and apply directives\n");
+        printf("  push      Publish status (skipped when unchanged)\n");
+        printf("  sync      Pull, then push\n");
         printf("  menu      Manage menu of the day\n");
         printf("  help      Show detailed help message\n\n");
         printf("Quick Examples:\n");
@@ -718,6 +901,7 @@ int cmd_federate(int argc, char *argv[]) {
         return till_federate_leave(delete_gist);
     }
     else if (strcmp(subcmd, "status") == 0) {
+        till_output_parse(argc, argv);
         return till_federate_status();
     }
     else if (strcmp(subcmd, "set") == 0) {
@@ -738,6 +922,25 @@ int cmd_federate(int argc, char *argv[]) {
         extern int cmd_menu(int argc, char **argv);
         return cmd_menu(argc - 1, argv + 1);
     }
+    else if (strcmp(subcmd, "push") == 0) {
+        int force = 0;
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--force") == 0) {
+                force = 1;
+            }
+        }
+        return till_federate_push(force);
+    }
+    else if (strcmp(subcmd, "pull") == 0) {
+        return till_federate_pull();
+    }
+    else if (strcmp(subcmd, "sync") == 0) {
+        return till_federate_sync();
+    }
+    else if (strcmp(subcmd, "admin") == 0) {
+        /* Owner-only gist processing, not listed in help */
+        return till_federate_admin(argc, argv);
+    }
     else if (strcmp(subcmd, "--help") == 0 || strcmp(subcmd, "help") == 0) {
         // Show help
         printf("Till Federation Commands\n");
@@ -748,12 +951,17 @@ int cmd_federate(int argc, char *argv[]) {
         printf("  leave     Leave the federation\n");
         printf("  status    Show current federation status\n");
         printf("  set       Set federation configuration values\n");
+        printf("  pull      Fetch menu of the day and apply directives\n");
+        printf("  push      Publish status (skipped when unchanged)\n");
+        printf("  sync      Pull, then push\n");
         printf("  menu      Manage menu of the day\n");
         printf("  help      Show this help message\n\n");
         printf("Join Options:\n");
         printf("  anonymous         Join as anonymous (read-only)\n");
         printf("  named            Join as named member\n");
         printf("  trusted          Join as trusted member\n\n");
+        printf("Push Options:\n");
+        printf("  --force          Send full status even if unchanged\n\n");
         printf("Set Options:\n");
         printf("  site_id <id>     Set your unique site identifier\n");
         printf("  federation_mode  Set mode: anonymous, named, or trusted\n");
@@ -781,7 +989,7 @@ int cmd_federate(int argc, char *argv[]) {
             }
         } else {
             fprintf(stderr, "Error: Unknown federate command: %s\n", subcmd);
-            fprintf(stderr, "\nAvailable commands: join, leave, status, set, menu, help\n");
+            fprintf(stderr, "\nAvailable commands: join, leave, status, set, pull, push, sync, menu, help\n");
             fprintf(stderr, "Use 'till federate help' for usage information\n");
         }
         fflush(stderr);
@@ -26,8 +26,13 @@ typedef struct {
     time_t last_sync;            /* Last sync timestamp */
     int auto_sync;               /* Auto-sync enabled */
     char last_menu_date[32];     /* Date of last processed menu */
+    char last_push_hash[16];     /* Content hash of last full status pushed */
+    time_t last_push;            /* Last successful push (full or heartbeat) */
+    time_t last_full_push;       /* Last full status push */
 } federation_config_t;
 
+struct till_condition;
+
 /* Menu directive structure */
 typedef struct {
     char id[64];                 /* Unique directive ID */
@@ -37,8 +42,21 @@ typedef struct {
     char action[1024];           /* Command to execute */
     char priority[16];           /* low|medium|high|critical */
     int report_back;             /* Report results to gist */
+    int timeout;                 /* Seconds, 0 for the default */
+    struct till_condition *compiled;  /* Compiled condition, NULL if invalid */
 } directive_t;
 
+/* Outcome of running one directive */
+typedef struct {
+    const directive_t *directive;
+    int status;                  /* 0 ok, -1 failed, DIRECTIVE_TIMED_OUT */
+    int exit_code;
+    double duration;             /* Seconds */
+    char output[2048];           /* Combined stdout/stderr, truncated */
+} directive_result_t;
+
+#define DIRECTIVE_TIMED_OUT -2
+
 /* Menu of the day structure */
 typedef struct {
     char date[32];               /* Menu date */
@@ -60,11 +78,37 @@ typedef struct {
     time_t updated;              /* Last update timestamp */
 } manifest_t;
 
+/* Gist operation results */
+#define GIST_NOT_FOUND -2            /* Gist deleted (e.g. processed by admin) */
+#define GIST_NOT_MODIFIED -3         /* Conditional fetch matched */
+#define GIST_RATE_LIMITED -4         /* API refused for rate limiting */
+
 /* Main federation functions */
 int till_federate_join(const char *trust_level);
 int till_federate_leave(int delete_gist);
 int till_federate_status(void);
 int till_federate_set(const char *key, const char *value);
+int till_federate_pull(void);
+int till_federate_push(int force);
+int till_federate_sync(void);
+
+/* Outbox of gist operations waiting for GitHub (~/.till/federation/outbox).
+ * Items coalesce: one status and one merged report per site. */
+int federation_outbox_status(const char *site_id, const char *content,
+                             const char *hash, int heartbeat);
+int federation_outbox_report(const char *site_id, const char *content);
+int federation_outbox_delete(const char *gist_id);
+int federation_outbox_pending(void);
+int federation_outbox_flush(void);            /* Returns operations still queued */
+/* Flush, waiting out one already in progress; 0 once the op item for key
+ * has been sent, -1 while it is still queued */
+int federation_outbox_flush_item(const char *op, const char *key);
+
+/* 1 if GitHub is usable; the first success in a process flushes the outbox */
+int federation_check_connectivity(void);
+
+/* Per-user federation state (~/.till/federation[/subdir]), created on demand */
+int get_federation_state_dir(char *path, size_t size, const char *subdir);
 
 /* Configuration management */
 int load_federation_config(federation_config_t *config);
@@ -74,8 +118,11 @@ int federation_is_joined(void);
 
 /* Menu processing */
 int fetch_menu_of_the_day(menu_t *menu);
+void free_menu(menu_t *menu);
 int process_directive(const directive_t *directive, char *result, size_t result_size);
 int evaluate_condition(const char *condition);
+int evaluate_directive_condition(const directive_t *directive);
+int execute_directives(const directive_t **directives, int count, directive_result_t *results);
 int is_directive_completed(const char *directive_id);
 int mark_directive_completed(const char *directive_id);
 
@@ -90,17 +137,33 @@ typedef struct {
     time_t uptime;
     time_t last_sync;
     char trust_level[32];
+    int memory_mb;
+    int host_count;
+    int hold_count;              /* Holds still in force */
+    struct cJSON *installations; /* Per-installation summaries (owned) */
+    struct cJSON *hosts;         /* Per-host summaries (owned) */
 } federation_status_t;
 
 /* Gist management */
 int create_federation_gist(const char *site_id, char *gist_id, size_t gist_id_size);
 int update_federation_gist(const char *gist_id, const char *content);
+int update_federation_gist_file(const char *gist_id, const char *filename, const char *content);
 int delete_federation_gist(const char *gist_id);
 int fetch_federation_gist(const char *gist_id, char *content, size_t content_size);
+int fetch_gist_file(const char *gist_id, const char *filename, char **content);
+int read_gist_file(const char *gist_id, const char *filename, char **content);
+int valid_gist_id(const char *gist_id);
 
 /* Status collection */
 int collect_system_status(federation_status_t *status);
-int create_status_json(const federation_status_t *status, char *json, size_t json_size);
+void free_system_status(federation_status_t *status);
+char *create_status_json(const federation_status_t *status);
+int status_content_hash(const federation_status_t *status, char *hash, size_t hash_size);
+char *create_heartbeat_json(const federation_status_t *status, const char *hash);
+
+/* Status documents on the wire (compressed when large); callers free */
+char *pack_status_json(const char *json);
+char *unpack_status_json(const char *content);
 
 /* GitHub API */
 int github_api_call(const char *method, const char *url,
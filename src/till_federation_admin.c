@@ -8,14 +8,32 @@
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/wait.h>
 #include "till_federation.h"
+#include "till_federation_transport.h"
+#include "till_federation_stats.h"
 #include "till_common.h"
+#include "till_config.h"
+#include "till_constants.h"
+#include "till_progress.h"
+#include "till_arena.h"
 #include "cJSON.h"
 
 #define REPO_OWNER "ckoons"
 #define SECRET_GIST_DESC "Till Federation Admin Status (Private)"
 #define ADMIN_CONFIG_FILE "admin.json"
 
+/* Processing pipeline limits */
+#define ADMIN_MAX_GISTS 1000        /* Gists listed per run */
+#define ADMIN_WORKERS 8             /* Concurrent gist requests */
+#define ADMIN_DELETE_BATCH 25       /* Gists deleted per request batch */
+#define ADMIN_BACKOFF_SECONDS 2     /* Rate limit backoff, doubled per retry */
+
+/* Incremental report policy */
+#define ADMIN_SITE_RETENTION_DAYS 30           /* Drop sites silent this long */
+#define ADMIN_RUN_HISTORY 30                   /* Per-run summaries kept */
+
 /* Admin configuration structure */
 typedef struct {
     char secret_gist_id[64];
@@ -25,25 +43,10 @@ typedef struct {
 
 /* Verify current user is repo owner */
 static int verify_owner(void) {
-    FILE *fp;
-    char buffer[128];
-    char username[64] = {0};
+    char username[64];
     
     /* Get current GitHub username */
-    fp = popen("gh api user --jq .login 2>/dev/null", "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Error: Failed to get GitHub user\n");
-        return -1;
-    }
-    
-    if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        buffer[strcspn(buffer, "\n")] = '\0';
-        strncpy(username, buffer, sizeof(username) - 1);
-    }
-    
-    pclose(fp);
-    
-    if (strlen(username) == 0) {
+    if (federation_gists()->whoami(username, sizeof(username)) != 0) {
         fprintf(stderr, "Error: Not authenticated with GitHub CLI\n");
         fprintf(stderr, "Run: gh auth login\n");
         return -1;
@@ -118,7 +121,7 @@ static int save_admin_config(const admin_config_t *config) {
     
     char *json_str = cJSON_Print(json);
     fprintf(fp, "%s\n", json_str);
-    free(json_str);
+    cJSON_free(json_str);
     cJSON_Delete(json);
     
     fclose(fp);
@@ -127,87 +130,259 @@ static int save_admin_config(const admin_config_t *config) {
 
 /* Find or create secret gist */
 static int get_or_create_secret_gist(char *gist_id, size_t gist_id_size) {
-    FILE *fp;
-    char buffer[256];
-    
     /* First check if we have a saved gist ID */
     admin_config_t config;
     if (load_admin_config(&config) == 0 && strlen(config.secret_gist_id) > 0) {
-        /* Verify it still exists */
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd), "gh api gists/%s --jq .id 2>/dev/null", config.secret_gist_id);
-        fp = popen(cmd, "r");
-        if (fp) {
-            if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-                pclose(fp);
-                strncpy(gist_id, config.secret_gist_id, gist_id_size - 1);
-                return 0;
-            }
-            pclose(fp);
+        /* Verify it still exists (cached - the report read that follows is a 304) */
+        char *content;
+        int result = fetch_gist_file(config.secret_gist_id, "status.json", &content);
+        free(content);
+        if (result == 0) {
+            strncpy(gist_id, config.secret_gist_id, gist_id_size - 1);
+            return 0;
+        }
+        if (result != GIST_NOT_FOUND) {
+            fprintf(stderr, "Error: Cannot reach secret gist %s\n", config.secret_gist_id);
+            return -1;
         }
     }
     
     /* Create new secret gist */
     printf("Creating secret gist for admin status...\n");
     
-    /* Create status.json file directly */
-    const char *temp_file = "/tmp/status.json";
-    FILE *tf = fopen(temp_file, "w");
-    if (tf == NULL) {
-        fprintf(stderr, "Error: Failed to create temp file\n");
+    char new_id[64];
+    if (federation_gists()->create(SECRET_GIST_DESC, 0, "status.json",
+            "{\"last_processed\":null,\"total_sites\":0,\"sites\":{},\"statistics\":{}}",
+            new_id, sizeof(new_id)) != 0 || !valid_gist_id(new_id)) {
+        fprintf(stderr, "Error: Failed to create secret gist\n");
         return -1;
     }
     
-    fprintf(tf, "{\"last_processed\":null,\"total_sites\":0,\"sites\":{},\"statistics\":{}}");
-    fclose(tf);
+    strncpy(gist_id, new_id, gist_id_size - 1);
+    gist_id[gist_id_size - 1] = '\0';
     
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd),
-        "gh gist create %s --desc \"%s\" 2>/dev/null | head -1",  /* secret is default */
-        temp_file, SECRET_GIST_DESC);
+    /* Save for future use */
+    strncpy(config.secret_gist_id, gist_id, sizeof(config.secret_gist_id) - 1);
+    save_admin_config(&config);
     
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Error: Failed to create secret gist\n");
-        unlink(temp_file);
+    printf("Created secret gist: %s\n", gist_id);
+    return 0;
+}
+
+/*
+ * Admin processing pipeline
+ *
+ * Stage 1 fetches every listed gist with a bounded pool of workers,
+ * stage 2 parses and aggregates the results sequentially in list order
+ * (so the report is identical to a serial run), and stage 3 deletes the
+ * fetched gists in batches (with gh, one shell per batch instead of one
+ * per gist).
+ */
+
+/* One listed federation gist moving through the pipeline */
+typedef struct {
+    char gist_id[64];
+    char *content;              /* status.json body, NULL until fetched */
+    int fetched;                /* the transport returned the gist */
+    int rate_limited;           /* gave up after repeated rate limiting */
+    int deleted;                /* removed in the delete stage */
+} admin_gist_t;
+
+typedef struct admin_pool admin_pool_t;
+typedef void (*admin_job_fn)(admin_pool_t *pool, int job);
+
+/* Work queue shared by the fetch and delete workers */
+struct admin_pool {
+    admin_gist_t *gists;
+    int *order;                 /* gist indices for batched jobs */
+    int order_count;
+    int job_count;
+    int next_job;
+    int jobs_done;
+    int task;                   /* progress display for this stage */
+    time_t backoff_until;       /* all workers pause until this time */
+    admin_job_fn job;
+    pthread_mutex_t mutex;
+};
+
+/* Sleep until any pool-wide backoff has expired */
+static void admin_wait_backoff(admin_pool_t *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    time_t until = pool->backoff_until;
+    pthread_mutex_unlock(&pool->mutex);
+
+    time_t now = time(NULL);
+    if (until > now) {
+        sleep((unsigned int)(until - now));
+    }
+}
+
+/* Ask every worker to back off, doubling the delay per attempt */
+static void admin_set_backoff(admin_pool_t *pool, int attempt) {
+    time_t until = time(NULL) + (ADMIN_BACKOFF_SECONDS << attempt);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (until > pool->backoff_until) {
+        pool->backoff_until = until;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/* Fetch job: retrieve one gist's status.json */
+static void admin_fetch_job(admin_pool_t *pool, int job) {
+    admin_gist_t *gist = &pool->gists[job];
+
+    for (int attempt = 0; attempt <= MAX_RETRIES; attempt++) {
+        admin_wait_backoff(pool);
+
+        char *content;
+        int result = read_gist_file(gist->gist_id, "status.json", &content);
+        if (result == 0) {
+            gist->content = content;
+            gist->fetched = 1;
+            progress_task_add(pool->task, strlen(content), 0);
+            return;
+        }
+
+        if (result != GIST_RATE_LIMITED) {
+            return;
+        }
+        if (attempt == MAX_RETRIES) {
+            gist->rate_limited = 1;
+            return;
+        }
+        admin_set_backoff(pool, attempt);
+    }
+}
+
+/* Delete job: remove one batch of gists with a single request batch */
+static void admin_delete_job(admin_pool_t *pool, int job) {
+    char *ids[ADMIN_DELETE_BATCH];
+    int deleted[ADMIN_DELETE_BATCH];
+    int first = job * ADMIN_DELETE_BATCH;
+    int last = first + ADMIN_DELETE_BATCH;
+    if (last > pool->order_count) {
+        last = pool->order_count;
+    }
+
+    for (int i = first; i < last; i++) {
+        ids[i - first] = pool->gists[pool->order[i]].gist_id;
+    }
+
+    admin_wait_backoff(pool);
+
+    if (federation_gists()->remove(ids, last - first, deleted) <= 0) {
+        return;
+    }
+    for (int i = first; i < last; i++) {
+        if (deleted[i - first]) {
+            pool->gists[pool->order[i]].deleted = 1;
+        }
+    }
+}
+
+static void *admin_worker(void *arg) {
+    admin_pool_t *pool = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        int job = pool->next_job < pool->job_count ? pool->next_job++ : -1;
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (job < 0) {
+            break;
+        }
+        pool->job(pool, job);
+
+        char done[32];
+        pthread_mutex_lock(&pool->mutex);
+        snprintf(done, sizeof(done), "%d/%d", ++pool->jobs_done, pool->job_count);
+        pthread_mutex_unlock(&pool->mutex);
+        progress_task_state(pool->task, done);
+    }
+    return NULL;
+}
+
+/* Run job_count jobs on at most ADMIN_WORKERS threads */
+static void admin_run_pool(admin_pool_t *pool, const char *label, admin_job_fn job, int job_count) {
+    pthread_t threads[ADMIN_WORKERS];
+    int workers = job_count < ADMIN_WORKERS ? job_count : ADMIN_WORKERS;
+    int started = 0;
+
+    pool->job = job;
+    pool->job_count = job_count;
+    pool->next_job = 0;
+    pool->jobs_done = 0;
+    pool->task = progress_task_begin(label);
+
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, admin_worker, pool) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    /* No threads available - drain the queue on this one */
+    if (started == 0) {
+        admin_worker(pool);
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    progress_task_end(pool->task, 1);
+}
+
+/* List federation status gists owned by the current user */
+static int admin_list_gists(admin_gist_t **gists_out) {
+    char **ids;
+    int count;
+
+    *gists_out = NULL;
+    if (federation_gists()->list("Till Federation Status", ADMIN_MAX_GISTS, &ids, &count) != 0) {
         return -1;
     }
-    
-    /* Read first line which contains the URL */
-    if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        /* Remove newline */
-        buffer[strcspn(buffer, "\n")] = '\0';
-        
-        /* Check if it's a URL */
-        if (strstr(buffer, "https://gist.github.com/") != NULL) {
-            /* Extract gist ID from URL */
-            char *id = strrchr(buffer, '/');
-            if (id) {
-                id++;
-                strncpy(gist_id, id, gist_id_size - 1);
-                gist_id[gist_id_size - 1] = '\0';
-                
-                /* Save for future use */
-                strncpy(config.secret_gist_id, gist_id, sizeof(config.secret_gist_id) - 1);
-                save_admin_config(&config);
-                
-                pclose(fp);
-                unlink(temp_file);
-                printf("Created secret gist: %s\n", gist_id);
-                return 0;
-            }
+
+    admin_gist_t *gists = calloc(count > 0 ? count : 1, sizeof(admin_gist_t));
+    for (int i = 0; i < count; i++) {
+        if (gists) {
+            strncpy(gists[i].gist_id, ids[i], sizeof(gists[i].gist_id) - 1);
         }
-        fprintf(stderr, "Error: Unexpected output: %s\n", buffer);
-    } else {
-        fprintf(stderr, "Error: No output from gist create command\n");
+        free(ids[i]);
+    }
+    free(ids);
+
+    if (gists == NULL) {
+        return -1;
+    }
+    *gists_out = gists;
+    return count;
+}
+
+/* Fetch the admin report from the secret gist (revalidated by ETag).
+ * Returns 0 with *report NULL when there is no usable previous report,
+ * -1 if the gist could not be read at all. */
+static int admin_fetch_report(const char *secret_gist_id, cJSON **report) {
+    char *content;
+    
+    *report = NULL;
+    if (fetch_gist_file(secret_gist_id, "status.json", &content) != 0) {
+        return -1;
     }
     
-    unlink(temp_file);
-    return -1;
+    *report = cJSON_Parse(content);
+    free(content);
+    return 0;
 }
 
 /* Process all federation gists */
 int till_federate_admin_process(void) {
+    /* Fail fast rather than stall on every gh call; also sends queued deletes */
+    if (!federation_check_connectivity()) {
+        fprintf(stderr, "Error: GitHub API unreachable or rate limited - try again later\n");
+        return -1;
+    }
+    
     if (verify_owner() != 0) {
         return -1;
     }
@@ -222,224 +397,236 @@ int till_federate_admin_process(void) {
         return -1;
     }
     
-    printf("Using secret gist: %s\n\n", secret_gist_id);
+    printf("Using secret gist: %s\n", secret_gist_id);
+    
+    /* Start from the previous report so sites that stay quiet are kept */
+    cJSON *previous;
+    if (admin_fetch_report(secret_gist_id, &previous) != 0) {
+        fprintf(stderr, "Error: Failed to read previous report from secret gist\n");
+        return -1;
+    }
+    
+    federation_stats_t fed_stats;
+    federation_stats_init(&fed_stats);
+    
+    cJSON *runs = NULL;
+    if (previous) {
+        int carried = federation_stats_load_sites(&fed_stats,
+                                                  cJSON_GetObjectItem(previous, "sites"));
+        printf("Loaded %d sites from previous report\n", carried);
+        runs = cJSON_DetachItemFromObject(previous, "runs");
+        cJSON_Delete(previous);
+    } else {
+        printf("No previous report - starting a new one\n");
+    }
+    if (!cJSON_IsArray(runs)) {
+        cJSON_Delete(runs);
+        runs = cJSON_CreateArray();
+    }
+    printf("\n");
     
     /* Find all Till Federation gists */
     printf("Searching for Till Federation gists...\n");
     
-    FILE *fp;
-    char cmd[512];
-    char buffer[256];
+    admin_gist_t *gists;
+    int total_found = admin_list_gists(&gists);
+    if (total_found < 0) {
+        fprintf(stderr, "Error: Failed to list gists\n");
+        federation_stats_free(&fed_stats);
+        cJSON_Delete(runs);
+        return -1;
+    }
     
-    /* Create aggregated data */
-    cJSON *report = cJSON_CreateObject();
-    cJSON_AddStringToObject(report, "last_processed", "");
-    cJSON_AddNumberToObject(report, "total_sites", 0);
-    cJSON *sites = cJSON_CreateObject();
-    cJSON_AddItemToObject(report, "sites", sites);
-    cJSON *stats = cJSON_CreateObject();
-    cJSON_AddItemToObject(report, "statistics", stats);
-    cJSON *malformed = cJSON_CreateArray();
-    cJSON_AddItemToObject(report, "malformed", malformed);
+    /* Stage 1: fetch concurrently */
+    admin_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.gists = gists;
+    pthread_mutex_init(&pool.mutex, NULL);
+    
+    if (total_found > 0) {
+        printf("Fetching %d gists (%d workers)...\n", total_found,
+               total_found < ADMIN_WORKERS ? total_found : ADMIN_WORKERS);
+        admin_run_pool(&pool, "Fetching gists", admin_fetch_job, total_found);
+    }
     
     /* Statistics tracking */
-    int total_found = 0;
     int total_processed = 0;
     int total_malformed = 0;
     int total_deleted = 0;
+    int total_deferred = 0;
     
-    cJSON *by_platform = cJSON_CreateObject();
-    cJSON *by_trust = cJSON_CreateObject();
-    int active_24h = 0;
-    int active_7d = 0;
+    /* From here to the saved report every tree is built and dropped in
+     * one arena scope; each gist's status gets a scope of its own, so
+     * the arena stays the size of the largest status, not all of them */
+    till_arena_begin();
+    cJSON *malformed = cJSON_CreateArray();
     
     time_t now = time(NULL);
     
-    /* Get list of gists */
-    snprintf(cmd, sizeof(cmd), 
-        "gh gist list --limit 1000 2>/dev/null | grep 'Till Federation Status' | cut -f1");
-    
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Error: Failed to list gists\n");
-        cJSON_Delete(report);
-        return -1;
-    }
-    
-    /* Process each gist */
-    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        buffer[strcspn(buffer, "\n")] = '\0';
-        if (strlen(buffer) == 0) continue;
+    /* Stage 2: parse and aggregate in list order */
+    for (int i = 0; i < total_found; i++) {
+        const char *gist_id = gists[i].gist_id;
+        printf("  Processing gist %s...", gist_id);
         
-        total_found++;
-        printf("  Processing gist %s...", buffer);
-        
-        /* Fetch gist content */
-        char fetch_cmd[512];
-        snprintf(fetch_cmd, sizeof(fetch_cmd),
-            "gh api gists/%s --jq '.files.\"status.json\".content' 2>/dev/null", buffer);
-        
-        FILE *content_fp = popen(fetch_cmd, "r");
-        if (content_fp == NULL) {
-            printf(" FAILED\n");
-            total_malformed++;
-            
-            cJSON *mal = cJSON_CreateObject();
-            cJSON_AddStringToObject(mal, "gist_id", buffer);
-            cJSON_AddStringToObject(mal, "error", "Failed to fetch");
-            cJSON_AddItemToArray(malformed, mal);
+        if (!gists[i].fetched) {
+            /* Left in place so the next run can pick it up */
+            printf(gists[i].rate_limited ? " RATE LIMITED\n" : " FAILED\n");
+            total_deferred++;
             continue;
         }
         
-        /* Read content */
-        char content[8192] = {0};
-        size_t total_read = 0;
-        while (fgets(content + total_read, sizeof(content) - total_read, content_fp) != NULL) {
-            total_read = strlen(content);
-            if (total_read >= sizeof(content) - 1) break;
+        /* Parse JSON - large statuses arrive gzip+base64'd */
+        federation_site_t site;
+        char hostname[128] = "";
+        till_arena_begin();
+        char *text = unpack_status_json(gists[i].content);
+        cJSON *status = text ? cJSON_Parse(text) : NULL;
+        free(text);
+        int parsed = status != NULL;
+        int valid = parsed && federation_site_from_json(status, &site) == 0;
+        if (parsed && !valid) {
+            snprintf(hostname, sizeof(hostname), "%s", json_get_string(status, "hostname", ""));
         }
-        pclose(content_fp);
+        cJSON_Delete(status);
+        till_arena_end();
         
-        /* Parse JSON */
-        cJSON *status = cJSON_Parse(content);
-        if (status == NULL) {
-            printf(" MALFORMED\n");
-            total_malformed++;
-            
-            cJSON *mal = cJSON_CreateObject();
-            cJSON_AddStringToObject(mal, "gist_id", buffer);
-            cJSON_AddStringToObject(mal, "error", "Invalid JSON");
-            cJSON_AddItemToArray(malformed, mal);
-        } else {
-            /* Extract data */
-            const char *site_id = cJSON_GetStringValue(cJSON_GetObjectItem(status, "site_id"));
-            const char *hostname = cJSON_GetStringValue(cJSON_GetObjectItem(status, "hostname"));
-            const char *platform = cJSON_GetStringValue(cJSON_GetObjectItem(status, "platform"));
-            const char *trust_level = cJSON_GetStringValue(cJSON_GetObjectItem(status, "trust_level"));
-            double last_sync = cJSON_GetNumberValue(cJSON_GetObjectItem(status, "last_sync"));
-            int inst_count = cJSON_GetNumberValue(cJSON_GetObjectItem(status, "installation_count"));
-            
-            if (site_id) {
-                printf(" OK (site: %s)\n", site_id);
-                total_processed++;
-                
-                /* Add to sites */
-                cJSON *site = cJSON_CreateObject();
-                cJSON_AddStringToObject(site, "hostname", hostname ? hostname : "unknown");
-                cJSON_AddStringToObject(site, "platform", platform ? platform : "unknown");
-                cJSON_AddStringToObject(site, "trust_level", trust_level ? trust_level : "unknown");
-                cJSON_AddNumberToObject(site, "last_sync", last_sync);
-                cJSON_AddNumberToObject(site, "installation_count", inst_count);
-                cJSON_AddStringToObject(site, "gist_id", buffer);
-                cJSON_AddNumberToObject(site, "processed_at", now);
-                cJSON_AddItemToObject(sites, site_id, site);
-                
-                /* Update statistics */
-                if (platform) {
-                    cJSON *plat_count = cJSON_GetObjectItem(by_platform, platform);
-                    if (plat_count) {
-                        int count = cJSON_GetNumberValue(plat_count);
-                        cJSON_DeleteItemFromObject(by_platform, platform);
-                        cJSON_AddNumberToObject(by_platform, platform, count + 1);
-                    } else {
-                        cJSON_AddNumberToObject(by_platform, platform, 1);
-                    }
-                }
-                
-                if (trust_level) {
-                    cJSON *trust_count = cJSON_GetObjectItem(by_trust, trust_level);
-                    if (trust_count) {
-                        int count = cJSON_GetNumberValue(trust_count);
-                        cJSON_DeleteItemFromObject(by_trust, trust_level);
-                        cJSON_AddNumberToObject(by_trust, trust_level, count + 1);
-                    } else {
-                        cJSON_AddNumberToObject(by_trust, trust_level, 1);
-                    }
-                }
-                
-                /* Check activity */
-                if (last_sync > 0) {
-                    if (now - last_sync < 86400) active_24h++;
-                    if (now - last_sync < 604800) active_7d++;
-                }
+        if (valid) {
+            snprintf(site.gist_id, sizeof(site.gist_id), "%s", gist_id);
+            site.processed_at = now;
+            int orphans = fed_stats.orphan_heartbeats;
+            federation_stats_add_site(&fed_stats, &site);
+            if (fed_stats.orphan_heartbeats > orphans) {
+                printf(" HEARTBEAT ONLY (site: %s, no full status yet)\n", site.site_id);
             } else {
-                printf(" MALFORMED (no site_id)\n");
-                total_malformed++;
-                
-                cJSON *mal = cJSON_CreateObject();
-                cJSON_AddStringToObject(mal, "gist_id", buffer);
-                cJSON_AddStringToObject(mal, "error", "Missing site_id");
-                if (hostname) cJSON_AddStringToObject(mal, "hostname", hostname);
-                cJSON_AddItemToArray(malformed, mal);
+                printf(" OK (site: %s)\n", site.site_id);
+                total_processed++;
             }
-            
-            cJSON_Delete(status);
+            continue;
         }
         
-        /* Delete the gist */
-        printf("    Deleting gist %s...", buffer);
-        char delete_cmd[512];
-        snprintf(delete_cmd, sizeof(delete_cmd), "gh gist delete %s 2>/dev/null", buffer);
-        if (system(delete_cmd) == 0) {
-            printf(" DELETED\n");
-            total_deleted++;
-        } else {
-            printf(" FAILED\n");
-        }
+        printf(parsed ? " MALFORMED (no site_id)\n" : " MALFORMED\n");
+        total_malformed++;
+        
+        cJSON *mal = cJSON_CreateObject();
+        cJSON_AddStringToObject(mal, "gist_id", gist_id);
+        cJSON_AddStringToObject(mal, "error", parsed ? "Missing site_id" : "Invalid JSON");
+        if (hostname[0]) cJSON_AddStringToObject(mal, "hostname", hostname);
+        cJSON_AddItemToArray(malformed, mal);
     }
     
-    pclose(fp);
+    /* Every gist read into the report is deleted once the report is
+     * saved - now, or from the outbox if the delete fails */
+    int total_fetched = 0;
+    for (int i = 0; i < total_found; i++) {
+        total_fetched += gists[i].fetched;
+    }
     
-    /* Update report metadata */
+    /* Build the report from the aggregated sites */
     char time_str[64];
     time_t process_time = time(NULL);
     strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%SZ", gmtime(&process_time));
-    cJSON_DeleteItemFromObject(report, "last_processed");
+    
+    /* Age out sites that have stopped reporting, then roll up the rest */
+    time_t cutoff = process_time - (time_t)ADMIN_SITE_RETENTION_DAYS * 86400;
+    int total_expired = federation_stats_expire(&fed_stats, cutoff);
+    federation_stats_rollup(&fed_stats, process_time);
+    
+    cJSON *report = cJSON_CreateObject();
     cJSON_AddStringToObject(report, "last_processed", time_str);
-    cJSON_DeleteItemFromObject(report, "total_sites");
-    cJSON_AddNumberToObject(report, "total_sites", total_processed);
-    
-    /* Add statistics */
-    cJSON_AddItemToObject(stats, "by_platform", by_platform);
-    cJSON_AddItemToObject(stats, "by_trust_level", by_trust);
-    cJSON_AddNumberToObject(stats, "active_last_24h", active_24h);
-    cJSON_AddNumberToObject(stats, "active_last_7d", active_7d);
+    cJSON_AddNumberToObject(report, "total_sites", fed_stats.sites.count);
+    cJSON_AddItemToObject(report, "sites", federation_stats_sites_json(&fed_stats));
+    
+    cJSON *stats = federation_stats_rollup_json(&fed_stats);
+    cJSON_AddItemToObject(report, "statistics", stats);
+    cJSON_AddItemToObject(report, "malformed", malformed);
+    
     cJSON_AddNumberToObject(stats, "total_found", total_found);
     cJSON_AddNumberToObject(stats, "total_processed", total_processed);
+    cJSON_AddNumberToObject(stats, "total_duplicates", fed_stats.duplicates);
+    cJSON_AddNumberToObject(stats, "total_orphan_heartbeats", fed_stats.orphan_heartbeats);
     cJSON_AddNumberToObject(stats, "total_malformed", total_malformed);
-    cJSON_AddNumberToObject(stats, "total_deleted", total_deleted);
+    cJSON_AddNumberToObject(stats, "total_deleted", total_fetched);
+    cJSON_AddNumberToObject(stats, "total_deferred", total_deferred);
+    cJSON_AddNumberToObject(stats, "total_expired", total_expired);
+    federation_stats_free(&fed_stats);
+    
+    /* Per-run history, newest first */
+    cJSON *run = cJSON_CreateObject();
+    cJSON_AddStringToObject(run, "processed", time_str);
+    cJSON_AddNumberToObject(run, "found", total_found);
+    cJSON_AddNumberToObject(run, "processed_sites", total_processed);
+    cJSON_AddNumberToObject(run, "malformed", total_malformed);
+    cJSON_AddNumberToObject(run, "deleted", total_fetched);
+    cJSON_AddNumberToObject(run, "expired", total_expired);
+    cJSON_InsertItemInArray(runs, 0, run);
+    while (cJSON_GetArraySize(runs) > ADMIN_RUN_HISTORY) {
+        cJSON_DeleteItemFromArray(runs, ADMIN_RUN_HISTORY);
+    }
+    cJSON_AddItemToObject(report, "runs", runs);
     
     /* Save to secret gist */
     printf("\nSaving report to secret gist...\n");
     char *report_json = cJSON_Print(report);
     
-    /* Create status.json file */
-    const char *temp_file = "/tmp/status.json";
-    FILE *tf = fopen(temp_file, "w");
-    if (tf == NULL) {
-        fprintf(stderr, "Error: Failed to create temp file\n");
-        free(report_json);
-        cJSON_Delete(report);
-        return -1;
-    }
-    
-    fprintf(tf, "%s", report_json);
-    fclose(tf);
+    int saved = report_json &&
+                update_federation_gist_file(secret_gist_id, "status.json", report_json) == 0;
     
-    /* Update gist - delete old file and add new one */
-    snprintf(cmd, sizeof(cmd),
-        "gh gist edit %s --add %s 2>/dev/null",
-        secret_gist_id, temp_file);
+    cJSON_free(report_json);
+    cJSON_Delete(report);
+    till_arena_end();
     
-    if (system(cmd) == 0) {
-        printf("✓ Report saved to secret gist\n");
-    } else {
-        fprintf(stderr, "Error: Failed to update secret gist\n");
+    if (!saved) {
+        /* Nothing deleted - the next run reads the same gists again */
+        fprintf(stderr, "Error: Failed to update secret gist - site gists kept\n");
+        for (int i = 0; i < total_found; i++) {
+            free(gists[i].content);
+        }
+        free(gists);
+        pthread_mutex_destroy(&pool.mutex);
+        return -1;
     }
+    printf("✓ Report saved to secret gist\n");
+    
+    /* Stage 3: with the report saved, delete everything we fetched, in batches */
+    int *order = malloc((total_found > 0 ? total_found : 1) * sizeof(int));
+    for (int round = 0; order != NULL && round <= MAX_RETRIES; round++) {
+        int pending = 0;
+        for (int i = 0; i < total_found; i++) {
+            if (gists[i].fetched && !gists[i].deleted) {
+                order[pending++] = i;
+            }
+        }
+        if (pending == 0) {
+            break;
+        }
+        
+        if (round == 0) {
+            printf("\nDeleting %d gists...\n", pending);
+        } else {
+            /* Failed deletes are usually rate limits - back off first */
+            printf("  Retrying %d deletes...\n", pending);
+            admin_set_backoff(&pool, round - 1);
+        }
+        
+        pool.order = order;
+        pool.order_count = pending;
+        admin_run_pool(&pool, "Deleting gists", admin_delete_job,
+                       (pending + ADMIN_DELETE_BATCH - 1) / ADMIN_DELETE_BATCH);
+    }
+    free(order);
     
-    unlink(temp_file);
-    free(report_json);
-    cJSON_Delete(report);
+    for (int i = 0; i < total_found; i++) {
+        if (gists[i].deleted) {
+            total_deleted++;
+        } else if (gists[i].fetched) {
+            /* Already counted - make sure the next run doesn't count it again */
+            printf("    Failed to delete gist %s (queued)\n", gists[i].gist_id);
+            federation_outbox_delete(gists[i].gist_id);
+        }
+        free(gists[i].content);
+    }
+    free(gists);
+    pthread_mutex_destroy(&pool.mutex);
     
     /* Update admin config */
     admin_config_t config;
@@ -452,13 +639,35 @@ int till_federate_admin_process(void) {
     printf("\n=== Process Summary ===\n");
     printf("Found:      %d gists\n", total_found);
     printf("Processed:  %d sites\n", total_processed);
+    printf("Expired:    %d sites (silent %d+ days)\n", total_expired, ADMIN_SITE_RETENTION_DAYS);
     printf("Malformed:  %d gists\n", total_malformed);
-    printf("Deleted:    %d gists\n", total_deleted);
+    printf("Deleted:    %d gists", total_deleted);
+    if (total_fetched > total_deleted) {
+        printf(" (%d queued for retry)", total_fetched - total_deleted);
+    }
+    printf("\n");
+    if (total_deferred > 0) {
+        printf("Deferred:   %d gists (fetch failed, kept for next run)\n", total_deferred);
+    }
     printf("Report:     Secret gist %s\n", secret_gist_id);
     
     return 0;
 }
 
+/* Print one statistics histogram, if the report has it */
+static void print_histogram(const char *title, cJSON *histogram) {
+    if (histogram == NULL) {
+        return;
+    }
+    
+    printf("%s:\n", title);
+    cJSON *item;
+    cJSON_ArrayForEach(item, histogram) {
+        printf("  %-10s: %d\n", item->string, (int)cJSON_GetNumberValue(item));
+    }
+    printf("\n");
+}
+
 /* Display admin status */
 int till_federate_admin_status(int full) {
     if (verify_owner() != 0) {
@@ -475,27 +684,12 @@ int till_federate_admin_status(int full) {
         return -1;
     }
     
-    /* Fetch secret gist content - skip first 2 lines (title and blank) */
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd), "gh gist view %s --filename status.json 2>/dev/null", config.secret_gist_id);
-    
-    FILE *fp = popen(cmd, "r");
-    if (fp == NULL) {
+    /* Fetch the report from the secret gist */
+    cJSON *report;
+    if (admin_fetch_report(config.secret_gist_id, &report) != 0) {
         fprintf(stderr, "Error: Failed to fetch secret gist\n");
         return -1;
     }
-    
-    /* Read content */
-    char content[32768] = {0};
-    size_t total_read = 0;
-    while (fgets(content + total_read, sizeof(content) - total_read, fp) != NULL) {
-        total_read = strlen(content);
-        if (total_read >= sizeof(content) - 1) break;
-    }
-    pclose(fp);
-    
-    /* Parse JSON */
-    cJSON *report = cJSON_Parse(content);
     if (report == NULL) {
         fprintf(stderr, "Error: Failed to parse admin status\n");
         return -1;
@@ -513,33 +707,24 @@ int till_federate_admin_status(int full) {
     if (stats) {
         printf("=== Statistics ===\n");
         
-        cJSON *by_platform = cJSON_GetObjectItem(stats, "by_platform");
-        if (by_platform) {
-            printf("By Platform:\n");
-            cJSON *item;
-            cJSON_ArrayForEach(item, by_platform) {
-                printf("  %-10s: %d\n", item->string, (int)cJSON_GetNumberValue(item));
-            }
-        }
-        
-        cJSON *by_trust = cJSON_GetObjectItem(stats, "by_trust_level");
-        if (by_trust) {
-            printf("\nBy Trust Level:\n");
-            cJSON *item;
-            cJSON_ArrayForEach(item, by_trust) {
-                printf("  %-10s: %d\n", item->string, (int)cJSON_GetNumberValue(item));
-            }
-        }
+        print_histogram("By Platform", cJSON_GetObjectItem(stats, "by_platform"));
+        print_histogram("By Trust Level", cJSON_GetObjectItem(stats, "by_trust_level"));
+        print_histogram("By Till Version", cJSON_GetObjectItem(stats, "by_till_version"));
+        print_histogram("By Installations", cJSON_GetObjectItem(stats, "by_installation_count"));
+        print_histogram("By CPU Count", cJSON_GetObjectItem(stats, "by_cpu_count"));
         
-        printf("\nActivity:\n");
+        printf("Activity:\n");
         printf("  Last 24h:   %d sites\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "active_last_24h")));
         printf("  Last 7d:    %d sites\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "active_last_7d")));
         
         printf("\nProcessing:\n");
         printf("  Found:      %d gists\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "total_found")));
         printf("  Processed:  %d sites\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "total_processed")));
+        printf("  Duplicates: %d reports\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "total_duplicates")));
+        printf("  Orphaned:   %d heartbeats (no full status yet)\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "total_orphan_heartbeats")));
         printf("  Malformed:  %d gists\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "total_malformed")));
         printf("  Deleted:    %d gists\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "total_deleted")));
+        printf("  Expired:    %d sites\n", (int)cJSON_GetNumberValue(cJSON_GetObjectItem(stats, "total_expired")));
     }
     
     /* Display full site list if requested */
@@ -0,0 +1,362 @@
+/*
+ * till_federation_directive.c - Menu directive processing for Till Federation
+ *
+ * Conditions and execution of the directives delivered by the menu
+ * of the day. Completion tracking lives in till_federation_journal.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "till_federation.h"
+#include "till_condition.h"
+#include "till_config.h"
+#include "till_constants.h"
+#include "till_common.h"
+#include "till_security.h"
+#include "till_progress.h"
+
+/* Facts are gathered once per process and shared by every condition */
+static till_facts_t facts;
+static int facts_loaded = 0;
+
+static const till_facts_t *directive_facts(void) {
+    if (!facts_loaded) {
+        federation_config_t config;
+        memset(&config, 0, sizeof(config));
+        load_federation_config(&config);
+        till_facts_collect(&facts, config.trust_level);
+        facts_loaded = 1;
+    }
+    return &facts;
+}
+
+/* Evaluate a condition expression once; 0 if it doesn't compile */
+int evaluate_condition(const char *condition) {
+    char error[256];
+    till_condition_t *cond = till_condition_compile(condition, error, sizeof(error));
+    if (!cond) {
+        till_warn("Invalid directive condition '%s': %s", condition, error);
+        return 0;
+    }
+
+    int result = till_condition_eval(cond, directive_facts());
+    till_condition_free(cond);
+    return result;
+}
+
+/* Evaluate a directive's precompiled condition */
+int evaluate_directive_condition(const directive_t *directive) {
+    if (!directive->compiled) {
+        return 0;  /* Failed to compile - never run it */
+    }
+    return till_condition_eval(directive->compiled, directive_facts());
+}
+
+/* Scheduling rank - lower runs first */
+static int priority_rank(const char *priority) {
+    if (strcmp(priority, "critical") == 0) return 0;
+    if (strcmp(priority, "high") == 0) return 1;
+    if (strcmp(priority, "low") == 0) return 3;
+    return 2;  /* medium, or unrecognized */
+}
+
+/* update/patch change their target, so only one runs per target at a time */
+static int is_exclusive(const directive_t *directive) {
+    return strcmp(directive->type, "update") == 0 || strcmp(directive->type, "patch") == 0;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Pipes must not leak into children forked by other workers, or their
+ * readers would never see EOF - create and fork under one lock */
+static pthread_mutex_t fork_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Run cmd in its own process group, killing the group at the timeout;
+ * output seen is counted against progress task */
+static void run_with_timeout(const char *cmd, int timeout, int task, directive_result_t *result) {
+    int fds[2];
+    size_t len = 0;
+
+    pthread_mutex_lock(&fork_lock);
+    if (pipe(fds) != 0) {
+        pthread_mutex_unlock(&fork_lock);
+        snprintf(result->output, sizeof(result->output), "pipe: %s", strerror(errno));
+        result->status = -1;
+        return;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        setpgid(0, 0);
+        int devnull = open("/dev/null", O_RDONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+        }
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    pthread_mutex_unlock(&fork_lock);
+
+    if (pid < 0) {
+        close(fds[0]);
+        snprintf(result->output, sizeof(result->output), "fork: %s", strerror(errno));
+        result->status = -1;
+        return;
+    }
+    setpgid(pid, pid);  /* Also here, so kill(-pid) works even if the child hasn't run yet */
+
+    double deadline = now_seconds() + timeout;
+    int timed_out = 0;
+    int open_output = 1;
+    int status = 0;
+
+    for (;;) {
+        int wait_ms = (int)((deadline - now_seconds()) * 1000);
+        if (wait_ms <= 0) {
+            timed_out = 1;
+            break;
+        }
+
+        if (!open_output) {
+            /* Output closed - wait for the exit, still bounded by the deadline */
+            pid_t done = waitpid(pid, &status, WNOHANG);
+            if (done == pid || (done < 0 && errno != EINTR)) {
+                break;
+            }
+            struct timespec pause = { 0, 10 * 1000 * 1000 };
+            nanosleep(&pause, NULL);
+            continue;
+        }
+
+        struct pollfd pfd = { fds[0], POLLIN, 0 };
+        if (poll(&pfd, 1, wait_ms) <= 0) {
+            continue;
+        }
+
+        char buf[4096];
+        ssize_t n = read(fds[0], buf, sizeof(buf));
+        if (n <= 0) {
+            open_output = 0;
+            continue;
+        }
+        size_t lines = 0;
+        for (ssize_t i = 0; i < n; i++) {
+            lines += buf[i] == '\n';
+        }
+        progress_task_add(task, (size_t)n, lines);
+        size_t keep = sizeof(result->output) - 1 - len;
+        if ((size_t)n < keep) keep = n;
+        memcpy(result->output + len, buf, keep);
+        len += keep;
+    }
+    result->output[len] = '\0';
+    close(fds[0]);
+
+    if (timed_out) {
+        kill(-pid, SIGKILL);
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+        result->status = DIRECTIVE_TIMED_OUT;
+        result->exit_code = -1;
+        return;
+    }
+
+    result->exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    result->status = result->exit_code == 0 ? 0 : -1;
+}
+
+static void run_directive(const directive_t *directive, directive_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    result->directive = directive;
+
+    if (directive->action[0] == '\0') {
+        snprintf(result->output, sizeof(result->output), "no action");
+        return;
+    }
+
+    int timeout = directive->timeout > 0 ? directive->timeout : FEDERATION_DIRECTIVE_TIMEOUT;
+    till_log(LOG_INFO, "Running directive %s (%s, %s, %ds): %s", directive->id,
+             directive->type, directive->priority, timeout, directive->action);
+
+    int task = progress_task_begin(directive->id);
+    progress_task_state(task, directive->type);
+
+    double start = now_seconds();
+    run_with_timeout(directive->action, timeout, task, result);
+    result->duration = now_seconds() - start;
+
+    progress_task_end(task, result->status == 0);
+
+    till_log(LOG_INFO, "Directive %s finished: status %d, exit %d, %.1fs", directive->id,
+             result->status, result->exit_code, result->duration);
+}
+
+/* Run a directive's action; result receives its output */
+int process_directive(const directive_t *directive, char *result, size_t result_size) {
+    directive_result_t outcome;
+
+    run_directive(directive, &outcome);
+    safe_strncpy(result, outcome.output, result_size);
+    return outcome.status == 0 ? 0 : -1;
+}
+
+/* Work queue shared by the executor threads */
+typedef struct {
+    const directive_t **directives;
+    directive_result_t *results;
+    int *order;                  /* Indices in scheduling order */
+    char *state;                 /* Per order slot: 0 waiting, 1 running, 2 done */
+    int count;
+    int waiting;
+    int critical_left;           /* Critical directives not yet finished */
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+} directive_queue_t;
+
+static const directive_queue_t *sort_queue;
+
+static int compare_order(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    int rx = priority_rank(sort_queue->directives[x]->priority);
+    int ry = priority_rank(sort_queue->directives[y]->priority);
+    return rx != ry ? rx - ry : x - y;  /* Stable within a priority */
+}
+
+/* Next slot that may start now, or -1; called with the mutex held */
+static int next_slot(const directive_queue_t *q) {
+    for (int i = 0; i < q->count; i++) {
+        if (q->state[i] != 0) {
+            continue;
+        }
+
+        const directive_t *d = q->directives[q->order[i]];
+        if (q->critical_left > 0 && priority_rank(d->priority) > 0) {
+            return -1;  /* Everything else waits for critical directives */
+        }
+
+        int busy = 0;
+        for (int j = 0; j < q->count && is_exclusive(d) && !busy; j++) {
+            const directive_t *other = q->directives[q->order[j]];
+            busy = q->state[j] == 1 && is_exclusive(other) &&
+                   strcmp(other->target, d->target) == 0;
+        }
+        if (!busy) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void *directive_worker(void *arg) {
+    directive_queue_t *q = arg;
+
+    pthread_mutex_lock(&q->mutex);
+    while (q->waiting > 0) {
+        int slot = next_slot(q);
+        if (slot < 0) {
+            pthread_cond_wait(&q->changed, &q->mutex);
+            continue;
+        }
+        q->state[slot] = 1;
+        q->waiting--;
+        pthread_mutex_unlock(&q->mutex);
+
+        int index = q->order[slot];
+        run_directive(q->directives[index], &q->results[index]);
+
+        pthread_mutex_lock(&q->mutex);
+        q->state[slot] = 2;
+        if (priority_rank(q->directives[index]->priority) == 0) {
+            q->critical_left--;
+        }
+        pthread_cond_broadcast(&q->changed);
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return NULL;
+}
+
+/*
+ * Run directives on a small thread pool. Critical directives all finish
+ * before anything else starts; the rest start in priority order as
+ * workers free up. results[i] is the outcome of directives[i].
+ */
+int execute_directives(const directive_t **directives, int count, directive_result_t *results) {
+    directive_queue_t q;
+    pthread_t threads[FEDERATION_DIRECTIVE_WORKERS];
+
+    if (count <= 0) {
+        return 0;
+    }
+
+    memset(&q, 0, sizeof(q));
+    q.directives = directives;
+    q.results = results;
+    q.count = count;
+    q.waiting = count;
+    q.order = malloc(count * sizeof(int));
+    q.state = calloc(count, 1);
+    if (!q.order || !q.state) {
+        free(q.order);
+        free(q.state);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        q.order[i] = i;
+        if (priority_rank(directives[i]->priority) == 0) {
+            q.critical_left++;
+        }
+    }
+    sort_queue = &q;
+    qsort(q.order, count, sizeof(int), compare_order);
+
+    pthread_mutex_init(&q.mutex, NULL);
+    pthread_cond_init(&q.changed, NULL);
+
+    int workers = count < FEDERATION_DIRECTIVE_WORKERS ? count : FEDERATION_DIRECTIVE_WORKERS;
+    int started = 0;
+    for (; started < workers; started++) {
+        if (pthread_create(&threads[started], NULL, directive_worker, &q) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        directive_worker(&q);  /* No threads - run them here, in order */
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&q.changed);
+    pthread_mutex_destroy(&q.mutex);
+    free(q.order);
+    free(q.state);
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].status != 0) {
+            failed++;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,346 @@
+/*
+ * till_federation_gh.c - Gist transport over the GitHub CLI
+ *
+ * Every gist operation runs a gh command. Request bodies go through a
+ * temp file (--input) rather than the command line, so content of any
+ * size and with any characters arrives intact. Gist ids are checked with
+ * valid_gist_id() before they are put in a command.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "till_federation.h"
+#include "till_federation_transport.h"
+#include "till_config.h"
+#include "till_constants.h"
+#include "till_common.h"
+#include "till_platform.h"
+#include "till_security.h"
+#include "cJSON.h"
+
+/* Map failed gh output to a gist result */
+static int gh_failure(const char *output) {
+    if (output && strstr(output, "HTTP 404")) {
+        return GIST_NOT_FOUND;
+    }
+    if (output && (strstr(output, "rate limit") || strstr(output, "HTTP 429"))) {
+        return GIST_RATE_LIMITED;
+    }
+    return -1;
+}
+
+/* A 403 is rate limiting only with no requests left; otherwise it is a
+ * permission problem (token scope, someone else's gist) not worth retrying */
+static int out_of_requests(const char *headers) {
+    static const char name[] = "x-ratelimit-remaining:";
+
+    for (const char *line = headers; line && *line && *line != '\r' && *line != '\n';
+         line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        if (strncasecmp(line, name, strlen(name)) == 0) {
+            return atoi(line + strlen(name)) == 0;
+        }
+    }
+    return 0;
+}
+
+/* Send a gists API request with a JSON body; id receives the gist id */
+static int gh_api_request(const char *method, const char *endpoint, cJSON *body,
+                          char *id, size_t id_size) {
+    char body_path[TILL_MAX_PATH];
+    char cmd[TILL_MAX_COMMAND];
+    FILE *fp;
+
+    char *text = cJSON_PrintUnformatted(body);
+    if (!text) {
+        return -1;
+    }
+
+    snprintf(body_path, sizeof(body_path), "%s/till-gist.XXXXXX", platform_get_temp_dir());
+    if (create_temp_file(body_path, &fp) != 0) {
+        cJSON_free(text);
+        return -1;
+    }
+    int written = fputs(text, fp) >= 0;
+    written = fclose(fp) == 0 && written;
+    cJSON_free(text);
+
+    char *quoted_path = written ? shell_quote(body_path) : NULL;
+    if (!quoted_path) {
+        unlink(body_path);
+        return -1;
+    }
+    snprintf(cmd, sizeof(cmd), "gh api %s --method %s --input %s --jq .id 2>&1",
+             endpoint, method, quoted_path);
+    free(quoted_path);
+
+    char *output;
+    int result = run_command_capture_all(cmd, &output, TILL_OUTPUT_BUFFER);
+    unlink(body_path);
+
+    if (result != 0) {
+        result = gh_failure(output);
+        free(output);
+        return result;
+    }
+
+    if (id && output) {
+        output[strcspn(output, "\r\n")] = '\0';
+        safe_strncpy(id, output, id_size);
+    }
+    free(output);
+    return 0;
+}
+
+static int gh_check_auth(void) {
+    char token[256];
+    /* Prints what to install or run when gh isn't ready */
+    int result = get_github_token(token, sizeof(token));
+    secure_memzero(token, sizeof(token));
+    return result;
+}
+
+static int gh_probe(void) {
+    char output[64];
+
+    /* rate_limit doesn't count against the limit, and needs a working gh login */
+    if (run_command_timeout("gh api rate_limit --jq .resources.core.remaining 2>/dev/null",
+                            FEDERATION_PROBE_TIMEOUT, output, sizeof(output)) != 0) {
+        till_log(LOG_WARN, "GitHub API unreachable");
+        return 0;
+    }
+    if (atoi(output) <= 0) {
+        till_log(LOG_WARN, "GitHub API rate limit exhausted");
+        return 0;
+    }
+    return 1;
+}
+
+static int gh_whoami(char *login, size_t size) {
+    login[0] = '\0';
+    if (run_command("gh api user --jq .login 2>/dev/null", login, size) != 0) {
+        login[0] = '\0';
+        return -1;
+    }
+    login[strcspn(login, "\r\n")] = '\0';
+    return login[0] ? 0 : -1;
+}
+
+static int gh_list(const char *description, int limit, char ***ids, int *count) {
+    char cmd[512];
+    char line[256];
+    int cap = 64;
+
+    *ids = NULL;
+    *count = 0;
+
+    char *quoted = shell_quote(description);
+    if (!quoted) {
+        return -1;
+    }
+    snprintf(cmd, sizeof(cmd), "gh gist list --limit %d 2>/dev/null | grep -F %s | cut -f1",
+             limit, quoted);
+    free(quoted);
+
+    FILE *fp = popen(cmd, "r");
+    char **list = fp ? malloc(cap * sizeof(char *)) : NULL;
+    if (!list) {
+        if (fp) pclose(fp);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!valid_gist_id(line)) continue;
+
+        if (*count == cap) {
+            char **grown = realloc(list, cap * 2 * sizeof(char *));
+            if (!grown) break;
+            list = grown;
+            cap *= 2;
+        }
+        list[*count] = strdup(line);
+        if (list[*count]) (*count)++;
+    }
+    pclose(fp);
+
+    *ids = list;
+    return 0;
+}
+
+static int gh_create(const char *description, int is_public, const char *filename,
+                     const char *content, char *id, size_t id_size) {
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddStringToObject(body, "description", description);
+    cJSON_AddBoolToObject(body, "public", is_public);
+    cJSON *file = cJSON_AddObjectToObject(cJSON_AddObjectToObject(body, "files"), filename);
+    cJSON_AddStringToObject(file, "content", content);
+
+    id[0] = '\0';
+    int result = gh_api_request("POST", "gists", body, id, id_size);
+    cJSON_Delete(body);
+    return result;
+}
+
+static int gh_update_file(const char *id, const char *filename, const char *content) {
+    char endpoint[128];
+
+    if (!valid_gist_id(id)) {
+        return -1;
+    }
+    snprintf(endpoint, sizeof(endpoint), "gists/%s", id);
+
+    cJSON *body = cJSON_CreateObject();
+    cJSON *file = cJSON_AddObjectToObject(cJSON_AddObjectToObject(body, "files"), filename);
+    cJSON_AddStringToObject(file, "content", content);
+
+    int result = gh_api_request("PATCH", endpoint, body, NULL, 0);
+    cJSON_Delete(body);
+    return result;
+}
+
+static int gh_fetch(const char *id, const char *etag, char **body,
+                    char *new_etag, size_t etag_size) {
+    char cmd[TILL_MAX_COMMAND];
+
+    *body = NULL;
+    if (new_etag && etag_size) {
+        new_etag[0] = '\0';
+    }
+    if (!valid_gist_id(id)) {
+        return -1;
+    }
+
+    if (etag && *etag && strchr(etag, '\'') == NULL) {
+        snprintf(cmd, sizeof(cmd),
+            "gh api --include gists/%s -H 'If-None-Match: %s' 2>&1", id, etag);
+    } else {
+        snprintf(cmd, sizeof(cmd), "gh api --include gists/%s 2>&1", id);
+    }
+
+    char *response;
+    run_command_capture_all(cmd, &response, FEDERATION_GIST_MAX);
+    if (!response) {
+        return -1;
+    }
+
+    /* Status line: HTTP/2.0 200 OK */
+    int code = 0;
+    if (strncmp(response, "HTTP/", 5) == 0) {
+        const char *sp = strchr(response, ' ');
+        code = sp ? atoi(sp + 1) : 0;
+    }
+
+    if (code != 200) {
+        int result = code == 304 ? GIST_NOT_MODIFIED :
+                     code == 404 ? GIST_NOT_FOUND :
+                     code == 429 || (code == 403 && out_of_requests(response)) ?
+                     GIST_RATE_LIMITED : gh_failure(response);
+        free(response);
+        return result;
+    }
+
+    /* Headers end at the first blank line */
+    char *start = NULL;
+    char *sep = strstr(response, "\r\n\r\n");
+    if (sep) {
+        start = sep + 4;
+    } else if ((sep = strstr(response, "\n\n")) != NULL) {
+        start = sep + 2;
+    }
+    if (!start) {
+        free(response);
+        return -1;
+    }
+
+    for (char *line = response; line && line < start; ) {
+        if (strncasecmp(line, "ETag:", 5) == 0 && new_etag && etag_size) {
+            char *value = line + 5;
+            while (*value == ' ') value++;
+            size_t len = strcspn(value, "\r\n");
+            if (len >= etag_size) len = etag_size - 1;
+            memcpy(new_etag, value, len);
+            new_etag[len] = '\0';
+            break;
+        }
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+
+    *body = strdup(start);
+    free(response);
+    return *body ? 0 : -1;
+}
+
+static int gh_fetch_raw(const char *id, const char *filename, char **content) {
+    char cmd[512];
+
+    *content = NULL;
+    char *quoted = valid_gist_id(id) ? shell_quote(filename) : NULL;
+    if (!quoted) {
+        return -1;
+    }
+    snprintf(cmd, sizeof(cmd), "gh gist view %s --raw --filename %s 2>/dev/null", id, quoted);
+    free(quoted);
+
+    if (run_command_capture_all(cmd, content, FEDERATION_GIST_MAX) != 0) {
+        free(*content);
+        *content = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* One shell for the whole batch; it echoes back each id that is gone */
+static int gh_remove(char *const *ids, int count, int *deleted) {
+    char cmd[TILL_MAX_COMMAND];
+    int len = snprintf(cmd, sizeof(cmd), "for id in");
+
+    for (int i = 0; i < count; i++) {
+        deleted[i] = 0;
+        if (valid_gist_id(ids[i]) && len < (int)sizeof(cmd) - 256) {
+            len += snprintf(cmd + len, sizeof(cmd) - len, " %s", ids[i]);
+        }
+    }
+    snprintf(cmd + len, sizeof(cmd) - len,
+        "; do out=$(gh api --method DELETE gists/$id 2>&1) && echo $id || "
+        "case \"$out\" in *'HTTP 404'*) echo $id;; esac; done");
+
+    char *output;
+    run_command_capture_all(cmd, &output, TILL_OUTPUT_BUFFER + (size_t)count * 64);
+    if (!output) {
+        return -1;
+    }
+
+    int removed = 0;
+    char *saveptr = NULL;
+    for (char *line = strtok_r(output, "\n", &saveptr); line != NULL;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        for (int i = 0; i < count; i++) {
+            if (!deleted[i] && strcmp(ids[i], line) == 0) {
+                deleted[i] = 1;
+                removed++;
+                break;
+            }
+        }
+    }
+    free(output);
+    return removed;
+}
+
+const federation_gist_transport_t federation_gh_gists = {
+    "gh",
+    gh_check_auth,
+    gh_probe,
+    gh_whoami,
+    gh_list,
+    gh_create,
+    gh_update_file,
+    gh_fetch,
+    gh_fetch_raw,
+    gh_remove
+};
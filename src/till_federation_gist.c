@@ -7,179 +7,281 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <ctype.h>
+#include <sys/stat.h>
 #include "till_federation.h"
+#include "till_federation_transport.h"
 #include "till_common.h"
+#include "till_config.h"
+#include "till_hash.h"
+#include "till_security.h"
+#include "till_platform.h"
 #include "cJSON.h"
 
+#define GIST_CACHE_DIR "cache"  /* Under the federation state dir */
+
 /* Create a new federation gist */
 int create_federation_gist(const char *site_id, char *gist_id, size_t gist_id_size) {
-    char cmd[4096];
-    char status_json[2048];
-    FILE *fp;
-    char buffer[256];
-    
-    /* Create initial status JSON */
-    snprintf(status_json, sizeof(status_json),
-        "{"
-        "\"site_id\":\"%s\","
-        "\"created\":%ld,"
-        "\"last_updated\":%ld,"
-        "\"till_version\":\"1.5.0\","
-        "\"status\":\"active\""
-        "}",
-        site_id, time(NULL), time(NULL)
-    );
-    
-    /* Use gh CLI to create gist */
-    snprintf(cmd, sizeof(cmd),
-        "gh api gists "
-        "--field description='Till Federation Status for %s' "
-        "--field public=true "
-        "--field 'files[status.json][content]=%s' "
-        "--jq .id",
-        site_id, status_json
-    );
-    
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
+    char description[256];
+    char *initial;
+
+    /* Placeholder status until the first push */
+    cJSON *status = cJSON_CreateObject();
+    cJSON_AddNumberToObject(status, "schema", FEDERATION_STATUS_SCHEMA);
+    cJSON_AddStringToObject(status, "site_id", site_id);
+    cJSON_AddNumberToObject(status, "created", (double)time(NULL));
+    cJSON_AddNumberToObject(status, "last_updated", (double)time(NULL));
+    cJSON_AddStringToObject(status, "till_version", TILL_VERSION);
+    cJSON_AddStringToObject(status, "status", "active");
+    initial = cJSON_PrintUnformatted(status);
+    cJSON_Delete(status);
+
+    snprintf(description, sizeof(description), "Till Federation Status for %s", site_id);
+
+    gist_id[0] = '\0';
+    int result = federation_gists()->create(description, 1, "status.json",
+                                            initial ? initial : "{}", gist_id, gist_id_size);
+    free(initial);
+
+    if (result != 0 || !valid_gist_id(gist_id)) {
         fprintf(stderr, "Error: Failed to create gist\n");
         return -1;
     }
-    
-    if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        /* Remove newline */
-        buffer[strcspn(buffer, "\n")] = '\0';
-        strncpy(gist_id, buffer, gist_id_size - 1);
-        gist_id[gist_id_size - 1] = '\0';
+
+    return 0;
+}
+
+/* Update an existing federation gist */
+int update_federation_gist(const char *gist_id, const char *content) {
+    return update_federation_gist_file(gist_id, "status.json", content);
+}
+
+/* Replace one file of a gist */
+int update_federation_gist_file(const char *gist_id, const char *filename, const char *content) {
+    if (!valid_gist_id(gist_id)) {
+        return -1;
     }
-    
-    int result = pclose(fp);
-    if (result != 0 || strlen(gist_id) == 0) {
-        fprintf(stderr, "Error: Failed to create gist (exit code: %d)\n", result);
+
+    int result = federation_gists()->update_file(gist_id, filename, content);
+    if (result != 0 && result != GIST_NOT_FOUND) {
+        fprintf(stderr, "Error: Failed to update %s in gist %s\n", filename, gist_id);
+        return -1;
+    }
+    return result;
+}
+
+/* Delete a federation gist; a gist that is already gone counts as deleted */
+int delete_federation_gist(const char *gist_id) {
+    char *ids[1];
+    int deleted = 0;
+
+    if (!valid_gist_id(gist_id)) {
+        return -1;
+    }
+
+    ids[0] = (char *)gist_id;
+    if (federation_gists()->remove(ids, 1, &deleted) < 0 || !deleted) {
+        fprintf(stderr, "Error: Failed to delete gist %s\n", gist_id);
         return -1;
     }
-    
     return 0;
 }
 
-/* Update an existing federation gist */
-int update_federation_gist(const char *gist_id, const char *content) {
-    char cmd[8192];
-    FILE *fp;
-    char escaped_content[4096];
-    const char *p = content;
-    char *q = escaped_content;
-    
-    /* Escape special characters for shell */
-    while (*p && q < escaped_content + sizeof(escaped_content) - 2) {
-        if (*p == '"' || *p == '\\' || *p == '`' || *p == '$') {
-            *q++ = '\\';
+/* Gist IDs are hex, but they end up in paths and commands - be strict */
+int valid_gist_id(const char *gist_id) {
+    if (!gist_id || !*gist_id || strlen(gist_id) >= 64) {
+        return 0;
+    }
+    for (const char *p = gist_id; *p; p++) {
+        if (!isalnum((unsigned char)*p)) {
+            return 0;
         }
-        *q++ = *p++;
     }
-    *q = '\0';
+    return 1;
+}
+
+/* Read a small text file, NULL if missing */
+static char *read_cache_file(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return NULL;
+    }
     
-    /* Use gh CLI to update gist */
-    snprintf(cmd, sizeof(cmd),
-        "gh api gists/%s --method PATCH "
-        "--field 'files[status.json][content]=%s' "
-        ">/dev/null 2>&1",
-        gist_id, escaped_content
-    );
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
     
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Error: Failed to update gist\n");
+    char *data = NULL;
+    if (size >= 0 && size <= FEDERATION_GIST_MAX) {
+        data = malloc(size + 1);
+        if (data) {
+            size_t n = fread(data, 1, size, fp);
+            data[n] = '\0';
+        }
+    }
+    fclose(fp);
+    return data;
+}
+
+/* Pull filename's content out of a fetched gist body */
+static int gist_body_file(const char *gist_id, const char *body, const char *filename,
+                          char **content) {
+    cJSON *gist = cJSON_Parse(body);
+    if (!gist) {
         return -1;
     }
     
-    int result = pclose(fp);
-    if (result != 0) {
-        fprintf(stderr, "Error: Failed to update gist %s (exit code: %d)\n", gist_id, result);
-        return -1;
+    cJSON *file = cJSON_GetObjectItemCaseSensitive(
+        cJSON_GetObjectItemCaseSensitive(gist, "files"), filename);
+    const char *text = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(file, "content"));
+    
+    int result = -1;
+    if (cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(file, "truncated"))) {
+        /* The API truncates large files - fetch the raw file instead */
+        result = federation_gists()->fetch_raw(gist_id, filename, content);
+    } else if (text) {
+        *content = strdup(text);
+        result = *content ? 0 : -1;
     }
     
-    return 0;
+    cJSON_Delete(gist);
+    return result;
 }
 
-/* Delete a federation gist */
-int delete_federation_gist(const char *gist_id) {
-    char cmd[512];
-    FILE *fp;
+/* Read one file from a gist, uncached */
+int read_gist_file(const char *gist_id, const char *filename, char **content) {
+    char *body;
     
-    /* Use gh CLI to delete gist */
-    snprintf(cmd, sizeof(cmd),
-        "gh api gists/%s --method DELETE",
-        gist_id
-    );
-    
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Error: Failed to delete gist\n");
+    *content = NULL;
+    if (!valid_gist_id(gist_id)) {
         return -1;
     }
     
-    int result = pclose(fp);
+    int result = federation_gists()->fetch(gist_id, NULL, &body, NULL, 0);
     if (result != 0) {
-        fprintf(stderr, "Error: Failed to delete gist %s (exit code: %d)\n", gist_id, result);
-        return -1;
+        return result;
     }
-    
-    return 0;
+    result = gist_body_file(gist_id, body, filename, content);
+    free(body);
+    return result;
 }
 
-/* Fetch a gist by ID */
-int fetch_federation_gist(const char *gist_id, char *content, size_t content_size) {
-    char cmd[512];
-    FILE *fp;
-    char buffer[4096];
-    size_t total_read = 0;
-    
-    /* Use gh CLI to fetch gist content */
-    snprintf(cmd, sizeof(cmd),
-        "gh api gists/%s --jq '.files.\"status.json\".content'",
-        gist_id
-    );
+/*
+ * Read one file from a gist with a conditional request.
+ *
+ * The last response body and its ETag are kept under the federation
+ * cache dir; when GitHub answers 304 Not Modified the cached copy is
+ * used, which does not count against the API rate limit.
+ */
+int fetch_gist_file(const char *gist_id, const char *filename, char **content) {
+    char cache_dir[TILL_MAX_PATH];
+    char body_path[TILL_MAX_PATH];
+    char etag_path[TILL_MAX_PATH];
+    char new_etag[256];
     
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Error: Failed to fetch gist\n");
+    *content = NULL;
+    if (!valid_gist_id(gist_id)) {
         return -1;
     }
     
-    content[0] = '\0';
-    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        size_t len = strlen(buffer);
-        if (total_read + len < content_size - 1) {
-            strcat(content, buffer);
-            total_read += len;
+    /* A cache path that doesn't fit just means fetching without the cache */
+    int cached = get_federation_state_dir(cache_dir, sizeof(cache_dir), GIST_CACHE_DIR) == 0 &&
+        snprintf(body_path, sizeof(body_path), "%s/%s.json", cache_dir, gist_id) < (int)sizeof(body_path) &&
+        snprintf(etag_path, sizeof(etag_path), "%s/%s.etag", cache_dir, gist_id) < (int)sizeof(etag_path);
+    
+    char *etag = cached && path_exists(body_path) ? read_cache_file(etag_path) : NULL;
+    char *body;
+    int result = federation_gists()->fetch(gist_id, etag, &body, new_etag, sizeof(new_etag));
+    free(etag);
+    
+    if (result == GIST_NOT_MODIFIED) {
+        body = read_cache_file(body_path);
+    } else if (result == 0) {
+        /* Remember the ETag for next time */
+        if (cached && new_etag[0]) {
+            write_file_atomic(body_path, body, strlen(body));
+            write_file_atomic(etag_path, new_etag, strlen(new_etag));
         }
+    } else {
+        return result == GIST_NOT_FOUND ? GIST_NOT_FOUND : -1;
     }
     
-    int result = pclose(fp);
-    if (result != 0) {
-        fprintf(stderr, "Error: Failed to fetch gist %s (exit code: %d)\n", gist_id, result);
+    if (!body) {
         return -1;
     }
+    result = gist_body_file(gist_id, body, filename, content);
+    free(body);
+    return result;
+}
+
+/* Fetch a gist's status.json by ID */
+int fetch_federation_gist(const char *gist_id, char *content, size_t content_size) {
+    char *text;
+    int result = fetch_gist_file(gist_id, "status.json", &text);
+    if (result != 0) {
+        if (result == -1) {
+            fprintf(stderr, "Error: Failed to fetch gist %s\n", gist_id);
+        }
+        return result;
+    }
     
+    safe_strncpy(content, text, content_size);
+    free(text);
     return 0;
 }
 
+/* Summaries of what this site runs - names and shape only, no paths or addresses */
+static void collect_installations(federation_status_t *status, cJSON *registry) {
+    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
+    cJSON *holds = cJSON_GetObjectItem(registry, "holds");
+    cJSON *inst;
+
+    status->installations = cJSON_CreateArray();
+    cJSON_ArrayForEach(inst, installations) {
+        cJSON *summary = cJSON_CreateObject();
+        cJSON_AddStringToObject(summary, "name", inst->string);
+        cJSON_AddStringToObject(summary, "mode", json_get_string(inst, "mode", "unknown"));
+        cJSON_AddNumberToObject(summary, "port_base", json_get_int(inst, "port_base", 0));
+        cJSON_AddBoolToObject(summary, "held", cJSON_GetObjectItem(holds, inst->string) != NULL);
+        cJSON_AddItemToArray(status->installations, summary);
+        status->installation_count++;
+    }
+}
+
+static void collect_hosts(federation_status_t *status) {
+    cJSON *json = load_till_json("hosts-local.json");
+    cJSON *hosts = cJSON_GetObjectItem(json, "hosts");
+    cJSON *host;
+
+    status->hosts = cJSON_CreateArray();
+    cJSON_ArrayForEach(host, hosts) {
+        cJSON *summary = cJSON_CreateObject();
+        cJSON_AddStringToObject(summary, "name", host->string);
+        cJSON_AddStringToObject(summary, "status", json_get_string(host, "status", "unknown"));
+        cJSON_AddBoolToObject(summary, "till_configured",
+                              strcmp(json_get_string(host, "till_configured", "no"), "yes") == 0);
+        cJSON_AddItemToArray(status->hosts, summary);
+        status->host_count++;
+    }
+    cJSON_Delete(json);
+}
+
 /* Collect system status for federation */
 int collect_system_status(federation_status_t *status) {
     char hostname[256];
-    
+
     if (gethostname(hostname, sizeof(hostname)) != 0) {
         strcpy(hostname, "unknown");
     }
-    
+
     /* Basic status collection */
     strncpy(status->hostname, hostname, sizeof(status->hostname) - 1);
     status->till_version = 150;  /* 1.5.0 */
     status->uptime = time(NULL);
     status->last_sync = time(NULL);
     status->cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
-    
+    status->memory_mb = platform_get_memory_mb();
+
     /* Platform detection */
 #ifdef __APPLE__
     strcpy(status->platform, "darwin");
@@ -188,61 +290,166 @@ int collect_system_status(federation_status_t *status) {
 #else
     strcpy(status->platform, "unknown");
 #endif
-    
-    /* Collect installation count from registry */
-    status->installation_count = 0;
-    
-    char registry_path[512];
-    snprintf(registry_path, sizeof(registry_path), "%s/.till/tekton/till-private.json", getenv("HOME"));
-    
-    FILE *fp = fopen(registry_path, "r");
-    if (fp) {
-        fseek(fp, 0, SEEK_END);
-        long size = ftell(fp);
-        fseek(fp, 0, SEEK_SET);
-        
-        char *content = malloc(size + 1);
-        if (content) {
-            fread(content, 1, size, fp);
-            content[size] = '\0';
-            
-            cJSON *json = cJSON_Parse(content);
-            if (json) {
-                cJSON *installations = cJSON_GetObjectItem(json, "installations");
-                if (installations) {
-                    status->installation_count = cJSON_GetArraySize(installations);
-                }
-                cJSON_Delete(json);
-            }
-            free(content);
+
+    /* Holds that are still in force */
+    cJSON *registry = load_till_json("tekton/till-private.json");
+    cJSON *hold;
+    time_t now = time(NULL);
+    cJSON_ArrayForEach(hold, cJSON_GetObjectItem(registry, "holds")) {
+        time_t expires = (time_t)json_get_int(hold, "expires_at", 0);
+        if (expires == 0 || expires > now) {
+            status->hold_count++;
         }
-        fclose(fp);
     }
-    
+
+    collect_installations(status, registry);
+    collect_hosts(status);
+    cJSON_Delete(registry);
+
     return 0;
 }
 
-/* Create status JSON from federation status */
-int create_status_json(const federation_status_t *status, char *json, size_t json_size) {
+void free_system_status(federation_status_t *status) {
+    cJSON_Delete(status->installations);
+    cJSON_Delete(status->hosts);
+    status->installations = NULL;
+    status->hosts = NULL;
+}
+
+/* Create status JSON (schema FEDERATION_STATUS_SCHEMA); caller frees */
+char *create_status_json(const federation_status_t *status) {
     cJSON *root = cJSON_CreateObject();
-    
+
+    cJSON_AddNumberToObject(root, "schema", FEDERATION_STATUS_SCHEMA);
     cJSON_AddStringToObject(root, "site_id", status->site_id);
     cJSON_AddStringToObject(root, "hostname", status->hostname);
     cJSON_AddStringToObject(root, "platform", status->platform);
     cJSON_AddNumberToObject(root, "till_version", status->till_version / 100.0);
     cJSON_AddNumberToObject(root, "cpu_count", status->cpu_count);
+    cJSON_AddNumberToObject(root, "memory_mb", status->memory_mb);
     cJSON_AddNumberToObject(root, "installation_count", status->installation_count);
+    cJSON_AddNumberToObject(root, "host_count", status->host_count);
+    cJSON_AddNumberToObject(root, "hold_count", status->hold_count);
     cJSON_AddNumberToObject(root, "uptime", status->uptime);
     cJSON_AddNumberToObject(root, "last_sync", status->last_sync);
     cJSON_AddStringToObject(root, "trust_level", status->trust_level);
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    if (json_str) {
-        strncpy(json, json_str, json_size - 1);
-        json[json_size - 1] = '\0';
-        free(json_str);
+
+    /* Added by reference - deleting root leaves the caller's copies alone */
+    if (status->installations) {
+        cJSON_AddItemReferenceToObject(root, "installations", status->installations);
     }
-    
+    if (status->hosts) {
+        cJSON_AddItemReferenceToObject(root, "hosts", status->hosts);
+    }
+
+    char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
+    return json;
+}
+
+/* Hash the parts of a status that matter - uptime and last_sync change
+ * on every run and are deliberately left out */
+int status_content_hash(const federation_status_t *status, char *hash, size_t hash_size) {
+    federation_status_t stable = *status;
+
+    stable.uptime = 0;
+    stable.last_sync = 0;
+    char *json = create_status_json(&stable);
+    if (!json) {
+        return -1;
+    }
+
+    snprintf(hash, hash_size, "%08x", till_hash_string(json));
+    free(json);
     return 0;
-}
\ No newline at end of file
+}
+
+/* Minimal document that only refreshes last_sync for an unchanged site */
+char *create_heartbeat_json(const federation_status_t *status, const char *hash) {
+    cJSON *root = cJSON_CreateObject();
+
+    cJSON_AddNumberToObject(root, "schema", FEDERATION_STATUS_SCHEMA);
+    cJSON_AddStringToObject(root, "site_id", status->site_id);
+    cJSON_AddBoolToObject(root, "heartbeat", 1);
+    cJSON_AddStringToObject(root, "status_hash", hash);
+    cJSON_AddNumberToObject(root, "last_sync", status->last_sync);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json;
+}
+
+/* Run a shell filter over a temp file holding input; caller frees */
+static char *filter_through(const char *input, const char *filter, size_t limit) {
+    char path[TILL_MAX_PATH];
+    char cmd[TILL_MAX_COMMAND];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/till-status.XXXXXX", platform_get_temp_dir());
+    if (create_temp_file(path, &fp) != 0) {
+        return NULL;
+    }
+    int written = fputs(input, fp) >= 0;
+    written = fclose(fp) == 0 && written;
+
+    char *quoted = written ? shell_quote(path) : NULL;
+    char *output = NULL;
+    if (quoted) {
+        snprintf(cmd, sizeof(cmd), "(%s) < %s 2>/dev/null", filter, quoted);
+        if (run_command_capture_all(cmd, &output, limit) != 0 || !output || !*output) {
+            free(output);
+            output = NULL;
+        }
+        free(quoted);
+    }
+    unlink(path);
+    return output;
+}
+
+/*
+ * Large statuses are sent gzip'd and base64'd inside a small wrapper:
+ * {"schema":N,"encoding":"gzip+base64","size":bytes,"data":"..."}.
+ * Smaller ones (and hosts without gzip/base64) send the JSON as is.
+ */
+char *pack_status_json(const char *json) {
+    size_t len = strlen(json);
+    if (len < FEDERATION_COMPRESS_MIN) {
+        return strdup(json);
+    }
+
+    char *data = filter_through(json, "gzip -9c | base64 | tr -d '\\n'", len + len / 2 + 64);
+    if (!data) {
+        return strdup(json);
+    }
+
+    cJSON *wrapper = cJSON_CreateObject();
+    cJSON_AddNumberToObject(wrapper, "schema", FEDERATION_STATUS_SCHEMA);
+    cJSON_AddStringToObject(wrapper, "encoding", "gzip+base64");
+    cJSON_AddNumberToObject(wrapper, "size", (double)len);
+    cJSON_AddStringToObject(wrapper, "data", data);
+    free(data);
+
+    char *packed = cJSON_PrintUnformatted(wrapper);
+    cJSON_Delete(wrapper);
+    return packed ? packed : strdup(json);
+}
+
+/* Undo pack_status_json; plain JSON is returned as a copy. NULL if the
+ * encoding is unknown or the data doesn't decode */
+char *unpack_status_json(const char *content) {
+    cJSON *doc = cJSON_Parse(content);
+    const char *encoding = json_get_string(doc, "encoding", NULL);
+
+    if (!encoding) {
+        cJSON_Delete(doc);
+        return strdup(content);
+    }
+
+    char *json = NULL;
+    const char *data = json_get_string(doc, "data", NULL);
+    if (strcmp(encoding, "gzip+base64") == 0 && data) {
+        json = filter_through(data, "base64 -d | gzip -dc", FEDERATION_GIST_MAX);
+    }
+    cJSON_Delete(doc);
+    return json;
+}
@@ -0,0 +1,322 @@
+/*
+ * till_federation_gist_store.c - Local file-backed gist transport
+ *
+ * A stand-in for GitHub gists used when TILL_GIST_STORE names a
+ * directory. Each gist is one file, <store>/<id>.json, holding the same
+ * JSON the gists API returns ({"id","description","public","files"}).
+ * The ETag is derived from the file's mtime and size. The authenticated
+ * user is read from <store>/.user (default $USER).
+ *
+ * Several till processes (and admin workers) can share one store:
+ * writes are atomic renames made under <store>/.lock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "till_federation.h"
+#include "till_federation_transport.h"
+#include "till_config.h"
+#include "till_constants.h"
+#include "till_common.h"
+#include "till_security.h"
+#include "till_platform.h"
+#include "cJSON.h"
+
+#define STORE_ENV "TILL_GIST_STORE"
+#define STORE_LOCK ".lock"
+#define STORE_USER ".user"
+
+static const char *store_dir(void) {
+    const char *dir = getenv(STORE_ENV);
+    return (dir && *dir) ? dir : NULL;
+}
+
+static int gist_path(char *path, size_t size, const char *id) {
+    const char *dir = store_dir();
+    if (!dir || !valid_gist_id(id)) {
+        return -1;
+    }
+    snprintf(path, size, "%s/%s.json", dir, id);
+    return 0;
+}
+
+static int lock_store(void) {
+    char path[TILL_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", store_dir(), STORE_LOCK);
+    return acquire_lock_file(path, LOCK_TIMEOUT * 1000);
+}
+
+static void file_etag(const char *path, char *etag, size_t size) {
+    struct stat st;
+    if (!etag || !size) {
+        return;
+    }
+    if (stat(path, &st) != 0) {
+        etag[0] = '\0';
+        return;
+    }
+    snprintf(etag, size, "\"%llx-%lx\"", (unsigned long long)platform_stat_mtime_ns(&st),
+             (unsigned long)st.st_size);
+}
+
+static int save_gist(const char *path, cJSON *gist) {
+    char *text = cJSON_PrintUnformatted(gist);
+    if (!text) {
+        return -1;
+    }
+    int result = write_file_atomic(path, text, strlen(text));
+    cJSON_free(text);
+    return result;
+}
+
+/* 32 hex digits, like GitHub's */
+static void new_gist_id(char *id, size_t size) {
+    unsigned char bytes[16];
+    int fd = open("/dev/urandom", O_RDONLY);
+
+    if (fd < 0 || read(fd, bytes, sizeof(bytes)) != (ssize_t)sizeof(bytes)) {
+        static unsigned int counter = 0;
+        unsigned int seed = (unsigned int)time(NULL) ^ ((unsigned int)getpid() << 16) ^ counter++;
+        for (size_t i = 0; i < sizeof(bytes); i++) {
+            seed = seed * 1103515245 + 12345;
+            bytes[i] = (unsigned char)(seed >> 16);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    for (size_t i = 0; i < sizeof(bytes) && 2 * i + 2 < size; i++) {
+        snprintf(id + 2 * i, 3, "%02x", bytes[i]);
+    }
+}
+
+static int store_check_auth(void) {
+    if (!store_dir() || !is_directory(store_dir())) {
+        printf("Error: Gist store %s=%s is not a directory\n", STORE_ENV,
+               store_dir() ? store_dir() : "");
+        return -1;
+    }
+    return 0;
+}
+
+static int store_probe(void) {
+    return store_dir() && is_directory(store_dir());
+}
+
+static int store_whoami(char *login, size_t size) {
+    char path[TILL_MAX_PATH];
+
+    login[0] = '\0';
+    if (!store_dir()) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/%s", store_dir(), STORE_USER);
+
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        if (fgets(login, size, fp) == NULL) {
+            login[0] = '\0';
+        }
+        fclose(fp);
+        login[strcspn(login, "\r\n")] = '\0';
+    }
+    if (!login[0] && getenv("USER")) {
+        safe_strncpy(login, getenv("USER"), size);
+    }
+    return login[0] ? 0 : -1;
+}
+
+static int store_list(const char *description, int limit, char ***ids, int *count) {
+    char path[TILL_MAX_PATH];
+    int cap = 64;
+
+    *ids = NULL;
+    *count = 0;
+
+    DIR *dir = store_dir() ? opendir(store_dir()) : NULL;
+    char **list = dir ? malloc(cap * sizeof(char *)) : NULL;
+    if (!list) {
+        if (dir) closedir(dir);
+        return -1;
+    }
+
+    struct dirent *entry;
+    while (*count < limit && (entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (entry->d_name[0] == '.' || len <= 5 || strcmp(entry->d_name + len - 5, ".json") != 0) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", store_dir(), entry->d_name);
+        cJSON *gist = load_json_file(path);
+        const char *desc = json_get_string(gist, "description", "");
+        const char *id = json_get_string(gist, "id", "");
+
+        if (strstr(desc, description) && valid_gist_id(id)) {
+            if (*count == cap) {
+                char **grown = realloc(list, cap * 2 * sizeof(char *));
+                if (!grown) {
+                    cJSON_Delete(gist);
+                    break;
+                }
+                list = grown;
+                cap *= 2;
+            }
+            list[*count] = strdup(id);
+            if (list[*count]) (*count)++;
+        }
+        cJSON_Delete(gist);
+    }
+    closedir(dir);
+
+    *ids = list;
+    return 0;
+}
+
+static int store_create(const char *description, int is_public, const char *filename,
+                        const char *content, char *id, size_t id_size) {
+    char path[TILL_MAX_PATH];
+    char new_id[33] = {0};
+
+    new_gist_id(new_id, sizeof(new_id));
+    if (gist_path(path, sizeof(path), new_id) != 0) {
+        return -1;
+    }
+
+    cJSON *gist = cJSON_CreateObject();
+    cJSON_AddStringToObject(gist, "id", new_id);
+    cJSON_AddStringToObject(gist, "description", description);
+    cJSON_AddBoolToObject(gist, "public", is_public);
+    cJSON_AddNumberToObject(gist, "updated_at", (double)time(NULL));
+    cJSON *file = cJSON_AddObjectToObject(cJSON_AddObjectToObject(gist, "files"), filename);
+    cJSON_AddStringToObject(file, "filename", filename);
+    cJSON_AddStringToObject(file, "content", content);
+
+    int result = save_gist(path, gist);
+    cJSON_Delete(gist);
+
+    if (result == 0) {
+        safe_strncpy(id, new_id, id_size);
+    }
+    return result;
+}
+
+static int store_update_file(const char *id, const char *filename, const char *content) {
+    char path[TILL_MAX_PATH];
+
+    if (gist_path(path, sizeof(path), id) != 0) {
+        return -1;
+    }
+
+    int lock_fd = lock_store();
+    if (lock_fd < 0) {
+        return -1;
+    }
+
+    int result = GIST_NOT_FOUND;
+    cJSON *gist = load_json_file(path);
+    if (gist) {
+        cJSON *files = cJSON_GetObjectItemCaseSensitive(gist, "files");
+        if (!files) {
+            files = cJSON_AddObjectToObject(gist, "files");
+        }
+        cJSON_DeleteItemFromObjectCaseSensitive(files, filename);
+        cJSON *file = cJSON_AddObjectToObject(files, filename);
+        cJSON_AddStringToObject(file, "filename", filename);
+        cJSON_AddStringToObject(file, "content", content);
+        cJSON_DeleteItemFromObjectCaseSensitive(gist, "updated_at");
+        cJSON_AddNumberToObject(gist, "updated_at", (double)time(NULL));
+
+        result = save_gist(path, gist);
+        cJSON_Delete(gist);
+    }
+
+    release_lock_file(lock_fd);
+    return result;
+}
+
+static int store_fetch(const char *id, const char *etag, char **body,
+                       char *new_etag, size_t etag_size) {
+    char path[TILL_MAX_PATH];
+    char current[64];
+
+    *body = NULL;
+    if (gist_path(path, sizeof(path), id) != 0) {
+        return -1;
+    }
+    if (!path_exists(path)) {
+        return GIST_NOT_FOUND;
+    }
+
+    file_etag(path, current, sizeof(current));
+    if (new_etag && etag_size) {
+        safe_strncpy(new_etag, current, etag_size);
+    }
+    if (etag && *etag && strcmp(etag, current) == 0) {
+        return GIST_NOT_MODIFIED;
+    }
+
+    cJSON *gist = load_json_file(path);
+    if (!gist) {
+        return GIST_NOT_FOUND;  /* Deleted (or replaced) under us */
+    }
+    /* Bodies are plain malloc'd, like gh's, whatever cJSON's hooks are */
+    char *text = cJSON_PrintUnformatted(gist);
+    cJSON_Delete(gist);
+    *body = text ? strdup(text) : NULL;
+    cJSON_free(text);
+    return *body ? 0 : -1;
+}
+
+/* The store never truncates, so this is just the file from fetch */
+static int store_fetch_raw(const char *id, const char *filename, char **content) {
+    char *body;
+
+    *content = NULL;
+    int result = store_fetch(id, NULL, &body, NULL, 0);
+    if (result != 0) {
+        return result;
+    }
+
+    cJSON *gist = cJSON_Parse(body);
+    free(body);
+    cJSON *file = cJSON_GetObjectItemCaseSensitive(
+        cJSON_GetObjectItemCaseSensitive(gist, "files"), filename);
+    const char *text = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(file, "content"));
+    *content = text ? strdup(text) : NULL;
+    cJSON_Delete(gist);
+    return *content ? 0 : -1;
+}
+
+static int store_remove(char *const *ids, int count, int *deleted) {
+    char path[TILL_MAX_PATH];
+    int removed = 0;
+
+    for (int i = 0; i < count; i++) {
+        deleted[i] = gist_path(path, sizeof(path), ids[i]) == 0 &&
+                     (unlink(path) == 0 || !path_exists(path));
+        removed += deleted[i];
+    }
+    return removed;
+}
+
+const federation_gist_transport_t federation_local_gists = {
+    "local",
+    store_check_auth,
+    store_probe,
+    store_whoami,
+    store_list,
+    store_create,
+    store_update_file,
+    store_fetch,
+    store_fetch_raw,
+    store_remove
+};
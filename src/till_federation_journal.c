@@ -0,0 +1,199 @@
+/*
+ * till_federation_journal.c - Directive completion journal for Till Federation
+ *
+ * Completed directives are appended to ~/.till/federation/completed.journal
+ * as "<id>\t<time>\n" lines and fsync'd, so a crash loses at most the
+ * line being written. The journal is read once per process into a hash
+ * index; lookups never touch the disk again.
+ *
+ * Lines only become redundant when runs race on the same directive or a
+ * write is torn. Once they make up half the file it is rewritten in
+ * place (atomically, under the journal lock, after re-reading it so
+ * entries appended by other processes are kept).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "till_federation.h"
+#include "till_config.h"
+#include "till_constants.h"
+#include "till_common.h"
+#include "till_hash.h"
+#include "till_security.h"
+
+#define JOURNAL_FILE "completed.journal"
+#define JOURNAL_COMPACT_MIN 256      /* Don't bother compacting small journals */
+
+static till_hash_t journal;          /* id -> completion time (in count) */
+static size_t journal_lines = 0;     /* Lines in the file, valid or not */
+static int journal_torn = 0;         /* File doesn't end in a newline */
+static int journal_loaded = 0;
+
+static int get_journal_path(char *path, size_t size) {
+    char dir[TILL_MAX_PATH];
+    if (get_federation_state_dir(dir, sizeof(dir), NULL) != 0) {
+        return -1;
+    }
+    return snprintf(path, size, "%s/%s", dir, JOURNAL_FILE) < (int)size ? 0 : -1;
+}
+
+/* Read the journal into the index (merging with what is there) */
+static void journal_read(const char *path) {
+    FILE *fp = fopen(path, "r");
+
+    journal_lines = 0;
+    journal_torn = 0;
+    if (!fp) {
+        return;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        size_t len = strlen(line);
+        journal_lines++;
+
+        if (len == 0 || line[len - 1] != '\n') {
+            /* Torn last write (or an over-long line); skip the rest of it */
+            journal_torn = 1;
+            int c;
+            while ((c = fgetc(fp)) != EOF && c != '\n');
+            continue;
+        }
+
+        char *tab = strchr(line, '\t');
+        if (!tab || tab == line) {
+            continue;
+        }
+        *tab = '\0';
+
+        till_hash_entry_t *entry = till_hash_upsert(&journal, line, NULL);
+        if (entry && entry->count == 0) {
+            entry->count = atol(tab + 1);
+        }
+    }
+    fclose(fp);
+}
+
+static void journal_load(void) {
+    char path[TILL_MAX_PATH];
+
+    if (journal_loaded) {
+        return;
+    }
+    till_hash_init(&journal);
+    journal_loaded = 1;
+
+    if (get_journal_path(path, sizeof(path)) == 0) {
+        journal_read(path);
+        till_log(LOG_DEBUG, "Completion journal: %zu directives, %zu lines",
+                 journal.count, journal_lines);
+    }
+}
+
+/* Rewrite the journal with one line per directive; caller holds the lock */
+static int journal_compact(const char *path) {
+    journal_read(path);
+
+    size_t cap = 1;
+    till_hash_entry_t *entry;
+    till_hash_foreach(&journal, entry) {
+        cap += strlen(entry->key) + 24;
+    }
+
+    char *buf = malloc(cap);
+    if (!buf) {
+        return -1;
+    }
+
+    size_t len = 0;
+    till_hash_foreach(&journal, entry) {
+        len += snprintf(buf + len, cap - len, "%s\t%ld\n", entry->key, entry->count);
+    }
+
+    int result = write_file_atomic(path, buf, len);
+    free(buf);
+
+    if (result == 0) {
+        till_log(LOG_DEBUG, "Compacted completion journal: %zu lines -> %zu",
+                 journal_lines, journal.count);
+        journal_lines = journal.count;
+        journal_torn = 0;
+    }
+    return result;
+}
+
+int is_directive_completed(const char *directive_id) {
+    journal_load();
+    return till_hash_find(&journal, directive_id) != NULL;
+}
+
+int mark_directive_completed(const char *directive_id) {
+    char path[TILL_MAX_PATH];
+    char lock_path[TILL_MAX_PATH];
+    char line[128];
+
+    journal_load();
+    if (till_hash_find(&journal, directive_id)) {
+        return 0;
+    }
+
+    /* The id is the line key - it must not contain the separators */
+    if (directive_id[0] == '\0' || strpbrk(directive_id, "\t\n") ||
+        strlen(directive_id) >= sizeof(line) - 32) {
+        till_warn("Cannot record directive id '%s'", directive_id);
+        return -1;
+    }
+
+    if (get_journal_path(path, sizeof(path)) != 0) {
+        return -1;
+    }
+    if (snprintf(lock_path, sizeof(lock_path), "%s.lock", path) >= (int)sizeof(lock_path)) {
+        till_error("Completion journal path too long: %s", path);
+        return -1;
+    }
+
+    int lock_fd = acquire_lock_file(lock_path, LOCK_TIMEOUT * 1000);
+    if (lock_fd < 0) {
+        till_error("Cannot lock completion journal");
+        return -1;
+    }
+
+    long now = (long)time(NULL);
+    till_hash_entry_t *entry = till_hash_upsert(&journal, directive_id, NULL);
+    if (entry) {
+        entry->count = now;
+    }
+
+    int result = 0;
+    if (journal_torn ||
+        (journal_lines + 1 >= JOURNAL_COMPACT_MIN && journal_lines + 1 > journal.count * 2)) {
+        /* Rewriting also drops a torn tail we would otherwise append after */
+        result = journal_compact(path);
+    } else {
+        int len = snprintf(line, sizeof(line), "%s\t%ld\n", directive_id, now);
+        int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, TILL_FILE_PERMS);
+
+        if (fd < 0 || write(fd, line, len) != len || fsync(fd) != 0) {
+            result = -1;
+        } else {
+            journal_lines++;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    release_lock_file(lock_fd);
+
+    if (result != 0) {
+        till_hash_remove(&journal, directive_id);
+        till_error("Failed to record completion of directive %s", directive_id);
+    }
+    return result;
+}
@@ -0,0 +1,226 @@
+/*
+ * till_federation_menu.c - Menu of the day fetch and cache for Till Federation
+ *
+ * The menu is cached under ~/.till/federation/menu together with the
+ * validators it was served with. Within TTL_ANNOUNCEMENT the cached copy
+ * is used without touching the network; after that it is revalidated
+ * with If-None-Match/If-Modified-Since, so an unchanged menu costs a 304.
+ * If the fetch fails, a cached menu younger than TTL_PUBLIC_FACE is used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "till_federation.h"
+#include "till_condition.h"
+#include "till_federation_transport.h"
+#include "till_config.h"
+#include "till_constants.h"
+#include "till_common.h"
+#include "till_security.h"
+#include "cJSON.h"
+
+#define MENU_CACHE_DIR "menu"
+#define MENU_CACHE_FILE "latest.json"
+#define MENU_META_FILE "latest.meta.json"
+
+/* Copy a string member of a directive into a fixed field */
+static void copy_member(char *dest, size_t size, const cJSON *obj, const char *key,
+                        const char *fallback) {
+    const char *value = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(obj, key));
+    safe_strncpy(dest, value ? value : fallback, size);
+}
+
+/* Parse menu JSON into a menu_t */
+static int parse_menu(const char *text, menu_t *menu) {
+    cJSON *json = cJSON_Parse(text);
+    if (!json) {
+        return -1;
+    }
+
+    memset(menu, 0, sizeof(*menu));
+    copy_member(menu->date, sizeof(menu->date), json, "date", "");
+    copy_member(menu->version, sizeof(menu->version), json, "version", "");
+
+    cJSON *directives = cJSON_GetObjectItemCaseSensitive(json, "directives");
+    int count = cJSON_IsArray(directives) ? cJSON_GetArraySize(directives) : 0;
+    if (count > 0) {
+        menu->directives = calloc(count, sizeof(directive_t));
+        if (!menu->directives) {
+            cJSON_Delete(json);
+            return -1;
+        }
+
+        cJSON *item;
+        cJSON_ArrayForEach(item, directives) {
+            directive_t *d = &menu->directives[menu->directive_count];
+            copy_member(d->id, sizeof(d->id), item, "id", "");
+            if (d->id[0] == '\0') {
+                continue;  /* Can't track completion without an id */
+            }
+            copy_member(d->type, sizeof(d->type), item, "type", "script");
+            copy_member(d->target, sizeof(d->target), item, "target", "till");
+            copy_member(d->condition, sizeof(d->condition), item, "condition", "");
+            copy_member(d->action, sizeof(d->action), item, "action", "");
+            copy_member(d->priority, sizeof(d->priority), item, "priority", "medium");
+            d->report_back = cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(item, "report_back"));
+            d->timeout = json_get_int(item, "timeout", 0);
+
+            /* Compile once here; evaluation then only reads facts */
+            char error[256];
+            d->compiled = till_condition_compile(d->condition, error, sizeof(error));
+            if (!d->compiled) {
+                till_warn("Directive %s has an invalid condition: %s", d->id, error);
+            }
+            menu->directive_count++;
+        }
+    }
+
+    cJSON *announcements = cJSON_GetObjectItemCaseSensitive(json, "announcements");
+    count = cJSON_IsArray(announcements) ? cJSON_GetArraySize(announcements) : 0;
+    if (count > 0) {
+        menu->announcements = calloc(count, sizeof(char *));
+        cJSON *item;
+        cJSON_ArrayForEach(item, announcements) {
+            if (menu->announcements && cJSON_IsString(item)) {
+                menu->announcements[menu->announcement_count++] = strdup(item->valuestring);
+            }
+        }
+    }
+
+    cJSON_Delete(json);
+    return 0;
+}
+
+/* Free everything fetch_menu_of_the_day allocated */
+void free_menu(menu_t *menu) {
+    for (int i = 0; i < menu->announcement_count; i++) {
+        free(menu->announcements[i]);
+    }
+    free(menu->announcements);
+    for (int i = 0; i < menu->directive_count; i++) {
+        till_condition_free(menu->directives[i].compiled);
+    }
+    free(menu->directives);
+    memset(menu, 0, sizeof(*menu));
+}
+
+/* Read a whole file, NULL if missing */
+static char *read_file(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *data = (size >= 0 && size <= JSON_MAX_SIZE) ? malloc(size + 1) : NULL;
+    if (data) {
+        size_t n = fread(data, 1, size, fp);
+        data[n] = '\0';
+    }
+    fclose(fp);
+    return data;
+}
+
+/* Fetch the menu of the day, from cache when fresh */
+int fetch_menu_of_the_day(menu_t *menu) {
+    char dir[TILL_MAX_PATH];
+    char cache_path[TILL_MAX_PATH];
+    char meta_path[TILL_MAX_PATH];
+    char url[TILL_MAX_URL];
+
+    memset(menu, 0, sizeof(*menu));
+    snprintf(url, sizeof(url), "%s%s", federation_base_url(), MENU_OF_THE_DAY_PATH);
+
+    if (get_federation_state_dir(dir, sizeof(dir), MENU_CACHE_DIR) != 0) {
+        till_error("Cannot create federation state directory");
+        return -1;
+    }
+    if (snprintf(cache_path, sizeof(cache_path), "%s/%s", dir, MENU_CACHE_FILE) >= (int)sizeof(cache_path) ||
+        snprintf(meta_path, sizeof(meta_path), "%s/%s", dir, MENU_META_FILE) >= (int)sizeof(meta_path)) {
+        till_error("Menu cache path too long: %s", dir);
+        return -1;
+    }
+
+    /* Cache metadata: where it came from, validators, when last checked */
+    cJSON *meta = load_json_file(meta_path);
+    if (meta && strcmp(json_get_string(meta, "url", ""), url) != 0) {
+        cJSON_Delete(meta);  /* Different source - start over */
+        meta = NULL;
+    }
+    if (!meta) {
+        meta = cJSON_CreateObject();
+    }
+
+    time_t now = time(NULL);
+    time_t checked = (time_t)json_get_int(meta, "checked", 0);
+    char *cached = read_file(cache_path);
+    if (!cached) {
+        checked = 0;
+    }
+
+    char *text = NULL;
+    if (cached && now - checked < (time_t)(TTL_ANNOUNCEMENT * 3600)) {
+        till_log(LOG_DEBUG, "Menu cache is fresh, not revalidating");
+        text = cached;
+        cached = NULL;
+    } else {
+        federation_response_t resp;
+        const char *etag = cached ? json_get_string(meta, "etag", NULL) : NULL;
+        const char *modified = cached ? json_get_string(meta, "last_modified", NULL) : NULL;
+
+        int rc = federation_get(url, etag, modified, &resp);
+        if (rc == 0 && resp.status == 304 && cached) {
+            till_log(LOG_DEBUG, "Menu not modified");
+            text = cached;
+            cached = NULL;
+        } else if (rc == 0 && resp.status == 200 && resp.body) {
+            write_file_atomic(cache_path, resp.body, resp.body_len);
+            text = resp.body;
+            resp.body = NULL;
+        } else if (cached && now - checked < (time_t)(TTL_PUBLIC_FACE * 3600)) {
+            till_warn("Cannot reach federation (status %d), using cached menu", resp.status);
+            text = cached;
+            cached = NULL;
+            now = checked;  /* Still stale - retry next time */
+        } else {
+            till_error("Failed to fetch menu of the day (status %d)", resp.status);
+        }
+
+        if (text && now != checked) {
+            json_set_string(meta, "url", url);
+            /* A new body without validators must not keep the old ones,
+             * or the next request would revalidate against stale data */
+            if (resp.status == 200) {
+                cJSON_DeleteItemFromObject(meta, "etag");
+                cJSON_DeleteItemFromObject(meta, "last_modified");
+            }
+            if (resp.etag[0]) json_set_string(meta, "etag", resp.etag);
+            if (resp.last_modified[0]) json_set_string(meta, "last_modified", resp.last_modified);
+            cJSON_DeleteItemFromObject(meta, "checked");
+            cJSON_AddNumberToObject(meta, "checked", (double)now);
+            save_json_file(meta_path, meta);
+        }
+        federation_response_free(&resp);
+    }
+
+    free(cached);
+    cJSON_Delete(meta);
+
+    if (!text) {
+        return -1;
+    }
+
+    int result = parse_menu(text, menu);
+    if (result != 0) {
+        till_error("Menu of the day is not valid JSON");
+    }
+    free(text);
+    return result;
+}
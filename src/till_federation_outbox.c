@@ -0,0 +1,521 @@
+/*
+ * till_federation_outbox.c - Queued federation operations for Till
+ *
+ * Gist operations that need GitHub (status pushes, directive reports,
+ * gist deletes) are written to ~/.till/federation/outbox first and sent
+ * from there, so nothing is lost while the API is unreachable. Each item
+ * is one JSON file named after what it replaces:
+ *
+ *   status-<site>.json   latest status document (a newer one overwrites it)
+ *   report-<site>.json   directive results, merged by directive id
+ *   delete-<gist>.json   gist to delete
+ *
+ * The outbox is flushed after the first successful connectivity check in
+ * a process. A flush claims an item by renaming it to *.sending, sends it
+ * without holding any lock, and puts it back (merging with anything queued
+ * meanwhile) if the send fails. Only one process flushes at a time; the
+ * others leave the outbox alone rather than wait.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "till_federation.h"
+#include "till_federation_transport.h"
+#include "till_config.h"
+#include "till_constants.h"
+#include "till_common.h"
+#include "till_security.h"
+#include "cJSON.h"
+
+#define OUTBOX_DIR "outbox"
+#define OUTBOX_LOCK ".lock"          /* Held while items are read or written */
+#define OUTBOX_FLUSH_LOCK ".flush"   /* Held for a whole flush */
+#define OUTBOX_CLAIMED ".sending"
+
+/* Flush order: deletes before statuses, statuses (which recreate gists) before reports */
+static const char *const flush_order[] = { "delete-", "status-", "report-" };
+
+static int get_outbox_dir(char *path, size_t size) {
+    return get_federation_state_dir(path, size, OUTBOX_DIR);
+}
+
+/* Item file for op and key; keys are site ids or gist ids */
+static int get_item_path(char *path, size_t size, const char *op, const char *key) {
+    char dir[TILL_MAX_PATH];
+    char name[160];
+
+    if (get_outbox_dir(dir, sizeof(dir)) != 0) {
+        return -1;
+    }
+    safe_strncpy(name, key, sizeof(name));
+    sanitize_filename(name);
+    return snprintf(path, size, "%s/%s-%s.json", dir, op, name) < (int)size ? 0 : -1;
+}
+
+static int lock_outbox(int timeout_ms, const char *which) {
+    char path[TILL_MAX_PATH];
+    char dir[TILL_MAX_PATH];
+
+    if (get_outbox_dir(dir, sizeof(dir)) != 0) {
+        return -1;
+    }
+    if (snprintf(path, sizeof(path), "%s/%s", dir, which) >= (int)sizeof(path)) {
+        return -1;
+    }
+    return acquire_lock_file(path, timeout_ms);
+}
+
+/* Add older results not superseded in newer (matched by directive id) */
+static void merge_report(cJSON *newer, cJSON *older) {
+    cJSON *results = cJSON_GetObjectItem(newer, "results");
+    cJSON *old_results = cJSON_GetObjectItem(older, "results");
+    cJSON *old;
+
+    if (!cJSON_IsArray(results)) {
+        return;
+    }
+    cJSON_ArrayForEach(old, old_results) {
+        const char *id = json_get_string(old, "id", "");
+        int superseded = 0;
+        cJSON *r;
+        cJSON_ArrayForEach(r, results) {
+            if (strcmp(json_get_string(r, "id", ""), id) == 0) {
+                superseded = 1;
+                break;
+            }
+        }
+        if (!superseded) {
+            cJSON_AddItemToArray(results, cJSON_Duplicate(old, 1));
+        }
+    }
+}
+
+/* Write item to path, coalescing with what is queued there; caller holds the lock */
+static int store_item(const char *path, cJSON *item) {
+    const char *op = json_get_string(item, "op", "");
+
+    if (strcmp(op, "report") == 0) {
+        cJSON *queued = load_json_file(path);
+        if (queued) {
+            merge_report(cJSON_GetObjectItem(item, "report"),
+                         cJSON_GetObjectItem(queued, "report"));
+            cJSON_Delete(queued);
+        }
+    }
+    /* A status or delete simply replaces the queued one */
+    return save_json_file(path, item);
+}
+
+static int enqueue(const char *op, const char *key, cJSON *item) {
+    char path[TILL_MAX_PATH];
+
+    cJSON_AddStringToObject(item, "op", op);
+    cJSON_AddNumberToObject(item, "queued_at", (double)time(NULL));
+
+    if (get_item_path(path, sizeof(path), op, key) != 0) {
+        cJSON_Delete(item);
+        return -1;
+    }
+
+    int lock_fd = lock_outbox(LOCK_TIMEOUT * 1000, OUTBOX_LOCK);
+    if (lock_fd < 0) {
+        till_error("Cannot lock federation outbox");
+        cJSON_Delete(item);
+        return -1;
+    }
+    int result = store_item(path, item);
+    release_lock_file(lock_fd);
+    cJSON_Delete(item);
+
+    if (result == 0) {
+        till_log(LOG_DEBUG, "Queued federation %s for %s", op, key);
+    }
+    return result;
+}
+
+int federation_outbox_status(const char *site_id, const char *content,
+                             const char *hash, int heartbeat) {
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "site_id", site_id);
+    cJSON_AddStringToObject(item, "hash", hash ? hash : "");
+    cJSON_AddBoolToObject(item, "heartbeat", heartbeat);
+    cJSON_AddStringToObject(item, "content", content);
+    return enqueue("status", site_id, item);
+}
+
+int federation_outbox_report(const char *site_id, const char *content) {
+    cJSON *report = cJSON_Parse(content);
+    if (!report) {
+        return -1;
+    }
+
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "site_id", site_id);
+    cJSON_AddItemToObject(item, "report", report);
+    return enqueue("report", site_id, item);
+}
+
+int federation_outbox_delete(const char *gist_id) {
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "gist_id", gist_id);
+    return enqueue("delete", gist_id, item);
+}
+
+/* Directory listing of queued (and claimed) item names */
+typedef struct {
+    char **names;
+    int count;
+    int cap;
+} outbox_list_t;
+
+static int is_item_name(const char *name) {
+    size_t len = strlen(name);
+    return name[0] != '.' &&
+           ((len > 5 && strcmp(name + len - 5, ".json") == 0) ||
+            (len > 13 && strcmp(name + len - 13, ".json" OUTBOX_CLAIMED) == 0));
+}
+
+static int collect_item(const char *path, const char *name, void *context) {
+    outbox_list_t *list = context;
+    (void)path;
+
+    if (!is_item_name(name)) {
+        return 0;  /* Lock files, save_json_file temporaries */
+    }
+    if (list->count == list->cap) {
+        int cap = list->cap ? list->cap * 2 : 16;
+        char **names = realloc(list->names, cap * sizeof(char *));
+        if (!names) {
+            return -1;
+        }
+        list->names = names;
+        list->cap = cap;
+    }
+    list->names[list->count] = strdup(name);
+    if (list->names[list->count]) {
+        list->count++;
+    }
+    return 0;
+}
+
+static void list_items(outbox_list_t *list) {
+    char dir[TILL_MAX_PATH];
+
+    memset(list, 0, sizeof(*list));
+    if (get_outbox_dir(dir, sizeof(dir)) == 0) {
+        foreach_dir_entry(dir, collect_item, list);
+    }
+}
+
+static void free_list(outbox_list_t *list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->names[i]);
+    }
+    free(list->names);
+}
+
+int federation_outbox_pending(void) {
+    outbox_list_t list;
+    list_items(&list);
+    int count = list.count;
+    free_list(&list);
+    return count;
+}
+
+/* Put a claimed item back, unless something newer replaced it; caller holds the lock */
+static void restore_item(const char *claimed_path) {
+    char path[TILL_MAX_PATH];
+
+    safe_strncpy(path, claimed_path, sizeof(path));
+    path[strlen(path) - strlen(OUTBOX_CLAIMED)] = '\0';
+
+    cJSON *item = load_json_file(claimed_path);
+    cJSON *queued = path_exists(path) ? load_json_file(path) : NULL;
+
+    if (!queued) {
+        rename(claimed_path, path);
+    } else {
+        /* What was queued meanwhile is newer; only reports keep older parts */
+        if (item && strcmp(json_get_string(item, "op", ""), "report") == 0) {
+            merge_report(cJSON_GetObjectItem(queued, "report"),
+                         cJSON_GetObjectItem(item, "report"));
+            save_json_file(path, queued);
+        }
+        unlink(claimed_path);
+    }
+    cJSON_Delete(item);
+    cJSON_Delete(queued);
+}
+
+/* A heartbeat must not replace a full status the admin hasn't read yet.
+ * If the gist still holds one, *merged is set to that status with the
+ * heartbeat's last_sync, to send instead. -1 if the gist can't be read */
+static int merge_heartbeat(const char *gist_id, const char *heartbeat, char **merged) {
+    char *existing;
+
+    *merged = NULL;
+    int result = fetch_gist_file(gist_id, "status.json", &existing);
+    if (result == GIST_NOT_FOUND) {
+        return 0;  /* Processed; the heartbeat starts a new gist */
+    }
+    if (result != 0) {
+        return -1;
+    }
+
+    char *status_text = unpack_status_json(existing);
+    char *beat_text = unpack_status_json(heartbeat);
+    free(existing);
+    cJSON *status = status_text ? cJSON_Parse(status_text) : NULL;
+    cJSON *beat = beat_text ? cJSON_Parse(beat_text) : NULL;
+    free(status_text);
+    free(beat_text);
+
+    cJSON *last_sync = cJSON_GetObjectItem(beat, "last_sync");
+    if (status && cJSON_IsNumber(last_sync) &&
+        !json_get_bool(status, "heartbeat", 0) &&
+        strcmp(json_get_string(status, "site_id", ""), json_get_string(beat, "site_id", "")) == 0) {
+        cJSON_DeleteItemFromObject(status, "last_sync");
+        cJSON_AddNumberToObject(status, "last_sync", last_sync->valuedouble);
+        char *json = cJSON_PrintUnformatted(status);
+        *merged = json ? pack_status_json(json) : NULL;
+        cJSON_free(json);
+        result = *merged ? 0 : -1;
+    }
+    cJSON_Delete(status);
+    cJSON_Delete(beat);
+    return result;
+}
+
+/* Send a status, recreating the gist if the admin has processed it */
+static int deliver_status(federation_config_t *config, cJSON *item) {
+    const char *content = json_get_string(item, "content", NULL);
+    int heartbeat = json_get_bool(item, "heartbeat", 0);
+    int result = GIST_NOT_FOUND;
+    char *merged = NULL;
+
+    if (!content) {
+        return 0;  /* Nothing to send; drop it */
+    }
+
+    if (config->gist_id[0] != '\0') {
+        if (heartbeat) {
+            if (merge_heartbeat(config->gist_id, content, &merged) != 0) {
+                return -1;
+            }
+            if (merged) {
+                content = merged;
+                till_log(LOG_DEBUG, "Gist %s still holds an unread status; refreshing it",
+                         config->gist_id);
+            }
+        }
+        printf("  Updating gist %s...\n", heartbeat ? "(heartbeat)" : "status");
+        result = update_federation_gist(config->gist_id, content);
+    }
+
+    if (result == GIST_NOT_FOUND) {
+        /* Deleted since the merge looked - the heartbeat alone is right now */
+        content = json_get_string(item, "content", NULL);
+        printf("  Creating GitHub gist...\n");
+        if (create_federation_gist(config->site_id, config->gist_id,
+                                   sizeof(config->gist_id)) != 0) {
+            free(merged);
+            return -1;
+        }
+        printf("  Created gist: %s\n", config->gist_id);
+        save_federation_config(config);
+        result = update_federation_gist(config->gist_id, content);
+    }
+    free(merged);
+    if (result != 0) {
+        return -1;
+    }
+
+    /* Record what was sent */
+    time_t now = time(NULL);
+    config->last_sync = now;
+    config->last_push = now;
+    if (!heartbeat) {
+        config->last_full_push = now;
+        snprintf(config->last_push_hash, sizeof(config->last_push_hash), "%s",
+                 json_get_string(item, "hash", ""));
+    }
+    save_federation_config(config);
+    return 0;
+}
+
+static int deliver_report(const federation_config_t *config, cJSON *item) {
+    char *json = cJSON_Print(cJSON_GetObjectItem(item, "report"));
+    if (!json) {
+        return 0;
+    }
+
+    /* A missing gist is recreated by the next status push; keep the report until then */
+    int result = update_federation_gist_file(config->gist_id, FEDERATION_REPORT_FILE, json);
+    if (result == 0) {
+        printf("  Reported %d directive result(s)\n",
+               cJSON_GetArraySize(cJSON_GetObjectItem(cJSON_GetObjectItem(item, "report"),
+                                                      "results")));
+    }
+    free(json);
+    return result == 0 ? 0 : -1;
+}
+
+/* Send one item: 0 sent (or obsolete), -1 keep it queued */
+static int deliver_item(cJSON *item) {
+    const char *op = json_get_string(item, "op", "");
+
+    if (strcmp(op, "delete") == 0) {
+        return delete_federation_gist(json_get_string(item, "gist_id", ""));
+    }
+
+    /* Statuses and reports belong to this site's current membership */
+    federation_config_t config;
+    if (!federation_is_joined() || load_federation_config(&config) != 0 ||
+        strcmp(config.site_id, json_get_string(item, "site_id", "")) != 0 ||
+        strcmp(config.trust_level, TRUST_ANONYMOUS) == 0) {
+        till_log(LOG_INFO, "Dropping queued federation %s for a site no longer joined", op);
+        return 0;
+    }
+
+    if (strcmp(op, "status") == 0) {
+        return deliver_status(&config, item);
+    }
+    if (strcmp(op, "report") == 0) {
+        if (config.gist_id[0] == '\0') {
+            return -1;
+        }
+        return deliver_report(&config, item);
+    }
+    return 0;  /* Unknown op from a newer till - nothing we can do with it */
+}
+
+/* Send what is queued; wait_ms is how long to wait for a flush already
+ * in progress. Returns operations still queued */
+static int flush_outbox(int wait_ms) {
+    char dir[TILL_MAX_PATH];
+    char path[TILL_MAX_PATH];
+    outbox_list_t list;
+
+    if (get_outbox_dir(dir, sizeof(dir)) != 0) {
+        return -1;
+    }
+
+    /* Someone else is flushing - they will send what we queued */
+    int flush_fd = lock_outbox(wait_ms, OUTBOX_FLUSH_LOCK);
+    if (flush_fd < 0) {
+        till_log(LOG_DEBUG, "Federation outbox flush already in progress");
+        return federation_outbox_pending();
+    }
+
+    list_items(&list);
+
+    /* Claims left by a flush that died part way */
+    int lock_fd = lock_outbox(LOCK_TIMEOUT * 1000, OUTBOX_LOCK);
+    for (int i = 0; lock_fd >= 0 && i < list.count; i++) {
+        size_t len = strlen(list.names[i]);
+        if (len > strlen(OUTBOX_CLAIMED) &&
+            strcmp(list.names[i] + len - strlen(OUTBOX_CLAIMED), OUTBOX_CLAIMED) == 0 &&
+            snprintf(path, sizeof(path), "%s/%s", dir, list.names[i]) < (int)sizeof(path)) {
+            restore_item(path);
+            list.names[i][len - strlen(OUTBOX_CLAIMED)] = '\0';
+        }
+    }
+    release_lock_file(lock_fd);
+
+    int failed = 0;
+    for (size_t pass = 0; !failed && pass < sizeof(flush_order) / sizeof(flush_order[0]); pass++) {
+        for (int i = 0; !failed && i < list.count; i++) {
+            const char *name = list.names[i];
+            if (strncmp(name, flush_order[pass], strlen(flush_order[pass])) != 0) {
+                continue;
+            }
+
+            char claimed[TILL_MAX_PATH];
+            if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path) ||
+                snprintf(claimed, sizeof(claimed), "%s%s", path, OUTBOX_CLAIMED) >= (int)sizeof(claimed)) {
+                till_warn("Skipping outbox item with too long a path: %s", name);
+                continue;
+            }
+
+            lock_fd = lock_outbox(LOCK_TIMEOUT * 1000, OUTBOX_LOCK);
+            if (lock_fd < 0) {
+                failed = 1;
+                break;
+            }
+            cJSON *item = load_json_file(path);
+            int claimed_ok = item && rename(path, claimed) == 0;
+            if (!item && path_exists(path)) {
+                unlink(path);  /* Unreadable - it will never send */
+            }
+            release_lock_file(lock_fd);
+
+            if (!claimed_ok) {
+                cJSON_Delete(item);
+                continue;
+            }
+
+            /* Stop at the first failure; the API is down or refusing us */
+            if (deliver_item(item) == 0) {
+                unlink(claimed);
+            } else {
+                failed = 1;
+                lock_fd = lock_outbox(LOCK_TIMEOUT * 1000, OUTBOX_LOCK);
+                restore_item(claimed);
+                release_lock_file(lock_fd);
+            }
+            cJSON_Delete(item);
+        }
+    }
+
+    free_list(&list);
+    release_lock_file(flush_fd);
+
+    int remaining = federation_outbox_pending();
+    if (remaining > 0) {
+        till_log(LOG_INFO, "Federation outbox: %d operation(s) still queued", remaining);
+    }
+    return remaining;
+}
+
+int federation_outbox_flush(void) {
+    return flush_outbox(1);
+}
+
+int federation_outbox_flush_item(const char *op, const char *key) {
+    char path[TILL_MAX_PATH];
+    char claimed[TILL_MAX_PATH];
+
+    /* A flush in progress may be sending this very item - let it finish */
+    flush_outbox(LOCK_TIMEOUT * 1000);
+
+    if (get_item_path(path, sizeof(path), op, key) != 0 ||
+        snprintf(claimed, sizeof(claimed), "%s%s", path, OUTBOX_CLAIMED) >= (int)sizeof(claimed)) {
+        return -1;
+    }
+    return path_exists(path) || path_exists(claimed) ? -1 : 0;
+}
+
+/* Is the gist service usable right now? Checked once per process */
+int federation_check_connectivity(void) {
+    static int checked = 0;
+    static int online = 0;
+
+    if (checked) {
+        return online;
+    }
+    checked = 1;
+    online = federation_gists()->probe();
+
+    int pending = online ? federation_outbox_pending() : 0;
+    if (pending > 0) {
+        printf("  Sending %d queued federation operation(s)...\n", pending);
+        int remaining = federation_outbox_flush();
+        printf("  Outbox: %d sent, %d still queued\n", pending - remaining, remaining);
+    }
+    return online;
+}
@@ -0,0 +1,243 @@
+/*
+ * till_federation_stats.c - Site aggregation for federation admin reports
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "till_federation_stats.h"
+
+#define SECONDS_PER_DAY 86400
+
+void federation_stats_init(federation_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    till_hash_init(&stats->sites);
+    till_hash_init(&stats->by_platform);
+    till_hash_init(&stats->by_trust);
+    till_hash_init(&stats->by_version);
+    till_hash_init(&stats->by_installations);
+    till_hash_init(&stats->by_cpu);
+}
+
+static void free_rollups(federation_stats_t *stats) {
+    till_hash_free(&stats->by_platform, NULL);
+    till_hash_free(&stats->by_trust, NULL);
+    till_hash_free(&stats->by_version, NULL);
+    till_hash_free(&stats->by_installations, NULL);
+    till_hash_free(&stats->by_cpu, NULL);
+}
+
+void federation_stats_free(federation_stats_t *stats) {
+    till_hash_free(&stats->sites, free);
+    free_rollups(stats);
+}
+
+/* Copy a string field, substituting fallback when missing */
+static void copy_field(char *dest, size_t size, const cJSON *obj,
+                       const char *key, const char *fallback) {
+    const char *value = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(obj, key));
+    snprintf(dest, size, "%s", value ? value : fallback);
+}
+
+/* Fill a site from a status or report entry under the given site_id */
+static int fill_site(const cJSON *status, const char *site_id, federation_site_t *site) {
+    memset(site, 0, sizeof(*site));
+    if (site_id == NULL || site_id[0] == '\0') {
+        return -1;
+    }
+
+    snprintf(site->site_id, sizeof(site->site_id), "%s", site_id);
+    copy_field(site->hostname, sizeof(site->hostname), status, "hostname", "unknown");
+    copy_field(site->platform, sizeof(site->platform), status, "platform", "unknown");
+    copy_field(site->trust_level, sizeof(site->trust_level), status, "trust_level", "unknown");
+    copy_field(site->gist_id, sizeof(site->gist_id), status, "gist_id", "");
+
+    /* Older clients send the version as a string, newer ones as a number */
+    const cJSON *version = cJSON_GetObjectItemCaseSensitive(status, "till_version");
+    if (cJSON_IsNumber(version)) {
+        snprintf(site->till_version, sizeof(site->till_version), "%g", version->valuedouble);
+    } else {
+        copy_field(site->till_version, sizeof(site->till_version), status, "till_version", "unknown");
+    }
+
+    site->last_sync = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(status, "last_sync"));
+    site->installation_count = (int)cJSON_GetNumberValue(
+        cJSON_GetObjectItemCaseSensitive(status, "installation_count"));
+    site->cpu_count = (int)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(status, "cpu_count"));
+    site->heartbeat = cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(status, "heartbeat"));
+
+    /* cJSON_GetNumberValue returns NaN for missing items */
+    if (site->last_sync != site->last_sync) site->last_sync = 0;
+    if (site->installation_count < 0) site->installation_count = 0;
+    if (site->cpu_count < 0) site->cpu_count = 0;
+
+    return 0;
+}
+
+int federation_site_from_json(const cJSON *status, federation_site_t *site) {
+    const char *site_id = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(status, "site_id"));
+    return fill_site(status, site_id, site);
+}
+
+int federation_stats_add_site(federation_stats_t *stats, const federation_site_t *site) {
+    int created;
+    till_hash_entry_t *entry = till_hash_upsert(&stats->sites, site->site_id, &created);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    if (created && site->heartbeat) {
+        /* Nothing to report about a site until its full status arrives */
+        till_hash_remove(&stats->sites, site->site_id);
+        stats->orphan_heartbeats++;
+        return -1;
+    }
+    if (created) {
+        entry->value = malloc(sizeof(federation_site_t));
+        if (entry->value == NULL) {
+            till_hash_remove(&stats->sites, site->site_id);
+            return -1;
+        }
+        memcpy(entry->value, site, sizeof(federation_site_t));
+        return 1;
+    }
+
+    /* Same site reported more than once - the latest sync wins. Only
+     * reports from the same run count as duplicates; replacing a site
+     * carried over from a previous report is the normal update path. */
+    federation_site_t *existing = entry->value;
+    if (existing->processed_at == site->processed_at) {
+        stats->duplicates++;
+    }
+    if (site->last_sync <= existing->last_sync) {
+        return -1;
+    }
+
+    if (site->heartbeat) {
+        existing->last_sync = site->last_sync;
+        existing->processed_at = site->processed_at;
+        memcpy(existing->gist_id, site->gist_id, sizeof(existing->gist_id));
+    } else {
+        memcpy(existing, site, sizeof(federation_site_t));
+    }
+    return 0;
+}
+
+int federation_stats_load_sites(federation_stats_t *stats, const cJSON *sites) {
+    const cJSON *item;
+    int loaded = 0;
+
+    cJSON_ArrayForEach(item, sites) {
+        if (item->string == NULL || !cJSON_IsObject(item)) continue;
+
+        /* Report sites are keyed by site_id rather than carrying it */
+        federation_site_t site;
+        if (fill_site(item, item->string, &site) != 0) continue;
+
+        site.processed_at = (time_t)cJSON_GetNumberValue(
+            cJSON_GetObjectItemCaseSensitive(item, "processed_at"));
+        if (federation_stats_add_site(stats, &site) >= 0) {
+            loaded++;
+        }
+    }
+
+    return loaded;
+}
+
+int federation_stats_expire(federation_stats_t *stats, time_t cutoff) {
+    till_hash_entry_t *entry;
+    int removed = 0;
+
+    till_hash_foreach(&stats->sites, entry) {
+        const federation_site_t *site = entry->value;
+
+        /* Sites that never synced age out from when we first saw them */
+        double seen = site->last_sync > 0 ? site->last_sync : (double)site->processed_at;
+        if (seen < (double)cutoff) {
+            free(till_hash_remove(&stats->sites, entry->key));
+            removed++;
+        }
+    }
+    return removed;
+}
+
+static const char *installation_bucket(int count) {
+    if (count <= 0) return "0";
+    if (count == 1) return "1";
+    if (count <= 5) return "2-5";
+    if (count <= 10) return "6-10";
+    if (count <= 25) return "11-25";
+    return "26+";
+}
+
+void federation_stats_rollup(federation_stats_t *stats, time_t now) {
+    till_hash_entry_t *entry;
+    char key[32];
+
+    free_rollups(stats);
+    stats->active_24h = 0;
+    stats->active_7d = 0;
+
+    till_hash_foreach(&stats->sites, entry) {
+        const federation_site_t *site = entry->value;
+
+        till_hash_incr(&stats->by_platform, site->platform, 1);
+        till_hash_incr(&stats->by_trust, site->trust_level, 1);
+        till_hash_incr(&stats->by_version, site->till_version, 1);
+        till_hash_incr(&stats->by_installations, installation_bucket(site->installation_count), 1);
+        snprintf(key, sizeof(key), "%d", site->cpu_count);
+        till_hash_incr(&stats->by_cpu, key, 1);
+
+        if (site->last_sync > 0) {
+            double age = (double)now - site->last_sync;
+            if (age < SECONDS_PER_DAY) stats->active_24h++;
+            if (age < 7 * SECONDS_PER_DAY) stats->active_7d++;
+        }
+    }
+}
+
+static cJSON *histogram_json(const till_hash_t *map) {
+    cJSON *obj = cJSON_CreateObject();
+    till_hash_entry_t *entry;
+
+    till_hash_foreach(map, entry) {
+        cJSON_AddNumberToObject(obj, entry->key, entry->count);
+    }
+    return obj;
+}
+
+cJSON *federation_stats_sites_json(const federation_stats_t *stats) {
+    cJSON *sites = cJSON_CreateObject();
+    till_hash_entry_t *entry;
+
+    till_hash_foreach(&stats->sites, entry) {
+        const federation_site_t *site = entry->value;
+        cJSON *obj = cJSON_CreateObject();
+
+        cJSON_AddStringToObject(obj, "hostname", site->hostname);
+        cJSON_AddStringToObject(obj, "platform", site->platform);
+        cJSON_AddStringToObject(obj, "trust_level", site->trust_level);
+        cJSON_AddStringToObject(obj, "till_version", site->till_version);
+        cJSON_AddNumberToObject(obj, "last_sync", site->last_sync);
+        cJSON_AddNumberToObject(obj, "installation_count", site->installation_count);
+        cJSON_AddNumberToObject(obj, "cpu_count", site->cpu_count);
+        cJSON_AddStringToObject(obj, "gist_id", site->gist_id);
+        cJSON_AddNumberToObject(obj, "processed_at", (double)site->processed_at);
+        cJSON_AddItemToObject(sites, site->site_id, obj);
+    }
+    return sites;
+}
+
+cJSON *federation_stats_rollup_json(const federation_stats_t *stats) {
+    cJSON *rollup = cJSON_CreateObject();
+
+    cJSON_AddItemToObject(rollup, "by_platform", histogram_json(&stats->by_platform));
+    cJSON_AddItemToObject(rollup, "by_trust_level", histogram_json(&stats->by_trust));
+    cJSON_AddItemToObject(rollup, "by_till_version", histogram_json(&stats->by_version));
+    cJSON_AddItemToObject(rollup, "by_installation_count", histogram_json(&stats->by_installations));
+    cJSON_AddItemToObject(rollup, "by_cpu_count", histogram_json(&stats->by_cpu));
+    cJSON_AddNumberToObject(rollup, "active_last_24h", stats->active_24h);
+    cJSON_AddNumberToObject(rollup, "active_last_7d", stats->active_7d);
+    return rollup;
+}
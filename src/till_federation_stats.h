@@ -0,0 +1,71 @@
+/*
+ * till_federation_stats.h - Site aggregation for federation admin reports
+ *
+ * Sites are deduplicated by site_id in a hash map; rollups are computed
+ * from the deduplicated set and converted to cJSON once, at the end.
+ */
+
+#ifndef TILL_FEDERATION_STATS_H
+#define TILL_FEDERATION_STATS_H
+
+#include <time.h>
+#include "till_hash.h"
+#include "cJSON.h"
+
+/* One reporting site */
+typedef struct {
+    char site_id[128];
+    char hostname[128];
+    char platform[32];
+    char trust_level[32];
+    char till_version[32];       /* As reported, "unknown" if absent */
+    char gist_id[64];
+    double last_sync;
+    int installation_count;
+    int cpu_count;
+    time_t processed_at;
+    int heartbeat;               /* Report only refreshes last_sync */
+} federation_site_t;
+
+/* Aggregated federation state */
+typedef struct {
+    till_hash_t sites;           /* site_id -> federation_site_t */
+    int duplicates;              /* Reports superseded by another for the same site */
+    int orphan_heartbeats;       /* Heartbeats from sites with no full status yet */
+
+    /* Rollups, valid after federation_stats_rollup() */
+    till_hash_t by_platform;
+    till_hash_t by_trust;
+    till_hash_t by_version;
+    till_hash_t by_installations;
+    till_hash_t by_cpu;
+    int active_24h;
+    int active_7d;
+} federation_stats_t;
+
+void federation_stats_init(federation_stats_t *stats);
+void federation_stats_free(federation_stats_t *stats);
+
+/* Fill a site from a status.json document; -1 if it has no site_id */
+int federation_site_from_json(const cJSON *status, federation_site_t *site);
+
+/* Add a site, keeping the report with the latest last_sync. A heartbeat
+ * for a known site only refreshes its last_sync, gist and processed time;
+ * one for an unknown site is only counted in orphan_heartbeats.
+ * Returns 1 if new, 0 if it replaced an older report, -1 if ignored */
+int federation_stats_add_site(federation_stats_t *stats, const federation_site_t *site);
+
+/* Load the "sites" object of a previous report; returns sites loaded */
+int federation_stats_load_sites(federation_stats_t *stats, const cJSON *sites);
+
+/* Drop sites not heard from since cutoff; returns sites removed */
+int federation_stats_expire(federation_stats_t *stats, time_t cutoff);
+
+/* Recompute all rollups from the current site set */
+void federation_stats_rollup(federation_stats_t *stats, time_t now);
+
+/* Build the report "sites" object and "statistics" rollups */
+cJSON *federation_stats_sites_json(const federation_stats_t *stats);
+cJSON *federation_stats_rollup_json(const federation_stats_t *stats);
+
+#endif /* TILL_FEDERATION_STATS_H */
@@ -0,0 +1,194 @@
+/*
+ * till_federation_transport.c - Pluggable transports for federation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "till_federation_transport.h"
+#include "till_federation.h"
+#include "till_config.h"
+#include "till_constants.h"
+#include "till_common.h"
+#include "till_hash.h"
+#include "till_security.h"
+
+static const federation_transport_t *transport_override = NULL;
+static const federation_gist_transport_t *gist_transport_override = NULL;
+
+const char *federation_base_url(void) {
+    const char *url = getenv("TILL_FEDERATION_URL");
+    return (url && *url) ? url : FEDERATION_REPO_URL;
+}
+
+void federation_transport_override(const federation_transport_t *transport) {
+    transport_override = transport;
+}
+
+const federation_gist_transport_t *federation_gists(void) {
+    const char *store = getenv("TILL_GIST_STORE");
+
+    if (gist_transport_override) {
+        return gist_transport_override;
+    }
+    return (store && *store) ? &federation_local_gists : &federation_gh_gists;
+}
+
+void federation_gist_transport_override(const federation_gist_transport_t *transport) {
+    gist_transport_override = transport;
+}
+
+void federation_response_free(federation_response_t *resp) {
+    free(resp->body);
+    memset(resp, 0, sizeof(*resp));
+}
+
+int federation_get(const char *url, const char *etag, const char *last_modified,
+                   federation_response_t *resp) {
+    const federation_transport_t *transport = transport_override;
+
+    memset(resp, 0, sizeof(*resp));
+    if (!transport) {
+        transport = strncmp(url, "file://", 7) == 0 ? &federation_file_transport
+                                                     : &federation_http_transport;
+    }
+
+    till_log(LOG_DEBUG, "Federation GET (%s): %s", transport->name, url);
+    return transport->get(url, etag, last_modified, resp);
+}
+
+/* Copy a header value (up to end of line) if line is that header */
+static int match_header(const char *line, const char *name, char *dest, size_t size) {
+    size_t len = strlen(name);
+    if (strncasecmp(line, name, len) != 0 || line[len] != ':') {
+        return 0;
+    }
+
+    const char *value = line + len + 1;
+    while (*value == ' ') value++;
+    size_t n = strcspn(value, "\r\n");
+    if (n >= size) n = size - 1;
+    memcpy(dest, value, n);
+    dest[n] = '\0';
+    return 1;
+}
+
+/* HTTP(S) via curl -i: status line, headers, blank line, body */
+static int http_get(const char *url, const char *etag, const char *last_modified,
+                    federation_response_t *resp) {
+    char cmd[TILL_MAX_COMMAND];
+    char header[256];
+    int len = snprintf(cmd, sizeof(cmd), "curl -sS -i --max-time %d", DEFAULT_TIMEOUT);
+
+    if (etag && *etag) {
+        snprintf(header, sizeof(header), "If-None-Match: %s", etag);
+        char *quoted = shell_quote(header);
+        len += snprintf(cmd + len, sizeof(cmd) - len, " -H %s", quoted ? quoted : "''");
+        free(quoted);
+    }
+    if (last_modified && *last_modified) {
+        snprintf(header, sizeof(header), "If-Modified-Since: %s", last_modified);
+        char *quoted = shell_quote(header);
+        len += snprintf(cmd + len, sizeof(cmd) - len, " -H %s", quoted ? quoted : "''");
+        free(quoted);
+    }
+
+    char *quoted_url = shell_quote(url);
+    if (!quoted_url) {
+        return -1;
+    }
+    snprintf(cmd + len, sizeof(cmd) - len, " %s 2>/dev/null", quoted_url);
+    free(quoted_url);
+
+    char *output;
+    if (run_command_capture_all(cmd, &output, FEDERATION_GIST_MAX) != 0) {
+        free(output);
+        return -1;
+    }
+
+    /* Skip interim 1xx responses; the final one carries the validators */
+    char *block = output;
+    char *body = NULL;
+    while (block && strncmp(block, "HTTP/", 5) == 0) {
+        const char *sp = strchr(block, ' ');
+        resp->status = sp ? atoi(sp + 1) : 0;
+
+        char *sep = strstr(block, "\r\n\r\n");
+        body = sep ? sep + 4 : NULL;
+        if (!sep && (sep = strstr(block, "\n\n")) != NULL) {
+            body = sep + 2;
+        }
+
+        if (resp->status >= 200 || !body) {
+            break;
+        }
+        block = body;
+    }
+
+    for (char *line = block; line && (!body || line < body); ) {
+        match_header(line, "ETag", resp->etag, sizeof(resp->etag));
+        match_header(line, "Last-Modified", resp->last_modified, sizeof(resp->last_modified));
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+
+    if (resp->status == 200 && body) {
+        resp->body_len = strlen(body);
+        resp->body = strdup(body);
+    }
+
+    free(output);
+    return resp->status > 0 ? 0 : -1;
+}
+
+/* file:// URLs - validators derived from content and mtime */
+static int file_get(const char *url, const char *etag, const char *last_modified,
+                    federation_response_t *resp) {
+    const char *path = url + strlen("file://");
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        resp->status = 404;
+        return 0;
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        resp->status = 403;
+        return 0;
+    }
+
+    char *data = malloc(st.st_size + 1);
+    size_t n = data ? fread(data, 1, st.st_size, fp) : 0;
+    fclose(fp);
+    if (!data) {
+        return -1;
+    }
+    data[n] = '\0';
+
+    snprintf(resp->etag, sizeof(resp->etag), "\"%08x-%zx\"",
+             till_hash_bytes(data, n, TILL_HASH_SEED), n);
+    strftime(resp->last_modified, sizeof(resp->last_modified),
+             "%a, %d %b %Y %H:%M:%S GMT", gmtime(&st.st_mtime));
+
+    /* If-None-Match takes precedence over If-Modified-Since */
+    int not_modified = (etag && *etag) ? strcmp(etag, resp->etag) == 0
+                     : (last_modified && strcmp(last_modified, resp->last_modified) == 0);
+    if (not_modified) {
+        free(data);
+        resp->status = 304;
+        return 0;
+    }
+
+    resp->status = 200;
+    resp->body = data;
+    resp->body_len = n;
+    return 0;
+}
+
+const federation_transport_t federation_http_transport = { "http", http_get };
+const federation_transport_t federation_file_transport = { "file", file_get };
@@ -0,0 +1,96 @@
+/*
+ * till_federation_transport.h - Pluggable transports for federation
+ *
+ * Federation content (menu of the day) is fetched through a transport
+ * chosen by URL scheme: http(s) uses curl, file:// reads the local
+ * filesystem. Tests point TILL_FEDERATION_URL at a directory or a local
+ * HTTP server, or install their own transport.
+ *
+ * Gist operations go through a gist transport: "gh" drives the GitHub
+ * CLI, "local" keeps gists as files under TILL_GIST_STORE so push and
+ * admin processing can be tested and load-tested without GitHub.
+ */
+
+#ifndef TILL_FEDERATION_TRANSPORT_H
+#define TILL_FEDERATION_TRANSPORT_H
+
+#include <stddef.h>
+
+/* Response from a conditional GET */
+typedef struct {
+    int status;                  /* 200, 304, 404..., 0 if the transport failed */
+    char *body;                  /* malloc'd, NULL unless status is 200 */
+    size_t body_len;
+    char etag[128];              /* Validators to send next time */
+    char last_modified[64];
+} federation_response_t;
+
+/* A transport performs conditional GETs; etag/last_modified may be NULL */
+typedef struct {
+    const char *name;
+    int (*get)(const char *url, const char *etag, const char *last_modified,
+               federation_response_t *resp);
+} federation_transport_t;
+
+/* Base URL for federation content: TILL_FEDERATION_URL or FEDERATION_REPO_URL */
+const char *federation_base_url(void);
+
+/* Conditional GET through the transport for url's scheme (or the override) */
+int federation_get(const char *url, const char *etag, const char *last_modified,
+                   federation_response_t *resp);
+
+/* Replace the transport for all URLs (NULL restores scheme selection) */
+void federation_transport_override(const federation_transport_t *transport);
+
+void federation_response_free(federation_response_t *resp);
+
+/* Built-in transports */
+extern const federation_transport_t federation_http_transport;
+extern const federation_transport_t federation_file_transport;
+
+/*
+ * Gist operations. Results are 0, -1, or one of GIST_NOT_FOUND,
+ * GIST_NOT_MODIFIED, GIST_RATE_LIMITED (till_federation.h).
+ */
+typedef struct {
+    const char *name;
+
+    /* 0 if gists can be written; explains why not on stdout */
+    int (*check_auth)(void);
+
+    /* 1 if the service is usable right now (bounded time) */
+    int (*probe)(void);
+
+    /* Login of the authenticated user */
+    int (*whoami)(char *login, size_t size);
+
+    /* Up to limit gist ids whose description contains description; caller frees */
+    int (*list)(const char *description, int limit, char ***ids, int *count);
+
+    int (*create)(const char *description, int is_public, const char *filename,
+                  const char *content, char *id, size_t id_size);
+    int (*update_file)(const char *id, const char *filename, const char *content);
+
+    /* Gist as API JSON ({"files":{...}}); etag may be NULL. GIST_NOT_MODIFIED
+     * if it still matches etag. new_etag receives the current validator.
+     * *body is malloc'd; caller frees it with free() */
+    int (*fetch)(const char *id, const char *etag, char **body,
+                 char *new_etag, size_t etag_size);
+
+    /* One file in full, for files fetch reports as truncated; caller frees */
+    int (*fetch_raw)(const char *id, const char *filename, char **content);
+
+    /* Delete ids (already-gone counts as deleted); sets deleted[i], returns count */
+    int (*remove)(char *const *ids, int count, int *deleted);
+} federation_gist_transport_t;
+
+/* Gist transport in use: the override, TILL_GIST_STORE's local store, or gh */
+const federation_gist_transport_t *federation_gists(void);
+
+/* Replace the gist transport (NULL restores the default selection) */
+void federation_gist_transport_override(const federation_gist_transport_t *transport);
+
+extern const federation_gist_transport_t federation_gh_gists;
+extern const federation_gist_transport_t federation_local_gists;
+
+#endif /* TILL_FEDERATION_TRANSPORT_H */
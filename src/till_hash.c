@@ -0,0 +1,206 @@
+/*
+ * till_hash.c - String-keyed hash map for Till
+ *
+ * Entries live in a dense array in insertion order; the slot table holds
+ * indices into it and is probed linearly. Removal leaves a tombstone in
+ * both, and both are compacted the next time the table grows.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "till_hash.h"
+
+#define SLOT_EMPTY   -1
+#define SLOT_REMOVED -2
+#define MIN_SLOTS    16
+
+uint32_t till_hash_bytes(const void *data, size_t len, uint32_t seed) {
+    const unsigned char *p = data;
+    uint32_t hash = seed;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t till_hash_string(const char *key) {
+    return till_hash_bytes(key, strlen(key), TILL_HASH_SEED);
+}
+
+void till_hash_init(till_hash_t *map) {
+    memset(map, 0, sizeof(*map));
+}
+
+void till_hash_free(till_hash_t *map, void (*free_value)(void *)) {
+    for (size_t i = 0; i < map->used; i++) {
+        if (map->entries[i].key == NULL) continue;
+        free(map->entries[i].key);
+        if (free_value && map->entries[i].value) {
+            free_value(map->entries[i].value);
+        }
+    }
+    free(map->entries);
+    free(map->slots);
+    memset(map, 0, sizeof(*map));
+}
+
+/* Slot index holding key, or -1 */
+static long find_slot(const till_hash_t *map, const char *key, uint32_t hash) {
+    if (map->slot_count == 0) {
+        return -1;
+    }
+
+    size_t mask = map->slot_count - 1;
+    for (size_t i = hash & mask, probes = 0; probes < map->slot_count;
+         i = (i + 1) & mask, probes++) {
+        int32_t idx = map->slots[i];
+        if (idx == SLOT_EMPTY) {
+            return -1;
+        }
+        if (idx >= 0 && map->entries[idx].hash == hash &&
+            strcmp(map->entries[idx].key, key) == 0) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+/* Rebuild slots (and drop tombstones) with room for at least need entries */
+static int rebuild(till_hash_t *map, size_t need) {
+    size_t slot_count = MIN_SLOTS;
+    while (slot_count < need * 2) {
+        slot_count *= 2;
+    }
+
+    int32_t *slots = malloc(slot_count * sizeof(int32_t));
+    if (slots == NULL) {
+        return -1;
+    }
+
+    /* Compact live entries, keeping their order */
+    size_t live = 0;
+    for (size_t i = 0; i < map->used; i++) {
+        if (map->entries[i].key != NULL) {
+            map->entries[live++] = map->entries[i];
+        }
+    }
+    map->used = live;
+
+    if (need > map->capacity) {
+        till_hash_entry_t *entries = realloc(map->entries, need * sizeof(till_hash_entry_t));
+        if (entries == NULL) {
+            free(slots);
+            return -1;
+        }
+        map->entries = entries;
+        map->capacity = need;
+    }
+
+    for (size_t i = 0; i < slot_count; i++) {
+        slots[i] = SLOT_EMPTY;
+    }
+    size_t mask = slot_count - 1;
+    for (size_t e = 0; e < map->used; e++) {
+        size_t i = map->entries[e].hash & mask;
+        while (slots[i] != SLOT_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = (int32_t)e;
+    }
+
+    free(map->slots);
+    map->slots = slots;
+    map->slot_count = slot_count;
+    return 0;
+}
+
+till_hash_entry_t *till_hash_find(const till_hash_t *map, const char *key) {
+    long slot = find_slot(map, key, till_hash_string(key));
+    return slot < 0 ? NULL : &map->entries[map->slots[slot]];
+}
+
+void *till_hash_get(const till_hash_t *map, const char *key) {
+    till_hash_entry_t *entry = till_hash_find(map, key);
+    return entry ? entry->value : NULL;
+}
+
+till_hash_entry_t *till_hash_upsert(till_hash_t *map, const char *key, int *created) {
+    uint32_t hash = till_hash_string(key);
+    long slot = find_slot(map, key, hash);
+
+    if (created) *created = 0;
+    if (slot >= 0) {
+        return &map->entries[map->slots[slot]];
+    }
+
+    /* Keep the slot table at most half full, counting tombstones */
+    if (map->used + 1 > map->capacity || (map->used + 1) * 2 > map->slot_count) {
+        size_t need = map->capacity ? map->count * 2 + 1 : MIN_SLOTS / 2;
+        if (need < map->count + 1) need = map->count + 1;
+        if (rebuild(map, need) != 0) {
+            return NULL;
+        }
+    }
+
+    char *copy = strdup(key);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    size_t e = map->used++;
+    map->entries[e].key = copy;
+    map->entries[e].value = NULL;
+    map->entries[e].count = 0;
+    map->entries[e].hash = hash;
+    map->count++;
+
+    /* Reuse the first empty or removed slot on the probe path */
+    size_t mask = map->slot_count - 1;
+    size_t i = hash & mask;
+    while (map->slots[i] >= 0) {
+        i = (i + 1) & mask;
+    }
+    map->slots[i] = (int32_t)e;
+
+    if (created) *created = 1;
+    return &map->entries[e];
+}
+
+void *till_hash_put(till_hash_t *map, const char *key, void *value) {
+    till_hash_entry_t *entry = till_hash_upsert(map, key, NULL);
+    if (entry == NULL) {
+        return NULL;
+    }
+    void *old = entry->value;
+    entry->value = value;
+    return old;
+}
+
+long till_hash_incr(till_hash_t *map, const char *key, long delta) {
+    till_hash_entry_t *entry = till_hash_upsert(map, key, NULL);
+    if (entry == NULL) {
+        return 0;
+    }
+    entry->count += delta;
+    return entry->count;
+}
+
+void *till_hash_remove(till_hash_t *map, const char *key) {
+    long slot = find_slot(map, key, till_hash_string(key));
+    if (slot < 0) {
+        return NULL;
+    }
+
+    till_hash_entry_t *entry = &map->entries[map->slots[slot]];
+    void *value = entry->value;
+    free(entry->key);
+    entry->key = NULL;
+    entry->value = NULL;
+    map->slots[slot] = SLOT_REMOVED;
+    map->count--;
+    return value;
+}
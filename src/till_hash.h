@@ -0,0 +1,65 @@
+/*
+ * till_hash.h - String-keyed hash map for Till
+ *
+ * Open addressing over a dense entry array, so iteration follows
+ * insertion order and output built from a map is deterministic.
+ */
+
+#ifndef TILL_HASH_H
+#define TILL_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Map entry - key is owned by the map, value is not */
+typedef struct {
+    char *key;                   /* NULL once removed */
+    void *value;                 /* Caller data */
+    long count;                  /* Counter for till_hash_incr */
+    uint32_t hash;
+} till_hash_entry_t;
+
+typedef struct {
+    till_hash_entry_t *entries;  /* Insertion order, may contain removed */
+    size_t used;                 /* Entries in use, including removed */
+    size_t capacity;             /* Allocated entries */
+    size_t count;                /* Live entries */
+    int32_t *slots;              /* Index into entries, or empty/removed */
+    size_t slot_count;           /* Power of two */
+} till_hash_t;
+
+/* Hash a NUL-terminated string (FNV-1a) */
+uint32_t till_hash_string(const char *key);
+
+/* Hash a byte range (FNV-1a), continuing from seed */
+uint32_t till_hash_bytes(const void *data, size_t len, uint32_t seed);
+
+/* Initial seed for till_hash_bytes */
+#define TILL_HASH_SEED 2166136261u
+
+/* Lifecycle */
+void till_hash_init(till_hash_t *map);
+void till_hash_free(till_hash_t *map, void (*free_value)(void *));
+
+/* Lookup - NULL if missing */
+till_hash_entry_t *till_hash_find(const till_hash_t *map, const char *key);
+void *till_hash_get(const till_hash_t *map, const char *key);
+
+/* Find or create the entry for key; *created set when new. NULL on OOM */
+till_hash_entry_t *till_hash_upsert(till_hash_t *map, const char *key, int *created);
+
+/* Set value for key, returns previous value (NULL if new) */
+void *till_hash_put(till_hash_t *map, const char *key, void *value);
+
+/* Add delta to the counter for key, returns the new count */
+long till_hash_incr(till_hash_t *map, const char *key, long delta);
+
+/* Remove key, returns its value (NULL if missing) */
+void *till_hash_remove(till_hash_t *map, const char *key);
+
+/* Iterate live entries in insertion order */
+#define till_hash_foreach(map, entry) \
+    for ((entry) = (map)->entries; (entry) < (map)->entries + (map)->used; (entry)++) \
+        if ((entry)->key != NULL)
+
+#endif /* TILL_HASH_H */
@@ -0,0 +1,131 @@
+/*
+ * till_heap.c - Timer heap for Till
+ *
+ * Items sit in an array with the earliest at index 0 and each parent no
+ * later than its children, so push and pop are O(log n) and peeking at
+ * the next due job is O(1). Cancelling filters and rebuilds, which is fine
+ * for the few dozen jobs a site schedules.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "till_heap.h"
+
+#define MIN_ITEMS 16
+
+/* Does a come out before b? */
+static int earlier(const till_heap_item_t *a, const till_heap_item_t *b) {
+    return a->due != b->due ? a->due < b->due : a->seq < b->seq;
+}
+
+static void swap(till_heap_item_t *a, till_heap_item_t *b) {
+    till_heap_item_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void sift_up(till_heap_t *heap, size_t i) {
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!earlier(&heap->items[i], &heap->items[parent])) {
+            break;
+        }
+        swap(&heap->items[i], &heap->items[parent]);
+        i = parent;
+    }
+}
+
+static void sift_down(till_heap_t *heap, size_t i) {
+    for (;;) {
+        size_t first = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+
+        if (left < heap->count && earlier(&heap->items[left], &heap->items[first])) {
+            first = left;
+        }
+        if (right < heap->count && earlier(&heap->items[right], &heap->items[first])) {
+            first = right;
+        }
+        if (first == i) {
+            break;
+        }
+        swap(&heap->items[i], &heap->items[first]);
+        i = first;
+    }
+}
+
+void till_heap_init(till_heap_t *heap) {
+    memset(heap, 0, sizeof(*heap));
+}
+
+void till_heap_free(till_heap_t *heap) {
+    free(heap->items);
+    memset(heap, 0, sizeof(*heap));
+}
+
+void till_heap_clear(till_heap_t *heap) {
+    heap->count = 0;
+}
+
+int till_heap_push(till_heap_t *heap, time_t due, int kind, const char *key) {
+    if (heap->count == heap->capacity) {
+        size_t capacity = heap->capacity ? heap->capacity * 2 : MIN_ITEMS;
+        till_heap_item_t *items = realloc(heap->items, capacity * sizeof(*items));
+        if (items == NULL) {
+            return -1;
+        }
+        heap->items = items;
+        heap->capacity = capacity;
+    }
+
+    till_heap_item_t *item = &heap->items[heap->count];
+    item->due = due;
+    item->kind = kind;
+    snprintf(item->key, sizeof(item->key), "%s", key ? key : "");
+    item->seq = heap->next_seq++;
+
+    sift_up(heap, heap->count++);
+    return 0;
+}
+
+const till_heap_item_t *till_heap_peek(const till_heap_t *heap) {
+    return heap->count ? &heap->items[0] : NULL;
+}
+
+int till_heap_pop(till_heap_t *heap, till_heap_item_t *out) {
+    if (heap->count == 0) {
+        return -1;
+    }
+
+    if (out) {
+        *out = heap->items[0];
+    }
+    heap->items[0] = heap->items[--heap->count];
+    sift_down(heap, 0);
+    return 0;
+}
+
+int till_heap_remove(till_heap_t *heap, int kind, const char *key) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < heap->count; i++) {
+        till_heap_item_t *item = &heap->items[i];
+        if (item->kind != kind || (key && strcmp(item->key, key) != 0)) {
+            heap->items[kept++] = *item;
+        }
+    }
+
+    int removed = (int)(heap->count - kept);
+    heap->count = kept;
+
+    /* Re-establish the order bottom-up */
+    if (removed) {
+        for (size_t i = kept / 2; i-- > 0; ) {
+            sift_down(heap, i);
+        }
+    }
+    return removed;
+}
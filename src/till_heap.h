@@ -0,0 +1,46 @@
+/*
+ * till_heap.h - Timer heap for Till
+ *
+ * Binary min-heap of pending jobs ordered by due time; jobs due at the
+ * same second come out in the order they were added.
+ */
+
+#ifndef TILL_HEAP_H
+#define TILL_HEAP_H
+
+#include <stddef.h>
+#include <time.h>
+
+/* A pending job - kind and key are the caller's */
+typedef struct {
+    time_t due;
+    int kind;
+    char key[256];               /* What the job is for, e.g. a held component */
+    unsigned long seq;           /* Insertion order, breaks ties */
+} till_heap_item_t;
+
+typedef struct {
+    till_heap_item_t *items;
+    size_t count;
+    size_t capacity;
+    unsigned long next_seq;
+} till_heap_t;
+
+/* Lifecycle */
+void till_heap_init(till_heap_t *heap);
+void till_heap_free(till_heap_t *heap);
+void till_heap_clear(till_heap_t *heap);
+
+/* Add a job; -1 on OOM */
+int till_heap_push(till_heap_t *heap, time_t due, int kind, const char *key);
+
+/* Earliest job, or NULL if empty */
+const till_heap_item_t *till_heap_peek(const till_heap_t *heap);
+
+/* Remove the earliest job into out; -1 if empty */
+int till_heap_pop(till_heap_t *heap, till_heap_item_t *out);
+
+/* Cancel every job of kind for key (any key if NULL); returns how many */
+int till_heap_remove(till_heap_t *heap, int kind, const char *key);
+
+#endif /* TILL_HEAP_H */
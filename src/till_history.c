@@ -0,0 +1,283 @@
+/*
+ * till_history.c - Sync history for Till
+ *
+ * The log is append-only JSONL: each run is a single write of one line,
+ * so concurrent syncs can't interleave and a crash loses at most the run
+ * being written. The index is a JSON array of [started, seconds, ok]
+ * triples, oldest first, capped at TILL_SYNC_INDEX_RUNS and rewritten
+ * atomically - small enough that statistics load it whole.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "till_config.h"
+#include "till_common.h"
+#include "till_history.h"
+#include "till_schedule.h"
+#include "cJSON.h"
+
+static const char *phase_names[SYNC_PHASES] = { "till_update", "installations", "menu" };
+
+double sync_history_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void sync_history_begin(sync_run_t *run, int scheduled) {
+    memset(run, 0, sizeof(*run));
+    run->started = time(NULL);
+    run->start = sync_history_now();
+    run->phase_start = run->start;
+    run->scheduled = scheduled;
+}
+
+void sync_history_phase_begin(sync_run_t *run) {
+    run->phase_start = sync_history_now();
+}
+
+void sync_history_phase_end(sync_run_t *run, sync_phase_t phase) {
+    run->phases[phase] += sync_history_now() - run->phase_start;
+}
+
+void sync_history_install(sync_run_t *run, const char *name, const char *outcome,
+                          double seconds, long bytes) {
+    if (run->install_count == run->install_capacity) {
+        int capacity = run->install_capacity ? run->install_capacity * 2 : 16;
+        sync_install_t *installs = realloc(run->installs, capacity * sizeof(*installs));
+        if (!installs) {
+            return;  /* History is best effort */
+        }
+        run->installs = installs;
+        run->install_capacity = capacity;
+    }
+
+    sync_install_t *install = &run->installs[run->install_count++];
+    snprintf(install->name, sizeof(install->name), "%s", name);
+    install->outcome = outcome;
+    install->seconds = seconds;
+    install->bytes = bytes;
+}
+
+/* Round to milliseconds so the log stays compact */
+static double ms(double seconds) {
+    return (double)(long)(seconds * 1000 + 0.5) / 1000;
+}
+
+static int append_log(const char *line) {
+    char path[TILL_MAX_PATH];
+
+    if (build_till_path(path, sizeof(path), TILL_SYNC_HISTORY) != 0) {
+        return -1;
+    }
+    char *slash = strrchr(path, '/');
+    if (slash) {
+        *slash = '\0';
+        ensure_directory(path);
+        *slash = '/';
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        till_log(LOG_WARN, "Cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    size_t len = strlen(line);
+    ssize_t written = write(fd, line, len);
+    close(fd);
+    return written == (ssize_t)len ? 0 : -1;
+}
+
+/* Append a run to the index under its lock so concurrent syncs don't
+ * drop each other's entries; the array is capped at TILL_SYNC_INDEX_RUNS */
+static int add_index_entry(cJSON *json, void *ctx) {
+    cJSON *runs = cJSON_GetObjectItem(json, "runs");
+    if (!cJSON_IsArray(runs)) {
+        cJSON_DeleteItemFromObject(json, "runs");
+        runs = cJSON_AddArrayToObject(json, "runs");
+    }
+
+    cJSON_AddItemToArray(runs, cJSON_Duplicate(ctx, 1));
+    while (cJSON_GetArraySize(runs) > TILL_SYNC_INDEX_RUNS) {
+        cJSON_DeleteItemFromArray(runs, 0);
+    }
+    return 0;
+}
+
+static void append_index(time_t started, double seconds, int success) {
+    cJSON *entry = cJSON_CreateArray();
+    cJSON_AddItemToArray(entry, cJSON_CreateNumber((double)started));
+    cJSON_AddItemToArray(entry, cJSON_CreateNumber(ms(seconds)));
+    cJSON_AddItemToArray(entry, cJSON_CreateBool(success));
+
+    till_json_transaction(TILL_SYNC_INDEX, add_index_entry, entry);
+    cJSON_Delete(entry);
+}
+
+int sync_history_record(sync_run_t *run, int success) {
+    double seconds = sync_history_now() - run->start;
+    long bytes = 0;
+    int updated = 0;
+
+    cJSON *entry = cJSON_CreateObject();
+    cJSON_AddNumberToObject(entry, "started", (double)run->started);
+    cJSON_AddStringToObject(entry, "status", success ? "success" : "failure");
+    cJSON_AddNumberToObject(entry, "seconds", ms(seconds));
+    cJSON_AddBoolToObject(entry, "scheduled", run->scheduled);
+
+    cJSON *phases = cJSON_AddObjectToObject(entry, "phases");
+    for (int i = 0; i < SYNC_PHASES; i++) {
+        cJSON_AddNumberToObject(phases, phase_names[i], ms(run->phases[i]));
+    }
+
+    cJSON *installs = cJSON_CreateArray();
+    for (int i = 0; i < run->install_count; i++) {
+        const sync_install_t *install = &run->installs[i];
+        cJSON *item = cJSON_CreateObject();
+
+        cJSON_AddStringToObject(item, "name", install->name);
+        cJSON_AddStringToObject(item, "outcome", install->outcome);
+        cJSON_AddNumberToObject(item, "seconds", ms(install->seconds));
+        cJSON_AddNumberToObject(item, "bytes", install->bytes);
+        cJSON_AddItemToArray(installs, item);
+
+        bytes += install->bytes;
+        updated += strcmp(install->outcome, "updated") == 0;
+    }
+    cJSON_AddNumberToObject(entry, "bytes", bytes);
+    cJSON_AddItemToObject(entry, "installations", installs);
+
+    char *text = cJSON_PrintUnformatted(entry);
+    cJSON_Delete(entry);
+    if (text) {
+        size_t len = strlen(text);
+        char *line = malloc(len + 2);
+        if (line) {
+            memcpy(line, text, len);
+            memcpy(line + len, "\n", 2);
+            append_log(line);
+            free(line);
+        }
+        free(text);
+    }
+
+    append_index(run->started, seconds, success);
+    till_watch_record_sync(success, (int)(seconds + 0.5), updated, 0);
+
+    free(run->installs);
+    memset(run, 0, sizeof(*run));
+    return 0;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted values */
+static double percentile(const double *sorted, int count, int pct) {
+    if (count == 0) {
+        return 0;
+    }
+    int rank = (pct * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static double median(double *values, int count) {
+    qsort(values, count, sizeof(double), compare_double);
+    return percentile(values, count, 50);
+}
+
+int sync_history_stats(int days, sync_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->days = days;
+
+    cJSON *index = load_till_json(TILL_SYNC_INDEX);
+    cJSON *runs = cJSON_GetObjectItem(index, "runs");
+    int size = cJSON_GetArraySize(runs);
+    if (size == 0) {
+        cJSON_Delete(index);
+        return 0;
+    }
+
+    time_t now = time(NULL);
+    time_t since = now - (time_t)days * 86400;
+    time_t middle = now - (time_t)days * 43200;
+    double *all = malloc(size * sizeof(double));
+    double *earlier = malloc(size * sizeof(double));
+    double *recent = malloc(size * sizeof(double));
+    int n_earlier = 0, n_recent = 0;
+
+    if (!all || !earlier || !recent) {
+        free(all);
+        free(earlier);
+        free(recent);
+        cJSON_Delete(index);
+        return -1;
+    }
+
+    cJSON *run;
+    cJSON_ArrayForEach(run, runs) {
+        cJSON *started = cJSON_GetArrayItem(run, 0);
+        cJSON *seconds = cJSON_GetArrayItem(run, 1);
+        cJSON *ok = cJSON_GetArrayItem(run, 2);
+        if (!cJSON_IsNumber(started) || !cJSON_IsNumber(seconds) ||
+            started->valuedouble < since) {
+            continue;
+        }
+
+        all[stats->runs++] = seconds->valuedouble;
+        stats->failures += !cJSON_IsTrue(ok);
+        if (started->valuedouble < middle) {
+            earlier[n_earlier++] = seconds->valuedouble;
+        } else {
+            recent[n_recent++] = seconds->valuedouble;
+        }
+    }
+    cJSON_Delete(index);
+
+    qsort(all, stats->runs, sizeof(double), compare_double);
+    stats->p50 = percentile(all, stats->runs, 50);
+    stats->p95 = percentile(all, stats->runs, 95);
+
+    if (n_earlier >= 2 && n_recent >= 2) {
+        double before = median(earlier, n_earlier);
+        if (before > 0) {
+            stats->has_trend = 1;
+            stats->trend = median(recent, n_recent) / before - 1;
+        }
+    }
+
+    free(all);
+    free(earlier);
+    free(recent);
+    return stats->runs;
+}
+
+cJSON *sync_history_stats_model(int days) {
+    sync_stats_t stats;
+    cJSON *model = cJSON_CreateObject();
+
+    sync_history_stats(days, &stats);
+    cJSON_AddNumberToObject(model, "days", stats.days);
+    cJSON_AddNumberToObject(model, "runs", stats.runs);
+    cJSON_AddNumberToObject(model, "failures", stats.failures);
+    cJSON_AddNumberToObject(model, "failure_rate",
+        stats.runs ? (double)stats.failures / stats.runs : 0);
+    cJSON_AddNumberToObject(model, "p50_seconds", stats.p50);
+    cJSON_AddNumberToObject(model, "p95_seconds", stats.p95);
+    if (stats.has_trend) {
+        cJSON_AddNumberToObject(model, "trend", stats.trend);
+    } else {
+        cJSON_AddNullToObject(model, "trend");
+    }
+    return model;
+}
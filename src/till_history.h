@@ -0,0 +1,78 @@
+/*
+ * till_history.h - Sync history for Till
+ *
+ * Every sync appends one JSON line to logs/sync-history.jsonl with its
+ * phase timings, bytes fetched and what happened to each installation.
+ * A small rolling index (sync-index.json) keeps just the start time,
+ * duration and outcome of recent runs, so statistics never read the log.
+ */
+
+#ifndef TILL_HISTORY_H
+#define TILL_HISTORY_H
+
+#include <time.h>
+#include "cJSON.h"
+
+/* Sync phases, timed separately */
+typedef enum {
+    SYNC_PHASE_TILL_UPDATE,      /* check for (and apply) Till updates */
+    SYNC_PHASE_INSTALLATIONS,    /* git pull each installation */
+    SYNC_PHASE_MENU,             /* menu of the day auto-install/update */
+    SYNC_PHASES
+} sync_phase_t;
+
+/* One installation's part in a sync */
+typedef struct {
+    char name[256];
+    const char *outcome;         /* "updated", "current", "held", "failed" */
+    double seconds;
+    long bytes;                  /* Growth of the object store */
+} sync_install_t;
+
+/* A sync in progress */
+typedef struct {
+    time_t started;
+    double start;                /* Monotonic seconds */
+    double phase_start;
+    double phases[SYNC_PHASES];
+    int scheduled;
+    sync_install_t *installs;
+    int install_count;
+    int install_capacity;
+} sync_run_t;
+
+/* Statistics over the index */
+typedef struct {
+    int days;
+    int runs;
+    int failures;
+    double p50;                  /* Seconds */
+    double p95;
+    int has_trend;               /* Enough runs in both halves of the window */
+    double trend;                /* Recent vs earlier median, e.g. 0.12 = 12% slower */
+} sync_stats_t;
+
+/* Start timing a sync */
+void sync_history_begin(sync_run_t *run, int scheduled);
+
+/* Time a phase */
+void sync_history_phase_begin(sync_run_t *run);
+void sync_history_phase_end(sync_run_t *run, sync_phase_t phase);
+
+/* Note an installation's outcome */
+void sync_history_install(sync_run_t *run, const char *name, const char *outcome,
+                          double seconds, long bytes);
+
+/* Monotonic clock, seconds */
+double sync_history_now(void);
+
+/* Append the run to the log and index, update schedule.json; frees run */
+int sync_history_record(sync_run_t *run, int success);
+
+/* Statistics for runs started in the last days */
+int sync_history_stats(int days, sync_stats_t *stats);
+
+/* Statistics as a status model object */
+cJSON *sync_history_stats_model(int days);
+
+#endif /* TILL_HISTORY_H */
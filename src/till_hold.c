@@ -17,6 +17,7 @@
 #include "till_hold.h"
 #include "till_common.h"
 #include "till_registry.h"
+#include "till_status.h"
 #include "cJSON.h"
 
 /* Load holds from registry */
@@ -26,40 +27,20 @@ cJSON *load_holds(void) {
         return NULL;
     }
     
-    cJSON *holds = cJSON_GetObjectItem(registry, "holds");
-    if (!holds) {
-        holds = cJSON_CreateObject();
-        cJSON_AddItemToObject(registry, "holds", holds);
-        save_till_json("tekton/till-private.json", registry);
-    }
-    
     /* Detach holds from registry before deleting registry */
-    cJSON_DetachItemFromObject(registry, "holds");
+    cJSON *holds = cJSON_DetachItemFromObject(registry, "holds");
     cJSON_Delete(registry);
     
-    return holds;
+    return holds ? holds : cJSON_CreateObject();
 }
 
-/* Save holds to registry */
-int save_holds(cJSON *holds) {
-    if (!holds) return -1;
-    
-    cJSON *registry = load_or_create_registry();
-    if (!registry) {
-        return -1;
+/* The registry's holds, created if it has none */
+static cJSON *registry_holds(cJSON *registry) {
+    cJSON *holds = cJSON_GetObjectItem(registry, "holds");
+    if (!holds) {
+        holds = cJSON_AddObjectToObject(registry, "holds");
     }
-    
-    /* Remove old holds if exists */
-    cJSON_DeleteItemFromObject(registry, "holds");
-    
-    /* Add new holds */
-    cJSON_AddItemToObject(registry, "holds", cJSON_Duplicate(holds, 1));
-    
-    /* Save registry */
-    int result = save_till_json("tekton/till-private.json", registry);
-    cJSON_Delete(registry);
-    
-    return result;
+    return holds;
 }
 
 /* Format time for display */
@@ -168,34 +149,73 @@ int parse_duration(const char *duration, time_t *seconds_out) {
     return 0;
 }
 
+typedef struct {
+    const char *component;
+    time_t now;
+    int held;                   /* Out: still held */
+} expire_check_t;
+
+/* Remove the component's hold if it has expired */
+static int expire_hold(cJSON *registry, void *ctx) {
+    expire_check_t *check = ctx;
+    cJSON *holds = cJSON_GetObjectItem(registry, "holds");
+    cJSON *hold = cJSON_GetObjectItem(holds, check->component);
+    
+    check->held = hold != NULL;
+    if (!hold) {
+        return 1;
+    }
+    
+    cJSON *expires = cJSON_GetObjectItem(hold, "expires_at");
+    if (expires && expires->valueint > 0 && check->now > expires->valueint) {
+        cJSON_DeleteItemFromObject(holds, check->component);
+        check->held = 0;
+        return 0;
+    }
+    return 1;
+}
+
 /* Check if component is held */
 int is_component_held(const char *component) {
     if (!component) return 0;
     
-    cJSON *holds = load_holds();
-    if (!holds) return 0;
+    /* Read from the snapshot; expired holds go on to the JSON, where
+     * they are removed under the registry lock */
+    till_snapshot_t snap;
+    if (registry_snapshot_open(&snap) == 0) {
+        const till_snapshot_hold_t *hold = till_snapshot_hold(&snap, component);
+        int expired = hold && hold->expires_at > 0 && time(NULL) > hold->expires_at;
+        int held = hold != NULL;
+        till_snapshot_close(&snap);
+        if (!expired) {
+            return held;
+        }
+    }
     
-    cJSON *hold = cJSON_GetObjectItem(holds, component);
+    expire_check_t check = { component, time(NULL), 0 };
+    till_json_transaction(TILL_REGISTRY_FILE, expire_hold, &check);
+    return check.held;
+}
+
+void holds_index_load(till_json_index_t *index) {
+    till_json_index_init(index, load_holds());
+}
+
+int holds_index_held(const till_json_index_t *index, const char *component, time_t now) {
+    cJSON *hold = till_json_index_get_nocase(index, component);
     if (!hold) {
-        cJSON_Delete(holds);
         return 0;
     }
     
-    /* Check if hold has expired */
     cJSON *expires = cJSON_GetObjectItem(hold, "expires_at");
-    if (expires && expires->valueint > 0) {
-        time_t now = time(NULL);
-        if (now > expires->valueint) {
-            /* Hold has expired, remove it */
-            cJSON_DeleteItemFromObject(holds, component);
-            save_holds(holds);
-            cJSON_Delete(holds);
-            return 0;
-        }
-    }
-    
-    cJSON_Delete(holds);
-    return 1;
+    return !(expires && expires->valueint > 0 && now > expires->valueint);
+}
+
+/* Frees the holds along with the index */
+void holds_index_free(till_json_index_t *index) {
+    till_json_index_free(index);
+    cJSON_Delete(index->object);
+    index->object = NULL;
 }
 
 /* Get hold information for component */
@@ -205,6 +225,19 @@ int get_hold_info(const char *component, hold_info_t *info) {
     memset(info, 0, sizeof(hold_info_t));
     strncpy(info->component, component, sizeof(info->component) - 1);
     
+    till_snapshot_t snap;
+    if (registry_snapshot_open(&snap) == 0) {
+        const till_snapshot_hold_t *hold = till_snapshot_hold(&snap, component);
+        if (hold) {
+            info->held_at = (time_t)hold->held_at;
+            info->expires_at = (time_t)hold->expires_at;
+            strncpy(info->reason, till_snapshot_string(&snap, hold->reason), sizeof(info->reason) - 1);
+            strncpy(info->held_by, till_snapshot_string(&snap, hold->held_by), sizeof(info->held_by) - 1);
+        }
+        till_snapshot_close(&snap);
+        return hold ? 0 : -1;
+    }
+    
     cJSON *holds = load_holds();
     if (!holds) return -1;
     
@@ -291,30 +324,34 @@ int list_holds(hold_info_t **holds_out, int *count) {
     return 0;
 }
 
-/* Add a hold for a component */
-int add_hold(const char *component, const char *reason, time_t expires_at) {
-    if (!component) return -1;
-    
-    cJSON *holds = load_holds();
+typedef struct {
+    const char *component;
+    const char *reason;
+    time_t expires_at;
+    time_t now;
+    int removed;                /* Out: expired holds removed */
+} hold_change_t;
+
+static int place_hold(cJSON *registry, void *ctx) {
+    hold_change_t *change = ctx;
+    cJSON *holds = registry_holds(registry);
     if (!holds) {
-        holds = cJSON_CreateObject();
+        return -1;
     }
     
     /* Check if already held */
-    cJSON *existing = cJSON_GetObjectItem(holds, component);
-    if (existing) {
-        till_warn("Component '%s' is already held", component);
-        cJSON_Delete(holds);
+    if (cJSON_GetObjectItem(holds, change->component)) {
+        till_warn("Component '%s' is already held", change->component);
         return -1;
     }
     
     /* Create hold entry */
     cJSON *hold = cJSON_CreateObject();
-    cJSON_AddNumberToObject(hold, "held_at", time(NULL));
-    cJSON_AddNumberToObject(hold, "expires_at", expires_at);
+    cJSON_AddNumberToObject(hold, "held_at", change->now);
+    cJSON_AddNumberToObject(hold, "expires_at", change->expires_at);
     
-    if (reason && strlen(reason) > 0) {
-        cJSON_AddStringToObject(hold, "reason", reason);
+    if (change->reason && strlen(change->reason) > 0) {
+        cJSON_AddStringToObject(hold, "reason", change->reason);
     }
     
     /* Get current user */
@@ -324,11 +361,16 @@ int add_hold(const char *component, const char *reason, time_t expires_at) {
     }
     
     /* Add to holds */
-    cJSON_AddItemToObject(holds, component, hold);
+    cJSON_AddItemToObject(holds, change->component, hold);
+    return 0;
+}
+
+/* Add a hold for a component */
+int add_hold(const char *component, const char *reason, time_t expires_at) {
+    if (!component) return -1;
     
-    /* Save */
-    int result = save_holds(holds);
-    cJSON_Delete(holds);
+    hold_change_t change = { component, reason, expires_at, time(NULL), 0 };
+    int result = till_json_transaction(TILL_REGISTRY_FILE, place_hold, &change) == 0 ? 0 : -1;
     
     if (result == 0) {
         char time_buf[64];
@@ -343,29 +385,30 @@ int add_hold(const char *component, const char *reason, time_t expires_at) {
     return result;
 }
 
-/* Remove a hold for a component */
-int remove_hold(const char *component) {
-    if (!component) return -1;
-    
-    cJSON *holds = load_holds();
+static int lift_hold(cJSON *registry, void *ctx) {
+    hold_change_t *change = ctx;
+    cJSON *holds = cJSON_GetObjectItem(registry, "holds");
     if (!holds) {
         till_warn("No holds found");
         return -1;
     }
     
-    cJSON *hold = cJSON_GetObjectItem(holds, component);
-    if (!hold) {
-        till_warn("Component '%s' is not held", component);
-        cJSON_Delete(holds);
+    if (!cJSON_GetObjectItem(holds, change->component)) {
+        till_warn("Component '%s' is not held", change->component);
         return -1;
     }
     
     /* Remove hold */
-    cJSON_DeleteItemFromObject(holds, component);
+    cJSON_DeleteItemFromObject(holds, change->component);
+    return 0;
+}
+
+/* Remove a hold for a component */
+int remove_hold(const char *component) {
+    if (!component) return -1;
     
-    /* Save */
-    int result = save_holds(holds);
-    cJSON_Delete(holds);
+    hold_change_t change = { component, NULL, 0, time(NULL), 0 };
+    int result = till_json_transaction(TILL_REGISTRY_FILE, lift_hold, &change) == 0 ? 0 : -1;
     
     if (result == 0) {
         till_info("Hold released for '%s'", component);
@@ -374,34 +417,65 @@ int remove_hold(const char *component) {
     return result;
 }
 
-/* Check and remove expired holds */
-int cleanup_expired_holds(void) {
-    cJSON *holds = load_holds();
-    if (!holds) return 0;
-    
-    time_t now = time(NULL);
-    int removed = 0;
+static int remove_expired(cJSON *registry, void *ctx) {
+    hold_change_t *change = ctx;
+    cJSON *holds = cJSON_GetObjectItem(registry, "holds");
+    cJSON *hold = holds ? holds->child : NULL;
     
-    cJSON *hold = holds->child;
     while (hold) {
         cJSON *next = hold->next;
         
         cJSON *expires = cJSON_GetObjectItem(hold, "expires_at");
-        if (expires && expires->valueint > 0 && expires->valueint < now) {
+        if (expires && expires->valueint > 0 && expires->valueint < change->now) {
             till_info("Removing expired hold for '%s'", hold->string);
-            cJSON_DeleteItemFromObject(holds, hold->string);
-            removed++;
+            cJSON_Delete(cJSON_DetachItemViaPointer(holds, hold));
+            change->removed++;
         }
         
         hold = next;
     }
     
-    if (removed > 0) {
-        save_holds(holds);
+    return change->removed > 0 ? 0 : 1;
+}
+
+/* Check and remove expired holds */
+int cleanup_expired_holds(void) {
+    hold_change_t change = { NULL, NULL, 0, time(NULL), 0 };
+    if (till_json_transaction(TILL_REGISTRY_FILE, remove_expired, &change) < 0) {
+        return 0;
     }
+    return change.removed;
+}
+
+/* Holds as a status model section */
+cJSON *hold_status_model(void) {
+    hold_info_t *holds = NULL;
+    int count = 0;
+    cJSON *list = cJSON_CreateArray();
     
-    cJSON_Delete(holds);
-    return removed;
+    if (list_holds(&holds, &count) != 0) {
+        return list;
+    }
+    
+    time_t now = time(NULL);
+    for (int i = 0; i < count; i++) {
+        hold_info_t *h = &holds[i];
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "component", h->component);
+        cJSON_AddStringToObject(item, "held_by", h->held_by);
+        cJSON_AddNumberToObject(item, "held_at", (double)h->held_at);
+        if (h->expires_at > 0) {
+            cJSON_AddNumberToObject(item, "expires_at", (double)h->expires_at);
+        } else {
+            cJSON_AddNullToObject(item, "expires_at");
+        }
+        cJSON_AddBoolToObject(item, "expired", h->expires_at > 0 && h->expires_at <= now);
+        cJSON_AddStringToObject(item, "reason", h->reason);
+        cJSON_AddItemToArray(list, item);
+    }
+    
+    free(holds);
+    return list;
 }
 
 /* Show hold status for all components */
@@ -409,6 +483,11 @@ void show_hold_status(void) {
     hold_info_t *holds = NULL;
     int count = 0;
     
+    if (g_output != TILL_OUTPUT_TEXT) {
+        till_status_show(STATUS_HOLDS);
+        return;
+    }
+    
     if (list_holds(&holds, &count) != 0) {
         till_error("Failed to list holds");
         return;
@@ -475,16 +554,20 @@ int hold_interactive(void) {
     
     /* List components */
     printf("Select components to hold:\n");
+    till_json_index_t holds;
+    holds_index_load(&holds);
+    time_t now = time(NULL);
     int index = 1;
     cJSON *inst = NULL;
     cJSON_ArrayForEach(inst, installations) {
         const char *name = inst->string;
-        if (is_component_held(name)) {
+        if (holds_index_held(&holds, name, now)) {
             printf("  %d. %s [ALREADY HELD]\n", index++, name);
         } else {
             printf("  %d. %s\n", index++, name);
         }
     }
+    holds_index_free(&holds);
     printf("  %d. All components\n", index);
     printf("  0. Cancel\n");
     
@@ -787,6 +870,8 @@ int release_interactive(void) {
 int till_hold_command(int argc, char *argv[]) {
     hold_options_t opts = {0};
     
+    argc = till_output_parse(argc, argv);
+    
     /* Parse arguments - skip argv[0] which is the command name */
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interactive") == 0) {
@@ -924,6 +1009,8 @@ int till_hold_command(int argc, char *argv[]) {
 int till_release_command(int argc, char *argv[]) {
     release_options_t opts = {0};
     
+    argc = till_output_parse(argc, argv);
+    
     /* Parse arguments - skip argv[0] which is the command name */
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interactive") == 0) {
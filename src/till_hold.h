@@ -9,6 +9,7 @@
 
 #include <time.h>
 #include "cJSON.h"
+#include "till_json_index.h"
 
 /* Hold information structure */
 typedef struct {
@@ -51,6 +52,12 @@ int till_release_command(int argc, char *argv[]);
 /* Check if component is held */
 int is_component_held(const char *component);
 
+/* Check many components against one load of the holds; expired holds
+ * count as released but are left for cleanup_expired_holds */
+void holds_index_load(till_json_index_t *index);
+int holds_index_held(const till_json_index_t *index, const char *component, time_t now);
+void holds_index_free(till_json_index_t *index);
+
 /* Get hold information for component */
 int get_hold_info(const char *component, hold_info_t *info);
 
@@ -96,9 +103,6 @@ void show_hold_details(const char *component);
 /* Load holds from registry */
 cJSON *load_holds(void);
 
-/* Save holds to registry */
-int save_holds(cJSON *holds);
-
 /* Format time for display */
 void format_time(time_t t, char *buf, size_t size);
 
@@ -18,6 +18,8 @@
 #include "till_common.h"
 #include "till_security.h"
 #include "till_platform.h"
+#include "till_status.h"
+#include "till_json_index.h"
 #include "cJSON.h"
 
 #ifndef TILL_MAX_PATH
@@ -64,33 +66,16 @@ static int run_ssh_command(const char *user, const char *host, int port,
     return run_command(ssh_cmd, output, output_size);
 }
 
-/* Add a new host */
-int till_host_add(const char *name, const char *user_at_host) {
-    if (!name || !user_at_host) {
-        till_log(LOG_ERROR, "Usage: till host add <name> <user>@<host>[:port]");
-        return -1;
-    }
-    
-    till_log(LOG_INFO, "Adding host '%s'", name);
-    printf("Adding host '%s'...\n", name);
-    
-    /* Parse user@host:port */
-    char user[256], host[256];
+typedef struct {
+    const char *name;
+    const char *user;
+    const char *host;
     int port;
-    if (parse_host_spec(user_at_host, user, sizeof(user), 
-                       host, sizeof(host), &port) != 0) {
-        till_log(LOG_ERROR, "Invalid host specification: %s", user_at_host);
-        till_error("Invalid format. Use: user@host[:port]\n");
-        return -1;
-    }
-    
-    /* Load or create hosts file */
-    cJSON *json = load_till_json("hosts-local.json");
-    if (!json) {
-        json = cJSON_CreateObject();
-        cJSON_AddObjectToObject(json, "hosts");
-        json_set_string(json, "updated", "0");
-    }
+} host_entry_t;
+
+static int add_host_entry(cJSON *json, void *ctx) {
+    const host_entry_t *entry = ctx;
+    const char *name = entry->name;
     
     cJSON *hosts = cJSON_GetObjectItem(json, "hosts");
     if (!hosts) {
@@ -110,16 +95,15 @@ int till_host_add(const char *name, const char *user_at_host) {
         } else {
             till_log(LOG_ERROR, "Host '%s' already exists and is active", name);
             till_error("Host '%s' already exists and is active\n", name);
-            cJSON_Delete(json);
             return -1;
         }
     }
     
     /* Add host entry */
     cJSON *host_obj = cJSON_CreateObject();
-    json_set_string(host_obj, "user", user);
-    json_set_string(host_obj, "host", host);
-    json_set_int(host_obj, "port", port);
+    json_set_string(host_obj, "user", entry->user);
+    json_set_string(host_obj, "host", entry->host);
+    json_set_int(host_obj, "port", entry->port);
     json_set_string(host_obj, "status", "untested");
     
     /* Add timestamp */
@@ -133,13 +117,53 @@ int till_host_add(const char *name, const char *user_at_host) {
     /* Update timestamp */
     char ts[32];
     snprintf(ts, sizeof(ts), "%ld", time(NULL));
-    cJSON_SetValuestring(cJSON_GetObjectItem(json, "updated"), ts);
+    json_set_string(json, "updated", ts);
+    return 0;
+}
+
+static int mark_host_ready(cJSON *json, void *ctx) {
+    cJSON *host = cJSON_GetObjectItem(cJSON_GetObjectItem(json, "hosts"), ctx);
+    if (!host) {
+        return 1;
+    }
+    json_set_string(host, "status", "ready");
+    return 0;
+}
+
+static int drop_host(cJSON *json, void *ctx) {
+    cJSON *hosts = cJSON_GetObjectItem(json, "hosts");
+    if (!cJSON_GetObjectItem(hosts, ctx)) {
+        return 1;
+    }
+    cJSON_DeleteItemFromObject(hosts, ctx);
+    return 0;
+}
+
+/* Add a new host */
+int till_host_add(const char *name, const char *user_at_host) {
+    if (!name || !user_at_host) {
+        till_log(LOG_ERROR, "Usage: till host add <name> <user>@<host>[:port]");
+        return -1;
+    }
     
-    /* Save hosts file */
-    if (save_till_json("hosts-local.json", json) != 0) {
-        till_log(LOG_ERROR, "Failed to save hosts file");
-        till_error("Failed to save hosts\n");
-        cJSON_Delete(json);
+    till_log(LOG_INFO, "Adding host '%s'", name);
+    printf("Adding host '%s'...\n", name);
+    
+    /* Parse user@host:port */
+    char user[256], host[256];
+    int port;
+    if (parse_host_spec(user_at_host, user, sizeof(user), 
+                       host, sizeof(host), &port) != 0) {
+        till_log(LOG_ERROR, "Invalid host specification: %s", user_at_host);
+        till_error("Invalid format. Use: user@host[:port]\n");
+        return -1;
+    }
+    
+    /* Add to the hosts file as it is under its lock; failures have
+     * been reported by then */
+    host_entry_t entry = { name, user, host, port };
+    if (till_json_transaction("hosts-local.json", add_host_entry, &entry) != 0) {
+        till_log(LOG_ERROR, "Host '%s' not added", name);
         return -1;
     }
     
@@ -150,8 +174,6 @@ int till_host_add(const char *name, const char *user_at_host) {
         printf("✓ SSH config updated\n");
     }
     
-    cJSON_Delete(json);
-    
     printf("\nUse 'till host test %s' to test connectivity\n", name);
     printf("Use 'till host setup %s' to install Till remotely\n", name);
     
@@ -223,8 +245,7 @@ int till_host_test(const char *name) {
         till_log(LOG_INFO, "SSH test successful for host '%s'", name);
         
         /* Update status */
-        cJSON_SetValuestring(cJSON_GetObjectItem(host, "status"), "ready");
-        save_till_json("hosts-local.json", json);
+        till_json_transaction("hosts-local.json", mark_host_ready, (void *)name);
         
         cJSON_Delete(json);
         return 0;
@@ -388,19 +409,17 @@ int till_host_remove(const char *name, int clean_remote) {
         }
     }
     
-    /* Remove host from JSON */
+    /* Remove host from the hosts file as it is now - the remote cleanup
+     * above can take a while */
     printf("Removing host '%s'...\n", name);
-    cJSON_DeleteItemFromObject(hosts, name);
+    cJSON_Delete(json);
     
-    if (save_till_json("hosts-local.json", json) != 0) {
+    if (till_json_transaction("hosts-local.json", drop_host, (void *)name) < 0) {
         till_log(LOG_ERROR, "Failed to update hosts file");
         till_error("Failed to update hosts file\n");
-        cJSON_Delete(json);
         return -1;
     }
     
-    cJSON_Delete(json);
-    
     /* Remove from SSH config */
     if (remove_ssh_config_entry(name) == 0) {
         printf("✓ SSH configuration cleaned up\n");
@@ -414,8 +433,45 @@ int till_host_remove(const char *name, int clean_remote) {
     return 0;
 }
 
+/* Hosts (or just the named one) as a status model section */
+cJSON *till_host_status_model(const char *name) {
+    cJSON *list = cJSON_CreateArray();
+    cJSON *json = load_till_json("hosts-local.json");
+    cJSON *host = NULL;
+    
+    cJSON_ArrayForEach(host, cJSON_GetObjectItem(json, "hosts")) {
+        if (!host->string || (name && strcmp(name, host->string) != 0)) {
+            continue;
+        }
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", host->string);
+        cJSON_AddStringToObject(item, "user", json_get_string(host, "user", ""));
+        cJSON_AddStringToObject(item, "host", json_get_string(host, "host", ""));
+        cJSON_AddNumberToObject(item, "port", json_get_int(host, "port", 22));
+        cJSON_AddStringToObject(item, "status", json_get_string(host, "status", ""));
+        cJSON_AddStringToObject(item, "added", json_get_string(host, "added", ""));
+        cJSON_AddItemToArray(list, item);
+    }
+    
+    cJSON_Delete(json);
+    return list;
+}
+
 /* Show host status */
 int till_host_status(const char *name) {
+    if (g_output != TILL_OUTPUT_TEXT && !name) {
+        return till_status_show(STATUS_HOSTS);
+    }
+    if (g_output != TILL_OUTPUT_TEXT) {
+        cJSON *hosts = till_host_status_model(name);
+        if (name && cJSON_GetArraySize(hosts) == 0) {
+            cJSON_Delete(hosts);
+            till_error("Host '%s' not found\n", name);
+            return -1;
+        }
+        return till_status_emit_section(STATUS_HOSTS, hosts);
+    }
+    
     cJSON *json = load_till_json("hosts-local.json");
     if (!json) {
         printf("No hosts configured.\n");
@@ -471,6 +527,23 @@ int till_host_status(const char *name) {
     return 0;
 }
 
+/* Print host update help */
+static void print_host_update_help(void) {
+    printf("Usage: till host update [name] [--relay]\n\n");
+    printf("Updates Till on one host, or all of them. Hosts with this machine's OS\n");
+    printf("and type get this build copied to them over SSH and check its SHA-256;\n");
+    printf("the rest pull and build their own.\n\n");
+    printf("Options:\n");
+    printf("  --relay    Let hosts that have the build copy it to the others, so\n");
+    printf("             copies double each round. This forwards your SSH agent to\n");
+    printf("             every host (ssh -A): while it runs, anyone with root on one\n");
+    printf("             of them can use your keys. The hash check protects the\n");
+    printf("             build, not your credentials - only relay among hosts you\n");
+    printf("             trust as much as this one. A relay only reaches hosts whose\n");
+    printf("             key the relaying host already knows; others are copied to\n");
+    printf("             directly from here.\n");
+}
+
 /* Print host command help */
 static void print_host_help(void) {
     printf("Till Host Management Commands\n\n");
@@ -478,7 +551,7 @@ static void print_host_help(void) {
     printf("Commands:\n");
     printf("  add <name> <user>@<host>[:port]  Add a new host\n");
     printf("  test <name>                      Test SSH connectivity\n");
-    printf("  update [name]                    Update Till on host(s) (auto-installs if needed)\n");
+    printf("  update [name] [--relay]          Update Till on host(s), sharing this build (auto-installs if needed)\n");
     printf("  sync [name]                      Sync Tekton installations on host(s)\n");
     printf("  exec <name> <command>            Execute command on remote\n");
     printf("  ssh <name> [args]                SSH to remote host\n");
@@ -497,6 +570,50 @@ static void print_host_help(void) {
     printf("  till host exec m2 'till status'\n");
 }
 
+/* What a host sync learned, merged into the hosts file as it is now */
+typedef struct {
+    cJSON *merged;              /* hosts as the sync saw them */
+    cJSON *known;               /* hosts in the file when the sync started */
+    cJSON *saved;               /* the file as written, to push to remotes */
+} host_sync_t;
+
+static int merge_synced_hosts(cJSON *json, void *ctx) {
+    static const char *const learned[] = { "hostname", "till_configured", "till_path" };
+    host_sync_t *sync = ctx;
+    cJSON *hosts = cJSON_GetObjectItem(json, "hosts");
+    cJSON *host;
+    
+    if (!cJSON_IsObject(hosts)) {
+        cJSON_DeleteItemFromObject(json, "hosts");
+        hosts = cJSON_AddObjectToObject(json, "hosts");
+    }
+    till_json_index_t index;
+    till_json_index_init(&index, hosts);
+    
+    cJSON_ArrayForEach(host, sync->merged) {
+        cJSON *current = till_json_index_get(&index, host->string);
+        if (cJSON_GetObjectItem(sync->known, host->string)) {
+            /* One of ours: record what we found, unless it was removed meanwhile */
+            for (size_t i = 0; current && i < sizeof(learned) / sizeof(learned[0]); i++) {
+                cJSON *value = cJSON_GetObjectItem(host, learned[i]);
+                if (cJSON_IsString(value)) {
+                    json_set_string(current, learned[i], value->valuestring);
+                }
+            }
+        } else if (!till_json_index_get_nocase(&index, host->string)) {
+            till_json_index_add(&index, host->string, cJSON_Duplicate(host, 1));
+        }
+    }
+    till_json_index_free(&index);
+    
+    char ts[32];
+    snprintf(ts, sizeof(ts), "%ld", time(NULL));
+    json_set_string(json, "updated", ts);
+    
+    sync->saved = cJSON_Duplicate(json, 1);
+    return sync->saved ? 0 : -1;
+}
+
 /* Update host configurations across all machines (internal function) */
 static int till_host_update_configs(void) {
     printf("Updating host configurations...\n");
@@ -519,6 +636,10 @@ static int till_host_update_configs(void) {
     /* Create merged hosts object */
     cJSON *merged_hosts = cJSON_CreateObject();
     
+    /* Each remote's hosts are checked against the merged set */
+    till_json_index_t merged_index;
+    till_json_index_init(&merged_index, merged_hosts);
+    
     /* First, copy all local hosts to merged */
     cJSON *host;
     cJSON_ArrayForEach(host, local_hosts) {
@@ -534,7 +655,7 @@ static int till_host_update_configs(void) {
             json_set_string(host_copy, "till_configured", "yes");
         }
         
-        cJSON_AddItemToObject(merged_hosts, host_name, host_copy);
+        till_json_index_add(&merged_index, host_name, host_copy);
     }
     
     /* Process each remote host */
@@ -578,7 +699,7 @@ static int till_host_update_configs(void) {
             printf("    ✓ Hostname: %s\n", output);
             
             /* Update host entry with hostname */
-            cJSON *merged_host = cJSON_GetObjectItem(merged_hosts, host_name);
+            cJSON *merged_host = till_json_index_get(&merged_index, host_name);
             if (merged_host) {
                 json_set_string(merged_host, "hostname", output);
             }
@@ -614,7 +735,7 @@ static int till_host_update_configs(void) {
                 }
                 
                 /* Update host entry */
-                cJSON *merged_host = cJSON_GetObjectItem(merged_hosts, host_name);
+                cJSON *merged_host = till_json_index_get(&merged_index, host_name);
                 if (merged_host) {
                     json_set_string(merged_host, "till_configured", till_configured);
                     if (strlen(till_path) > 0) {
@@ -658,9 +779,9 @@ static int till_host_update_configs(void) {
                         const char *remote_host_name = remote_host->string;
                         
                         /* Don't overwrite existing entries, but add new ones */
-                        if (!cJSON_GetObjectItem(merged_hosts, remote_host_name)) {
+                        if (!till_json_index_get_nocase(&merged_index, remote_host_name)) {
                             cJSON *host_copy = cJSON_Duplicate(remote_host, 1);
-                            cJSON_AddItemToObject(merged_hosts, remote_host_name, host_copy);
+                            till_json_index_add(&merged_index, remote_host_name, host_copy);
                             printf("    + Added host '%s' from remote\n", remote_host_name);
                         }
                     }
@@ -680,25 +801,21 @@ static int till_host_update_configs(void) {
         hosts_processed++;
     }
     
-    /* Create new hosts file without local_hostname */
-    cJSON *new_json = cJSON_CreateObject();
-    cJSON_AddItemToObject(new_json, "hosts", merged_hosts);
-    
-    /* Update timestamp */
-    char ts[32];
-    snprintf(ts, sizeof(ts), "%ld", time(NULL));
-    json_set_string(new_json, "updated", ts);
-    
-    /* Save merged hosts locally */
+    /* Save merged hosts locally; the SSH round trips took a while, so
+     * apply them to the file as it is now, not as it was read */
     printf("\nSaving merged hosts file...\n");
-    if (save_till_json("hosts-local.json", new_json) == 0) {
+    host_sync_t sync = { merged_hosts, local_hosts, NULL };
+    if (till_json_transaction("hosts-local.json", merge_synced_hosts, &sync) == 0) {
         printf("✓ Local hosts file updated\n");
     } else {
         till_error("Failed to save merged hosts file\n");
+        till_json_index_free(&merged_index);
+        cJSON_Delete(merged_hosts);
         cJSON_Delete(local_json);
-        cJSON_Delete(new_json);
+        cJSON_Delete(sync.saved);
         return -1;
     }
+    cJSON *new_json = sync.saved;
     
     /* Push merged hosts to all remotes */
     printf("\nPushing hosts file to all remotes...\n");
@@ -718,7 +835,7 @@ static int till_host_update_configs(void) {
         if (!port) port = 22;
         
         /* Check if till is configured */
-        cJSON *merged_host = cJSON_GetObjectItem(merged_hosts, host_name);
+        cJSON *merged_host = till_json_index_get(&merged_index, host_name);
         const char *till_configured = json_get_string(merged_host, "till_configured", "no");
         
         if (strcmp(till_configured, "yes") == 0) {
@@ -778,6 +895,8 @@ static int till_host_update_configs(void) {
     }
     
     free(hosts_json_str);
+    till_json_index_free(&merged_index);
+    cJSON_Delete(merged_hosts);
     cJSON_Delete(local_json);
     cJSON_Delete(new_json);
     
@@ -1025,19 +1144,34 @@ static int run_till_on_all_hosts(const char *till_cmd) {
     return failed > 0 ? 1 : 0;
 }
 
-/* Update Till on remote host(s) */
-int till_host_update(const char *host_name) {
+/* Update Till on remote host(s) - same-platform hosts get this host's
+ * build pushed to them; the rest pull and build as before */
+int till_host_update(const char *host_name, int relay) {
     if (host_name) {
-        /* Update specific host */
         printf("Updating Till on host '%s'...\n", host_name);
         till_log(LOG_INFO, "Updating Till on host: %s", host_name);
-        return run_till_on_host(host_name, "update");
     } else {
-        /* Update all hosts */
         printf("Updating Till on all hosts...\n");
         till_log(LOG_INFO, "Updating Till on all hosts");
-        return run_till_on_all_hosts("update");
     }
+
+    cJSON *fallback = cJSON_CreateArray();
+    int failed = till_host_distribute(host_name, fallback, relay);
+    if (failed < 0) {
+        cJSON_Delete(fallback);
+        return host_name ? run_till_on_host(host_name, "update")
+                         : run_till_on_all_hosts("update");
+    }
+
+    cJSON *name;
+    cJSON_ArrayForEach(name, fallback) {
+        printf("\n");
+        if (run_till_on_host(name->valuestring, "update") != 0) {
+            failed++;
+        }
+    }
+    cJSON_Delete(fallback);
+    return failed > 0 ? 1 : 0;
 }
 
 /* Sync Tekton installations on remote host(s) */
@@ -1113,11 +1247,26 @@ int till_host_command(int argc, char *argv[]) {
         return till_host_remove(argv[1], clean_remote);
     }
     else if (strcmp(subcmd, "status") == 0 || strcmp(subcmd, "list") == 0) {
+        argc = till_output_parse(argc, argv);
         return till_host_status(argc > 1 ? argv[1] : NULL);
     }
     else if (strcmp(subcmd, "update") == 0) {
-        const char *host_name = (argc > 1) ? argv[1] : NULL;
-        return till_host_update(host_name);
+        const char *host_name = NULL;
+        int relay = 0;
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+                print_host_update_help();
+                return 0;
+            } else if (strcmp(argv[i], "--relay") == 0) {
+                relay = 1;
+            } else if (argv[i][0] == '-' || host_name) {
+                till_error("Usage: till host update [name] [--relay]\n");
+                return -1;
+            } else {
+                host_name = argv[i];
+            }
+        }
+        return till_host_update(host_name, relay);
     }
     else if (strcmp(subcmd, "sync") == 0) {
         const char *host_name = (argc > 1) ? argv[1] : NULL;
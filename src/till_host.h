@@ -5,6 +5,8 @@
 #ifndef TILL_HOST_H
 #define TILL_HOST_H
 
+#include "cJSON.h"
+
 /* Add a new host */
 int till_host_add(const char *name, const char *user_at_host);
 
@@ -23,8 +25,13 @@ int till_host_remove(const char *name, int clean_remote);
 /* Show host status */
 int till_host_status(const char *name);
 
-/* Update Till on remote host(s) */
-int till_host_update(const char *host_name);
+/* Update Till on remote host(s); relay lets hosts pass the build on */
+int till_host_update(const char *host_name, int relay);
+
+/* Push this host's build to same-platform hosts (till_host_dist.c),
+ * directly or, with relay, host to host over agent forwarding; hosts
+ * that must build their own are appended to fallback */
+int till_host_distribute(const char *host_name, cJSON *fallback, int relay);
 
 /* Sync Tekton installations on remote host(s) */
 int till_host_sync(const char *host_name);
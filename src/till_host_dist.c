@@ -0,0 +1,350 @@
+/*
+ * till_host_dist.c - Push Till builds to managed hosts
+ *
+ * "till host update" verifies one build here and copies it over SSH to
+ * every host with the same OS and machine type, several at a time. With
+ * --relay copies go out in rounds instead: each host that has the build
+ * passes it to one more, so the number of holders doubles every round.
+ * That forwards our SSH agent to every host, so any of them could use our
+ * keys while it runs - it is opt-in, and the hop only goes to hosts whose
+ * key the relaying host already knows. A failed relay is retried directly
+ * from here, and every copy is checked against its SHA-256 before it is
+ * kept. Hosts of another type, or without a Till checkout, update
+ * themselves as before.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include "till_config.h"
+#include "till_host.h"
+#include "till_common.h"
+#include "till_security.h"
+#include "till_update.h"
+#include "cJSON.h"
+
+#define DIST_SSH "ssh -o ConnectTimeout=5 -o BatchMode=yes"
+
+typedef enum {
+    DIST_UNREACHABLE = 0,
+    DIST_FALLBACK,              /* other platform or no checkout - builds itself */
+    DIST_NEEDS,                 /* same platform, build not stored there */
+    DIST_HAS,                   /* build stored there */
+    DIST_FAILED                 /* copy failed */
+} dist_state_t;
+
+typedef struct {
+    char name[128];
+    char user[128];
+    char host[256];
+    int port;
+    dist_state_t state;
+    int relayed;                /* received from another host */
+    int activated;
+} dist_host_t;
+
+typedef struct dist_pool dist_pool_t;
+typedef void (*dist_job_fn)(dist_pool_t *pool, int job);
+
+struct dist_pool {
+    dist_host_t *hosts;
+    int count;
+    char sha[TILL_SHA256_HEX];
+    char commit[64];
+    char binary[TILL_MAX_PATH];
+    /* "uname -sm" here */
+    char platform[sizeof(((struct utsname *)0)->sysname) + sizeof(((struct utsname *)0)->machine)];
+    int *pairs;                 /* this round: holder (-1 = here), target */
+    dist_job_fn job;
+    int job_count;
+    int next_job;
+    pthread_mutex_t mutex;
+};
+
+static void *dist_worker(void *arg) {
+    dist_pool_t *pool = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        int job = pool->next_job < pool->job_count ? pool->next_job++ : -1;
+        pthread_mutex_unlock(&pool->mutex);
+        if (job < 0) {
+            return NULL;
+        }
+        pool->job(pool, job);
+    }
+}
+
+/* Run job(0..count-1) on up to TILL_HOST_DIST_WORKERS threads */
+static void dist_run(dist_pool_t *pool, dist_job_fn job, int count) {
+    pthread_t threads[TILL_HOST_DIST_WORKERS];
+    int started = 0;
+
+    pool->job = job;
+    pool->job_count = count;
+    pool->next_job = 0;
+
+    for (int i = 0; i < count && i < TILL_HOST_DIST_WORKERS; i++) {
+        if (pthread_create(&threads[i], NULL, dist_worker, pool) != 0) {
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        dist_worker(pool);  /* No threads - do it here */
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/* Shell that takes the build on stdin, checks its hash and keeps it.
+ * d is "$" when run directly and "\$" inside a relay's double quotes. */
+static void receive_script(char *buf, size_t size, const char *sha, const char *d) {
+    snprintf(buf, size,
+        "v=%sHOME/%s/%s; mkdir -p %sv && cat > %sv/till.new && chmod 755 %sv/till.new && "
+        "s=%s( (sha256sum %sv/till.new 2>/dev/null || shasum -a 256 %sv/till.new) | cut -c1-64) && "
+        "[ x%ss = x%s ] && mv %sv/till.new %sv/till && echo RECEIVED",
+        d, TILL_VERSIONS_DIR, sha, d, d, d,
+        d, d, d,
+        d, sha, d, d);
+}
+
+/* Platform, checkout and stored build of one host */
+static void probe_job(dist_pool_t *pool, int job) {
+    dist_host_t *h = &pool->hosts[job];
+    char cmd[2048];
+    char output[512];
+
+    snprintf(cmd, sizeof(cmd),
+        DIST_SSH " -p %d %s@%s 'uname -sm; [ -d ~/%s/till ] && echo CHECKOUT; "
+        "[ -x ~/%s/%s/till ] && echo STORED; exit 0' 2>/dev/null",
+        h->port, h->user, h->host, TILL_PROJECTS_BASE, TILL_VERSIONS_DIR, pool->sha);
+
+    if (run_command(cmd, output, sizeof(output)) != 0) {
+        h->state = DIST_UNREACHABLE;
+        return;
+    }
+    char *rest = strchr(output, '\n');
+    if (rest) {
+        *rest++ = '\0';
+    } else {
+        rest = "";
+    }
+    if (strcmp(output, pool->platform) != 0 || !strstr(rest, "CHECKOUT")) {
+        h->state = DIST_FALLBACK;
+    } else {
+        h->state = strstr(rest, "STORED") ? DIST_HAS : DIST_NEEDS;
+    }
+}
+
+/* Copy the build to a host from here */
+static int push_direct(dist_pool_t *pool, dist_host_t *to) {
+    char script[1024];
+    char cmd[4096];
+    char output[512];
+
+    receive_script(script, sizeof(script), pool->sha, "$");
+    if (snprintf(cmd, sizeof(cmd), DIST_SSH " -p %d %s@%s '%s' < \"%s\" 2>&1",
+                 to->port, to->user, to->host, script, pool->binary) >= (int)sizeof(cmd)) {
+        return -1;
+    }
+    return run_command(cmd, output, sizeof(output)) == 0 && strstr(output, "RECEIVED") ? 0 : -1;
+}
+
+/* Have a host that has the build copy it to another */
+static int push_relay(dist_pool_t *pool, dist_host_t *from, dist_host_t *to) {
+    char script[1024];
+    char cmd[4096];
+    char output[512];
+
+    receive_script(script, sizeof(script), pool->sha, "\\$");
+    snprintf(cmd, sizeof(cmd),
+        DIST_SSH " -A -p %d %s@%s '" DIST_SSH " "
+        "-p %d %s@%s \"%s\" < $HOME/%s/%s/till' 2>&1",
+        from->port, from->user, from->host,
+        to->port, to->user, to->host, script, TILL_VERSIONS_DIR, pool->sha);
+    return run_command(cmd, output, sizeof(output)) == 0 && strstr(output, "RECEIVED") ? 0 : -1;
+}
+
+static void push_job(dist_pool_t *pool, int job) {
+    int holder = pool->pairs[job * 2];
+    dist_host_t *to = &pool->hosts[pool->pairs[job * 2 + 1]];
+
+    if (holder >= 0 && push_relay(pool, &pool->hosts[holder], to) == 0) {
+        to->relayed = 1;
+        to->state = DIST_HAS;
+        printf("  ✓ %s (from %s)\n", to->name, pool->hosts[holder].name);
+    } else if (push_direct(pool, to) == 0) {
+        to->state = DIST_HAS;
+        printf("  ✓ %s\n", to->name);
+    } else {
+        to->state = DIST_FAILED;
+        printf("  ✗ %s: copy failed\n", to->name);
+    }
+    fflush(stdout);
+}
+
+/* Switch a host to the stored build */
+static void activate_job(dist_pool_t *pool, int job) {
+    dist_host_t *h = &pool->hosts[job];
+    char cmd[2048];
+    char output[1024];
+
+    if (h->state != DIST_HAS) {
+        return;
+    }
+    snprintf(cmd, sizeof(cmd),
+        DIST_SSH " -p %d %s@%s '~/%s/%s/till update --use %s%s%s' 2>&1",
+        h->port, h->user, h->host, TILL_VERSIONS_DIR, pool->sha, pool->sha,
+        pool->commit[0] ? " --commit " : "", pool->commit);
+    h->activated = run_command(cmd, output, sizeof(output)) == 0;
+}
+
+/* Hosts from hosts-local.json (all, or one), local excluded */
+static int load_dist_hosts(const char *only, dist_host_t **out) {
+    cJSON *json = load_till_json("hosts-local.json");
+    cJSON *hosts = cJSON_GetObjectItem(json, "hosts");
+    cJSON *host;
+    int count = 0;
+
+    *out = calloc(cJSON_GetArraySize(hosts) + 1, sizeof(dist_host_t));
+    if (!*out) {
+        cJSON_Delete(json);
+        return -1;
+    }
+
+    cJSON_ArrayForEach(host, hosts) {
+        const char *user = json_get_string(host, "user", NULL);
+        const char *hostname = json_get_string(host, "host", NULL);
+
+        if (!host->string || strcmp(host->string, "local") == 0 ||
+            (only && strcmp(host->string, only) != 0)) {
+            continue;
+        }
+        if (!user || !hostname) {
+            printf("  ⚠ Skipping %s: invalid configuration\n", host->string);
+            continue;
+        }
+
+        dist_host_t *h = &(*out)[count++];
+        safe_strncpy(h->name, host->string, sizeof(h->name));
+        safe_strncpy(h->user, user, sizeof(h->user));
+        safe_strncpy(h->host, hostname, sizeof(h->host));
+        h->port = json_get_int(host, "port", 22);
+    }
+
+    cJSON_Delete(json);
+    return count;
+}
+
+/* Push this host's build to same-platform hosts and switch them to it.
+ * Hosts that must update themselves are appended to fallback by name.
+ * Returns hosts that could not be reached, or -1 if there is no build here. */
+int till_host_distribute(const char *host_name, cJSON *fallback, int relay) {
+    dist_pool_t pool;
+    struct utsname uts;
+    int unreachable = 0;
+    int copies = 0, relayed = 0, activated = 0, rounds = 0;
+
+    memset(&pool, 0, sizeof(pool));
+    if (uname(&uts) != 0 ||
+        till_update_artifact(pool.sha, pool.commit, sizeof(pool.commit)) != 0 ||
+        till_update_version_path(pool.sha, pool.binary, sizeof(pool.binary)) != 0) {
+        till_warn("No verified build here to share - hosts will build their own");
+        return -1;
+    }
+    snprintf(pool.platform, sizeof(pool.platform), "%s %s", uts.sysname, uts.machine);
+
+    pool.count = load_dist_hosts(host_name, &pool.hosts);
+    if (pool.count <= 0) {
+        if (host_name && pool.count == 0) {
+            till_error("Host '%s' not found", host_name);
+        }
+        free(pool.hosts);
+        return pool.count < 0 ? -1 : (host_name ? 1 : 0);
+    }
+    pthread_mutex_init(&pool.mutex, NULL);
+
+    printf("Sharing till %.12s (%s) with %d host%s\n", pool.sha, pool.platform,
+           pool.count, pool.count == 1 ? "" : "s");
+    dist_run(&pool, probe_job, pool.count);
+
+    /* Holders: here (-1) and, when relaying, hosts that already have it;
+     * every round each holder feeds one host that doesn't. Without relays
+     * here feeds every host in a single round */
+    int *holders = malloc((pool.count + 1) * sizeof(int));
+    int *pending = malloc(pool.count * sizeof(int));
+    pool.pairs = malloc(pool.count * 2 * sizeof(int));
+    int holder_count = 0, pending_count = 0;
+
+    if (holders && pending && pool.pairs) {
+        holders[holder_count++] = -1;
+        for (int i = 0; i < pool.count; i++) {
+            if (pool.hosts[i].state == DIST_HAS) {
+                if (relay) {
+                    holders[holder_count++] = i;
+                }
+            } else if (pool.hosts[i].state == DIST_NEEDS) {
+                pending[pending_count++] = i;
+            }
+        }
+
+        int next = 0;
+        while (next < pending_count) {
+            int feeders = relay ? holder_count : pending_count - next;
+            int pairs = pending_count - next < feeders ? pending_count - next : feeders;
+            for (int i = 0; i < pairs; i++) {
+                pool.pairs[i * 2] = relay ? holders[i] : -1;
+                pool.pairs[i * 2 + 1] = pending[next + i];
+            }
+            printf("Round %d: %d cop%s\n", ++rounds, pairs, pairs == 1 ? "y" : "ies");
+            dist_run(&pool, push_job, pairs);
+
+            for (int i = 0; i < pairs; i++) {
+                dist_host_t *h = &pool.hosts[pending[next + i]];
+                if (h->state == DIST_HAS) {
+                    holders[holder_count++] = pending[next + i];
+                    copies++;
+                    relayed += h->relayed;
+                }
+            }
+            next += pairs;
+        }
+    }
+    free(holders);
+    free(pending);
+    free(pool.pairs);
+
+    dist_run(&pool, activate_job, pool.count);
+
+    for (int i = 0; i < pool.count; i++) {
+        dist_host_t *h = &pool.hosts[i];
+        if (h->activated) {
+            activated++;
+        } else if (h->state == DIST_UNREACHABLE) {
+            printf("  ✗ %s: unreachable\n", h->name);
+            unreachable++;
+        } else {
+            cJSON_AddItemToArray(fallback, cJSON_CreateString(h->name));
+        }
+    }
+
+    printf("\nShared: %d cop%s in %d round%s (%d relayed), %d host%s switched",
+           copies, copies == 1 ? "y" : "ies", rounds, rounds == 1 ? "" : "s", relayed,
+           activated, activated == 1 ? "" : "s");
+    if (cJSON_GetArraySize(fallback) > 0) {
+        printf(", %d building their own", cJSON_GetArraySize(fallback));
+    }
+    printf("\n");
+    till_log(LOG_INFO, "Host update: %.12s to %d hosts, %d copies in %d rounds, %d unreachable",
+             pool.sha, activated, copies, rounds, unreachable);
+
+    pthread_mutex_destroy(&pool.mutex);
+    free(pool.hosts);
+    return unreachable;
+}
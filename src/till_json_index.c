@@ -0,0 +1,186 @@
+/*
+ * till_json_index.c - Hashed member lookup for large cJSON objects
+ *
+ * Each map entry points at the first member with its key, which is what
+ * cJSON's own lookups return when a key repeats, and its counter holds how
+ * many members share the key. Deleting the member an entry points at only
+ * walks the list to find the next one when the counter says there is one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "till_config.h"
+#include "till_json_index.h"
+
+/* Lowercase key into buf, or a malloc'd copy if it doesn't fit */
+static char *fold_key(const char *key, char *buf, size_t size) {
+    size_t len = strlen(key);
+    char *folded = len < size ? buf : malloc(len + 1);
+
+    if (folded) {
+        for (size_t i = 0; i <= len; i++) {
+            folded[i] = (char)tolower((unsigned char)key[i]);
+        }
+    }
+    return folded;
+}
+
+static int same_key(const char *a, const char *b, int fold) {
+    if (!fold) {
+        return strcmp(a, b) == 0;
+    }
+    for (; *a && tolower((unsigned char)*a) == tolower((unsigned char)*b); a++, b++) {
+    }
+    return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+static int map_add(till_hash_t *map, const char *key, cJSON *item) {
+    int created;
+    till_hash_entry_t *entry = till_hash_upsert(map, key, &created);
+
+    if (!entry) {
+        return -1;
+    }
+    if (created) {
+        entry->value = item;
+    }
+    entry->count++;
+    return 0;
+}
+
+/* Drop item from the entry for key; fold says how keys compare */
+static void map_remove(till_hash_t *map, cJSON *object, const char *key, cJSON *item, int fold) {
+    till_hash_entry_t *entry = till_hash_find(map, key);
+
+    if (!entry) {
+        return;
+    }
+    if (--entry->count <= 0) {
+        till_hash_remove(map, key);
+        return;
+    }
+    if (entry->value == item) {
+        entry->value = NULL;
+        for (cJSON *member = object->child; member; member = member->next) {
+            if (member != item && member->string && same_key(member->string, key, fold)) {
+                entry->value = member;
+                break;
+            }
+        }
+    }
+}
+
+static int index_member(till_json_index_t *index, cJSON *item) {
+    char buf[TILL_MAX_NAME];
+    char *folded = fold_key(item->string, buf, sizeof(buf));
+    int result = -1;
+
+    if (folded) {
+        result = map_add(&index->keys, item->string, item) == 0 &&
+                 map_add(&index->folded, folded, item) == 0 ? 0 : -1;
+        if (folded != buf) {
+            free(folded);
+        }
+    }
+    return result;
+}
+
+/* Hash every member; on failure the index goes back to walking the list */
+static void index_build(till_json_index_t *index) {
+    index->hashed = 1;
+    for (cJSON *member = index->object->child; member; member = member->next) {
+        if (member->string && index_member(index, member) != 0) {
+            till_json_index_free(index);
+            return;
+        }
+    }
+}
+
+void till_json_index_init(till_json_index_t *index, cJSON *object) {
+    memset(index, 0, sizeof(*index));
+    till_hash_init(&index->keys);
+    till_hash_init(&index->folded);
+    index->object = cJSON_IsObject(object) ? object : NULL;
+
+    if (index->object && cJSON_GetArraySize(index->object) >= TILL_JSON_INDEX_MIN) {
+        index_build(index);
+    }
+}
+
+/* Leaves the object alone; the index can be re-initialized */
+void till_json_index_free(till_json_index_t *index) {
+    till_hash_free(&index->keys, NULL);
+    till_hash_free(&index->folded, NULL);
+    index->hashed = 0;
+}
+
+cJSON *till_json_index_get(const till_json_index_t *index, const char *key) {
+    if (!index->object || !key) {
+        return NULL;
+    }
+    if (!index->hashed) {
+        return cJSON_GetObjectItemCaseSensitive(index->object, key);
+    }
+    return till_hash_get(&index->keys, key);
+}
+
+cJSON *till_json_index_get_nocase(const till_json_index_t *index, const char *key) {
+    if (!index->object || !key) {
+        return NULL;
+    }
+    if (!index->hashed) {
+        return cJSON_GetObjectItem(index->object, key);
+    }
+
+    char buf[TILL_MAX_NAME];
+    char *folded = fold_key(key, buf, sizeof(buf));
+    if (!folded) {
+        return cJSON_GetObjectItem(index->object, key);
+    }
+    cJSON *item = till_hash_get(&index->folded, folded);
+    if (folded != buf) {
+        free(folded);
+    }
+    return item;
+}
+
+int till_json_index_add(till_json_index_t *index, const char *key, cJSON *item) {
+    if (!index->object || !cJSON_AddItemToObject(index->object, key, item)) {
+        return -1;
+    }
+
+    if (index->hashed) {
+        if (index_member(index, item) != 0) {
+            till_json_index_free(index);
+        }
+    } else if (cJSON_GetArraySize(index->object) >= TILL_JSON_INDEX_MIN) {
+        index_build(index);
+    }
+    return 0;
+}
+
+void till_json_index_delete(till_json_index_t *index, cJSON *item) {
+    if (!index->object || !item) {
+        return;
+    }
+
+    cJSON_DetachItemViaPointer(index->object, item);
+    if (index->hashed && item->string) {
+        char buf[TILL_MAX_NAME];
+        char *folded = fold_key(item->string, buf, sizeof(buf));
+
+        map_remove(&index->keys, index->object, item->string, item, 0);
+        if (folded) {
+            map_remove(&index->folded, index->object, folded, item, 1);
+            if (folded != buf) {
+                free(folded);
+            }
+        } else {
+            till_json_index_free(index);
+        }
+    }
+    cJSON_Delete(item);
+}
@@ -0,0 +1,41 @@
+/*
+ * till_json_index.h - Hashed member lookup for large cJSON objects
+ *
+ * cJSON finds object members by walking the child list, which turns
+ * loops over installations, hosts or holds into O(n^2). An index sits
+ * beside one object and maps keys to members; it only hashes once the
+ * object has TILL_JSON_INDEX_MIN members, and below that lookups walk
+ * the list as before. Adding and deleting through the index keeps it
+ * valid; changing the object behind its back does not.
+ */
+
+#ifndef TILL_JSON_INDEX_H
+#define TILL_JSON_INDEX_H
+
+#include "till_hash.h"
+#include "cJSON.h"
+
+typedef struct {
+    cJSON *object;
+    int hashed;                  /* Large enough to hash */
+    till_hash_t keys;            /* Exact key -> first member with it */
+    till_hash_t folded;          /* Lowercased key -> first member with it */
+} till_json_index_t;
+
+/* Attach to object (which may be NULL - lookups then find nothing) */
+void till_json_index_init(till_json_index_t *index, cJSON *object);
+void till_json_index_free(till_json_index_t *index);
+
+/* Case-sensitive lookup, like cJSON_GetObjectItemCaseSensitive */
+cJSON *till_json_index_get(const till_json_index_t *index, const char *key);
+
+/* Case-insensitive lookup, like cJSON_GetObjectItem */
+cJSON *till_json_index_get_nocase(const till_json_index_t *index, const char *key);
+
+/* Add item under key, like cJSON_AddItemToObject */
+int till_json_index_add(till_json_index_t *index, const char *key, cJSON *item);
+
+/* Delete a member of the object */
+void till_json_index_delete(till_json_index_t *index, cJSON *item);
+
+#endif /* TILL_JSON_INDEX_H */
@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <pwd.h>
 #include <limits.h>
+#include <time.h>
 
 #if PLATFORM_MACOS
 #define _DARWIN_C_SOURCE 1
@@ -143,6 +144,15 @@ const char *platform_get_temp_dir(void) {
     return "/tmp";
 }
 
+int64_t platform_stat_mtime_ns(const struct stat *st) {
+#if PLATFORM_MACOS
+    const struct timespec *mtime = &st->st_mtimespec;
+#else
+    const struct timespec *mtime = &st->st_mtim;
+#endif
+    return (int64_t)mtime->tv_sec * 1000000000 + mtime->tv_nsec;
+}
+
 /* Test host connectivity with ping */
 int platform_ping_host(const char *hostname, int timeout_ms) {
     if (!hostname) return -1;
@@ -283,6 +293,24 @@ int platform_get_memory_mb(void) {
     return 0;
 }
 
+/* Get 1-minute load average */
+double platform_get_load_average(void) {
+#if PLATFORM_MACOS || PLATFORM_BSD
+    struct loadavg load;
+    size_t size = sizeof(load);
+    if (sysctlbyname("vm.loadavg", &load, &size, NULL, 0) == 0 && load.fscale > 0) {
+        return (double)load.ldavg[0] / load.fscale;
+    }
+#elif PLATFORM_LINUX
+    struct sysinfo info;
+    if (sysinfo(&info) == 0) {
+        return info.loads[0] / (double)(1 << SI_LOAD_SHIFT);
+    }
+#endif
+    
+    return -1;
+}
+
 /* Get executable path */
 int platform_get_executable_path(char *path, size_t size) {
 #if PLATFORM_MACOS
@@ -134,6 +134,11 @@ int platform_mkdir_p(const char *path, int mode);
 /* Set file permissions */
 int platform_set_permissions(const char *path, int mode);
 
+/* Modification time of a stat result, in nanoseconds since the epoch
+ * (st_mtim on Linux and BSD, st_mtimespec on macOS) */
+struct stat;
+int64_t platform_stat_mtime_ns(const struct stat *st);
+
 /* Network Functions */
 
 /* Get list of network interfaces */
@@ -156,6 +161,9 @@ int platform_get_cpu_count(void);
 /* Get total memory in MB */
 int platform_get_memory_mb(void);
 
+/* Get 1-minute load average, or -1 if unknown */
+double platform_get_load_average(void);
+
 /* Get platform capabilities */
 void platform_get_capabilities(platform_capabilities_t *caps);
 
@@ -1,131 +1,363 @@
 /*
  * till_progress.c - Progress indicator for long operations
+ *
+ * Tasks live in a fixed table guarded by one mutex. A renderer thread
+ * runs while any task is live; it sleeps on a condition variable and is
+ * woken by task changes, so an idle display costs nothing. Terminal
+ * redraws are limited to one per PROGRESS_REFRESH_MS (plus a once a second
+ * tick for the elapsed column); elsewhere output is a summary line every
+ * PROGRESS_SUMMARY_SECONDS, which keeps logs from cron and systemd short.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
 #include <unistd.h>
-#include <signal.h>
-#include <sys/time.h>
 #include <pthread.h>
+#include <sys/stat.h>
 
 #include "till_config.h"
 #include "till_progress.h"
+#include "till_security.h"
+
+/* One tracked task */
+typedef struct {
+    int used;
+    char name[64];
+    char state[32];
+    double start;
+    size_t bytes;
+    size_t lines;
+} progress_task_t;
 
 /* Progress state */
 static struct {
-    int active;
-    const char *message;
+    progress_task_t tasks[PROGRESS_MAX_TASKS];
+    int active;                 /* live tasks */
+    int finished;               /* ended since the renderer started */
+    int failed;
+    int legacy;                 /* task behind progress_start(), or -1 */
+    int dirty;                  /* changed since the last draw */
+    int running;                /* renderer thread exists */
+    int stopping;
+    int tty;                    /* draw lines rather than summaries */
+    int drawn;                  /* lines of the block now on screen */
+    int summaries;              /* summary lines written this run */
+    double started;
     pthread_t thread;
     pthread_mutex_t mutex;
-    int dots;
-    struct timeval start_time;
+    pthread_cond_t wake;
 } progress_state = {
-    .active = 0,
+    .legacy = -1,
     .mutex = PTHREAD_MUTEX_INITIALIZER,
-    .dots = 0
+    .wake = PTHREAD_COND_INITIALIZER
 };
 
-/* Progress thread function */
+/* Serializes starting and joining the renderer; taken before the mutex */
+static pthread_mutex_t progress_lifecycle = PTHREAD_MUTEX_INITIALIZER;
+
+static double progress_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Status lines only make sense on an interactive terminal */
+static int progress_on_terminal(void) {
+    const char *term = getenv("TERM");
+    return isatty(STDERR_FILENO) && term && *term && strcmp(term, "dumb") != 0;
+}
+
+static void format_size(size_t bytes, char *out, size_t size) {
+    if (bytes >= 1024 * 1024) {
+        snprintf(out, size, "%.1f MB", bytes / (1024.0 * 1024.0));
+    } else if (bytes >= 1024) {
+        snprintf(out, size, "%.1f KB", bytes / 1024.0);
+    } else {
+        snprintf(out, size, "%zu B", bytes);
+    }
+}
+
+/* "name  state  12.3s  4.1 KB, 80 lines" */
+static void format_task(const progress_task_t *task, double now, char *out, size_t size) {
+    char seen[64] = "";
+    if (task->bytes > 0 || task->lines > 0) {
+        char amount[32];
+        format_size(task->bytes, amount, sizeof(amount));
+        snprintf(seen, sizeof(seen), "%s, %zu lines", amount, task->lines);
+    }
+    snprintf(out, size, "  %-28.28s %-12.12s %6.1fs  %s",
+             task->name, task->state, now - task->start, seen);
+}
+
+/* Redraw the block in place; the cursor rests on the line below it */
+static void draw_block(double now) {
+    char line[160];
+    int shown = 0;
+    int hidden = 0;
+
+    if (progress_state.drawn > 0) {
+        fprintf(stderr, "\033[%dA", progress_state.drawn);
+    }
+    for (int i = 0; i < PROGRESS_MAX_TASKS; i++) {
+        const progress_task_t *task = &progress_state.tasks[i];
+        if (!task->used) {
+            continue;
+        }
+        if (shown < PROGRESS_MAX_LINES) {
+            format_task(task, now, line, sizeof(line));
+            fprintf(stderr, "\r\033[K%s\n", line);
+            shown++;
+        } else {
+            hidden++;
+        }
+    }
+    if (hidden > 0) {
+        fprintf(stderr, "\r\033[K  ... and %d more\n", hidden);
+        shown++;
+    }
+    if (shown < progress_state.drawn) {
+        fprintf(stderr, "\033[J");
+    }
+    progress_state.drawn = shown;
+    fflush(stderr);
+}
+
+static void erase_block(void) {
+    if (progress_state.drawn > 0) {
+        fprintf(stderr, "\033[%dA\r\033[J", progress_state.drawn);
+        fflush(stderr);
+        progress_state.drawn = 0;
+    }
+}
+
+/* One line: counts, then the longest-running tasks */
+static void write_summary(double now) {
+    char line[512];
+    int len = snprintf(line, sizeof(line), "till: %d running, %d done, %d failed (%.0fs)",
+                       progress_state.active, progress_state.finished, progress_state.failed,
+                       now - progress_state.started);
+    int listed = 0;
+
+    for (int i = 0; i < PROGRESS_MAX_TASKS && listed < 3; i++) {
+        const progress_task_t *task = &progress_state.tasks[i];
+        if (task->used && len < (int)sizeof(line)) {
+            len += snprintf(line + len, sizeof(line) - len, "%s %s%s%s %.0fs",
+                            listed ? "," : " -", task->name, task->state[0] ? " " : "",
+                            task->state, now - task->start);
+            listed++;
+        }
+    }
+    fprintf(stderr, "%s\n", line);
+    fflush(stderr);
+    progress_state.summaries++;
+}
+
+/* Wait on the condition for up to seconds; called with the mutex held */
+static void progress_wait(double seconds) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    long ns = (long)(seconds * 1e9);
+    until.tv_sec += ns / 1000000000L;
+    until.tv_nsec += ns % 1000000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&progress_state.wake, &progress_state.mutex, &until);
+}
+
+/* Renderer thread - sleeps until a task changes or output is due */
 static void *progress_thread(void *arg) {
     (void)arg;  /* Unused */
-    
-    while (1) {
-        pthread_mutex_lock(&progress_state.mutex);
-        if (!progress_state.active) {
-            pthread_mutex_unlock(&progress_state.mutex);
-            break;
-        }
-        
-        /* Calculate elapsed time */
-        struct timeval now;
-        gettimeofday(&now, NULL);
-        long elapsed = (now.tv_sec - progress_state.start_time.tv_sec);
-        
-        /* Update dots every 2 seconds */
-        int new_dots = (elapsed / 2) % 6;  /* 0-5 dots, cycle every 10 seconds */
-        
-        if (new_dots != progress_state.dots) {
-            /* Clear current line */
-            fprintf(stderr, "\r%-60s\r", "");
-            
-            /* Print message with dots */
-            fprintf(stderr, "%s", progress_state.message);
-            for (int i = 0; i < new_dots; i++) {
-                fprintf(stderr, ".");
+    double refresh = PROGRESS_REFRESH_MS / 1000.0;
+    double last_draw = 0;
+    double next_summary = progress_state.started + PROGRESS_SUMMARY_SECONDS;
+
+    pthread_mutex_lock(&progress_state.mutex);
+    while (!progress_state.stopping) {
+        double now = progress_now();
+        double due;
+
+        if (progress_state.tty) {
+            double since = now - last_draw;
+            if ((progress_state.dirty || since >= 1.0) && since >= refresh) {
+                draw_block(now);
+                progress_state.dirty = 0;
+                last_draw = now;
+                continue;
             }
-            fflush(stderr);
-            
-            progress_state.dots = new_dots;
+            due = progress_state.dirty ? refresh - since : 1.0 - since;
+        } else {
+            if (now >= next_summary) {
+                write_summary(now);
+                next_summary += PROGRESS_SUMMARY_SECONDS;
+                continue;
+            }
+            due = next_summary - now;
         }
-        
-        pthread_mutex_unlock(&progress_state.mutex);
-        
-        /* Sleep for 100ms before checking again */
-        usleep(100000);
+        progress_wait(due);
+    }
+
+    if (progress_state.tty) {
+        erase_block();
+    } else if (progress_state.summaries > 0) {
+        write_summary(progress_now());  /* Close out what the log has seen */
     }
-    
+    pthread_mutex_unlock(&progress_state.mutex);
     return NULL;
 }
 
+static int valid_task(int task) {
+    return task >= 0 && task < PROGRESS_MAX_TASKS && progress_state.tasks[task].used;
+}
+
+/* Begin tracking a task */
+int progress_task_begin(const char *name) {
+    int task = -1;
+
+    pthread_mutex_lock(&progress_lifecycle);
+    pthread_mutex_lock(&progress_state.mutex);
+
+    for (int i = 0; i < PROGRESS_MAX_TASKS && task < 0; i++) {
+        if (!progress_state.tasks[i].used) {
+            task = i;
+        }
+    }
+
+    if (task >= 0) {
+        progress_task_t *t = &progress_state.tasks[task];
+        memset(t, 0, sizeof(*t));
+        t->used = 1;
+        safe_strncpy(t->name, name ? name : "", sizeof(t->name));
+        t->start = progress_now();
+        progress_state.active++;
+        progress_state.dirty = 1;
+
+        if (!progress_state.running) {
+            progress_state.tty = progress_on_terminal();
+            progress_state.started = t->start;
+            progress_state.finished = 0;
+            progress_state.failed = 0;
+            progress_state.summaries = 0;
+            progress_state.drawn = 0;
+            progress_state.stopping = 0;
+            progress_state.running =
+                pthread_create(&progress_state.thread, NULL, progress_thread, NULL) == 0;
+        } else {
+            pthread_cond_signal(&progress_state.wake);
+        }
+    }
+
+    pthread_mutex_unlock(&progress_state.mutex);
+    pthread_mutex_unlock(&progress_lifecycle);
+    return task;
+}
+
+/* Set a task's state text */
+void progress_task_state(int task, const char *state) {
+    pthread_mutex_lock(&progress_state.mutex);
+    if (valid_task(task)) {
+        safe_strncpy(progress_state.tasks[task].state, state ? state : "",
+                     sizeof(progress_state.tasks[task].state));
+        progress_state.dirty = 1;
+        pthread_cond_signal(&progress_state.wake);
+    }
+    pthread_mutex_unlock(&progress_state.mutex);
+}
+
+/* Count output seen by a task - summaries don't need a wakeup for this */
+void progress_task_add(int task, size_t bytes, size_t lines) {
+    pthread_mutex_lock(&progress_state.mutex);
+    if (valid_task(task)) {
+        progress_state.tasks[task].bytes += bytes;
+        progress_state.tasks[task].lines += lines;
+        if (progress_state.tty && !progress_state.dirty) {
+            progress_state.dirty = 1;
+            pthread_cond_signal(&progress_state.wake);
+        }
+    }
+    pthread_mutex_unlock(&progress_state.mutex);
+}
+
+/* Finish a task; the last one out stops the renderer */
+void progress_task_end(int task, int ok) {
+    int join = 0;
+
+    pthread_mutex_lock(&progress_lifecycle);
+    pthread_mutex_lock(&progress_state.mutex);
+    if (valid_task(task)) {
+        progress_state.tasks[task].used = 0;
+        progress_state.active--;
+        progress_state.finished++;
+        if (!ok) {
+            progress_state.failed++;
+        }
+        if (progress_state.legacy == task) {
+            progress_state.legacy = -1;
+        }
+        progress_state.dirty = 1;
+
+        join = progress_state.active == 0 && progress_state.running;
+        if (join) {
+            progress_state.stopping = 1;
+            progress_state.running = 0;
+        }
+        pthread_cond_signal(&progress_state.wake);
+    }
+    pthread_mutex_unlock(&progress_state.mutex);
+
+    if (join) {
+        pthread_join(progress_state.thread, NULL);
+    }
+    pthread_mutex_unlock(&progress_lifecycle);
+}
+
+/* Point the single legacy task at a new message, restarting its clock */
+static int restart_legacy(const char *message) {
+    int restarted = 0;
+
+    pthread_mutex_lock(&progress_state.mutex);
+    if (valid_task(progress_state.legacy)) {
+        progress_task_t *t = &progress_state.tasks[progress_state.legacy];
+        safe_strncpy(t->name, message ? message : "", sizeof(t->name));
+        t->start = progress_now();
+        progress_state.dirty = 1;
+        pthread_cond_signal(&progress_state.wake);
+        restarted = 1;
+    }
+    pthread_mutex_unlock(&progress_state.mutex);
+    return restarted;
+}
+
 /* Start progress indicator */
 void progress_start(const char *message) {
+    if (restart_legacy(message)) {
+        return;
+    }
+
+    int task = progress_task_begin(message);
     pthread_mutex_lock(&progress_state.mutex);
-    
-    if (progress_state.active) {
-        /* Already running, update message */
-        progress_state.message = message;
-        progress_state.dots = 0;
-        gettimeofday(&progress_state.start_time, NULL);
-    } else {
-        /* Start new progress */
-        progress_state.active = 1;
-        progress_state.message = message;
-        progress_state.dots = 0;
-        gettimeofday(&progress_state.start_time, NULL);
-        
-        /* Create thread */
-        pthread_create(&progress_state.thread, NULL, progress_thread, NULL);
-    }
-    
+    progress_state.legacy = task;
     pthread_mutex_unlock(&progress_state.mutex);
 }
 
 /* Stop progress indicator */
 void progress_stop(void) {
     pthread_mutex_lock(&progress_state.mutex);
-    
-    if (progress_state.active) {
-        progress_state.active = 0;
-        pthread_mutex_unlock(&progress_state.mutex);
-        
-        /* Wait for thread to finish */
-        pthread_join(progress_state.thread, NULL);
-        
-        /* Clear the line */
-        fprintf(stderr, "\r%-60s\r", "");
-        fflush(stderr);
-    } else {
-        pthread_mutex_unlock(&progress_state.mutex);
+    int task = progress_state.legacy;
+    pthread_mutex_unlock(&progress_state.mutex);
+
+    if (task >= 0) {
+        progress_task_end(task, 1);
     }
 }
 
 /* Update progress message */
 void progress_update(const char *message) {
-    pthread_mutex_lock(&progress_state.mutex);
-    
-    if (progress_state.active) {
-        progress_state.message = message;
-        progress_state.dots = 0;
-        gettimeofday(&progress_state.start_time, NULL);
-        
-        /* Clear and update immediately */
-        fprintf(stderr, "\r%-60s\r%s", "", message);
-        fflush(stderr);
-    }
-    
-    pthread_mutex_unlock(&progress_state.mutex);
+    restart_legacy(message);
 }
 
 /* Complete with message */
@@ -135,4 +367,4 @@ void progress_complete(const char *message) {
         fprintf(stderr, "%s\n", message);
         fflush(stderr);
     }
-}
\ No newline at end of file
+}
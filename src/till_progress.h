@@ -1,10 +1,28 @@
 /*
  * till_progress.h - Progress indicator for long operations
+ *
+ * Tracks any number of concurrent tasks. On a terminal they are drawn as
+ * a compact block of status lines; otherwise (pipes, cron, systemd) a
+ * one-line summary is written every PROGRESS_SUMMARY_SECONDS.
  */
 
 #ifndef TILL_PROGRESS_H
 #define TILL_PROGRESS_H
 
+#include <stddef.h>
+
+/* Begin tracking a task; returns its id, or -1 if the table is full */
+int progress_task_begin(const char *name);
+
+/* Set a task's state text ("running", "12/40", ...) */
+void progress_task_state(int task, const char *state);
+
+/* Count bytes and lines of output seen by a task */
+void progress_task_add(int task, size_t bytes, size_t lines);
+
+/* Finish a task; ok is 0 if it failed */
+void progress_task_end(int task, int ok);
+
 /* Start progress indicator with message */
 void progress_start(const char *message);
 
@@ -17,4 +35,4 @@ void progress_update(const char *message);
 /* Complete with final message */
 void progress_complete(const char *message);
 
-#endif /* TILL_PROGRESS_H */
\ No newline at end of file
+#endif /* TILL_PROGRESS_H */
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <dirent.h>
@@ -14,7 +15,13 @@
 
 #include "till_config.h"
 #include "till_registry.h"
+#include "till_arena.h"
+#include "till_hash.h"
+#include "till_json_index.h"
+#include "till_snapshot.h"
+#include "till_platform.h"
 #include "till_common.h"
+#include "till_status.h"
 #include "cJSON.h"
 
 #ifndef TILL_MAX_PATH
@@ -103,51 +110,59 @@ static int get_installation_ports(const char *path, int *main_port, int *ai_port
     return (*main_port > 0 && *ai_port > 0) ? 0 : -1;
 }
 
-/* Discover Tekton installations in a directory */
-int discover_tektons(void) {
-    char search_dir[TILL_MAX_PATH];
-    char *home = getenv("HOME");
-    
-    if (!home) {
-        till_log(LOG_ERROR, "Cannot determine home directory");
+/* Same file, unchanged, as far as the snapshot can tell */
+static int same_version(const struct stat *a, const struct stat *b) {
+    return a->st_size == b->st_size && a->st_ino == b->st_ino &&
+           platform_stat_mtime_ns(a) == platform_stat_mtime_ns(b);
+}
+
+/* Map the registry snapshot, rebuilding it when the JSON has changed */
+int registry_snapshot_open(till_snapshot_t *snap) {
+    char json_path[TILL_MAX_PATH];
+    char snap_path[TILL_MAX_PATH];
+    struct stat before, after;
+    
+    if (build_till_path(json_path, sizeof(json_path), TILL_REGISTRY_FILE) != 0 ||
+        build_till_path(snap_path, sizeof(snap_path), TILL_SNAPSHOT_FILE) != 0 ||
+        stat(json_path, &before) != 0) {
         return -1;
     }
-    
-    /* Search in projects/github */
-    path_join(search_dir, sizeof(search_dir), home, TILL_PROJECTS_BASE);
-    
-    till_log(LOG_INFO, "Discovering Tekton installations in %s", search_dir);
-    
-    /* Allow quiet discovery mode */
-    int quiet = getenv("TILL_QUIET_DISCOVERY") != NULL;
-    
-    if (!quiet) {
-        printf("Discovering existing Tekton installations...\n");
-        printf("Searching in TEKTON_ROOT parent: %s\n", search_dir);
+    if (till_snapshot_open(snap, snap_path, &before) == 0) {
+        return 0;
     }
     
-    /* Load or create registry */
-    cJSON *registry = load_or_create_registry();
-    if (!registry) {
-        till_error("Failed to create registry");
-        return -1;
+    /* Missing, damaged or hand-edited since - only a JSON that held
+     * still while it was read is recorded as the source */
+    int result = -1;
+    till_arena_begin();
+    cJSON *registry = load_json_file(json_path);
+    if (registry && stat(json_path, &after) == 0 && same_version(&before, &after) &&
+        till_snapshot_write(snap_path, registry, &after) == 0) {
+        till_log(LOG_DEBUG, "Rebuilt registry snapshot from %s", json_path);
+        result = till_snapshot_open(snap, snap_path, &after);
     }
-    
-    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
-    
-    /* Scan directory */
+    cJSON_Delete(registry);
+    till_arena_end();
+    return result;
+}
+
+/* One installation found on disk */
+typedef struct {
+    char name[TILL_MAX_NAME];
+    char root[TILL_MAX_PATH];
+} found_installation_t;
+
+/* Collect the installations under search_dir; -1 if it can't be read */
+static int scan_installations(const char *search_dir, found_installation_t **found_out, int *count_out) {
     DIR *dir = opendir(search_dir);
     if (!dir) {
-        till_log(LOG_WARN, "Cannot open directory %s", search_dir);
-        cJSON_Delete(registry);
         return -1;
     }
     
+    found_installation_t *found = NULL;
+    int count = 0;
+    int capacity = 0;
     struct dirent *entry;
-    int found_count = 0;
-    
-    /* Track which installations we find */
-    cJSON *found_installations = cJSON_CreateObject();
     
     while ((entry = readdir(dir)) != NULL) {
         if (entry->d_name[0] == '.') continue;
@@ -155,65 +170,125 @@ int discover_tektons(void) {
         char full_path[TILL_MAX_PATH];
         path_join(full_path, sizeof(full_path), search_dir, entry->d_name);
         
-        if (!is_directory(full_path)) continue;
+        if (!is_directory(full_path) || !is_tekton_installation(full_path)) continue;
         
-        if (is_tekton_installation(full_path)) {
-            char inst_name[256];
-            if (get_installation_name(full_path, inst_name, sizeof(inst_name)) == 0) {
-                /* Check if already in registry */
-                cJSON *existing = cJSON_GetObjectItem(installations, inst_name);
-                if (!existing) {
-                    /* Add to registry */
-                    cJSON *inst = cJSON_CreateObject();
-                    cJSON_AddStringToObject(inst, "root", full_path);
-                    
-                    /* Try to get main_root */
-                    char main_root[TILL_MAX_PATH];
-                    if (strstr(inst_name, "coder-")) {
-                        snprintf(main_root, sizeof(main_root), "%s/Tekton", search_dir);
-                    } else {
-                        strncpy(main_root, full_path, sizeof(main_root));
-                    }
-                    cJSON_AddStringToObject(inst, "main_root", main_root);
-                    
-                    /* Get ports */
-                    int main_port, ai_port;
-                    if (get_installation_ports(full_path, &main_port, &ai_port) == 0) {
-                        cJSON_AddNumberToObject(inst, "port_base", main_port);
-                        cJSON_AddNumberToObject(inst, "ai_port_base", ai_port);
-                    }
-                    
-                    cJSON_AddStringToObject(inst, "mode", "anonymous");
-                    cJSON_AddItemToObject(installations, inst_name, inst);
-                    
-                    if (!quiet) {
-                        printf("  [OK] Found: %s at %s\n", inst_name, full_path);
-                    }
-                    found_count++;
-                } else {
-                    /* Update path if changed */
-                    cJSON *root_item = cJSON_GetObjectItem(existing, "root");
-                    if (root_item && strcmp(root_item->valuestring, full_path) != 0) {
-                        cJSON_SetValuestring(root_item, full_path);
-                        if (!quiet) {
-                            printf("  [OK] Updated: %s at %s\n", inst_name, full_path);
-                        }
-                    } else {
-                        if (!quiet) {
-                        printf("  [OK] Found: %s at %s\n", inst_name, full_path);
-                    }
-                    }
-                    found_count++;
-                }
-                
-                /* Mark this installation as found */
-                cJSON_AddBoolToObject(found_installations, inst_name, 1);
+        /* If we can't get the installation name, just skip it silently */
+        char inst_name[TILL_MAX_NAME];
+        if (get_installation_name(full_path, inst_name, sizeof(inst_name)) != 0) continue;
+        
+        if (count == capacity) {
+            int grown = capacity ? capacity * 2 : 16;
+            found_installation_t *more = realloc(found, grown * sizeof(*found));
+            if (!more) {
+                closedir(dir);
+                free(found);
+                return -1;
             }
-            /* If we can't get the installation name, just skip it silently */
+            found = more;
+            capacity = grown;
         }
+        snprintf(found[count].name, sizeof(found[count].name), "%s", inst_name);
+        snprintf(found[count].root, sizeof(found[count].root), "%s", full_path);
+        count++;
     }
     
     closedir(dir);
+    *found_out = found;
+    *count_out = count;
+    return 0;
+}
+
+/* The registry needs no update when its snapshot lists exactly the
+ * installations on disk, at the same roots */
+static int registry_unchanged(const found_installation_t *found, int count) {
+    till_snapshot_t snap;
+    if (registry_snapshot_open(&snap) != 0) {
+        return 0;
+    }
+    
+    int unchanged = snap.header->installation_count == (uint32_t)count;
+    for (int i = 0; unchanged && i < count; i++) {
+        const till_snapshot_installation_t *inst = till_snapshot_installation(&snap, found[i].name);
+        unchanged = inst && strcmp(till_snapshot_string(&snap, inst->root), found[i].root) == 0;
+    }
+    
+    till_snapshot_close(&snap);
+    return unchanged;
+}
+
+typedef struct {
+    const found_installation_t *found;
+    int found_count;
+    const char *search_dir;
+    int quiet;
+} discovery_t;
+
+/* Bring the registry in line with what the scan found */
+static int apply_discovery(cJSON *registry, void *ctx) {
+    const discovery_t *discovery = ctx;
+    
+    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
+    if (!installations) {
+        installations = cJSON_AddObjectToObject(registry, "installations");
+    }
+    
+    /* Every installation found is looked up, and every registered one checked off */
+    till_json_index_t index;
+    till_json_index_init(&index, installations);
+    
+    /* Track which installations we find */
+    till_hash_t found_installations;
+    till_hash_init(&found_installations);
+    
+    for (int i = 0; i < discovery->found_count; i++) {
+        const char *inst_name = discovery->found[i].name;
+        const char *full_path = discovery->found[i].root;
+        
+        /* Check if already in registry */
+        cJSON *existing = till_json_index_get_nocase(&index, inst_name);
+        if (!existing) {
+            /* Add to registry */
+            cJSON *inst = cJSON_CreateObject();
+            cJSON_AddStringToObject(inst, "root", full_path);
+            
+            /* Try to get main_root */
+            char main_root[TILL_MAX_PATH];
+            if (strstr(inst_name, "coder-")) {
+                snprintf(main_root, sizeof(main_root), "%s/Tekton", discovery->search_dir);
+            } else {
+                strncpy(main_root, full_path, sizeof(main_root));
+            }
+            cJSON_AddStringToObject(inst, "main_root", main_root);
+            
+            /* Get ports */
+            int main_port, ai_port;
+            if (get_installation_ports(full_path, &main_port, &ai_port) == 0) {
+                cJSON_AddNumberToObject(inst, "port_base", main_port);
+                cJSON_AddNumberToObject(inst, "ai_port_base", ai_port);
+            }
+            
+            cJSON_AddStringToObject(inst, "mode", "anonymous");
+            till_json_index_add(&index, inst_name, inst);
+            
+            if (!discovery->quiet) {
+                printf("  [OK] Found: %s at %s\n", inst_name, full_path);
+            }
+        } else {
+            /* Update path if changed */
+            cJSON *root_item = cJSON_GetObjectItem(existing, "root");
+            if (root_item && strcmp(root_item->valuestring, full_path) != 0) {
+                cJSON_SetValuestring(root_item, full_path);
+                if (!discovery->quiet) {
+                    printf("  [OK] Updated: %s at %s\n", inst_name, full_path);
+                }
+            } else if (!discovery->quiet) {
+                printf("  [OK] Found: %s at %s\n", inst_name, full_path);
+            }
+        }
+        
+        /* Mark this installation as found */
+        till_hash_put(&found_installations, existing ? existing->string : inst_name, NULL);
+    }
     
     /* Remove installations that no longer exist */
     cJSON *inst_to_check = installations->child;
@@ -222,19 +297,20 @@ int discover_tektons(void) {
         const char *inst_name = inst_to_check->string;
         
         /* Check if this installation was found */
-        if (!cJSON_GetObjectItem(found_installations, inst_name)) {
+        if (!till_hash_find(&found_installations, inst_name)) {
             /* Installation no longer exists - remove it */
-            if (!quiet) {
+            if (!discovery->quiet) {
                 printf("  [REMOVED] %s no longer exists\n", inst_name);
             }
-            cJSON_DeleteItemFromObject(installations, inst_name);
+            till_json_index_delete(&index, inst_to_check);
         }
         
         inst_to_check = next;
     }
     
-    /* Clean up tracking object */
-    cJSON_Delete(found_installations);
+    /* Clean up tracking */
+    till_hash_free(&found_installations, NULL);
+    till_json_index_free(&index);
     
     /* Update last discovery time */
     time_t now = time(NULL);
@@ -249,8 +325,60 @@ int discover_tektons(void) {
         cJSON_AddStringToObject(registry, "last_discovery", timestamp);
     }
     
-    /* Save registry */
-    int save_result = save_till_json("tekton/till-private.json", registry);
+    return 0;
+}
+
+/* Scan projects/github and bring the registry up to date */
+static int discover_registry(void) {
+    char search_dir[TILL_MAX_PATH];
+    char *home = getenv("HOME");
+    
+    if (!home) {
+        till_log(LOG_ERROR, "Cannot determine home directory");
+        return -1;
+    }
+    
+    /* Search in projects/github */
+    path_join(search_dir, sizeof(search_dir), home, TILL_PROJECTS_BASE);
+    
+    till_log(LOG_INFO, "Discovering Tekton installations in %s", search_dir);
+    
+    /* Allow quiet discovery mode */
+    int quiet = getenv("TILL_QUIET_DISCOVERY") != NULL || g_output != TILL_OUTPUT_TEXT;
+    
+    if (!quiet) {
+        printf("Discovering existing Tekton installations...\n");
+        printf("Searching in TEKTON_ROOT parent: %s\n", search_dir);
+    }
+    
+    /* Scan directory */
+    found_installation_t *found = NULL;
+    int found_count = 0;
+    if (scan_installations(search_dir, &found, &found_count) != 0) {
+        till_log(LOG_WARN, "Cannot open directory %s", search_dir);
+        return -1;
+    }
+    
+    /* Most runs find what the registry already has - then it is neither
+     * parsed nor rewritten */
+    if (registry_unchanged(found, found_count)) {
+        if (!quiet) {
+            for (int i = 0; i < found_count; i++) {
+                printf("  [OK] Found: %s at %s\n", found[i].name, found[i].root);
+            }
+            printf("Found %d Tekton installation(s) - no changes\n", found_count);
+        }
+        till_log(LOG_INFO, "Discovery complete: %d installations found, registry unchanged", found_count);
+        free(found);
+        return 0;
+    }
+    
+    /* Apply the scan to the registry as it is under the lock, so a
+     * concurrent change to it is kept */
+    discovery_t discovery = { found, found_count, search_dir, quiet };
+    int save_result = till_json_transaction(TILL_REGISTRY_FILE, apply_discovery, &discovery);
+    free(found);
+    
     if (save_result == 0) {
         if (!quiet) {
             if (found_count > 0) {
@@ -264,12 +392,54 @@ int discover_tektons(void) {
         till_error("Failed to save registry (error: %d)", save_result);
     }
     
-    cJSON_Delete(registry);
     return 0;
 }
 
+/* Discover Tekton installations in a directory - the registry is read,
+ * updated and written in one arena scope, so it is freed in one go */
+int discover_tektons(void) {
+    till_arena_begin();
+    int result = discover_registry();
+    till_arena_end();
+    return result;
+}
+
+/* The primary installation in the snapshot, else the first one. Names
+ * match case-insensitively, as cJSON_GetObjectItem does */
+static const till_snapshot_installation_t *snapshot_primary(const till_snapshot_t *snap) {
+    const char *primary = "primary.tekton.development.us";
+    const till_snapshot_installation_t *inst = till_snapshot_installation(snap, primary);
+    
+    for (uint32_t i = 0; !inst && i < snap->header->installation_count; i++) {
+        if (strcasecmp(till_snapshot_string(snap, snap->installations[i].name), primary) == 0) {
+            inst = &snap->installations[i];
+        }
+    }
+    return inst;
+}
+
 /* Get primary Tekton installation path */
 int get_primary_tekton_path(char *path, size_t size) {
+    till_snapshot_t snap;
+    if (registry_snapshot_open(&snap) == 0) {
+        const till_snapshot_installation_t *primary = snapshot_primary(&snap);
+        const char *main_root = primary ? till_snapshot_string(&snap, primary->main_root) : "";
+        
+        /* Otherwise, use the first installation's main_root */
+        if (!*main_root && snap.header->installation_count > 0) {
+            main_root = till_snapshot_string(&snap, snap.installations[0].main_root);
+        }
+        int result = *main_root ? 0 : -1;
+        if (result == 0) {
+            strncpy(path, main_root, size - 1);
+            path[size - 1] = '\0';
+        } else {
+            till_log(LOG_ERROR, "No primary Tekton found");
+        }
+        till_snapshot_close(&snap);
+        return result;
+    }
+    
     cJSON *registry = load_till_json("tekton/till-private.json");
     if (!registry) {
         till_log(LOG_ERROR, "No Tekton registry found");
@@ -314,6 +484,23 @@ int get_primary_tekton_path(char *path, size_t size) {
 
 /* Get primary Tekton name */
 int get_primary_tekton_name(char *name, size_t size) {
+    till_snapshot_t snap;
+    if (registry_snapshot_open(&snap) == 0) {
+        const till_snapshot_installation_t *inst = snapshot_primary(&snap);
+        
+        /* Use first installation */
+        if (!inst && snap.header->installation_count > 0) {
+            inst = &snap.installations[0];
+        }
+        int result = inst ? 0 : -1;
+        if (inst) {
+            strncpy(name, till_snapshot_string(&snap, inst->name), size - 1);
+            name[size - 1] = '\0';
+        }
+        till_snapshot_close(&snap);
+        return result;
+    }
+    
     cJSON *registry = load_till_json("tekton/till-private.json");
     if (!registry) return -1;
     
@@ -344,6 +531,56 @@ int get_primary_tekton_name(char *name, size_t size) {
     return -1;
 }
 
+typedef struct {
+    const char *name;
+    const char *path;
+    const char *main_root;
+    int main_port;
+    int ai_port;
+    const char *mode;
+} registration_t;
+
+static int apply_registration(cJSON *registry, void *ctx) {
+    const registration_t *reg = ctx;
+    
+    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
+    if (!installations) {
+        installations = cJSON_AddObjectToObject(registry, "installations");
+    }
+    
+    /* Check if already exists */
+    if (cJSON_GetObjectItem(installations, reg->name)) {
+        till_log(LOG_WARN, "Installation %s already registered", reg->name);
+    }
+    
+    /* Create installation entry */
+    cJSON *inst = cJSON_CreateObject();
+    cJSON_AddStringToObject(inst, "root", reg->path);
+    cJSON_AddStringToObject(inst, "main_root", reg->main_root);
+    cJSON_AddNumberToObject(inst, "port_base", reg->main_port);
+    cJSON_AddNumberToObject(inst, "ai_port_base", reg->ai_port);
+    cJSON_AddStringToObject(inst, "mode", reg->mode ? reg->mode : "anonymous");
+    
+    /* Add or update */
+    cJSON_DeleteItemFromObject(installations, reg->name);
+    cJSON_AddItemToObject(installations, reg->name, inst);
+    
+    /* Update last discovery time */
+    time_t now = time(NULL);
+    struct tm *tm = gmtime(&now);
+    char timestamp[64];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", tm);
+    
+    cJSON *last_discovery = cJSON_GetObjectItem(registry, "last_discovery");
+    if (last_discovery) {
+        cJSON_SetValuestring(last_discovery, timestamp);
+    } else {
+        cJSON_AddStringToObject(registry, "last_discovery", timestamp);
+    }
+    
+    return 0;
+}
+
 /* Register a new Tekton installation */
 int register_installation(const char *name, const char *path, int main_port, int ai_port, const char *mode) {
     /* Ensure tekton directory exists */
@@ -353,20 +590,6 @@ int register_installation(const char *name, const char *path, int main_port, int
     }
     ensure_directory(tekton_dir);
     
-    /* Load or create registry */
-    cJSON *registry = load_or_create_registry();
-    if (!registry) {
-        till_error("Failed to create registry");
-        return -1;
-    }
-    
-    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
-    
-    /* Check if already exists */
-    if (cJSON_GetObjectItem(installations, name)) {
-        till_log(LOG_WARN, "Installation %s already registered", name);
-    }
-    
     /* Determine main_root */
     char main_root[TILL_MAX_PATH];
     if (strstr(name, "coder-")) {
@@ -388,40 +611,14 @@ int register_installation(const char *name, const char *path, int main_port, int
         strncpy(main_root, path, sizeof(main_root));
     }
     
-    /* Create installation entry */
-    cJSON *inst = cJSON_CreateObject();
-    cJSON_AddStringToObject(inst, "root", path);
-    cJSON_AddStringToObject(inst, "main_root", main_root);
-    cJSON_AddNumberToObject(inst, "port_base", main_port);
-    cJSON_AddNumberToObject(inst, "ai_port_base", ai_port);
-    cJSON_AddStringToObject(inst, "mode", mode ? mode : "anonymous");
-    
-    /* Add or update */
-    cJSON_DeleteItemFromObject(installations, name);
-    cJSON_AddItemToObject(installations, name, inst);
-    
-    /* Update last discovery time */
-    time_t now = time(NULL);
-    struct tm *tm = gmtime(&now);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", tm);
-    
-    cJSON *last_discovery = cJSON_GetObjectItem(registry, "last_discovery");
-    if (last_discovery) {
-        cJSON_SetValuestring(last_discovery, timestamp);
-    } else {
-        cJSON_AddStringToObject(registry, "last_discovery", timestamp);
-    }
-    
     /* Save registry */
-    if (save_till_json("tekton/till-private.json", registry) != 0) {
+    registration_t reg = { name, path, main_root, main_port, ai_port, mode };
+    if (till_json_transaction(TILL_REGISTRY_FILE, apply_registration, &reg) != 0) {
         till_log(LOG_ERROR, "Failed to save registry");
-        cJSON_Delete(registry);
         return -1;
     }
     
     till_log(LOG_INFO, "Registered installation %s at %s", name, path);
-    cJSON_Delete(registry);
     return 0;
 }
 
@@ -506,67 +703,39 @@ int fuzzy_match_name(const char *input, char *matched, size_t size) {
     }
     lower_input[i] = '\0';
     
-    /* Try exact match first */
+    /* One pass: an exact match wins, then the first case-insensitive,
+     * prefix and substring match, in that order */
+    cJSON *best[3] = { NULL, NULL, NULL };
+    size_t input_len = strlen(lower_input);
     cJSON *inst = NULL;
     cJSON_ArrayForEach(inst, installations) {
         const char *inst_name = inst->string;
         if (strcmp(inst_name, input) == 0) {
-            strncpy(matched, inst_name, size - 1);
-            matched[size - 1] = '\0';
-            cJSON_Delete(registry);
-            return 0;
+            break;
         }
-    }
-    
-    /* Try case-insensitive match */
-    cJSON_ArrayForEach(inst, installations) {
-        const char *inst_name = inst->string;
-        char lower_inst[256];
-        for (i = 0; i < sizeof(lower_inst) - 1 && inst_name[i]; i++) {
-            lower_inst[i] = tolower(inst_name[i]);
-        }
-        lower_inst[i] = '\0';
         
-        if (strcmp(lower_inst, lower_input) == 0) {
-            strncpy(matched, inst_name, size - 1);
-            matched[size - 1] = '\0';
-            cJSON_Delete(registry);
-            return 0;
-        }
-    }
-    
-    /* Try prefix match */
-    cJSON_ArrayForEach(inst, installations) {
-        const char *inst_name = inst->string;
         char lower_inst[256];
         for (i = 0; i < sizeof(lower_inst) - 1 && inst_name[i]; i++) {
             lower_inst[i] = tolower(inst_name[i]);
         }
         lower_inst[i] = '\0';
         
-        if (strncmp(lower_inst, lower_input, strlen(lower_input)) == 0) {
-            strncpy(matched, inst_name, size - 1);
-            matched[size - 1] = '\0';
-            cJSON_Delete(registry);
-            return 0;
+        int rank = strcmp(lower_inst, lower_input) == 0 ? 0 :
+                   strncmp(lower_inst, lower_input, input_len) == 0 ? 1 :
+                   strstr(lower_inst, lower_input) != NULL ? 2 : -1;
+        if (rank >= 0 && !best[rank]) {
+            best[rank] = inst;
         }
     }
+    for (i = 0; !inst && i < 3; i++) {
+        inst = best[i];
+    }
     
-    /* Try contains match */
-    cJSON_ArrayForEach(inst, installations) {
-        const char *inst_name = inst->string;
-        char lower_inst[256];
-        for (i = 0; i < sizeof(lower_inst) - 1 && inst_name[i]; i++) {
-            lower_inst[i] = tolower(inst_name[i]);
-        }
-        lower_inst[i] = '\0';
-        
-        if (strstr(lower_inst, lower_input) != NULL) {
-            strncpy(matched, inst_name, size - 1);
-            matched[size - 1] = '\0';
-            cJSON_Delete(registry);
-            return 0;
-        }
+    if (inst) {
+        strncpy(matched, inst->string, size - 1);
+        matched[size - 1] = '\0';
+        cJSON_Delete(registry);
+        return 0;
     }
     
     cJSON_Delete(registry);
@@ -5,9 +5,15 @@
 #ifndef TILL_REGISTRY_H
 #define TILL_REGISTRY_H
 
+#include "till_snapshot.h"
+
 /* Discover existing Tekton installations */
 int discover_tektons(void);
 
+/* Map the registry snapshot, rebuilding it first if till-private.json
+ * has changed since it was written; -1 if there is no usable registry */
+int registry_snapshot_open(till_snapshot_t *snap);
+
 /* Get primary Tekton installation path */
 int get_primary_tekton_path(char *path, size_t size);
 
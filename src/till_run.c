@@ -19,25 +19,38 @@
 #include "till_config.h"
 #include "till_run.h"
 #include "till_common.h"
+#include "till_registry.h"
+#include "till_snapshot.h"
+#include "till_json_index.h"
+#include "till_hash.h"
+#include "till_platform.h"
 #include "cJSON.h"
 
 #ifndef TILL_MAX_PATH
 #define TILL_MAX_PATH 4096
 #endif
 
-/* Component structure */
+/* Command index, cached in TILL_RUN_INDEX so `till run` neither parses
+ * the registry nor reads every commands directory:
+ *   "registry"       stat signature of the till-private.json it came from
+ *   "installations"  [{"name", "component", "root"}] in registry order
+ *   "targets"        {registry name or component: root}, resolved as
+ *                    before - exact name, then the component's primary
+ *                    installation, then its first
+ *   "roots"          {root: {"dir": mtime signature of the commands
+ *                    directory, "" if none, "commands": [...]}}
+ * A registry change rebuilds the index; a commands directory whose mtime
+ * moved is re-read on its own. Roots are read the first time they're
+ * asked for. chmod +x doesn't move a directory's mtime, so a command
+ * that isn't listed has its directory re-read before it's reported
+ * missing. */
 typedef struct {
-    char name[256];
-    char root[TILL_MAX_PATH];
-    char registry_name[256];
-    int has_commands;
-} component_t;
-
-/* Load installed components from till-private.json */
-static cJSON *load_installations(void) {
-    /* Use common function to load till JSON */
-    return load_till_json("tekton/till-private.json");
-}
+    cJSON *json;
+    till_json_index_t targets;
+    till_json_index_t roots;
+    int dirty;                   /* Save when done */
+    int readonly;                /* The Till directory can't be written */
+} run_index_t;
 
 /* Extract component name from registry name */
 static void extract_component_name(const char *registry_name, char *component) {
@@ -52,6 +65,9 @@ static void extract_component_name(const char *registry_name, char *component) {
     const char *dot = strchr(registry_name, '.');
     if (dot) {
         size_t len = dot - registry_name;
+        if (len > 256 - 1) {
+            len = 256 - 1;
+        }
         strncpy(component, registry_name, len);
         component[len] = '\0';
     } else {
@@ -60,42 +76,285 @@ static void extract_component_name(const char *registry_name, char *component) {
     }
 }
 
-/* Check if component has TILL_COMMANDS_DIR directory */
-static int has_command_directory(const char *root) {
+static void format_signature(char *buf, size_t size, unsigned long long bytes,
+                             long long mtime_ns, unsigned long long ino) {
+    snprintf(buf, size, "%llx:%llx:%llx", bytes, (unsigned long long)mtime_ns, ino);
+}
+
+/* Signature of path, "" if it isn't there (or, with want_dir, isn't a directory) */
+static void path_signature(const char *path, int want_dir, char *buf, size_t size) {
+    struct stat st;
+    
+    if (stat(path, &st) != 0 || (want_dir && !S_ISDIR(st.st_mode))) {
+        buf[0] = '\0';
+        return;
+    }
+    format_signature(buf, size, (unsigned long long)st.st_size,
+                     (long long)platform_stat_mtime_ns(&st), (unsigned long long)st.st_ino);
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Read the executable commands under root's commands directory */
+static cJSON *scan_commands(const char *root, const char *signature) {
+    cJSON *entry = cJSON_CreateObject();
+    cJSON_AddStringToObject(entry, "dir", signature);
+    cJSON *commands = cJSON_AddArrayToObject(entry, "commands");
+    
     char cmd_dir[TILL_MAX_PATH];
     snprintf(cmd_dir, sizeof(cmd_dir), "%s/%s", root, TILL_COMMANDS_DIR);
+    DIR *dir = signature[0] ? opendir(cmd_dir) : NULL;
+    if (!dir) {
+        return entry;
+    }
     
-    return is_directory(cmd_dir);
+    char **names = NULL;
+    size_t count = 0, capacity = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        char cmd_path[TILL_MAX_PATH];
+        if (snprintf(cmd_path, sizeof(cmd_path), "%s/%s", cmd_dir, ent->d_name) >=
+                (int)sizeof(cmd_path) || !is_executable(cmd_path)) {
+            continue;
+        }
+        if (count == capacity) {
+            size_t grown = capacity ? capacity * 2 : 16;
+            char **more = realloc(names, grown * sizeof(char *));
+            if (!more) {
+                break;
+            }
+            names = more;
+            capacity = grown;
+        }
+        if ((names[count] = strdup(ent->d_name)) != NULL) {
+            count++;
+        }
+    }
+    closedir(dir);
+    
+    /* Sorted, so listings don't depend on directory order */
+    qsort(names, count, sizeof(char *), compare_names);
+    for (size_t i = 0; i < count; i++) {
+        cJSON_AddItemToArray(commands, cJSON_CreateString(names[i]));
+        free(names[i]);
+    }
+    free(names);
+    return entry;
 }
 
-/* List available commands for a component */
-static int list_component_commands(const char *component, const char *root) {
+/* Commands for root, re-read when its directory changed or when rescan
+ * is set; NULL if root has no commands directory */
+static cJSON *root_commands(run_index_t *index, const char *root, int rescan) {
     char cmd_dir[TILL_MAX_PATH];
+    char signature[128];
     snprintf(cmd_dir, sizeof(cmd_dir), "%s/%s", root, TILL_COMMANDS_DIR);
+    path_signature(cmd_dir, 1, signature, sizeof(signature));
     
-    DIR *dir = opendir(cmd_dir);
-    if (!dir) {
+    cJSON *entry = till_json_index_get(&index->roots, root);
+    cJSON *dir = entry ? cJSON_GetObjectItem(entry, "dir") : NULL;
+    if (!rescan && cJSON_IsString(dir) && strcmp(dir->valuestring, signature) == 0) {
+        return signature[0] ? cJSON_GetObjectItem(entry, "commands") : NULL;
+    }
+    
+    if (entry) {
+        till_json_index_delete(&index->roots, entry);
+    }
+    entry = scan_commands(root, signature);
+    if (till_json_index_add(&index->roots, root, entry) != 0) {
+        cJSON_Delete(entry);
+        return NULL;
+    }
+    index->dirty = 1;
+    return signature[0] ? cJSON_GetObjectItem(entry, "commands") : NULL;
+}
+
+static int has_command(cJSON *commands, const char *command) {
+    cJSON *item;
+    cJSON_ArrayForEach(item, commands) {
+        if (cJSON_IsString(item) && strcmp(item->valuestring, command) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Point component at root unless something already claimed it */
+static void add_target(till_json_index_t *targets, const char *name, const char *root) {
+    if (!till_json_index_get(targets, name)) {
+        till_json_index_add(targets, name, cJSON_CreateString(root));
+    }
+}
+
+/* Add one registry installation to the index's list */
+static void add_installation(cJSON *installations, const char *name, const char *root) {
+    char component[256];
+    
+    if (!root[0]) {
+        return;
+    }
+    extract_component_name(name, component);
+    cJSON *inst = cJSON_CreateObject();
+    cJSON_AddStringToObject(inst, "name", name);
+    cJSON_AddStringToObject(inst, "component", component);
+    cJSON_AddStringToObject(inst, "root", root);
+    cJSON_AddItemToArray(installations, inst);
+}
+
+/* Index over installations (taken), built from the registry at signature */
+static cJSON *build_run_index(const char *signature, cJSON *installations) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "version", TILL_RUN_INDEX_VERSION);
+    cJSON_AddStringToObject(json, "registry", signature);
+    cJSON_AddItemToObject(json, "installations", installations);
+    cJSON_AddObjectToObject(json, "roots");
+    
+    till_json_index_t targets;
+    till_json_index_init(&targets, cJSON_AddObjectToObject(json, "targets"));
+    
+    /* Registry names, then components: the primary installation, else the first */
+    cJSON *inst;
+    cJSON_ArrayForEach(inst, installations) {
+        add_target(&targets, cJSON_GetObjectItem(inst, "name")->valuestring,
+                   cJSON_GetObjectItem(inst, "root")->valuestring);
+    }
+    cJSON_ArrayForEach(inst, installations) {
+        if (strstr(cJSON_GetObjectItem(inst, "name")->valuestring, "primary")) {
+            add_target(&targets, cJSON_GetObjectItem(inst, "component")->valuestring,
+                       cJSON_GetObjectItem(inst, "root")->valuestring);
+        }
+    }
+    cJSON_ArrayForEach(inst, installations) {
+        add_target(&targets, cJSON_GetObjectItem(inst, "component")->valuestring,
+                   cJSON_GetObjectItem(inst, "root")->valuestring);
+    }
+    
+    till_json_index_free(&targets);
+    return json;
+}
+
+/* Index the installations in the registry snapshot */
+static cJSON *index_snapshot(const till_snapshot_t *snap) {
+    const till_snapshot_header_t *header = snap->header;
+    char signature[128];
+    format_signature(signature, sizeof(signature), header->source_size,
+                     header->source_mtime * 1000000000 + header->source_mtime_nsec,
+                     header->source_ino);
+    
+    cJSON *installations = cJSON_CreateArray();
+    for (uint32_t i = 0; i < header->installation_count; i++) {
+        add_installation(installations,
+                         till_snapshot_string(snap, snap->installations[i].name),
+                         till_snapshot_string(snap, snap->installations[i].root));
+    }
+    return build_run_index(signature, installations);
+}
+
+/* Index the registry JSON, for when no snapshot can be written */
+static cJSON *index_registry(const char *signature) {
+    cJSON *registry = load_till_json(TILL_REGISTRY_FILE);
+    cJSON *installations = cJSON_CreateArray();
+    cJSON *inst;
+    
+    cJSON_ArrayForEach(inst, cJSON_GetObjectItem(registry, "installations")) {
+        if (inst->string) {
+            add_installation(installations, inst->string, json_get_string(inst, "root", ""));
+        }
+    }
+    cJSON_Delete(registry);
+    return build_run_index(signature, installations);
+}
+
+/* Cached index if it was built from the current registry */
+static cJSON *load_cached_index(const char *registry_signature) {
+    cJSON *json = load_till_json(TILL_RUN_INDEX);
+    cJSON *version = cJSON_GetObjectItem(json, "version");
+    cJSON *registry = cJSON_GetObjectItem(json, "registry");
+    
+    if (cJSON_IsNumber(version) && version->valueint == TILL_RUN_INDEX_VERSION &&
+        cJSON_IsString(registry) && strcmp(registry->valuestring, registry_signature) == 0 &&
+        cJSON_IsArray(cJSON_GetObjectItem(json, "installations")) &&
+        cJSON_IsObject(cJSON_GetObjectItem(json, "targets")) &&
+        cJSON_IsObject(cJSON_GetObjectItem(json, "roots"))) {
+        return json;
+    }
+    cJSON_Delete(json);
+    return NULL;
+}
+
+/* -1 if there is no registry to index */
+static int open_run_index(run_index_t *index) {
+    char registry_path[TILL_MAX_PATH];
+    char till_dir[TILL_MAX_PATH];
+    char signature[128];
+    
+    memset(index, 0, sizeof(*index));
+    if (build_till_path(registry_path, sizeof(registry_path), TILL_REGISTRY_FILE) != 0) {
+        return -1;
+    }
+    path_signature(registry_path, 0, signature, sizeof(signature));
+    if (!signature[0]) {
+        return -1;
+    }
+    
+    index->json = load_cached_index(signature);
+    if (!index->json) {
+        till_snapshot_t snap;
+        if (registry_snapshot_open(&snap) == 0) {
+            index->json = index_snapshot(&snap);
+            till_snapshot_close(&snap);
+        } else {
+            /* Read-only Till directory or full disk: read the JSON, and
+             * don't try to save an index that can't be written either */
+            index->json = index_registry(signature);
+            index->readonly = get_till_dir(till_dir, sizeof(till_dir)) != 0 ||
+                              access(till_dir, W_OK) != 0;
+        }
+        index->dirty = 1;
+        till_log(LOG_DEBUG, "Rebuilt run index from the registry");
+    }
+    
+    till_json_index_init(&index->targets, cJSON_GetObjectItem(index->json, "targets"));
+    till_json_index_init(&index->roots, cJSON_GetObjectItem(index->json, "roots"));
+    return 0;
+}
+
+/* Save anything learned and let go; losing the cache only costs a rescan */
+static void close_run_index(run_index_t *index) {
+    if (index->dirty && !index->readonly && index->json) {
+        save_till_json(TILL_RUN_INDEX, index->json);
+    }
+    till_json_index_free(&index->targets);
+    till_json_index_free(&index->roots);
+    cJSON_Delete(index->json);
+    index->json = NULL;
+}
+
+/* Root for a registry name or component, NULL if unknown */
+static const char *find_component_root(run_index_t *index, const char *component_name) {
+    cJSON *root = till_json_index_get(&index->targets, component_name);
+    return cJSON_IsString(root) ? root->valuestring : NULL;
+}
+
+/* List available commands for a component; 0 if it has no commands directory */
+static int list_component_commands(const char *component, cJSON *commands) {
+    if (!commands) {
         return 0;
     }
     
     printf("  %s:\n", component);
     
-    struct dirent *entry;
     int count = 0;
-    while ((entry = readdir(dir))) {
-        if (entry->d_name[0] != '.') {
-            char cmd_path[TILL_MAX_PATH];
-            snprintf(cmd_path, sizeof(cmd_path), "%s/%s", cmd_dir, entry->d_name);
-            
-            if (is_executable(cmd_path)) {
-                printf("    - %s\n", entry->d_name);
-                count++;
-            }
-        }
+    cJSON *command;
+    cJSON_ArrayForEach(command, commands) {
+        printf("    - %s\n", command->valuestring);
+        count++;
     }
     
-    closedir(dir);
-    
     if (count == 0) {
         printf("    (no executable commands found)\n");
     }
@@ -105,191 +364,138 @@ static int list_component_commands(const char *component, const char *root) {
 
 /* List all available components and their commands */
 static int list_all_components(void) {
-    cJSON *json = load_installations();
-    if (!json) {
+    run_index_t index;
+    if (open_run_index(&index) != 0) {
         till_error("No installations found. Run 'till install' first.");
         return -1;
     }
     
-    cJSON *installations = cJSON_GetObjectItem(json, "installations");
-    if (!installations) {
+    cJSON *installations = cJSON_GetObjectItem(index.json, "installations");
+    if (cJSON_GetArraySize(installations) == 0) {
         till_error("No installations found in configuration.");
-        cJSON_Delete(json);
+        close_run_index(&index);
         return -1;
     }
     
     printf("Available components and commands:\n\n");
     
-    /* Track unique components */
-    component_t components[100];
-    int comp_count = 0;
+    /* Each component type is listed from its first installation with commands */
+    till_hash_t listed;
+    till_hash_init(&listed);
     
     cJSON *installation;
     cJSON_ArrayForEach(installation, installations) {
-        const char *registry_name = installation->string;
+        cJSON *component_item = cJSON_GetObjectItem(installation, "component");
         cJSON *root_item = cJSON_GetObjectItem(installation, "root");
+        if (!cJSON_IsString(component_item) || !cJSON_IsString(root_item)) {
+            continue;
+        }
         
-        if (root_item && cJSON_IsString(root_item)) {
-            const char *root = root_item->valuestring;
-            
-            /* Extract component type */
-            char component[256];
-            extract_component_name(registry_name, component);
-            
-            /* Check if we've already listed this component type */
-            int found = 0;
-            for (int i = 0; i < comp_count; i++) {
-                if (strcmp(components[i].name, component) == 0) {
-                    found = 1;
-                    break;
-                }
-            }
-            
-            if (!found && has_command_directory(root)) {
-                strncpy(components[comp_count].name, component, sizeof(components[comp_count].name) - 1);
-                components[comp_count].name[sizeof(components[comp_count].name) - 1] = '\0';
-                strncpy(components[comp_count].root, root, sizeof(components[comp_count].root) - 1);
-                components[comp_count].root[sizeof(components[comp_count].root) - 1] = '\0';
-                strncpy(components[comp_count].registry_name, registry_name, sizeof(components[comp_count].registry_name) - 1);
-                components[comp_count].registry_name[sizeof(components[comp_count].registry_name) - 1] = '\0';
-                components[comp_count].has_commands = 1;
-                comp_count++;
-                
-                list_component_commands(component, root);
-                printf("\n");
-            }
+        const char *component = component_item->valuestring;
+        const char *root = root_item->valuestring;
+        if (till_hash_find(&listed, component)) {
+            continue;
+        }
+        cJSON *commands = root_commands(&index, root, 0);
+        if (commands) {
+            till_hash_put(&listed, component, NULL);
+            list_component_commands(component, commands);
+            printf("\n");
         }
     }
     
-    if (comp_count == 0) {
+    if (listed.count == 0) {
         printf("No components with executable commands found.\n");
-        printf("Components must have a TILL_COMMANDS_DIR/ directory with executable scripts.\n");
+        printf("Components must have a %s/ directory with executable scripts.\n", TILL_COMMANDS_DIR);
     } else {
         printf("Usage: till run <component> <command> [arguments...]\n");
         printf("Example: till run tekton start\n");
     }
     
-    cJSON_Delete(json);
+    till_hash_free(&listed, NULL);
+    close_run_index(&index);
     return 0;
 }
 
-/* Find component root by name or registry name */
-static char *find_component_root(const char *component_name) {
-    static char root[TILL_MAX_PATH];
-    
-    cJSON *json = load_installations();
-    if (!json) {
-        return NULL;
-    }
-    
-    cJSON *installations = cJSON_GetObjectItem(json, "installations");
-    if (!installations) {
-        cJSON_Delete(json);
-        return NULL;
-    }
-    
-    /* First try exact registry name match */
-    cJSON *installation;
-    cJSON_ArrayForEach(installation, installations) {
-        const char *registry_name = installation->string;
-        if (strcmp(component_name, registry_name) == 0) {
-            cJSON *root_item = cJSON_GetObjectItem(installation, "root");
-            if (root_item && cJSON_IsString(root_item)) {
-                strncpy(root, root_item->valuestring, TILL_MAX_PATH - 1);
-                root[TILL_MAX_PATH - 1] = '\0';
-                cJSON_Delete(json);
-                return root;
-            }
-        }
+/* Names for shell completion, one per line: components and registry names
+ * with commands, or the commands of one of them */
+static int complete_run(const char *component) {
+    run_index_t index;
+    if (open_run_index(&index) != 0) {
+        return 0;
     }
     
-    /* Then try component type match (e.g., "tekton" matches any tekton installation) */
-    /* For now, return the primary/first match */
-    cJSON_ArrayForEach(installation, installations) {
-        const char *registry_name = installation->string;
-        char comp_type[256];
-        extract_component_name(registry_name, comp_type);
-        
-        if (strcmp(component_name, comp_type) == 0) {
-            /* Prefer "primary" installation */
-            if (strstr(registry_name, "primary")) {
-                cJSON *root_item = cJSON_GetObjectItem(installation, "root");
-                if (root_item && cJSON_IsString(root_item)) {
-                    strncpy(root, root_item->valuestring, TILL_MAX_PATH - 1);
-                root[TILL_MAX_PATH - 1] = '\0';
-                    cJSON_Delete(json);
-                    return root;
-                }
+    cJSON *targets = cJSON_GetObjectItem(index.json, "targets");
+    cJSON *target;
+    cJSON *command;
+    if (!component) {
+        cJSON_ArrayForEach(target, targets) {
+            if (cJSON_IsString(target) && root_commands(&index, target->valuestring, 0)) {
+                printf("%s\n", target->string);
             }
         }
-    }
-    
-    /* If no primary, return first match */
-    cJSON_ArrayForEach(installation, installations) {
-        const char *registry_name = installation->string;
-        char comp_type[256];
-        extract_component_name(registry_name, comp_type);
-        
-        if (strcmp(component_name, comp_type) == 0) {
-            cJSON *root_item = cJSON_GetObjectItem(installation, "root");
-            if (root_item && cJSON_IsString(root_item)) {
-                strncpy(root, root_item->valuestring, TILL_MAX_PATH - 1);
-                root[TILL_MAX_PATH - 1] = '\0';
-                cJSON_Delete(json);
-                return root;
-            }
+    } else {
+        const char *root = find_component_root(&index, component);
+        cJSON *commands = root ? root_commands(&index, root, 0) : NULL;
+        cJSON_ArrayForEach(command, commands) {
+            printf("%s\n", command->valuestring);
         }
     }
     
-    cJSON_Delete(json);
-    return NULL;
+    close_run_index(&index);
+    return 0;
 }
 
 /* Execute a component command */
 static int execute_component_command(const char *component, const char *command, 
                                     int argc, char *argv[]) {
+    run_index_t index;
+    if (open_run_index(&index) != 0) {
+        till_error("No installations found. Run 'till install' first.");
+        return -1;
+    }
+    
     /* Find component root */
-    char *root = find_component_root(component);
-    if (!root) {
+    const char *found = find_component_root(&index, component);
+    if (!found) {
         till_error("Component '%s' not found.", component);
         till_info("Run 'till run' to see available components.");
+        close_run_index(&index);
         return -1;
     }
+    char root[TILL_MAX_PATH];
+    snprintf(root, sizeof(root), "%s", found);
+    
+    /* Not listed may only mean added or made executable since */
+    cJSON *commands = root_commands(&index, root, 0);
+    if (!has_command(commands, command)) {
+        commands = root_commands(&index, root, 1);
+    }
     
     /* Build path to command */
     char cmd_path[TILL_MAX_PATH];
-    snprintf(cmd_path, sizeof(cmd_path), "%s/TILL_COMMANDS_DIR/%s", root, command);
+    int path_len = snprintf(cmd_path, sizeof(cmd_path), "%s/%s/%s", root, TILL_COMMANDS_DIR, command);
     
     /* Check if command exists and is executable */
-    if (!path_exists(cmd_path)) {
+    if (path_len >= (int)sizeof(cmd_path) || !path_exists(cmd_path)) {
         till_error("Command '%s' not found for component '%s'.", 
                 command, component);
         
         /* List available commands */
-        char cmd_dir[TILL_MAX_PATH];
-        snprintf(cmd_dir, sizeof(cmd_dir), "%s/%s", root, TILL_COMMANDS_DIR);
-        
-        DIR *dir = opendir(cmd_dir);
-        if (dir) {
+        if (commands) {
             printf("\nAvailable commands for %s:\n", component);
-            struct dirent *entry;
-            while ((entry = readdir(dir))) {
-                if (entry->d_name[0] != '.') {
-                    char check_path[TILL_MAX_PATH];
-                    snprintf(check_path, sizeof(check_path), "%s/%s", 
-                            cmd_dir, entry->d_name);
-                    if (is_executable(check_path)) {
-                        printf("  - %s\n", entry->d_name);
-                    }
-                }
+            cJSON *item;
+            cJSON_ArrayForEach(item, commands) {
+                printf("  - %s\n", item->valuestring);
             }
-            closedir(dir);
         } else {
-            till_error("Component '%s' has no TILL_COMMANDS_DIR directory.", 
-                    component);
+            till_error("Component '%s' has no %s directory.", 
+                    component, TILL_COMMANDS_DIR);
         }
+        close_run_index(&index);
         return -1;
     }
+    close_run_index(&index);
     
     if (!is_executable(cmd_path)) {
         till_error("Command '%s' is not executable.", command);
@@ -381,7 +587,8 @@ static void print_run_help(void) {
     printf("Usage patterns:\n");
     printf("  till run                         List all components with commands\n");
     printf("  till run <component>             List commands for a component\n");
-    printf("  till run <component> <command>   Execute a component command\n\n");
+    printf("  till run <component> <command>   Execute a component command\n");
+    printf("  till run --complete [component]  Names for shell completion, one per line\n\n");
     printf("Examples:\n");
     printf("  till run                         # Show all available components\n");
     printf("  till run tekton                  # List tekton commands\n");
@@ -393,11 +600,16 @@ static void print_run_help(void) {
     printf("  2. Add executable scripts (chmod +x)\n");
     printf("  3. Scripts receive arguments and run in component directory\n\n");
     printf("Note: Commands are discovered from all Tekton installations\n");
-    printf("      managed by Till.\n");
+    printf("      managed by Till, and indexed in %s in the Till directory.\n", TILL_RUN_INDEX);
 }
 
 /* Main entry point for till run command */
 int till_run_command(int argc, char *argv[]) {
+    /* Shell completion - quiet, straight from the index */
+    if (argc > 0 && strcmp(argv[0], "--complete") == 0) {
+        return complete_run(argc > 1 ? argv[1] : NULL);
+    }
+    
     /* Check for help flag */
     for (int i = 0; i < argc; i++) {
         if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
@@ -413,17 +625,23 @@ int till_run_command(int argc, char *argv[]) {
     
     if (argc < 2) {
         /* Only component specified - list its commands */
-        char *root = find_component_root(argv[0]);
+        run_index_t index;
+        const char *root = NULL;
+        if (open_run_index(&index) == 0) {
+            root = find_component_root(&index, argv[0]);
+        }
         if (!root) {
             till_error("Component '%s' not found.", argv[0]);
+            close_run_index(&index);
             return list_all_components();
         }
         
         printf("Available commands for %s:\n", argv[0]);
-        if (list_component_commands(argv[0], root) == 0) {
+        if (list_component_commands(argv[0], root_commands(&index, root, 0)) == 0) {
             printf("Component '%s' has no executable commands.\n", argv[0]);
         }
         printf("\nUsage: till run %s <command> [arguments...]\n", argv[0]);
+        close_run_index(&index);
         return 0;
     }
     
@@ -436,8 +654,13 @@ int till_run_command(int argc, char *argv[]) {
 
 /* Check if Till can run a component */
 int till_can_run_component(const char *component) {
-    char *root = find_component_root(component);
-    if (!root) return 0;
+    run_index_t index;
+    if (open_run_index(&index) != 0) {
+        return 0;
+    }
     
-    return has_command_directory(root);
-}
\ No newline at end of file
+    const char *root = find_component_root(&index, component);
+    int result = root && root_commands(&index, root, 0) != NULL;
+    close_run_index(&index);
+    return result;
+}
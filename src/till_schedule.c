@@ -17,6 +17,11 @@
 #include "till_config.h"
 #include "till_schedule.h"
 #include "till_common.h"
+#include "till_status.h"
+#include "till_platform.h"
+#include "till_federation.h"
+#include "till_hash.h"
+#include "till_history.h"
 #include "cJSON.h"
 
 #ifndef TILL_MAX_PATH
@@ -80,34 +85,155 @@ static int parse_time(const char *time_str, int *hour, int *minute) {
     return 0;
 }
 
+/* Window for sync statistics, set by --days */
+static int stats_days = TILL_SYNC_STATS_DAYS;
+
+/* Sync spread window in minutes */
+static int spread_minutes(cJSON *sync) {
+    return json_get_int(sync, "spread_minutes", TILL_WATCH_SPREAD_MINUTES);
+}
+
+/* Load per CPU above which a scheduled sync waits (0 = never waits) */
+static double max_load(cJSON *sync) {
+    cJSON *load = cJSON_GetObjectItem(sync, "max_load");
+    return cJSON_IsNumber(load) ? load->valuedouble : TILL_WATCH_MAX_LOAD;
+}
+
+/* This site's fixed offset into the spread window, in seconds.
+ * Derived from the federation site_id (else the hostname) so a fleet
+ * sharing one daily_at spreads out, and each site keeps its own slot. */
+static void site_name(char *site, size_t size) {
+    federation_config_t config;
+    
+    memset(site, 0, size);
+    if (federation_is_joined() && load_federation_config(&config) == 0 && config.site_id[0]) {
+        snprintf(site, size, "%s", config.site_id);
+    } else if (gethostname(site, size - 1) != 0) {
+        snprintf(site, size, "localhost");
+    }
+}
+
+static int site_offset(cJSON *sync) {
+    int spread = spread_minutes(sync);
+    char site[256];
+    
+    if (spread <= 0) {
+        return 0;
+    }
+    site_name(site, sizeof(site));
+    return (int)(till_hash_string(site) % (uint32_t)(spread * 60));
+}
+
+/* Delay before retrying a failed sync: TILL_WATCH_RETRY_MINUTES doubling
+ * with each further failure, plus up to half that again so sites that
+ * failed together (GitHub down) don't all retry in the same second */
+static time_t retry_delay(int failures) {
+    int doublings = failures - 1 < 10 ? failures - 1 : 10;
+    time_t delay = (time_t)TILL_WATCH_RETRY_MINUTES * 60 * (1 << doublings);
+    char key[300];
+    
+    site_name(key, 256);
+    snprintf(key + strlen(key), sizeof(key) - strlen(key), ":%d", failures);
+    return delay + (time_t)(till_hash_string(key) % (uint32_t)(delay / 2 + 1));
+}
+
+/* Daily time with this site's offset applied */
+static void jittered_daily_time(cJSON *sync, int *hour, int *minute, int *second) {
+    cJSON *daily_at = cJSON_GetObjectItem(sync, "daily_at");
+    int h = 3, m = 0;  /* Default 3 AM */
+    
+    if (cJSON_IsString(daily_at)) {
+        parse_time(daily_at->valuestring, &h, &m);
+    }
+    
+    int at = (h * 3600 + m * 60 + site_offset(sync)) % 86400;
+    *hour = at / 3600;
+    *minute = at / 60 % 60;
+    *second = at % 60;
+}
+
 /* Calculate next run time */
-static time_t calculate_next_run(int interval_hours, const char *daily_at) {
+static time_t calculate_next_run(cJSON *sync) {
     time_t now = time(NULL);
-    struct tm *tm_now = localtime(&now);
-    
-    if (daily_at && strlen(daily_at) == 5) {
-        /* Daily at specific time */
-        int hour, minute;
-        if (parse_time(daily_at, &hour, &minute) == 0) {
-            struct tm next_run = *tm_now;
-            next_run.tm_hour = hour;
-            next_run.tm_min = minute;
-            next_run.tm_sec = 0;
-            
-            time_t next_time = mktime(&next_run);
-            
-            /* If time has passed today, schedule for tomorrow */
-            if (next_time <= now) {
-                next_run.tm_mday++;
-                next_time = mktime(&next_run);
-            }
-            
-            return next_time;
+    int interval_hours = json_get_int(sync, "interval_hours", TILL_DEFAULT_WATCH_HOURS);
+    cJSON *daily_at = cJSON_GetObjectItem(sync, "daily_at");
+    int hour, minute;
+    
+    /* Interval-based */
+    time_t next_time = now + (interval_hours * 3600);
+    
+    if (cJSON_IsString(daily_at) && parse_time(daily_at->valuestring, &hour, &minute) == 0) {
+        /* Daily at specific time, shifted into this site's slot */
+        struct tm next_run = *localtime(&now);
+        next_run.tm_hour = hour;
+        next_run.tm_min = minute;
+        next_run.tm_sec = site_offset(sync);
+        next_run.tm_isdst = -1;
+        
+        next_time = mktime(&next_run);
+        
+        /* If time has passed today, schedule for tomorrow */
+        if (next_time <= now) {
+            next_run.tm_mday++;
+            next_run.tm_isdst = -1;
+            next_time = mktime(&next_run);
         }
     }
     
-    /* Interval-based */
-    return now + (interval_hours * 3600);
+    /* After failures till serve retries ahead of the regular run, backing
+     * off each time. System timers only fire at the regular time, so
+     * without serve next_run stays the regular run they will actually make */
+    int failures = json_get_int(sync, "consecutive_failures", 0);
+    if (failures > 0 && till_watch_serve_scheduled(sync)) {
+        time_t retry = now + retry_delay(failures);
+        if (retry < next_time) {
+            next_time = retry;
+        }
+    }
+    
+    return next_time;
+}
+
+/* When the sync described by a schedule "sync" object runs next */
+time_t till_watch_next_run(cJSON *sync) {
+    return calculate_next_run(sync);
+}
+
+/* Hold off a scheduled sync while the machine is busy */
+int till_watch_wait_for_load(void) {
+    cJSON *schedule = load_schedule();
+    double limit = max_load(cJSON_GetObjectItem(schedule, "sync"));
+    cJSON_Delete(schedule);
+    
+    if (limit <= 0) {
+        return 0;
+    }
+    
+    limit *= platform_get_cpu_count();
+    int waited = 0;
+    double load;
+    
+    while ((load = platform_get_load_average()) > limit &&
+           waited < TILL_WATCH_DEFER_MAX_MINUTES) {
+        printf("Load %.2f is above %.2f - waiting %d minutes\n",
+            load, limit, TILL_WATCH_DEFER_MINUTES);
+        fflush(stdout);
+        sleep(TILL_WATCH_DEFER_MINUTES * 60);
+        waited += TILL_WATCH_DEFER_MINUTES;
+    }
+    
+    if (waited) {
+        till_log(LOG_INFO, "Scheduled sync waited %d minutes for load %.2f", waited, load);
+    }
+    return waited;
+}
+
+/* Is sync enabled and run by till serve rather than a system timer? */
+int till_watch_serve_scheduled(cJSON *sync) {
+    cJSON *scheduler = cJSON_GetObjectItem(sync, "scheduler");
+
+    return cJSON_IsTrue(cJSON_GetObjectItem(sync, "enabled")) &&
+           cJSON_IsString(scheduler) && strcmp(scheduler->valuestring, "serve") == 0;
 }
 
 /* Format time for display */
@@ -118,6 +244,43 @@ static void format_time(time_t t, char *buffer, size_t size) {
 
 /* Configure watch daemon */
 int till_watch_configure(int argc, char *argv[]) {
+    argc = till_output_parse(argc, argv);
+    
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printf("Till Watch - Configure automatic sync\n\n");
+            printf("Usage: till watch [hours] [options]\n\n");
+            printf("Options:\n");
+            printf("  <hours>              Sync every 1-168 hours\n");
+            printf("  --daily-at HH:MM     Sync once a day at this time\n");
+            printf("  --spread <minutes>   Spread daily syncs across a fleet over this\n");
+            printf("                       window, each site at its own offset (default %d)\n",
+                TILL_WATCH_SPREAD_MINUTES);
+            printf("  --max-load <n>       Scheduled syncs wait while load per CPU is\n");
+            printf("                       above n, 0 to never wait (default %.1f)\n",
+                TILL_WATCH_MAX_LOAD);
+            printf("  --enable, --disable  Turn automatic sync on or off\n");
+            printf("  --scheduler <which>  'system' (cron/systemd/launchd, default) or\n");
+            printf("                       'serve' (jobs run inside 'till serve')\n");
+            printf("  --status             Show the schedule (default)\n");
+            printf("  --days <n>           Statistics over the last n days (default %d)\n",
+                TILL_SYNC_STATS_DAYS);
+            printf("  --json, --jsonl      Machine-readable status\n");
+            return 0;
+        }
+    }
+    
+    for (int i = 0; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--days") == 0) {
+            stats_days = atoi(argv[i + 1]);
+            if (stats_days <= 0) {
+                till_error("Invalid number of days: %s\n", argv[i + 1]);
+                return -1;
+            }
+            return till_watch_status();
+        }
+    }
+    
     cJSON *schedule = load_schedule();
     if (!schedule) {
         till_error("Failed to load schedule configuration\n");
@@ -150,6 +313,53 @@ int till_watch_configure(int argc, char *argv[]) {
             cJSON_ReplaceItemInObject(sync, "enabled", cJSON_CreateBool(0));
             printf("Automatic sync disabled\n");
         }
+        else if (strcmp(argv[i], "--scheduler") == 0 && i + 1 < argc) {
+            const char *which = argv[++i];
+
+            if (strcmp(which, "serve") != 0 && strcmp(which, "system") != 0) {
+                till_error("Unknown scheduler '%s'. Use 'serve' or 'system'\n", which);
+                cJSON_Delete(schedule);
+                return -1;
+            }
+            if (cJSON_GetObjectItem(sync, "scheduler")) {
+                cJSON_ReplaceItemInObject(sync, "scheduler", cJSON_CreateString(which));
+            } else {
+                cJSON_AddStringToObject(sync, "scheduler", which);
+            }
+            printf("Scheduled jobs run by %s\n",
+                strcmp(which, "serve") == 0 ? "'till serve'" : "the system scheduler");
+        }
+        else if (strcmp(argv[i], "--spread") == 0 && i + 1 < argc) {
+            char *end;
+            long minutes = strtol(argv[++i], &end, 10);
+            
+            if (*end || minutes < 0 || minutes > 720) {
+                till_error("Invalid spread. Must be 0-720 minutes\n");
+                cJSON_Delete(schedule);
+                return -1;
+            }
+            cJSON_DeleteItemFromObject(sync, "spread_minutes");
+            cJSON_AddNumberToObject(sync, "spread_minutes", minutes);
+            printf("Daily sync spread over %ld minutes (this site +%d:%02d)\n",
+                minutes, site_offset(sync) / 60, site_offset(sync) % 60);
+        }
+        else if (strcmp(argv[i], "--max-load") == 0 && i + 1 < argc) {
+            char *end;
+            double load = strtod(argv[++i], &end);
+            
+            if (*end || load < 0) {
+                till_error("Invalid load. Use a number of runnable tasks per CPU, 0 for none\n");
+                cJSON_Delete(schedule);
+                return -1;
+            }
+            cJSON_DeleteItemFromObject(sync, "max_load");
+            cJSON_AddNumberToObject(sync, "max_load", load);
+            if (load > 0) {
+                printf("Scheduled syncs wait while load is above %.2f per CPU\n", load);
+            } else {
+                printf("Scheduled syncs run regardless of load\n");
+            }
+        }
         else if (strcmp(argv[i], "--daily-at") == 0 && i + 1 < argc) {
             const char *time_str = argv[++i];
             int hour, minute;
@@ -184,13 +394,7 @@ int till_watch_configure(int argc, char *argv[]) {
     /* Calculate next run time */
     cJSON *enabled = cJSON_GetObjectItem(sync, "enabled");
     if (enabled && cJSON_IsTrue(enabled)) {
-        cJSON *interval = cJSON_GetObjectItem(sync, "interval_hours");
-        cJSON *daily_at = cJSON_GetObjectItem(sync, "daily_at");
-        
-        time_t next_run = calculate_next_run(
-            interval ? interval->valueint : 24,
-            daily_at ? daily_at->valuestring : NULL
-        );
+        time_t next_run = calculate_next_run(sync);
         
         char time_str[64];
         format_time(next_run, time_str, sizeof(time_str));
@@ -199,8 +403,16 @@ int till_watch_configure(int argc, char *argv[]) {
         
         printf("Next sync scheduled for: %s\n", time_str);
         
+        /* The schedule changed - till serve recomputes its pending jobs */
+        cJSON_DeleteItemFromObject(schedule, "jobs");
+        
+        if (till_watch_serve_scheduled(sync)) {
+            /* No cold-started timer alongside the daemon */
+            platform_schedule_remove("sync");
+            printf("Sync runs inside 'till serve' - keep it running (launchd/systemd/nohup)\n");
+        }
         /* Create platform-specific scheduler */
-        if (till_watch_install_scheduler() == 0) {
+        else if (till_watch_install_scheduler() == 0) {
             printf("Scheduler installed successfully\n");
         } else {
             printf("Warning: Could not install system scheduler\n");
@@ -219,8 +431,45 @@ int till_watch_configure(int argc, char *argv[]) {
     return 0;
 }
 
+/* Sync schedule as a status model section */
+cJSON *till_watch_status_model(void) {
+    cJSON *schedule = load_schedule();
+    cJSON *sync = cJSON_Duplicate(cJSON_GetObjectItem(schedule, "sync"), 1);
+    
+    if (!sync) {
+        sync = cJSON_CreateObject();
+        cJSON_AddBoolToObject(sync, "enabled", 0);
+    }
+    if (!cJSON_GetObjectItem(sync, "spread_minutes")) {
+        cJSON_AddNumberToObject(sync, "spread_minutes", TILL_WATCH_SPREAD_MINUTES);
+    }
+    if (!cJSON_GetObjectItem(sync, "max_load")) {
+        cJSON_AddNumberToObject(sync, "max_load", TILL_WATCH_MAX_LOAD);
+    }
+    cJSON_AddNumberToObject(sync, "site_offset_seconds", site_offset(sync));
+    till_watch_status_live(sync, stats_days);
+    cJSON_Delete(schedule);
+    return sync;
+}
+
+/* Refresh the fields a cached schedule section can't keep */
+void till_watch_status_live(cJSON *sync, int days) {
+    cJSON_DeleteItemFromObject(sync, "load_average");
+    cJSON_AddNumberToObject(sync, "load_average", platform_get_load_average());
+    cJSON_DeleteItemFromObject(sync, "stats");
+    cJSON_AddItemToObject(sync, "stats", sync_history_stats_model(days));
+}
+
+int till_watch_stats_days(void) {
+    return stats_days;
+}
+
 /* Show watch status */
 int till_watch_status(void) {
+    if (g_output != TILL_OUTPUT_TEXT) {
+        return till_status_show(STATUS_SCHEDULE);
+    }
+    
     cJSON *schedule = load_schedule();
     if (!schedule) {
         printf("No schedule configured\n");
@@ -256,6 +505,26 @@ int till_watch_status(void) {
         printf("Daily at: %s\n", daily_at->valuestring);
     }
     
+    int offset = site_offset(sync);
+    printf("Spread: %d minutes (this site +%d:%02d)\n", spread_minutes(sync),
+        offset / 60, offset % 60);
+    
+    double limit = max_load(sync);
+    double load = platform_get_load_average();
+    if (limit > 0) {
+        printf("Max load: %.2f per CPU", limit);
+        if (load >= 0) {
+            printf(" (now %.2f on %d CPUs)", load, platform_get_cpu_count());
+        }
+        printf("\n");
+    } else {
+        printf("Max load: none\n");
+    }
+    
+    cJSON *scheduler = cJSON_GetObjectItem(sync, "scheduler");
+    printf("Scheduler: %s\n", cJSON_IsString(scheduler) &&
+        strcmp(scheduler->valuestring, "serve") == 0 ? "till serve" : "system");
+    
     if (next_run && next_run->valuestring) {
         printf("Next run: %s\n", next_run->valuestring);
     }
@@ -269,7 +538,21 @@ int till_watch_status(void) {
     }
     
     if (failures && failures->valueint > 0) {
-        printf("Warning: %d consecutive failures\n", failures->valueint);
+        printf("Warning: %d consecutive failures - retrying with backoff\n", failures->valueint);
+    }
+    
+    /* Statistics from the rolling index */
+    sync_stats_t stats;
+    if (sync_history_stats(stats_days, &stats) > 0) {
+        printf("\nLast %d days: %d sync%s, %d failed (%.0f%%)\n", stats.days, stats.runs,
+            stats.runs == 1 ? "" : "s", stats.failures, 100.0 * stats.failures / stats.runs);
+        printf("Duration: p50 %.1fs, p95 %.1fs", stats.p50, stats.p95);
+        if (stats.has_trend) {
+            printf(", %.0f%% %s than the first half of the period",
+                100.0 * (stats.trend < 0 ? -stats.trend : stats.trend),
+                stats.trend < 0 ? "faster" : "slower");
+        }
+        printf("\n");
     }
     
     /* Show recent history */
@@ -334,13 +617,8 @@ int till_watch_install_launchd(void) {
     cJSON *schedule = load_schedule();
     if (!schedule) return -1;
     
-    cJSON *sync = cJSON_GetObjectItem(schedule, "sync");
-    cJSON *daily_at = cJSON_GetObjectItem(sync, "daily_at");
-    
-    int hour = 3, minute = 0;  /* Default 3 AM */
-    if (daily_at && daily_at->valuestring) {
-        parse_time(daily_at->valuestring, &hour, &minute);
-    }
+    int hour, minute, second;
+    jittered_daily_time(cJSON_GetObjectItem(schedule, "sync"), &hour, &minute, &second);
     
     cJSON_Delete(schedule);
     
@@ -371,6 +649,7 @@ int till_watch_install_launchd(void) {
     fprintf(fp, "    <array>\n");
     fprintf(fp, "        <string>%s</string>\n", till_path);
     fprintf(fp, "        <string>sync</string>\n");
+    fprintf(fp, "        <string>--scheduled</string>\n");
     fprintf(fp, "    </array>\n");
     fprintf(fp, "    <key>StartCalendarInterval</key>\n");
     fprintf(fp, "    <dict>\n");
@@ -429,13 +708,8 @@ int till_watch_install_systemd(void) {
     cJSON *schedule = load_schedule();
     if (!schedule) return -1;
     
-    cJSON *sync = cJSON_GetObjectItem(schedule, "sync");
-    cJSON *daily_at = cJSON_GetObjectItem(sync, "daily_at");
-    
-    const char *time_spec = "03:00";  /* Default */
-    if (daily_at && daily_at->valuestring) {
-        time_spec = daily_at->valuestring;
-    }
+    int hour, minute, second;
+    jittered_daily_time(cJSON_GetObjectItem(schedule, "sync"), &hour, &minute, &second);
     
     cJSON_Delete(schedule);
     
@@ -462,7 +736,7 @@ int till_watch_install_systemd(void) {
     fprintf(fp, "Description=Till Sync Service\n\n");
     fprintf(fp, "[Service]\n");
     fprintf(fp, "Type=oneshot\n");
-    fprintf(fp, "ExecStart=%s sync\n", till_path);
+    fprintf(fp, "ExecStart=%s sync --scheduled\n", till_path);
     char till_dir[TILL_MAX_PATH];
     get_till_dir(till_dir, sizeof(till_dir));
     fprintf(fp, "StandardOutput=append:%s/logs/sync.log\n", till_dir);
@@ -482,7 +756,7 @@ int till_watch_install_systemd(void) {
     fprintf(fp, "Description=Till Sync Timer\n");
     fprintf(fp, "Requires=till-sync.service\n\n");
     fprintf(fp, "[Timer]\n");
-    fprintf(fp, "OnCalendar=*-*-* %s:00\n", time_spec);
+    fprintf(fp, "OnCalendar=*-*-* %02d:%02d:%02d\n", hour, minute, second);
     fprintf(fp, "Persistent=true\n\n");
     fprintf(fp, "[Install]\n");
     fprintf(fp, "WantedBy=timers.target\n");
@@ -512,13 +786,8 @@ int till_watch_install_cron(void) {
     cJSON *schedule = load_schedule();
     if (!schedule) return -1;
     
-    cJSON *sync = cJSON_GetObjectItem(schedule, "sync");
-    cJSON *daily_at = cJSON_GetObjectItem(sync, "daily_at");
-    
-    int hour = 3, minute = 0;  /* Default 3 AM */
-    if (daily_at && daily_at->valuestring) {
-        parse_time(daily_at->valuestring, &hour, &minute);
-    }
+    int hour, minute, second;
+    jittered_daily_time(cJSON_GetObjectItem(schedule, "sync"), &hour, &minute, &second);
     
     cJSON_Delete(schedule);
     
@@ -539,7 +808,7 @@ int till_watch_install_cron(void) {
     
     char cron_entry[TILL_MAX_PATH * 2];
     snprintf(cron_entry, sizeof(cron_entry),
-        "%d %d * * * %s sync >> %s/logs/cron.log 2>&1",
+        "%d %d * * * %s sync --scheduled >> %s/logs/cron.log 2>&1",
         minute, hour, till_path, till_dir);
     
     /* Add to crontab */
@@ -557,14 +826,20 @@ int till_watch_install_cron(void) {
     return 0;
 }
 
-/* Record sync result */
-int till_watch_record_sync(int success, int duration_seconds, int installations, int hosts) {
-    cJSON *schedule = load_schedule();
-    if (!schedule) return -1;
-    
+/* A finished sync, recorded under the schedule's lock: till serve writes
+ * its pending jobs to the same file while the sync child finishes */
+typedef struct {
+    int success;
+    int duration_seconds;
+    int installations;
+    int hosts;
+} sync_result_t;
+
+static int record_sync_result(cJSON *schedule, void *ctx) {
+    const sync_result_t *result = ctx;
+    int success = result->success;
     cJSON *sync = cJSON_GetObjectItem(schedule, "sync");
     if (!sync) {
-        cJSON_Delete(schedule);
         return -1;
     }
     
@@ -587,13 +862,7 @@ int till_watch_record_sync(int success, int duration_seconds, int installations,
     }
     
     /* Calculate next run */
-    cJSON *interval = cJSON_GetObjectItem(sync, "interval_hours");
-    cJSON *daily_at = cJSON_GetObjectItem(sync, "daily_at");
-    
-    time_t next_run = calculate_next_run(
-        interval ? interval->valueint : 24,
-        daily_at ? daily_at->valuestring : NULL
-    );
+    time_t next_run = calculate_next_run(sync);
     
     format_time(next_run, time_str, sizeof(time_str));
     cJSON_ReplaceItemInObject(sync, "next_run", cJSON_CreateString(time_str));
@@ -609,20 +878,23 @@ int till_watch_record_sync(int success, int duration_seconds, int installations,
     format_time(now, time_str, sizeof(time_str));
     cJSON_AddStringToObject(entry, "timestamp", time_str);
     cJSON_AddStringToObject(entry, "status", success ? "success" : "failure");
-    cJSON_AddNumberToObject(entry, "duration_seconds", duration_seconds);
-    cJSON_AddNumberToObject(entry, "installations_synced", installations);
-    cJSON_AddNumberToObject(entry, "hosts_synced", hosts);
+    cJSON_AddNumberToObject(entry, "duration_seconds", result->duration_seconds);
+    cJSON_AddNumberToObject(entry, "installations_synced", result->installations);
+    cJSON_AddNumberToObject(entry, "hosts_synced", result->hosts);
     
     /* Add to beginning of array */
-    cJSON_AddItemToArray(history, entry);
+    cJSON_InsertItemInArray(history, 0, entry);
     
-    /* Keep only last 10 entries */
+    /* Keep only the newest 10 entries */
     while (cJSON_GetArraySize(history) > 10) {
         cJSON_DeleteItemFromArray(history, 10);
     }
     
-    save_schedule(schedule);
-    cJSON_Delete(schedule);
-    
     return 0;
+}
+
+/* Record sync result */
+int till_watch_record_sync(int success, int duration_seconds, int installations, int hosts) {
+    sync_result_t result = { success, duration_seconds, installations, hosts };
+    return till_json_transaction("schedule.json", record_sync_result, &result) == 0 ? 0 : -1;
 }
\ No newline at end of file
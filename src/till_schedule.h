@@ -5,6 +5,9 @@
 #ifndef TILL_SCHEDULE_H
 #define TILL_SCHEDULE_H
 
+#include <time.h>
+#include "cJSON.h"
+
 /* Configure watch daemon */
 int till_watch_configure(int argc, char *argv[]);
 
@@ -19,6 +22,15 @@ int till_watch_install_launchd(void);  /* macOS */
 int till_watch_install_systemd(void);  /* Linux with systemd */
 int till_watch_install_cron(void);     /* Fallback */
 
+/* When the sync in a schedule.json "sync" object runs next */
+time_t till_watch_next_run(cJSON *sync);
+
+/* Is sync enabled and run by till serve rather than a system timer? */
+int till_watch_serve_scheduled(cJSON *sync);
+
+/* Wait while the load is above the schedule's limit; returns minutes waited */
+int till_watch_wait_for_load(void);
+
 /* Record sync result for history */
 int till_watch_record_sync(int success, int duration_seconds, int installations, int hosts);
 
@@ -0,0 +1,305 @@
+/*
+ * till_scheduler.c - Scheduled jobs inside till serve
+ *
+ * Pending jobs sit in a timer heap keyed on due time, and the serve loop
+ * sleeps until the earliest. The heap is rebuilt whenever the files it
+ * comes from change (schedule.json, the holds, the federation config) and
+ * written back as the "jobs" array of schedule.json after jobs run, so a
+ * restarted daemon picks up a sync it missed instead of waiting a day.
+ *
+ * Hold expiry is cheap and runs in the daemon. Sync and federation push
+ * talk to git and GitHub, so each runs in a forked child that starts from
+ * the daemon's warm state; at most one of each at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "till_config.h"
+#include "till_common.h"
+#include "till_commands.h"
+#include "till_federation.h"
+#include "till_heap.h"
+#include "till_hold.h"
+#include "till_schedule.h"
+#include "till_scheduler.h"
+#include "till_status.h"
+#include "cJSON.h"
+
+static const char *job_names[] = { "sync", "hold_expiry", "federation_push" };
+#define JOB_KINDS ((int)(sizeof(job_names) / sizeof(job_names[0])))
+
+/* A job that runs in a child */
+typedef struct {
+    pid_t pid;
+    time_t started;
+} job_child_t;
+
+static struct {
+    till_heap_t heap;
+    job_child_t sync;
+    job_child_t push;
+} sched;
+
+static int job_kind(const char *name) {
+    for (int kind = 0; kind < JOB_KINDS; kind++) {
+        if (strcmp(job_names[kind], name) == 0) {
+            return kind;
+        }
+    }
+    return -1;
+}
+
+/* Due time persisted for a job kind, or 0 */
+static time_t persisted_due(cJSON *jobs, int kind) {
+    cJSON *job;
+
+    cJSON_ArrayForEach(job, jobs) {
+        cJSON *name = cJSON_GetObjectItem(job, "kind");
+        cJSON *due = cJSON_GetObjectItem(job, "due");
+        if (cJSON_IsString(name) && job_kind(name->valuestring) == kind && cJSON_IsNumber(due)) {
+            return (time_t)due->valuedouble;
+        }
+    }
+    return 0;
+}
+
+static void push_job(time_t due, int kind, const char *key) {
+    if (till_heap_push(&sched.heap, due, kind, key) != 0) {
+        till_log(LOG_ERROR, "Scheduler: out of memory scheduling %s", job_names[kind]);
+    }
+}
+
+/* Rebuild pending jobs from schedule.json, holds and federation config */
+int till_scheduler_load(void) {
+    cJSON *schedule = load_till_json("schedule.json");
+    cJSON *sync = cJSON_GetObjectItem(schedule, "sync");
+    cJSON *jobs = cJSON_GetObjectItem(schedule, "jobs");
+
+    till_heap_clear(&sched.heap);
+
+    if (till_watch_serve_scheduled(sync)) {
+        /* A missed run persisted earlier still runs now; a failed sync's
+         * retry (recorded by the child after this was saved) comes sooner */
+        time_t due = persisted_due(jobs, TILL_JOB_SYNC);
+        time_t next = till_watch_next_run(sync);
+        push_job(due && due < next ? due : next, TILL_JOB_SYNC, NULL);
+
+        if (federation_is_joined()) {
+            federation_config_t config;
+            due = persisted_due(jobs, TILL_JOB_FEDERATION_PUSH);
+            if (!due) {
+                due = load_federation_config(&config) == 0
+                    ? config.last_push + FEDERATION_HEARTBEAT_HOURS * 3600 : time(NULL);
+            }
+            push_job(due, TILL_JOB_FEDERATION_PUSH, NULL);
+        }
+    }
+    cJSON_Delete(schedule);
+
+    /* A hold expires once the clock has passed expires_at */
+    cJSON *holds = load_holds();
+    cJSON *hold;
+    cJSON_ArrayForEach(hold, holds) {
+        cJSON *expires = cJSON_GetObjectItem(hold, "expires_at");
+        if (cJSON_IsNumber(expires) && expires->valuedouble > 0) {
+            push_job((time_t)expires->valuedouble + 1, TILL_JOB_HOLD_EXPIRY, hold->string);
+        }
+    }
+    cJSON_Delete(holds);
+
+    const till_heap_item_t *next = till_heap_peek(&sched.heap);
+    if (next) {
+        char when[64];
+        format_time(next->due, when, sizeof(when));
+        till_log(LOG_INFO, "Scheduler: %zu jobs pending, next %s at %s",
+                 sched.heap.count, job_names[next->kind], when);
+    }
+    return (int)sched.heap.count;
+}
+
+time_t till_scheduler_next_due(void) {
+    const till_heap_item_t *next = till_heap_peek(&sched.heap);
+    return next ? next->due : 0;
+}
+
+/* Record pending jobs (and the sync's next run) in schedule.json as it
+ * is now - the sync child may be recording its result at the same time */
+static int record_jobs(cJSON *schedule, void *ctx) {
+    (void)ctx;
+    if (!schedule->child) {
+        return 1;  /* Only holds are scheduled; nothing to record */
+    }
+
+    cJSON *jobs = cJSON_CreateArray();
+    cJSON *sync = cJSON_GetObjectItem(schedule, "sync");
+    char when[64];
+
+    for (size_t i = 0; i < sched.heap.count; i++) {
+        const till_heap_item_t *item = &sched.heap.items[i];
+        cJSON *job = cJSON_CreateObject();
+
+        format_time(item->due, when, sizeof(when));
+        cJSON_AddStringToObject(job, "kind", job_names[item->kind]);
+        if (item->key[0]) {
+            cJSON_AddStringToObject(job, "key", item->key);
+        }
+        cJSON_AddNumberToObject(job, "due", (double)item->due);
+        cJSON_AddStringToObject(job, "at", when);
+        cJSON_AddItemToArray(jobs, job);
+
+        if (item->kind == TILL_JOB_SYNC && sync) {
+            cJSON_DeleteItemFromObject(sync, "next_run");
+            cJSON_AddStringToObject(sync, "next_run", when);
+        }
+    }
+
+    cJSON_DeleteItemFromObject(schedule, "jobs");
+    cJSON_AddItemToObject(schedule, "jobs", jobs);
+    return 0;
+}
+
+static void save_jobs(void) {
+    till_json_transaction("schedule.json", record_jobs, NULL);
+}
+
+static int run_sync(void) {
+    char *argv[] = { "--scheduled", NULL };
+    return cmd_sync(1, argv);
+}
+
+static int run_push(void) {
+    return till_federate_push(0);
+}
+
+/* Fork a child for job, output appended to logs/<name>.log */
+static void spawn_job(job_child_t *child, const char *name, int (*job)(void)) {
+    char till_dir[TILL_MAX_PATH];
+    char path[TILL_MAX_PATH];
+
+    if (child->pid > 0) {
+        till_log(LOG_WARN, "Scheduler: %s still running (pid %d), skipped", name, (int)child->pid);
+        return;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        till_log(LOG_ERROR, "Scheduler: cannot start %s: %s", name, strerror(errno));
+        return;
+    }
+
+    if (pid == 0) {
+        /* The daemon's handlers would keep the child from stopping */
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+
+        /* Without a log the job still runs, writing to the daemon's output */
+        if (get_till_dir(till_dir, sizeof(till_dir)) == 0 &&
+            snprintf(path, sizeof(path), "%s/logs", till_dir) < (int)sizeof(path) &&
+            ensure_directory(path) == 0 &&
+            snprintf(path, sizeof(path), "%s/logs/%s.log", till_dir, name) < (int)sizeof(path)) {
+            int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (fd >= 0) {
+                dup2(fd, STDOUT_FILENO);
+                dup2(fd, STDERR_FILENO);
+                close(fd);
+            }
+        }
+
+        int status = job();
+        fflush(stdout);
+        fflush(stderr);
+        _exit(status == 0 ? 0 : 1);
+    }
+
+    child->pid = pid;
+    child->started = time(NULL);
+    till_log(LOG_INFO, "Scheduler: started %s (pid %d)", name, (int)pid);
+}
+
+/* Collect a finished child; returns 1 if it was reaped */
+static int reap(job_child_t *child, const char *name) {
+    int status;
+
+    if (child->pid <= 0 || waitpid(child->pid, &status, WNOHANG) != child->pid) {
+        return 0;
+    }
+
+    int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    till_log(ok ? LOG_INFO : LOG_WARN, "Scheduler: %s %s after %lds", name,
+             ok ? "finished" : "failed", (long)(time(NULL) - child->started));
+    child->pid = 0;
+    return 1;
+}
+
+/* Run one due job and queue its next occurrence */
+static unsigned int run_job(const till_heap_item_t *job, time_t now) {
+    cJSON *schedule;
+
+    switch (job->kind) {
+    case TILL_JOB_SYNC:
+        spawn_job(&sched.sync, job_names[job->kind], run_sync);
+        schedule = load_till_json("schedule.json");
+        push_job(till_watch_next_run(cJSON_GetObjectItem(schedule, "sync")), TILL_JOB_SYNC, NULL);
+        cJSON_Delete(schedule);
+        return STATUS_SCHEDULE;
+
+    case TILL_JOB_HOLD_EXPIRY:
+        if (cleanup_expired_holds() > 0) {
+            till_log(LOG_INFO, "Scheduler: hold on %s expired", job->key);
+        }
+        return STATUS_HOLDS;
+
+    case TILL_JOB_FEDERATION_PUSH:
+        spawn_job(&sched.push, job_names[job->kind], run_push);
+        push_job(now + FEDERATION_HEARTBEAT_HOURS * 3600, TILL_JOB_FEDERATION_PUSH, NULL);
+        return STATUS_FEDERATION;
+    }
+    return 0;
+}
+
+/* Run due jobs and reap finished ones; returns status sections they changed */
+unsigned int till_scheduler_run(void) {
+    unsigned int changed = 0;
+    time_t now = time(NULL);
+    const till_heap_item_t *next;
+    int ran = 0;
+
+    if (reap(&sched.sync, job_names[TILL_JOB_SYNC])) {
+        changed |= STATUS_INSTALLATIONS | STATUS_HOLDS | STATUS_SCHEDULE;
+    }
+    if (reap(&sched.push, job_names[TILL_JOB_FEDERATION_PUSH])) {
+        changed |= STATUS_FEDERATION;
+    }
+
+    while ((next = till_heap_peek(&sched.heap)) != NULL && next->due <= now) {
+        till_heap_item_t job;
+        till_heap_pop(&sched.heap, &job);
+        changed |= run_job(&job, now);
+        ran++;
+    }
+
+    if (ran) {
+        save_jobs();
+    }
+    return changed;
+}
+
+void till_scheduler_stop(void) {
+    if (sched.heap.count) {
+        save_jobs();
+    }
+    till_heap_free(&sched.heap);
+}
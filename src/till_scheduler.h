@@ -0,0 +1,34 @@
+/*
+ * till_scheduler.h - Scheduled jobs inside till serve
+ *
+ * The status daemon keeps pending jobs in a timer heap and runs each when
+ * it falls due: hold expiries always, and with "till watch --scheduler
+ * serve" the periodic sync and federation heartbeat that cron/systemd
+ * would otherwise start from cold.
+ */
+
+#ifndef TILL_SCHEDULER_H
+#define TILL_SCHEDULER_H
+
+#include <time.h>
+
+/* Job kinds, as persisted in schedule.json "jobs" */
+typedef enum {
+    TILL_JOB_SYNC,               /* till sync, in a child */
+    TILL_JOB_HOLD_EXPIRY,        /* drop a hold that has expired */
+    TILL_JOB_FEDERATION_PUSH     /* federation status push, in a child */
+} till_job_kind_t;
+
+/* Rebuild pending jobs from schedule.json, holds and federation config */
+int till_scheduler_load(void);
+
+/* When the next job is due, or 0 if none */
+time_t till_scheduler_next_due(void);
+
+/* Run due jobs and reap finished ones; returns status sections they changed */
+unsigned int till_scheduler_run(void);
+
+/* Persist pending jobs and release the heap (running children finish alone) */
+void till_scheduler_stop(void);
+
+#endif /* TILL_SCHEDULER_H */
@@ -14,6 +14,8 @@
 #include <errno.h>
 #include <ctype.h>
 #include <limits.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "till_security.h"
 #include "till_common.h"
@@ -400,41 +402,153 @@ int write_file_atomic(const char *path, const char *content, size_t len) {
     return 0;
 }
 
-/* Acquire lock file (with timeout) */
-int acquire_lock_file(const char *path, int timeout_ms) {
-    if (!path) return -1;
-    
-    int fd = open(path, O_CREAT | O_RDWR, TILL_FILE_PERMS);
-    if (fd < 0) {
-        return -1;
-    }
-    
-    /* Try to acquire lock with timeout */
+/* Take the lock by polling - only used when no waiter thread can start.
+ * Closes fd on failure */
+static int poll_lock(int fd, int timeout_ms) {
     int elapsed = 0;
     int interval = 100;  /* Check every 100ms */
+    int error = ETIMEDOUT;
     
     while (elapsed < timeout_ms) {
         if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
-            /* Got the lock */
-            return fd;
+            return 0;
         }
-        
         if (errno != EWOULDBLOCK) {
-            /* Unexpected error */
-            close(fd);
-            return -1;
+            error = errno;
+            break;
         }
-        
         usleep(interval * 1000);
         elapsed += interval;
     }
-    
-    /* Timeout */
     close(fd);
-    errno = ETIMEDOUT;
+    errno = error;
     return -1;
 }
 
+/* A blocking flock handed to a waiter thread, so the caller can give up
+ * at the deadline. Whoever finishes last frees it: the caller once the
+ * waiter is done, or the waiter itself if the caller has gone */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int fd;
+    int done;
+    int result;
+    int error;
+    int abandoned;
+} lock_wait_t;
+
+static void lock_wait_free(lock_wait_t *wait) {
+    pthread_mutex_destroy(&wait->mutex);
+    pthread_cond_destroy(&wait->cond);
+    free(wait);
+}
+
+static void *lock_waiter(void *arg) {
+    lock_wait_t *wait = arg;
+    int result;
+    
+    do {
+        result = flock(wait->fd, LOCK_EX);
+    } while (result != 0 && errno == EINTR);
+    
+    pthread_mutex_lock(&wait->mutex);
+    wait->done = 1;
+    wait->result = result;
+    wait->error = result == 0 ? 0 : errno;
+    int abandoned = wait->abandoned;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->mutex);
+    
+    /* Too late - let go of the lock straight away */
+    if (abandoned) {
+        close(wait->fd);
+        lock_wait_free(wait);
+    }
+    return NULL;
+}
+
+/* Block in flock until the lock is free or the deadline passes. On
+ * failure fd is closed, or left to the waiter to close */
+static int wait_lock(int fd, int timeout_ms) {
+    lock_wait_t *wait = calloc(1, sizeof(*wait));
+    pthread_t thread;
+    
+    if (!wait) {
+        return poll_lock(fd, timeout_ms);
+    }
+    pthread_mutex_init(&wait->mutex, NULL);
+    pthread_cond_init(&wait->cond, NULL);
+    wait->fd = fd;
+    
+    if (pthread_create(&thread, NULL, lock_waiter, wait) != 0) {
+        lock_wait_free(wait);
+        return poll_lock(fd, timeout_ms);
+    }
+    
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    
+    pthread_mutex_lock(&wait->mutex);
+    while (!wait->done) {
+        if (pthread_cond_timedwait(&wait->cond, &wait->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    
+    if (!wait->done) {
+        /* The waiter owns fd from here and closes it */
+        wait->abandoned = 1;
+        pthread_mutex_unlock(&wait->mutex);
+        pthread_detach(thread);
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    
+    pthread_mutex_unlock(&wait->mutex);
+    pthread_join(thread, NULL);
+    int result = wait->result;
+    int error = wait->error;
+    lock_wait_free(wait);
+    
+    if (result != 0) {
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+/* Acquire lock file (with timeout) - uncontended locks are taken at
+ * once; otherwise the wait blocks in flock and wakes as soon as the
+ * holder lets go, rather than on the next poll */
+int acquire_lock_file(const char *path, int timeout_ms) {
+    if (!path) return -1;
+    
+    int fd = open(path, O_CREAT | O_RDWR, TILL_FILE_PERMS);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+        return fd;
+    }
+    if (errno != EWOULDBLOCK || timeout_ms <= 0) {
+        int error = errno == EWOULDBLOCK ? ETIMEDOUT : errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    
+    return wait_lock(fd, timeout_ms) == 0 ? fd : -1;
+}
+
 /* Release lock file */
 int release_lock_file(int lock_fd) {
     if (lock_fd < 0) return -1;
@@ -0,0 +1,659 @@
+/*
+ * till_serve.c - Status daemon for Till
+ *
+ * One thread, one poll loop. The model sections are built once and kept
+ * until a file they come from changes (the schedule's load average and
+ * sync statistics are redone per query): on Linux inotify reports changes
+ * as they happen, elsewhere (or for a directory that doesn't exist yet)
+ * each file's stat signature is compared when a query arrives. A new or
+ * removed directory under ~/projects/github reruns discovery, debounced
+ * so a clone in progress is seen once it has settled.
+ *
+ * The same loop runs scheduled jobs (till_scheduler.c): poll sleeps until
+ * the earliest is due, and a change to the files they come from
+ * reschedules them.
+ *
+ * Protocol: the client sends one line and reads the reply until EOF.
+ *   status <sections> [days]   the model as JSON (sections as in
+ *                       till_status.h; days is the sync statistics window)
+ *   ping                "pong"
+ *   stop                "ok", then the daemon exits
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "till_config.h"
+#include "till_platform.h"
+#include "till_common.h"
+#include "till_security.h"
+#include "till_registry.h"
+#include "till_federation.h"
+#include "till_status.h"
+#include "till_serve.h"
+#include "till_scheduler.h"
+#include "cJSON.h"
+
+#if PLATFORM_LINUX
+#include <sys/inotify.h>
+#endif
+
+#define SERVE_NO_DAEMON_ENV "TILL_NO_SERVE"   /* Set to always read the files */
+#define SERVE_MAX_REQUEST 128
+#define SERVE_MAX_REPLY (16 * JSON_MAX_SIZE)
+#define SERVE_SECTIONS 6                      /* STATUS_TILL .. STATUS_FEDERATION */
+#define SERVE_WATCHES 8
+#define SERVE_DISCOVERY_DELAY 5               /* Seconds of quiet before rediscovery */
+#define SERVE_POLL_SECONDS 30                 /* Stat checks for files inotify can't watch */
+#define SERVE_MAX_SLEEP 3600                  /* Longest poll timeout, in seconds */
+
+#ifdef MSG_NOSIGNAL
+#define SERVE_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SERVE_SEND_FLAGS 0
+#endif
+
+/* A file (or directory) whose changes invalidate model sections */
+typedef struct {
+    char dir[TILL_MAX_PATH];
+    const char *name;           /* file in dir, or NULL for the directory itself */
+    unsigned int sections;
+    int discover;               /* change means installations came or went */
+    int wd;                     /* inotify watch on dir, or -1 to compare stats */
+    time_t mtime;               /* stat signature */
+    off_t size;
+    ino_t ino;
+} serve_watch_t;
+
+static struct {
+    serve_watch_t watches[SERVE_WATCHES];
+    int count;
+    int inotify_fd;
+    cJSON *cache[SERVE_SECTIONS];
+    unsigned int dirty;
+    time_t holds_stale_at;      /* a hold expires - "expired" flags change */
+    time_t discover_at;         /* pending rediscovery, or 0 */
+    int reschedule;             /* a file behind the scheduled jobs changed */
+    unsigned long queries;
+} serve = { .inotify_fd = -1 };
+
+static volatile sig_atomic_t serve_stop = 0;
+
+static int socket_path(char *path, size_t size) {
+    const char *home = getenv("HOME");
+    if (!home) {
+        return -1;
+    }
+    int len = snprintf(path, size, "%s/%s", home, TILL_SERVE_SOCKET);
+    return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, SERVE_SEND_FLAGS);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* ---- Client ---- */
+
+/* Send one request line and read the reply to EOF; NULL if no daemon */
+static char *serve_request(const char *request) {
+    struct sockaddr_un addr;
+
+    if (getenv(SERVE_NO_DAEMON_ENV)) {
+        return NULL;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path(addr.sun_path, sizeof(addr.sun_path)) != 0) {
+        return NULL;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        send_all(fd, request, strlen(request)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t cap = 4096, len = 0;
+    char *reply = malloc(cap);
+    int complete = 0;
+
+    while (reply) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, TILL_SERVE_TIMEOUT_MS) <= 0) {
+            break;  /* Hung daemon - read the files instead */
+        }
+        if (len + 1 == cap) {
+            char *grown = cap < SERVE_MAX_REPLY ? realloc(reply, cap * 2) : NULL;
+            if (!grown) {
+                break;
+            }
+            reply = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, reply + len, cap - len - 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            complete = n == 0;
+            break;
+        }
+        len += (size_t)n;
+    }
+    close(fd);
+
+    if (!complete || !reply) {
+        free(reply);
+        return NULL;
+    }
+    reply[len] = '\0';
+    return reply;
+}
+
+/* Model for the given sections from the daemon */
+cJSON *till_serve_query(unsigned int sections) {
+    char request[64];
+
+    snprintf(request, sizeof(request), "status %u %d\n", sections & STATUS_ALL,
+             till_watch_stats_days());
+    char *reply = serve_request(request);
+    cJSON *model = reply ? cJSON_Parse(reply) : NULL;
+    free(reply);
+
+    if (model && !cJSON_IsObject(model)) {
+        cJSON_Delete(model);
+        model = NULL;
+    }
+    return model;
+}
+
+/* Is a daemon answering on the socket? */
+int till_serve_running(void) {
+    char *reply = serve_request("ping\n");
+    int running = reply && strncmp(reply, "pong", 4) == 0;
+    free(reply);
+    return running;
+}
+
+/* ---- Daemon ---- */
+
+static void serve_signal(int sig) {
+    (void)sig;
+    serve_stop = 1;
+}
+
+/* SIGCHLD only needs to wake poll so a finished job is reaped */
+static void serve_child(int sig) {
+    (void)sig;
+}
+
+static int watch_path(const serve_watch_t *w, char *path, size_t size) {
+    int len = w->name ? snprintf(path, size, "%s/%s", w->dir, w->name)
+                      : snprintf(path, size, "%s", w->dir);
+    return len < (int)size ? 0 : -1;
+}
+
+/* Update a watch's stat signature; returns 1 if it changed */
+static int watch_changed(serve_watch_t *w) {
+    char path[TILL_MAX_PATH];
+    struct stat st;
+
+    if (watch_path(w, path, sizeof(path)) != 0 || stat(path, &st) != 0) {
+        memset(&st, 0, sizeof(st));
+    }
+    int changed = st.st_mtime != w->mtime || st.st_size != w->size || st.st_ino != w->ino;
+    w->mtime = st.st_mtime;
+    w->size = st.st_size;
+    w->ino = st.st_ino;
+    return changed;
+}
+
+static void watch_file(const char *dir, const char *name, unsigned int sections, int discover) {
+    if (serve.count == SERVE_WATCHES) {
+        return;
+    }
+
+    serve_watch_t *w = &serve.watches[serve.count++];
+    safe_strncpy(w->dir, dir, sizeof(w->dir));
+    w->name = name;
+    w->sections = sections;
+    w->discover = discover;
+    w->wd = -1;
+    watch_changed(w);
+
+#if PLATFORM_LINUX
+    if (serve.inotify_fd >= 0) {
+        w->wd = inotify_add_watch(serve.inotify_fd, dir,
+                                  IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                  IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF);
+    }
+#endif
+}
+
+/* The files behind each section; runs from the Till directory */
+static void serve_watch_files(void) {
+    char till_dir[TILL_MAX_PATH];
+    char path[TILL_MAX_PATH];
+    const char *home = getenv("HOME");
+
+#if PLATFORM_LINUX
+    serve.inotify_fd = inotify_init();
+    if (serve.inotify_fd >= 0) {
+        fcntl(serve.inotify_fd, F_SETFD, FD_CLOEXEC);
+        fcntl(serve.inotify_fd, F_SETFL, O_NONBLOCK);
+    }
+#endif
+
+    if (get_till_dir(till_dir, sizeof(till_dir)) == 0) {
+        if (snprintf(path, sizeof(path), "%s/tekton", till_dir) < (int)sizeof(path)) {
+            watch_file(path, "till-private.json", STATUS_INSTALLATIONS | STATUS_HOLDS, 0);
+        }
+        watch_file(till_dir, "hosts-local.json", STATUS_HOSTS, 0);
+        watch_file(till_dir, "schedule.json", STATUS_SCHEDULE, 0);
+        watch_file(till_dir, TILL_FEDERATION_CONFIG, STATUS_FEDERATION, 0);
+    }
+    if (get_federation_state_dir(path, sizeof(path), "outbox") == 0) {
+        watch_file(path, NULL, STATUS_FEDERATION, 0);
+    }
+    if (home) {
+        snprintf(path, sizeof(path), "%s/%s", home, TILL_PROJECTS_BASE);
+        watch_file(path, NULL, 0, 1);
+    }
+}
+
+static void watch_triggered(serve_watch_t *w) {
+    serve.dirty |= w->sections;
+    if (w->sections & (STATUS_HOLDS | STATUS_SCHEDULE | STATUS_FEDERATION)) {
+        serve.reschedule = 1;
+    }
+    if (w->discover) {
+        serve.discover_at = time(NULL) + SERVE_DISCOVERY_DELAY;
+    }
+}
+
+#if PLATFORM_LINUX
+/* Drain inotify and mark what changed */
+static void serve_read_events(void) {
+    char buf[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+
+    while ((n = read(serve.inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            for (int i = 0; i < serve.count; i++) {
+                serve_watch_t *w = &serve.watches[i];
+                if (w->wd != ev->wd) {
+                    continue;
+                }
+                if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    w->wd = -1;  /* Directory went away - fall back to stat */
+                    watch_triggered(w);
+                } else if (!w->name || (ev->len && strcmp(ev->name, w->name) == 0)) {
+                    watch_triggered(w);
+                }
+            }
+        }
+    }
+}
+#endif
+
+static int section_index(unsigned int section) {
+    int index = 0;
+    while (section > 1) {
+        section >>= 1;
+        index++;
+    }
+    return index;
+}
+
+/* Earliest future expiry among holds */
+static time_t holds_stale_at(cJSON *holds) {
+    time_t now = time(NULL);
+    time_t stale = 0;
+    cJSON *hold;
+
+    cJSON_ArrayForEach(hold, holds) {
+        cJSON *expires = cJSON_GetObjectItem(hold, "expires_at");
+        if (cJSON_IsNumber(expires) && expires->valuedouble > now &&
+            (stale == 0 || expires->valuedouble < stale)) {
+            stale = (time_t)expires->valuedouble;
+        }
+    }
+    return stale;
+}
+
+/* Compare stat signatures of the files inotify isn't watching; 1 if any */
+static int serve_check_watches(void) {
+    int polled = 0;
+
+    for (int i = 0; i < serve.count; i++) {
+        if (serve.watches[i].wd < 0) {
+            polled = 1;
+            if (watch_changed(&serve.watches[i])) {
+                watch_triggered(&serve.watches[i]);
+            }
+        }
+    }
+    return polled;
+}
+
+/* Rebuild whatever the requested sections need */
+static void serve_refresh(unsigned int sections) {
+    serve_check_watches();
+    if (serve.holds_stale_at && time(NULL) >= serve.holds_stale_at) {
+        serve.dirty |= STATUS_HOLDS;
+    }
+
+    for (unsigned int section = STATUS_INSTALLATIONS; section & STATUS_ALL; section <<= 1) {
+        int index = section_index(section);
+        if (!(sections & section) || (serve.cache[index] && !(serve.dirty & section))) {
+            continue;
+        }
+        cJSON_Delete(serve.cache[index]);
+        serve.cache[index] = till_status_section(section, 0);
+        serve.dirty &= ~section;
+        if (section == STATUS_HOLDS) {
+            serve.holds_stale_at = holds_stale_at(serve.cache[index]);
+        }
+    }
+}
+
+static void serve_discover(void) {
+    serve.discover_at = 0;
+    till_log(LOG_INFO, "Serve: rediscovering installations");
+    discover_tektons();
+    serve.dirty |= STATUS_INSTALLATIONS | STATUS_HOLDS;
+}
+
+static char *serve_status_reply(unsigned int sections, int days) {
+    cJSON *model = cJSON_CreateObject();
+
+    serve_refresh(sections);
+    for (unsigned int section = STATUS_TILL; section & STATUS_ALL; section <<= 1) {
+        if (!(sections & section)) {
+            continue;
+        }
+        cJSON *data;
+        if (section == STATUS_TILL) {
+            data = till_status_section(STATUS_TILL, 0);  /* Cheap, and timestamped */
+            cJSON_AddNumberToObject(data, "served_by", (double)getpid());
+        } else {
+            data = cJSON_Duplicate(serve.cache[section_index(section)], 1);
+        }
+        if (data && section == STATUS_SCHEDULE) {
+            till_watch_status_live(data, days);  /* For now, and the caller's --days */
+        }
+        if (data) {
+            cJSON_AddItemToObject(model, till_status_section_key(section), data);
+        }
+    }
+
+    char *text = cJSON_PrintUnformatted(model);
+    cJSON_Delete(model);
+    return text;
+}
+
+/* Answer one connection */
+static void serve_client(int listen_fd) {
+    char request[SERVE_MAX_REQUEST];
+    size_t len = 0;
+
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    while (len < sizeof(request) - 1 && !memchr(request, '\n', len)) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, TILL_SERVE_TIMEOUT_MS) <= 0) {
+            break;
+        }
+        ssize_t n = read(fd, request + len, sizeof(request) - 1 - len);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+    request[len] = '\0';
+    request[strcspn(request, "\r\n")] = '\0';
+
+    unsigned int sections;
+    int days = TILL_SYNC_STATS_DAYS;
+    char *reply = NULL;
+    if (sscanf(request, "status %u %d", &sections, &days) >= 1) {
+        reply = serve_status_reply(sections & STATUS_ALL, days > 0 ? days : TILL_SYNC_STATS_DAYS);
+        serve.queries++;
+    } else if (strcmp(request, "ping") == 0) {
+        reply = strdup("pong\n");
+    } else if (strcmp(request, "stop") == 0) {
+        reply = strdup("ok\n");
+        serve_stop = 1;
+    } else {
+        till_log(LOG_WARN, "Serve: unknown request '%s'", request);
+    }
+
+    if (reply) {
+        send_all(fd, reply, strlen(reply));
+        free(reply);
+    }
+    close(fd);
+}
+
+static int serve_listen(const char *path) {
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    safe_strncpy(addr.sun_path, path, sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    unlink(path);  /* Stale - the caller checked nothing answers */
+    mode_t old_umask = umask(077);
+    int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    umask(old_umask);
+
+    if (!bound || listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Milliseconds until rediscovery, the next job or a stat check; -1 if none */
+static int serve_timeout(int polled) {
+    time_t now = time(NULL);
+    time_t next = serve.discover_at;
+    time_t due = till_scheduler_next_due();
+
+    if (due && (!next || due < next)) {
+        next = due;
+    }
+    if (polled && (!next || now + SERVE_POLL_SECONDS < next)) {
+        next = now + SERVE_POLL_SECONDS;
+    }
+    if (!next) {
+        return -1;
+    }
+
+    time_t wait = next - now;
+    if (wait > SERVE_MAX_SLEEP) {
+        wait = SERVE_MAX_SLEEP;
+    }
+    return wait > 0 ? (int)wait * 1000 : 0;
+}
+
+static int serve_run(void) {
+    char path[TILL_MAX_PATH];
+    char dir[TILL_MAX_PATH];
+    struct sockaddr_un addr;
+
+    if (socket_path(path, sizeof(path)) != 0 || strlen(path) >= sizeof(addr.sun_path)) {
+        till_error("Socket path too long: $HOME/%s", TILL_SERVE_SOCKET);
+        return -1;
+    }
+    if (till_serve_running()) {
+        till_error("till serve is already running (%s)", path);
+        return -1;
+    }
+
+    snprintf(dir, sizeof(dir), "%s/%s", getenv("HOME"), TILL_HOME);
+    ensure_directory(dir);
+
+    int listen_fd = serve_listen(path);
+    if (listen_fd < 0) {
+        till_error("Cannot listen on %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    /* Queries made while serving must read files, not ask ourselves */
+    setenv(SERVE_NO_DAEMON_ENV, "1", 1);
+    setenv("TILL_QUIET_DISCOVERY", "1", 1);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = serve_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = serve_child;
+    sa.sa_flags = SA_RESTART;  /* poll still returns, other reads carry on */
+    sigaction(SIGCHLD, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    serve_watch_files();
+    serve_refresh(STATUS_ALL);
+    int jobs = till_scheduler_load();
+
+    printf("Serving Till status on %s (pid %d, %s, %d job%s scheduled)\n", path,
+           (int)getpid(), serve.inotify_fd >= 0 ? "inotify" : "polling",
+           jobs, jobs == 1 ? "" : "s");
+    fflush(stdout);
+    till_log(LOG_INFO, "Serve: listening on %s", path);
+
+    int polled = serve_check_watches();
+    while (!serve_stop) {
+        struct pollfd fds[2] = {
+            { listen_fd, POLLIN, 0 },
+            { serve.inotify_fd, POLLIN, 0 }
+        };
+
+        int ready = poll(fds, serve.inotify_fd >= 0 ? 2 : 1, serve_timeout(polled));
+        if (ready < 0 && errno != EINTR) {
+            till_error("poll: %s", strerror(errno));
+            break;
+        }
+
+#if PLATFORM_LINUX
+        if (ready > 0 && (fds[1].revents & POLLIN)) {
+            serve_read_events();
+        }
+#endif
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            serve_client(listen_fd);
+        }
+        if (serve.discover_at && time(NULL) >= serve.discover_at) {
+            serve_discover();
+        }
+
+        polled = serve_check_watches();
+        if (serve.reschedule) {
+            serve.reschedule = 0;
+            till_scheduler_load();
+        }
+        serve.dirty |= till_scheduler_run();
+    }
+
+    till_scheduler_stop();
+    close(listen_fd);
+    unlink(path);
+    if (serve.inotify_fd >= 0) {
+        close(serve.inotify_fd);
+    }
+    for (int i = 0; i < SERVE_SECTIONS; i++) {
+        cJSON_Delete(serve.cache[i]);
+    }
+
+    till_log(LOG_INFO, "Serve: stopped after %lu queries", serve.queries);
+    printf("Stopped (%lu queries answered)\n", serve.queries);
+    return 0;
+}
+
+static void print_serve_help(void) {
+    printf("Till Serve - Answer status queries from memory\n\n");
+    printf("Usage: till serve [--status | --stop]\n\n");
+    printf("Runs in the foreground (use launchd/systemd/nohup to keep it running).\n");
+    printf("Hold expiries run on time while it runs; with 'till watch --scheduler\n");
+    printf("serve' so do the periodic sync and federation push.\n");
+    printf("While it runs, 'till status' and the other status commands get their\n");
+    printf("answers from it over $HOME/%s; otherwise they read the files.\n\n", TILL_SERVE_SOCKET);
+    printf("Options:\n");
+    printf("  --status   Report whether a daemon is running\n");
+    printf("  --stop     Ask the running daemon to exit\n");
+    printf("\nSet %s=1 to bypass a running daemon.\n", SERVE_NO_DAEMON_ENV);
+}
+
+/* Main serve command handler */
+int till_serve_command(int argc, char *argv[]) {
+    if (argc < 1) {
+        return serve_run();
+    }
+
+    if (strcmp(argv[0], "--help") == 0 || strcmp(argv[0], "-h") == 0) {
+        print_serve_help();
+        return 0;
+    }
+    if (strcmp(argv[0], "--status") == 0) {
+        int running = till_serve_running();
+        printf("till serve: %s\n", running ? "running" : "not running");
+        return running ? 0 : 1;
+    }
+    if (strcmp(argv[0], "--stop") == 0) {
+        char *reply = serve_request("stop\n");
+        if (!reply) {
+            printf("till serve: not running\n");
+            return 1;
+        }
+        free(reply);
+        printf("till serve: stopped\n");
+        return 0;
+    }
+
+    till_error("Unknown serve option: %s\n", argv[0]);
+    print_serve_help();
+    return -1;
+}
@@ -0,0 +1,23 @@
+/*
+ * till_serve.h - Status daemon for Till
+ *
+ * "till serve" keeps the status model in memory and answers queries on a
+ * Unix socket ($HOME/.till/serve.sock). Status commands ask it first and
+ * read the files themselves when it isn't running.
+ */
+
+#ifndef TILL_SERVE_H
+#define TILL_SERVE_H
+
+#include "cJSON.h"
+
+/* Main serve command handler */
+int till_serve_command(int argc, char *argv[]);
+
+/* Model for the given sections from the daemon, or NULL if none answers */
+cJSON *till_serve_query(unsigned int sections);
+
+/* Is a daemon answering on the socket? */
+int till_serve_running(void);
+
+#endif /* TILL_SERVE_H */
@@ -0,0 +1,30 @@
+/*
+ * till_sha256.h - SHA-256 digests for Till
+ *
+ * Used to name and verify content-addressed artifacts, such as the
+ * binaries kept by till update.
+ */
+
+#ifndef TILL_SHA256_H
+#define TILL_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TILL_SHA256_HEX 65       /* 64 hex digits + NUL */
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;             /* Bytes hashed so far */
+    unsigned char block[64];
+    size_t used;                 /* Bytes pending in block */
+} till_sha256_t;
+
+void till_sha256_init(till_sha256_t *ctx);
+void till_sha256_update(till_sha256_t *ctx, const void *data, size_t len);
+void till_sha256_final(till_sha256_t *ctx, char hex[TILL_SHA256_HEX]);
+
+/* Hash a file's contents as hex; -1 if it can't be read */
+int till_sha256_file(const char *path, char hex[TILL_SHA256_HEX]);
+
+#endif /* TILL_SHA256_H */
@@ -0,0 +1,366 @@
+/*
+ * till_snapshot.c - Binary snapshot of the installation registry
+ *
+ * The snapshot is built in memory and written to a temp file that is
+ * renamed over the old one, so a reader maps either the old image or the
+ * new, never half of one. Opening checks the header, that the sections
+ * add up to the file size, and the checksum before anything is used;
+ * after that lookups only bounds-check the offsets they follow.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "till_config.h"
+#include "till_snapshot.h"
+#include "till_hash.h"
+#include "till_platform.h"
+
+#define SNAPSHOT_MIN_SLOTS 8
+
+/* Growable string table; offset 0 holds the empty string */
+typedef struct {
+    char *data;
+    size_t used;
+    size_t capacity;
+} strtab_t;
+
+static uint32_t strtab_add(strtab_t *tab, const char *s, int *failed) {
+    if (!s || !*s) {
+        return 0;
+    }
+
+    size_t len = strlen(s) + 1;
+    if (tab->used + len > tab->capacity) {
+        size_t capacity = tab->capacity ? tab->capacity : 256;
+        while (tab->used + len > capacity) {
+            capacity *= 2;
+        }
+        char *data = realloc(tab->data, capacity);
+        if (!data) {
+            *failed = 1;
+            return 0;
+        }
+        tab->data = data;
+        tab->capacity = capacity;
+    }
+
+    uint32_t offset = (uint32_t)tab->used;
+    memcpy(tab->data + tab->used, s, len);
+    tab->used += len;
+    return offset;
+}
+
+static const char *string_member(cJSON *object, const char *key) {
+    return cJSON_GetStringValue(cJSON_GetObjectItem(object, key));
+}
+
+static double number_member(cJSON *object, const char *key) {
+    cJSON *item = cJSON_GetObjectItem(object, key);
+    return cJSON_IsNumber(item) ? item->valuedouble : 0;
+}
+
+static uint32_t slot_count_for(uint32_t count) {
+    uint32_t slots = SNAPSHOT_MIN_SLOTS;
+    while (slots < count * 2) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+/* Bytes the sections after the header take; 0 if too large */
+static uint64_t body_size(uint64_t installations, uint64_t slots, uint64_t holds, uint64_t strings) {
+    uint64_t size = installations * sizeof(till_snapshot_installation_t) +
+                    slots * sizeof(uint32_t) +
+                    holds * sizeof(till_snapshot_hold_t) + strings;
+    return size + sizeof(till_snapshot_header_t) > UINT32_MAX ? 0 : size;
+}
+
+/* Lay the registry out into a malloc'd image; NULL on failure */
+static unsigned char *build_image(cJSON *registry, const struct stat *source, size_t *size_out) {
+    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
+    cJSON *holds = cJSON_GetObjectItem(registry, "holds");
+    uint32_t inst_count = cJSON_IsObject(installations) ? (uint32_t)cJSON_GetArraySize(installations) : 0;
+    uint32_t hold_count = cJSON_IsObject(holds) ? (uint32_t)cJSON_GetArraySize(holds) : 0;
+    uint32_t slot_count = slot_count_for(inst_count);
+
+    till_snapshot_installation_t *insts = calloc(inst_count ? inst_count : 1, sizeof(*insts));
+    till_snapshot_hold_t *hold_recs = calloc(hold_count ? hold_count : 1, sizeof(*hold_recs));
+    strtab_t tab = { NULL, 0, 0 };
+    int failed = !insts || !hold_recs;
+    unsigned char *image = NULL;
+
+    /* The leading NUL is the empty string at offset 0 */
+    tab.data = failed ? NULL : malloc(256);
+    if (tab.data) {
+        tab.data[0] = '\0';
+        tab.used = 1;
+        tab.capacity = 256;
+    } else {
+        failed = 1;
+    }
+
+    uint32_t n = 0;
+    cJSON *item = NULL;
+    if (inst_count) {
+        cJSON_ArrayForEach(item, installations) {
+            if (failed || n == inst_count) break;
+            till_snapshot_installation_t *rec = &insts[n++];
+            rec->name = strtab_add(&tab, item->string, &failed);
+            rec->root = strtab_add(&tab, string_member(item, "root"), &failed);
+            rec->main_root = strtab_add(&tab, string_member(item, "main_root"), &failed);
+            rec->mode = strtab_add(&tab, string_member(item, "mode"), &failed);
+            rec->port_base = (int32_t)number_member(item, "port_base");
+            rec->ai_port_base = (int32_t)number_member(item, "ai_port_base");
+            rec->hash = till_hash_string(item->string ? item->string : "");
+        }
+    }
+
+    n = 0;
+    if (hold_count) {
+        cJSON_ArrayForEach(item, holds) {
+            if (failed || n == hold_count) break;
+            till_snapshot_hold_t *rec = &hold_recs[n++];
+            rec->component = strtab_add(&tab, item->string, &failed);
+            rec->reason = strtab_add(&tab, string_member(item, "reason"), &failed);
+            rec->held_by = strtab_add(&tab, string_member(item, "held_by"), &failed);
+            rec->held_at = (int64_t)number_member(item, "held_at");
+            rec->expires_at = (int64_t)number_member(item, "expires_at");
+        }
+    }
+
+    till_snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.last_discovery = strtab_add(&tab, string_member(registry, "last_discovery"), &failed);
+
+    uint64_t body = failed ? 0 : body_size(inst_count, slot_count, hold_count, tab.used);
+    if (body > 0) {
+        image = calloc(1, sizeof(header) + body);
+    }
+
+    if (image) {
+        memcpy(header.magic, TILL_SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = TILL_SNAPSHOT_VERSION;
+        header.header_size = sizeof(header);
+        header.source_size = (uint64_t)source->st_size;
+        int64_t mtime = platform_stat_mtime_ns(source);
+        header.source_mtime = mtime / 1000000000;
+        header.source_mtime_nsec = mtime % 1000000000;
+        header.source_ino = (uint64_t)source->st_ino;
+        header.size = (uint32_t)(sizeof(header) + body);
+        header.installation_count = inst_count;
+        header.slot_count = slot_count;
+        header.hold_count = hold_count;
+        header.strings_size = (uint32_t)tab.used;
+
+        unsigned char *p = image + sizeof(header);
+        memcpy(p, insts, inst_count * sizeof(*insts));
+        p += inst_count * sizeof(*insts);
+
+        /* Linear probing; the first of a repeated name wins, as in cJSON */
+        uint32_t *slots = (uint32_t *)p;
+        for (uint32_t i = 0; i < inst_count; i++) {
+            uint32_t s = insts[i].hash & (slot_count - 1);
+            while (slots[s]) {
+                s = (s + 1) & (slot_count - 1);
+            }
+            slots[s] = i + 1;
+        }
+        p += slot_count * sizeof(uint32_t);
+
+        memcpy(p, hold_recs, hold_count * sizeof(*hold_recs));
+        p += hold_count * sizeof(*hold_recs);
+        memcpy(p, tab.data, tab.used);
+
+        header.checksum = till_hash_bytes(image + sizeof(header), body, TILL_HASH_SEED);
+        memcpy(image, &header, sizeof(header));
+        *size_out = header.size;
+    }
+
+    free(insts);
+    free(hold_recs);
+    free(tab.data);
+    return image;
+}
+
+int till_snapshot_write(const char *path, cJSON *registry, const struct stat *source) {
+    if (!path || !registry || !source) {
+        return -1;
+    }
+
+    size_t size = 0;
+    unsigned char *image = build_image(registry, source, &size);
+    if (!image) {
+        return -1;
+    }
+
+    char temp_path[TILL_MAX_PATH];
+    snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", path);
+    int fd = mkstemp(temp_path);
+    if (fd == -1) {
+        free(image);
+        return -1;
+    }
+
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(fd, image + written, size - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += (size_t)n;
+    }
+    free(image);
+
+    if (close(fd) != 0 || written != size || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static int source_matches(const till_snapshot_header_t *header, const struct stat *source) {
+    int64_t mtime = platform_stat_mtime_ns(source);
+    return header->source_size == (uint64_t)source->st_size &&
+           header->source_mtime == mtime / 1000000000 &&
+           header->source_mtime_nsec == mtime % 1000000000 &&
+           header->source_ino == (uint64_t)source->st_ino;
+}
+
+static int validate(till_snapshot_t *snap, const struct stat *source) {
+    const till_snapshot_header_t *header = snap->map;
+
+    if (snap->size < sizeof(*header) ||
+        memcmp(header->magic, TILL_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != TILL_SNAPSHOT_VERSION ||
+        header->header_size != sizeof(*header) ||
+        header->size != snap->size) {
+        return -1;
+    }
+    if (source && !source_matches(header, source)) {
+        return -1;
+    }
+
+    uint32_t slots = header->slot_count;
+    uint64_t body = body_size(header->installation_count, slots, header->hold_count,
+                              header->strings_size);
+    if (slots == 0 || (slots & (slots - 1)) != 0 || header->strings_size == 0 ||
+        body == 0 || sizeof(*header) + body != snap->size) {
+        return -1;
+    }
+
+    const unsigned char *p = (const unsigned char *)snap->map + sizeof(*header);
+    if (till_hash_bytes(p, body, TILL_HASH_SEED) != header->checksum) {
+        return -1;
+    }
+
+    snap->header = header;
+    snap->installations = (const till_snapshot_installation_t *)p;
+    p += header->installation_count * sizeof(till_snapshot_installation_t);
+    snap->slots = (const uint32_t *)p;
+    p += slots * sizeof(uint32_t);
+    snap->holds = (const till_snapshot_hold_t *)p;
+    p += header->hold_count * sizeof(till_snapshot_hold_t);
+    snap->strings = (const char *)p;
+
+    /* Every offset then reads a terminated string */
+    if (snap->strings[0] != '\0' || snap->strings[header->strings_size - 1] != '\0') {
+        return -1;
+    }
+    return 0;
+}
+
+int till_snapshot_open(till_snapshot_t *snap, const char *path, const struct stat *source) {
+    memset(snap, 0, sizeof(*snap));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(till_snapshot_header_t) ||
+        (uint64_t)st.st_size > UINT32_MAX) {
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    snap->map = map;
+    snap->size = (size_t)st.st_size;
+    if (validate(snap, source) != 0) {
+        till_snapshot_close(snap);
+        return -1;
+    }
+    return 0;
+}
+
+void till_snapshot_close(till_snapshot_t *snap) {
+    if (snap->map) {
+        munmap(snap->map, snap->size);
+    }
+    memset(snap, 0, sizeof(*snap));
+}
+
+const char *till_snapshot_string(const till_snapshot_t *snap, uint32_t offset) {
+    if (!snap->header || offset >= snap->header->strings_size) {
+        return "";
+    }
+    return snap->strings + offset;
+}
+
+const till_snapshot_installation_t *till_snapshot_installation(const till_snapshot_t *snap,
+                                                               const char *name) {
+    if (!snap->header || !name) {
+        return NULL;
+    }
+
+    uint32_t count = snap->header->installation_count;
+    uint32_t mask = snap->header->slot_count - 1;
+    uint32_t hash = till_hash_string(name);
+
+    for (uint32_t probe = 0, s = hash & mask; probe <= mask; probe++, s = (s + 1) & mask) {
+        uint32_t slot = snap->slots[s];
+        if (slot == 0 || slot > count) {
+            return NULL;
+        }
+        const till_snapshot_installation_t *inst = &snap->installations[slot - 1];
+        if (inst->hash == hash && strcmp(till_snapshot_string(snap, inst->name), name) == 0) {
+            return inst;
+        }
+    }
+    return NULL;
+}
+
+static int same_nocase(const char *a, const char *b) {
+    for (; *a && tolower((unsigned char)*a) == tolower((unsigned char)*b); a++, b++) {
+    }
+    return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+const till_snapshot_hold_t *till_snapshot_hold(const till_snapshot_t *snap, const char *component) {
+    if (!snap->header || !component) {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < snap->header->hold_count; i++) {
+        if (same_nocase(till_snapshot_string(snap, snap->holds[i].component), component)) {
+            return &snap->holds[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,92 @@
+/*
+ * till_snapshot.h - Binary snapshot of the installation registry
+ *
+ * till-private.json stays the registry people read and edit. Every save
+ * also writes a snapshot beside it: a flat image of the installations,
+ * holds and last discovery time that is mapped and read in place, with no
+ * parsing. The snapshot records the stat signature (size, mtime, inode) of
+ * the JSON it was built from, so after a hand edit it no longer matches
+ * and is rebuilt from the JSON.
+ *
+ * Layout, all in host byte order: header, installation records, a hash
+ * slot table over installation names, hold records, then a string table.
+ * Strings are offsets into the table; offset 0 is the empty string.
+ */
+
+#ifndef TILL_SNAPSHOT_H
+#define TILL_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include "cJSON.h"
+
+typedef struct {
+    char magic[8];               /* TILL_SNAPSHOT_MAGIC */
+    uint32_t version;            /* TILL_SNAPSHOT_VERSION */
+    uint32_t header_size;
+    uint64_t source_size;        /* Stat signature of the JSON */
+    int64_t source_mtime;
+    int64_t source_mtime_nsec;
+    uint64_t source_ino;
+    uint32_t size;               /* Whole file */
+    uint32_t checksum;           /* FNV-1a of everything after the header */
+    uint32_t installation_count;
+    uint32_t slot_count;         /* Power of two */
+    uint32_t hold_count;
+    uint32_t strings_size;
+    uint32_t last_discovery;     /* String */
+    uint32_t reserved;
+} till_snapshot_header_t;
+
+typedef struct {
+    uint32_t name;               /* Strings */
+    uint32_t root;
+    uint32_t main_root;
+    uint32_t mode;
+    int32_t port_base;
+    int32_t ai_port_base;
+    uint32_t hash;               /* till_hash_string(name) */
+    uint32_t reserved;
+} till_snapshot_installation_t;
+
+typedef struct {
+    uint32_t component;          /* Strings */
+    uint32_t reason;
+    uint32_t held_by;
+    uint32_t reserved;
+    int64_t held_at;
+    int64_t expires_at;          /* 0 = never */
+} till_snapshot_hold_t;
+
+/* A mapped snapshot; installations and holds are in registry order */
+typedef struct {
+    void *map;
+    size_t size;
+    const till_snapshot_header_t *header;
+    const till_snapshot_installation_t *installations;
+    const uint32_t *slots;       /* Installation index + 1, 0 = empty */
+    const till_snapshot_hold_t *holds;
+    const char *strings;
+} till_snapshot_t;
+
+/* Write a snapshot of registry to path, recording source as the JSON
+ * it stands for. Replaces any existing snapshot atomically */
+int till_snapshot_write(const char *path, cJSON *registry, const struct stat *source);
+
+/* Map the snapshot at path. -1 if it is missing, damaged, from another
+ * version, or (when source is given) built from a different JSON */
+int till_snapshot_open(till_snapshot_t *snap, const char *path, const struct stat *source);
+void till_snapshot_close(till_snapshot_t *snap);
+
+/* String at offset, "" if out of range */
+const char *till_snapshot_string(const till_snapshot_t *snap, uint32_t offset);
+
+/* Installation by exact name, NULL if missing */
+const till_snapshot_installation_t *till_snapshot_installation(const till_snapshot_t *snap,
+                                                               const char *name);
+
+/* Hold by component, case-insensitive like the JSON lookup; NULL if none */
+const till_snapshot_hold_t *till_snapshot_hold(const till_snapshot_t *snap, const char *component);
+
+#endif /* TILL_SNAPSHOT_H */
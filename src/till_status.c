@@ -0,0 +1,333 @@
+/*
+ * till_status.c - Status model and machine-readable output for Till
+ *
+ * Each section of the model comes from the module that owns the state
+ * (holds, hosts, schedule, federation); installations and Till itself
+ * are gathered here. Collection reads every file once, so one
+ * "till status --json" over SSH returns everything a dashboard needs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "till_config.h"
+#include "till_common.h"
+#include "till_hold.h"
+#include "till_status.h"
+#include "till_serve.h"
+#include "cJSON.h"
+
+extern int check_till_updates(int quiet_mode);
+
+till_output_t g_output = TILL_OUTPUT_TEXT;
+
+/* Model layout: key, JSONL record type for each element, source */
+typedef struct {
+    unsigned int section;
+    const char *key;
+    const char *record;
+} status_section_t;
+
+static const status_section_t status_sections[] = {
+    {STATUS_TILL,          "till",          "till"},
+    {STATUS_INSTALLATIONS, "installations", "installation"},
+    {STATUS_HOLDS,         "holds",         "hold"},
+    {STATUS_HOSTS,         "hosts",         "host"},
+    {STATUS_SCHEDULE,      "schedule",      "schedule"},
+    {STATUS_FEDERATION,    "federation",    "federation"},
+    {0, NULL, NULL}
+};
+
+int till_output_flag(const char *arg) {
+    return strcmp(arg, "--json") == 0 || strcmp(arg, "--jsonl") == 0;
+}
+
+/* Remove --json/--jsonl from argv, setting g_output */
+int till_output_parse(int argc, char *argv[]) {
+    int kept = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            g_output = TILL_OUTPUT_JSON;
+        } else if (strcmp(argv[i], "--jsonl") == 0) {
+            g_output = TILL_OUTPUT_JSONL;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    if (kept < argc) {
+        argv[kept] = NULL;
+    }
+    return kept;
+}
+
+static cJSON *till_model(int check_updates) {
+    char hostname[256] = "";
+    char dir[TILL_MAX_PATH] = "";
+
+    cJSON *till = cJSON_CreateObject();
+    cJSON_AddStringToObject(till, "version", TILL_VERSION);
+    cJSON_AddStringToObject(till, "config_version", TILL_CONFIG_VERSION);
+    cJSON_AddStringToObject(till, "platform", PLATFORM_NAME);
+    gethostname(hostname, sizeof(hostname) - 1);
+    cJSON_AddStringToObject(till, "hostname", hostname);
+    if (getcwd(dir, sizeof(dir)) != NULL) {
+        cJSON_AddStringToObject(till, "directory", dir);  /* main() runs from the Till dir */
+    }
+    cJSON_AddNumberToObject(till, "generated_at", (double)time(NULL));
+    if (check_updates) {
+        cJSON_AddNumberToObject(till, "updates_behind", check_till_updates(1));
+    }
+    return till;
+}
+
+/* Registered installations, as stored, plus name and hold state */
+cJSON *till_installations_model(int check_updates) {
+    cJSON *list = cJSON_CreateArray();
+    cJSON *registry = load_till_json("tekton/till-private.json");
+    cJSON *installations = cJSON_GetObjectItem(registry, "installations");
+    cJSON *inst;
+
+    cJSON_ArrayForEach(inst, installations) {
+        const char *root = json_get_string(inst, "root", NULL);
+        cJSON *item = cJSON_Duplicate(inst, 1);
+        if (!item || !inst->string) {
+            cJSON_Delete(item);
+            continue;
+        }
+        cJSON_AddStringToObject(item, "name", inst->string);
+        cJSON_AddBoolToObject(item, "held", is_component_held(inst->string));
+
+        if (check_updates && root) {
+            char output[256];
+            if (run_command_capture(output, sizeof(output),
+                                    "cd \"%s\" && git status --porcelain 2>/dev/null | wc -l",
+                                    root) == 0) {
+                cJSON_AddNumberToObject(item, "local_changes", atoi(output));
+            }
+            if (run_command_capture(output, sizeof(output),
+                                    "cd \"%s\" && git fetch --quiet && git rev-list HEAD..origin/main --count 2>/dev/null",
+                                    root) == 0) {
+                cJSON_AddNumberToObject(item, "updates_behind", atoi(output));
+            }
+        }
+        cJSON_AddItemToArray(list, item);
+    }
+
+    cJSON_Delete(registry);
+    return list;
+}
+
+/* Build one section from the files on disk */
+cJSON *till_status_section(unsigned int section, int check_updates) {
+    switch (section) {
+        case STATUS_TILL:          return till_model(check_updates);
+        case STATUS_INSTALLATIONS: return till_installations_model(check_updates);
+        case STATUS_HOLDS:         return hold_status_model();
+        case STATUS_HOSTS:         return till_host_status_model(NULL);
+        case STATUS_SCHEDULE:      return till_watch_status_model();
+        case STATUS_FEDERATION:    return till_federate_status_model();
+    }
+    return NULL;
+}
+
+/* Model key of a section */
+const char *till_status_section_key(unsigned int section) {
+    for (const status_section_t *s = status_sections; s->key; s++) {
+        if (s->section == section) {
+            return s->key;
+        }
+    }
+    return NULL;
+}
+
+/* Build the model for the given sections - from a running "till serve"
+ * if there is one, else from the files */
+cJSON *till_status_collect(unsigned int sections) {
+    int check_updates = (sections & STATUS_CHECK_UPDATES) != 0;
+
+    if (!check_updates) {
+        cJSON *served = till_serve_query(sections);
+        if (served) {
+            return served;
+        }
+    }
+
+    cJSON *model = cJSON_CreateObject();
+    for (const status_section_t *s = status_sections; s->key; s++) {
+        if (sections & s->section) {
+            cJSON *data = till_status_section(s->section, check_updates);
+            if (data) {
+                cJSON_AddItemToObject(model, s->key, data);
+            }
+        }
+    }
+    return model;
+}
+
+/* One JSONL record: {"type": ..., fields...} */
+static void print_record(const char *type, cJSON *data) {
+    cJSON *record = cJSON_CreateObject();
+    cJSON_AddStringToObject(record, "type", type);
+
+    if (cJSON_IsObject(data)) {
+        cJSON *field;
+        cJSON_ArrayForEach(field, data) {
+            cJSON_AddItemToObject(record, field->string, cJSON_Duplicate(field, 1));
+        }
+    } else {
+        cJSON_AddItemToObject(record, "value", cJSON_Duplicate(data, 1));
+    }
+
+    char *line = cJSON_PrintUnformatted(record);
+    if (line) {
+        printf("%s\n", line);
+        free(line);
+    }
+    cJSON_Delete(record);
+}
+
+static void print_time(const char *label, cJSON *value) {
+    if (cJSON_IsNumber(value) && value->valuedouble > 0) {
+        char buf[64];
+        time_t t = (time_t)value->valuedouble;
+        strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&t));
+        printf("%s%s", label, buf);
+    } else if (cJSON_IsString(value)) {
+        printf("%s%s", label, value->valuestring);
+    }
+}
+
+/* Human summary of a full model */
+static void print_text(cJSON *model) {
+    cJSON *item;
+    cJSON *till = cJSON_GetObjectItem(model, "till");
+    cJSON *installations = cJSON_GetObjectItem(model, "installations");
+    cJSON *holds = cJSON_GetObjectItem(model, "holds");
+    cJSON *hosts = cJSON_GetObjectItem(model, "hosts");
+    cJSON *schedule = cJSON_GetObjectItem(model, "schedule");
+    cJSON *federation = cJSON_GetObjectItem(model, "federation");
+
+    printf("Till Status\n");
+    printf("===========\n");
+    if (till) {
+        printf("Version: %s\n", json_get_string(till, "version", ""));
+        printf("Platform: %s\n", json_get_string(till, "platform", ""));
+        printf("Config: %s\n", json_get_string(till, "config_version", ""));
+        printf("Host: %s\n", json_get_string(till, "hostname", ""));
+    }
+
+    if (installations) {
+        printf("\nInstallations (%d):\n", cJSON_GetArraySize(installations));
+        cJSON_ArrayForEach(item, installations) {
+            printf("  %-20s %s%s\n", json_get_string(item, "name", ""),
+                   json_get_string(item, "root", ""),
+                   json_get_bool(item, "held", 0) ? "  [held]" : "");
+        }
+    }
+
+    if (holds) {
+        printf("\nHolds (%d):\n", cJSON_GetArraySize(holds));
+        cJSON_ArrayForEach(item, holds) {
+            printf("  %-20s", json_get_string(item, "component", ""));
+            print_time(" until ", cJSON_GetObjectItem(item, "expires_at"));
+            printf("%s\n", json_get_bool(item, "expired", 0) ? " [EXPIRED]" : "");
+        }
+    }
+
+    if (hosts) {
+        printf("\nHosts (%d):\n", cJSON_GetArraySize(hosts));
+        cJSON_ArrayForEach(item, hosts) {
+            printf("  %-20s %s@%-25s %s\n", json_get_string(item, "name", ""),
+                   json_get_string(item, "user", ""), json_get_string(item, "host", ""),
+                   json_get_string(item, "status", ""));
+        }
+    }
+
+    if (schedule) {
+        printf("\nSync Schedule: %s", json_get_bool(schedule, "enabled", 0) ? "enabled" : "disabled");
+        print_time(", next ", cJSON_GetObjectItem(schedule, "next_run"));
+        print_time(", last ", cJSON_GetObjectItem(schedule, "last_run"));
+        const char *last_status = json_get_string(schedule, "last_status", NULL);
+        if (last_status) {
+            printf(" (%s)", last_status);
+        }
+        printf("\n");
+    }
+
+    if (federation) {
+        if (json_get_bool(federation, "joined", 0)) {
+            printf("\nFederation: %s as %s", json_get_string(federation, "trust_level", ""),
+                   json_get_string(federation, "site_id", ""));
+            print_time(", last sync ", cJSON_GetObjectItem(federation, "last_sync"));
+            int pending = json_get_int(federation, "outbox_pending", 0);
+            if (pending > 0) {
+                printf(", %d queued", pending);
+            }
+            printf("\n");
+        } else {
+            printf("\nFederation: not joined\n");
+        }
+    }
+}
+
+/* Print a model in the current output format */
+int till_status_emit(cJSON *model) {
+    if (!model) {
+        return -1;
+    }
+
+    if (g_output == TILL_OUTPUT_JSON) {
+        char *text = cJSON_Print(model);
+        if (!text) {
+            return -1;
+        }
+        printf("%s\n", text);
+        free(text);
+    } else if (g_output == TILL_OUTPUT_JSONL) {
+        for (const status_section_t *s = status_sections; s->key; s++) {
+            cJSON *data = cJSON_GetObjectItem(model, s->key);
+            cJSON *element;
+            if (cJSON_IsArray(data)) {
+                cJSON_ArrayForEach(element, data) {
+                    print_record(s->record, element);
+                }
+            } else if (data) {
+                print_record(s->record, data);
+            }
+        }
+    } else {
+        print_text(model);
+    }
+    fflush(stdout);
+    return 0;
+}
+
+/* Collect and print the given sections */
+int till_status_show(unsigned int sections) {
+    cJSON *model = till_status_collect(sections);
+    int result = till_status_emit(model);
+    cJSON_Delete(model);
+    return result;
+}
+
+/* Print one section's data (takes ownership) */
+int till_status_emit_section(unsigned int section, cJSON *data) {
+    cJSON *model = cJSON_CreateObject();
+
+    for (const status_section_t *s = status_sections; s->key; s++) {
+        if (s->section == section) {
+            cJSON_AddItemToObject(model, s->key, data);
+            data = NULL;
+            break;
+        }
+    }
+    cJSON_Delete(data);  /* Unknown section */
+
+    int result = till_status_emit(model);
+    cJSON_Delete(model);
+    return result;
+}
@@ -0,0 +1,68 @@
+/*
+ * till_status.h - Status model and machine-readable output for Till
+ *
+ * Status commands build one cJSON model and render it as text, as one
+ * JSON document (--json), or as one JSON record per line (--jsonl),
+ * each record tagged with a "type".
+ */
+
+#ifndef TILL_STATUS_H
+#define TILL_STATUS_H
+
+#include "cJSON.h"
+
+/* Output formats */
+typedef enum {
+    TILL_OUTPUT_TEXT = 0,
+    TILL_OUTPUT_JSON,
+    TILL_OUTPUT_JSONL
+} till_output_t;
+
+extern till_output_t g_output;
+
+/* Model sections */
+#define STATUS_TILL            0x01
+#define STATUS_INSTALLATIONS   0x02
+#define STATUS_HOLDS           0x04
+#define STATUS_HOSTS           0x08
+#define STATUS_SCHEDULE        0x10
+#define STATUS_FEDERATION      0x20
+#define STATUS_ALL             0x3f
+#define STATUS_CHECK_UPDATES   0x100  /* Fetch to count commits behind (slow) */
+
+/* Remove --json/--jsonl from argv, setting g_output; returns the new argc */
+int till_output_parse(int argc, char *argv[]);
+
+/* Is this argument an output format flag? */
+int till_output_flag(const char *arg);
+
+/* Build the model for the given sections (served by "till serve" when running) */
+cJSON *till_status_collect(unsigned int sections);
+
+/* Build one section from the files on disk */
+cJSON *till_status_section(unsigned int section, int check_updates);
+
+/* Model key of a section ("hosts", ...) */
+const char *till_status_section_key(unsigned int section);
+
+/* Collect and print the given sections in the current output format */
+int till_status_show(unsigned int sections);
+
+/* Print a model in the current output format */
+int till_status_emit(cJSON *model);
+
+/* Print one section's data (takes ownership) in the current output format */
+int till_status_emit_section(unsigned int section, cJSON *data);
+
+/* Section data, provided by the modules that own the state */
+cJSON *till_installations_model(int check_updates);
+cJSON *hold_status_model(void);
+cJSON *till_host_status_model(const char *name);
+cJSON *till_watch_status_model(void);
+/* Schedule fields that go stale with no file changing: the load average
+ * and the sync statistics over the last days (till watch --days) */
+void till_watch_status_live(cJSON *sync, int days);
+int till_watch_stats_days(void);
+cJSON *till_federate_status_model(void);
+
+#endif /* TILL_STATUS_H */
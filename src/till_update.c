@@ -0,0 +1,744 @@
+/*
+ * till_update.c - Self-update for Till
+ *
+ * An update never leaves a host without a working till: the new binary
+ * is built (or found already built for that commit), verified by hash
+ * and by running it, copied into its own directory, and only then made
+ * current by renaming a symlink over the old one. Rolling back is the
+ * same flip in the other direction.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include "till_config.h"
+#include "till_common.h"
+#include "till_security.h"
+#include "till_sha256.h"
+#include "till_update.h"
+#include "cJSON.h"
+
+#define MANIFEST_FILE "manifest.json"
+#define BINARY_FILE "till"
+
+extern int get_till_parent_dir(char *parent_dir, size_t size);
+
+/* $HOME/.till/versions[/name[/file]] */
+static int versions_path(char *path, size_t size, const char *name, const char *file) {
+    const char *home = getenv("HOME");
+    if (!home) {
+        return -1;
+    }
+    int len = snprintf(path, size, "%s/%s%s%s%s%s", home, TILL_VERSIONS_DIR,
+                       name ? "/" : "", name ? name : "",
+                       file ? "/" : "", file ? file : "");
+    return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+/* The git checkout till is built from */
+static int source_dir(char *path, size_t size) {
+    if (get_till_parent_dir(path, size) != 0) {
+        return -1;
+    }
+    size_t len = strlen(path);
+    snprintf(path + len, size - len, "/till");
+    return is_directory(path) ? 0 : -1;
+}
+
+/* Builds only run where they were built: platform and machine */
+static void platform_key(char *key, size_t size) {
+    struct utsname uts;
+    if (uname(&uts) == 0) {
+        snprintf(key, size, "%s-%s", PLATFORM_NAME, uts.machine);
+    } else {
+        snprintf(key, size, "%s", PLATFORM_NAME);
+    }
+}
+
+static int git_head(const char *dir, char *commit, size_t size) {
+    if (run_command_capture(commit, size, "cd \"%s\" && git rev-parse HEAD 2>/dev/null", dir) != 0) {
+        return -1;
+    }
+    commit[strcspn(commit, "\r\n")] = '\0';
+    return strlen(commit) == 40 ? 0 : -1;
+}
+
+static int is_version_name(const char *name) {
+    if (strlen(name) != TILL_SHA256_HEX - 1) {
+        return 0;
+    }
+    return strspn(name, "0123456789abcdef") == TILL_SHA256_HEX - 1;
+}
+
+/* Run a binary's --version; fills version ("x.y.z") when it answers */
+static int verify_binary(const char *path, char *version, size_t size) {
+    char output[256];
+    const char *prefix = "Till version ";
+
+    if (run_command_capture(output, sizeof(output), "\"%s\" --version 2>/dev/null", path) != 0 ||
+        strncmp(output, prefix, strlen(prefix)) != 0) {
+        return -1;
+    }
+    safe_strncpy(version, output + strlen(prefix), size);
+    version[strcspn(version, "\r\n")] = '\0';
+    return 0;
+}
+
+/* Copy through a temp file and rename, so dest is never partial */
+static int install_file(const char *src, const char *dest, mode_t mode) {
+    char tmp[TILL_MAX_PATH];
+    char buf[65536];
+    size_t n;
+    int ok = 1;
+
+    snprintf(tmp, sizeof(tmp), "%s.new-%d", dest, (int)getpid());
+    FILE *in = fopen(src, "rb");
+    if (!in) {
+        return -1;
+    }
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fd < 0) {
+        fclose(in);
+        return -1;
+    }
+
+    while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        for (size_t done = 0; done < n; ) {
+            ssize_t w = write(fd, buf + done, n - done);
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            if (w <= 0) {
+                ok = 0;
+                break;
+            }
+            done += (size_t)w;
+        }
+    }
+    if (ferror(in) || fsync(fd) != 0) {
+        ok = 0;
+    }
+    fclose(in);
+    if (close(fd) != 0) {
+        ok = 0;
+    }
+
+    if (ok && chmod(tmp, mode) == 0 && rename(tmp, dest) == 0) {
+        return 0;
+    }
+    unlink(tmp);
+    return -1;
+}
+
+/* Point link_path at target in one rename - never missing, never partial */
+static int flip_symlink(const char *target, const char *link_path) {
+    char tmp[TILL_MAX_PATH];
+
+    snprintf(tmp, sizeof(tmp), "%s.new-%d", link_path, (int)getpid());
+    unlink(tmp);
+    if (symlink(target, tmp) != 0) {
+        return -1;
+    }
+    if (rename(tmp, link_path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/* Version a store link ("current", "previous") points at */
+static int read_version_link(const char *name, char sha[TILL_SHA256_HEX]) {
+    char path[TILL_MAX_PATH];
+
+    if (versions_path(path, sizeof(path), name, NULL) != 0) {
+        return -1;
+    }
+    ssize_t len = readlink(path, sha, TILL_SHA256_HEX - 1);
+    if (len < 0) {
+        return -1;
+    }
+    sha[len] = '\0';
+    return is_version_name(sha) ? 0 : -1;
+}
+
+/* Does the stored binary still hash to its name? */
+static int version_intact(const char *sha) {
+    char path[TILL_MAX_PATH];
+    char check[TILL_SHA256_HEX];
+
+    return versions_path(path, sizeof(path), sha, BINARY_FILE) == 0 &&
+           till_sha256_file(path, check) == 0 && strcmp(check, sha) == 0;
+}
+
+/* Add a binary to the store; sha receives its name */
+static int store_version(const char *binary, const char *commit, char sha[TILL_SHA256_HEX]) {
+    char path[TILL_MAX_PATH];
+    char platform[128];
+    char version[64];
+
+    if (till_sha256_file(binary, sha) != 0) {
+        till_error("Cannot read %s", binary);
+        return -1;
+    }
+
+    if (versions_path(path, sizeof(path), NULL, NULL) != 0 || ensure_directory(path) != 0 ||
+        versions_path(path, sizeof(path), sha, NULL) != 0 || ensure_directory(path) != 0) {
+        till_error("Cannot create version directory for %.12s", sha);
+        return -1;
+    }
+
+    /* Content-addressed: an intact copy is already this build */
+    versions_path(path, sizeof(path), sha, BINARY_FILE);
+    if (!version_intact(sha) &&
+        (install_file(binary, path, 0755) != 0 || !version_intact(sha))) {
+        till_error("Failed to store build %.12s", sha);
+        return -1;
+    }
+    if (verify_binary(path, version, sizeof(version)) != 0) {
+        till_error("Build %.12s does not run", sha);
+        return -1;
+    }
+
+    platform_key(platform, sizeof(platform));
+    cJSON *manifest = cJSON_CreateObject();
+    cJSON_AddStringToObject(manifest, "sha256", sha);
+    cJSON_AddStringToObject(manifest, "commit", commit ? commit : "");
+    cJSON_AddStringToObject(manifest, "version", version);
+    cJSON_AddStringToObject(manifest, "platform", platform);
+    cJSON_AddNumberToObject(manifest, "stored_at", (double)time(NULL));
+
+    versions_path(path, sizeof(path), sha, MANIFEST_FILE);
+    int result = save_json_file(path, manifest);
+    cJSON_Delete(manifest);
+    return result;
+}
+
+static cJSON *load_manifest(const char *sha) {
+    char path[TILL_MAX_PATH];
+
+    if (versions_path(path, sizeof(path), sha, MANIFEST_FILE) != 0) {
+        return NULL;
+    }
+    return path_exists(path) ? load_json_file(path) : NULL;
+}
+
+/* An intact stored build of commit for this platform */
+static int find_version(const char *commit, char sha[TILL_SHA256_HEX]) {
+    char path[TILL_MAX_PATH];
+    char platform[128];
+    struct dirent *entry;
+    int found = -1;
+
+    if (versions_path(path, sizeof(path), NULL, NULL) != 0) {
+        return -1;
+    }
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return -1;
+    }
+
+    platform_key(platform, sizeof(platform));
+    while (found != 0 && (entry = readdir(dir)) != NULL) {
+        if (!is_version_name(entry->d_name)) {
+            continue;
+        }
+        cJSON *manifest = load_manifest(entry->d_name);
+        if (manifest &&
+            strcmp(json_get_string(manifest, "commit", ""), commit) == 0 &&
+            strcmp(json_get_string(manifest, "platform", ""), platform) == 0 &&
+            version_intact(entry->d_name)) {
+            safe_strncpy(sha, entry->d_name, TILL_SHA256_HEX);
+            found = 0;
+        }
+        cJSON_Delete(manifest);
+    }
+    closedir(dir);
+    return found;
+}
+
+/* Make an installed till a link through "current" (only where one exists,
+ * unless it is the explicit path from make install) */
+static void link_installed(const char *path, int create) {
+    char target[TILL_MAX_PATH];
+    char dir[TILL_MAX_PATH];
+    struct stat st;
+
+    if (versions_path(target, sizeof(target), "current", BINARY_FILE) != 0 ||
+        (!create && lstat(path, &st) != 0) || symlink_points_to(path, target)) {
+        return;
+    }
+
+    safe_strncpy(dir, path, sizeof(dir));
+    char *slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+    }
+    if (access(dir, W_OK) != 0 || flip_symlink(target, path) != 0) {
+        till_warn("Could not link %s to %s", path, target);
+        return;
+    }
+    till_log(LOG_INFO, "Linked %s -> %s", path, target);
+}
+
+/* Make sha current, the old current previous, and bring links along */
+static int activate_version(const char *sha, const char *link_path) {
+    char path[TILL_MAX_PATH];
+    char current[TILL_SHA256_HEX] = "";
+    char check[TILL_SHA256_HEX];
+    const char *home = getenv("HOME");
+
+    if (read_version_link("current", current) == 0 && strcmp(current, sha) != 0) {
+        versions_path(path, sizeof(path), "previous", NULL);
+        if (flip_symlink(current, path) != 0) {
+            till_warn("Could not record previous version %.12s", current);
+        }
+    }
+
+    versions_path(path, sizeof(path), "current", NULL);
+    if (flip_symlink(sha, path) != 0) {
+        till_error("Could not switch to version %.12s: %s", sha, strerror(errno));
+        return -1;
+    }
+
+    if (link_path) {
+        link_installed(link_path, 1);
+    }
+    link_installed("/usr/local/bin/till", 0);
+    if (home) {
+        snprintf(path, sizeof(path), "%s/.local/bin/till", home);
+        link_installed(path, 0);
+    }
+
+    /* The checkout's till stays a plain file (make writes it) with current's contents */
+    char source[TILL_MAX_PATH];
+    if (source_dir(source, sizeof(source)) == 0) {
+        strncat(source, "/" BINARY_FILE, sizeof(source) - strlen(source) - 1);
+        if (till_sha256_file(source, check) != 0 || strcmp(check, sha) != 0) {
+            versions_path(path, sizeof(path), sha, BINARY_FILE);
+            if (install_file(path, source, 0755) != 0) {
+                till_warn("Could not refresh %s", source);
+            }
+        }
+    }
+
+    till_log(LOG_INFO, "Activated version %s", sha);
+    return 0;
+}
+
+static void remove_version(const char *sha) {
+    char path[TILL_MAX_PATH];
+
+    versions_path(path, sizeof(path), sha, BINARY_FILE);
+    unlink(path);
+    versions_path(path, sizeof(path), sha, MANIFEST_FILE);
+    unlink(path);
+    versions_path(path, sizeof(path), sha, NULL);
+    if (rmdir(path) == 0) {
+        till_log(LOG_INFO, "Removed old version %s", sha);
+    }
+}
+
+typedef struct {
+    char sha[TILL_SHA256_HEX];
+    double stored_at;
+} stored_version_t;
+
+static int newest_first(const void *a, const void *b) {
+    double ta = ((const stored_version_t *)a)->stored_at;
+    double tb = ((const stored_version_t *)b)->stored_at;
+    return (ta < tb) - (ta > tb);
+}
+
+/* Stored builds, newest first; caller frees */
+static int list_versions(stored_version_t **out) {
+    char path[TILL_MAX_PATH];
+    stored_version_t *list = NULL;
+    struct dirent *entry;
+    int count = 0, cap = 0;
+
+    *out = NULL;
+    if (versions_path(path, sizeof(path), NULL, NULL) != 0) {
+        return 0;
+    }
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return 0;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_version_name(entry->d_name)) {
+            continue;
+        }
+        if (count == cap) {
+            cap = cap ? cap * 2 : 8;
+            stored_version_t *grown = realloc(list, cap * sizeof(*list));
+            if (!grown) {
+                break;
+            }
+            list = grown;
+        }
+        cJSON *manifest = load_manifest(entry->d_name);
+        cJSON *stored = cJSON_GetObjectItem(manifest, "stored_at");
+        safe_strncpy(list[count].sha, entry->d_name, TILL_SHA256_HEX);
+        list[count].stored_at = cJSON_IsNumber(stored) ? stored->valuedouble : 0;
+        cJSON_Delete(manifest);
+        count++;
+    }
+    closedir(dir);
+
+    if (count > 1) {
+        qsort(list, count, sizeof(*list), newest_first);
+    }
+    *out = list;
+    return count;
+}
+
+/* Keep current, previous and the newest TILL_VERSIONS_KEEP others */
+static void prune_versions(void) {
+    char current[TILL_SHA256_HEX] = "";
+    char previous[TILL_SHA256_HEX] = "";
+    stored_version_t *list;
+    int kept = 0;
+
+    read_version_link("current", current);
+    read_version_link("previous", previous);
+
+    int count = list_versions(&list);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(list[i].sha, current) == 0 || strcmp(list[i].sha, previous) == 0) {
+            continue;
+        }
+        if (++kept > TILL_VERSIONS_KEEP) {
+            remove_version(list[i].sha);
+        }
+    }
+    free(list);
+}
+
+static void print_versions(void) {
+    char current[TILL_SHA256_HEX] = "";
+    char previous[TILL_SHA256_HEX] = "";
+    stored_version_t *list;
+
+    read_version_link("current", current);
+    read_version_link("previous", previous);
+
+    int count = list_versions(&list);
+    if (count == 0) {
+        printf("No stored versions (run 'make install' or 'till update')\n");
+        return;
+    }
+
+    printf("Stored versions:\n");
+    for (int i = 0; i < count; i++) {
+        cJSON *manifest = load_manifest(list[i].sha);
+        char when[32] = "";
+        time_t t = (time_t)list[i].stored_at;
+        if (t > 0) {
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime(&t));
+        }
+        printf("  %-9s %.12s  v%-8s %.8s  %s\n",
+               strcmp(list[i].sha, current) == 0 ? "current" :
+               strcmp(list[i].sha, previous) == 0 ? "previous" : "",
+               list[i].sha, json_get_string(manifest, "version", "?"),
+               json_get_string(manifest, "commit", ""), when);
+        cJSON_Delete(manifest);
+    }
+    free(list);
+}
+
+/* Store the binary in the checkout and make it current (make install) */
+static int activate_build(const char *link_path) {
+    char till_dir[TILL_MAX_PATH];
+    char binary[TILL_MAX_PATH];
+    char commit[64] = "";
+    char sha[TILL_SHA256_HEX];
+
+    if (source_dir(till_dir, sizeof(till_dir)) != 0) {
+        till_error("Could not determine till directory");
+        return -1;
+    }
+    if (snprintf(binary, sizeof(binary), "%s/%s", till_dir, BINARY_FILE) >= (int)sizeof(binary)) {
+        till_error("Till directory path too long: %s", till_dir);
+        return -1;
+    }
+    git_head(till_dir, commit, sizeof(commit));
+
+    if (store_version(binary, commit, sha) != 0 || activate_version(sha, link_path) != 0) {
+        return -1;
+    }
+    prune_versions();
+    printf("Activated till %.12s%s%.8s\n", sha, commit[0] ? " from " : "", commit);
+    return 0;
+}
+
+static int rollback_version(void) {
+    char previous[TILL_SHA256_HEX];
+
+    if (read_version_link("previous", previous) != 0) {
+        till_error("No previous version to roll back to");
+        return -1;
+    }
+    if (!version_intact(previous)) {
+        till_error("Previous version %.12s is damaged", previous);
+        return -1;
+    }
+    if (activate_version(previous, NULL) != 0) {
+        return -1;
+    }
+    printf("Rolled back to %.12s\n", previous);
+    return 0;
+}
+
+/* Make a build another host pushed into the store current */
+static int use_version(const char *sha, const char *commit) {
+    char path[TILL_MAX_PATH];
+    char stored[TILL_SHA256_HEX];
+
+    if (!is_version_name(sha) || !version_intact(sha)) {
+        till_error("Version %.12s is not stored here (or is damaged)", sha);
+        return -1;
+    }
+
+    /* A build copied in by till host update has no manifest yet */
+    cJSON *manifest = load_manifest(sha);
+    int have_manifest = manifest != NULL;
+    cJSON_Delete(manifest);
+    versions_path(path, sizeof(path), sha, BINARY_FILE);
+    if ((!have_manifest && store_version(path, commit, stored) != 0) ||
+        activate_version(sha, NULL) != 0) {
+        return -1;
+    }
+    prune_versions();
+    printf("Using till %.12s\n", sha);
+    return 0;
+}
+
+/* The build to hand to other hosts: current, else this checkout's */
+int till_update_artifact(char sha[TILL_SHA256_HEX], char *commit, size_t commit_size) {
+    char till_dir[TILL_MAX_PATH];
+    char binary[TILL_MAX_PATH];
+
+    commit[0] = '\0';
+    if (read_version_link("current", sha) == 0 && version_intact(sha)) {
+        cJSON *manifest = load_manifest(sha);
+        safe_strncpy(commit, json_get_string(manifest, "commit", ""), commit_size);
+        cJSON_Delete(manifest);
+        return 0;
+    }
+
+    if (source_dir(till_dir, sizeof(till_dir)) != 0) {
+        return -1;
+    }
+    if (snprintf(binary, sizeof(binary), "%s/%s", till_dir, BINARY_FILE) >= (int)sizeof(binary)) {
+        return -1;
+    }
+    git_head(till_dir, commit, commit_size);
+    return store_version(binary, commit, sha);
+}
+
+/* Path of a stored build's binary */
+int till_update_version_path(const char *sha, char *path, size_t size) {
+    return versions_path(path, size, sha, BINARY_FILE);
+}
+
+/* till update options */
+int till_update_command(int argc, char *argv[]) {
+    const char *link_path = NULL;
+    const char *use = NULL;
+    const char *commit = NULL;
+    int activate = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0) {
+            print_versions();
+            return 0;
+        } else if (strcmp(argv[i], "--rollback") == 0) {
+            return rollback_version();
+        } else if (strcmp(argv[i], "--activate") == 0) {
+            activate = 1;
+        } else if (strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+            link_path = argv[++i];
+        } else if (strcmp(argv[i], "--use") == 0 && i + 1 < argc) {
+            use = argv[++i];
+        } else if (strcmp(argv[i], "--commit") == 0 && i + 1 < argc) {
+            commit = argv[++i];
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printf("Usage: till update [--list | --rollback | --activate [--link PATH] | --use SHA]\n\n");
+            printf("Pulls Till, reuses a stored build of the new commit or builds it once,\n");
+            printf("and switches to it. Builds live side by side in $HOME/%s.\n\n", TILL_VERSIONS_DIR);
+            printf("  --list       Show stored versions\n");
+            printf("  --rollback   Switch back to the previous version\n");
+            printf("  --activate   Store this checkout's build and switch to it\n");
+            printf("  --link PATH  Also make PATH a link to the current version\n");
+            printf("  --use SHA    Switch to a stored build (pushed by 'till host update')\n");
+            return 0;
+        } else {
+            till_error("Unknown update option: %s", argv[i]);
+            return -1;
+        }
+    }
+
+    if (use) {
+        return use_version(use, commit);
+    }
+    return activate ? activate_build(link_path) : 0;
+}
+
+/* Self-update: pull, reuse or build, verify, switch */
+int self_update_till(void) {
+    char till_dir[TILL_MAX_PATH];
+    char lock_file[TILL_MAX_PATH];
+    char cmd[TILL_MAX_PATH * 2];
+    char output[1024];
+    char commit[64];
+    char sha[TILL_SHA256_HEX];
+    char path[TILL_MAX_PATH];
+    int lock_fd;
+
+    if (source_dir(till_dir, sizeof(till_dir)) != 0) {
+        till_error("Could not determine till directory");
+        return -1;
+    }
+
+    /* 1. LOCK - Prevent concurrent updates */
+    if (snprintf(lock_file, sizeof(lock_file), "%s/.till-update.lock", till_dir) >= (int)sizeof(lock_file)) {
+        till_error("Till directory path too long: %s", till_dir);
+        return -1;
+    }
+    lock_fd = acquire_lock_file(lock_file, 5000);  /* 5 second timeout */
+    if (lock_fd < 0) {
+        if (errno == ETIMEDOUT) {
+            printf("⚠️  Another till update in progress (timed out waiting)\n");
+        } else {
+            printf("⚠️  Could not acquire update lock\n");
+        }
+        return -1;
+    }
+
+    printf("📦 Updating till...\n");
+
+    /* 2. CHECK - Ensure clean working directory */
+    if (run_command_capture(output, sizeof(output),
+                            "cd \"%s\" && git status --porcelain 2>/dev/null", till_dir) == 0 &&
+        output[0] != '\0') {
+        printf("   ⚠️  Uncommitted changes detected\n");
+        printf("   Stashing changes...\n");
+        snprintf(cmd, sizeof(cmd),
+            "cd \"%s\" && git stash push -m 'till-auto-update-%ld' 2>&1",
+            till_dir, (long)time(NULL));
+        if (system(cmd) != 0) {
+            till_warn("Failed to stash changes");
+        }
+    }
+
+    /* 3. UPDATE - Pull latest (the running binary is untouched) */
+    printf("   Pulling latest changes...\n");
+    snprintf(cmd, sizeof(cmd),
+        "cd \"%s\" && git pull --no-edit origin main 2>&1", till_dir);
+
+    FILE *pipe = popen(cmd, "r");
+    int success = pipe != NULL;
+    while (pipe && fgets(output, sizeof(output), pipe)) {
+        if (strstr(output, "Fast-forward") ||
+            strstr(output, "files changed") ||
+            strstr(output, "insertions") ||
+            strstr(output, "deletions")) {
+            printf("   %s", output);
+        }
+        if (strstr(output, "error:") || strstr(output, "fatal:")) {
+            printf("   %s", output);
+            success = 0;
+        }
+    }
+    if (!pipe || pclose(pipe) != 0 || !success) {
+        printf("   ❌ Git pull failed, keeping current version\n");
+        release_lock_file(lock_fd);
+        return -1;
+    }
+
+    if (git_head(till_dir, commit, sizeof(commit)) != 0) {
+        printf("   ❌ Cannot read the new commit\n");
+        release_lock_file(lock_fd);
+        return -1;
+    }
+
+    /* 4. BUILD - Only if no stored build of this commit exists */
+    if (find_version(commit, sha) == 0) {
+        printf("   Using stored build %.12s of %.8s\n", sha, commit);
+    } else {
+        printf("   Building %.8s...\n", commit);
+        /* Incremental (per-file dependencies), on half the cores of a busy host */
+        long jobs = sysconf(_SC_NPROCESSORS_ONLN) / 2;
+        snprintf(cmd, sizeof(cmd), "cd \"%s\" && make -j%ld 2>&1", till_dir, jobs > 1 ? jobs : 1);
+
+        pipe = popen(cmd, "r");
+        success = pipe != NULL;
+        while (pipe && fgets(output, sizeof(output), pipe)) {
+            if (strstr(output, "error:") || strstr(output, "Error")) {
+                printf("   %s", output);
+                success = 0;
+            } else if (strstr(output, "Build complete")) {
+                printf("   %s", output);
+            }
+        }
+        if (pipe && pclose(pipe) != 0) {
+            success = 0;
+        }
+
+        /* 5. VERIFY - Hash it, run it, store it side by side */
+        if (!success ||
+            snprintf(path, sizeof(path), "%s/%s", till_dir, BINARY_FILE) >= (int)sizeof(path) ||
+            store_version(path, commit, sha) != 0) {
+            printf("   ❌ Build failed, keeping current version\n");
+            snprintf(cmd, sizeof(cmd), "cd \"%s\" && git reset --hard ORIG_HEAD", till_dir);
+            if (system(cmd) != 0) {
+                till_error("Failed to reset git repository");
+            }
+            release_lock_file(lock_fd);
+            return -1;
+        }
+    }
+
+    /* 6. SWITCH - One rename; 'till update --rollback' flips back */
+    if (activate_version(sha, NULL) != 0) {
+        release_lock_file(lock_fd);
+        return -1;
+    }
+    cJSON *manifest = load_manifest(sha);
+    printf("   ✅ Till updated to %s (%.12s)\n", json_get_string(manifest, "version", "?"), sha);
+    cJSON_Delete(manifest);
+    prune_versions();
+
+    /* Show what changed */
+    printf("\n   Recent changes:\n");
+    snprintf(cmd, sizeof(cmd), "cd \"%s\" && git log --oneline -5", till_dir);
+    pipe = popen(cmd, "r");
+    while (pipe && fgets(output, sizeof(output), pipe)) {
+        printf("     %s", output);
+    }
+    if (pipe) {
+        pclose(pipe);
+    }
+
+    /* 7. UNLOCK */
+    close(lock_fd);
+    unlink(lock_file);
+
+    /* 8. RE-EXEC - Run new version for the sync */
+    printf("\n   Restarting with new version...\n\n");
+    fflush(stdout);  /* exec discards buffered output */
+    versions_path(path, sizeof(path), "current", BINARY_FILE);
+    execl(path, "till", "sync", NULL);
+
+    till_error("Failed to restart with new version");
+    return -1;
+}
@@ -0,0 +1,28 @@
+/*
+ * till_update.h - Self-update for Till
+ *
+ * Builds are stored side by side in $HOME/.till/versions/<sha256>/, each
+ * with a manifest naming the commit it was built from. "current" and
+ * "previous" are symlinks into the store; updating and rolling back flip
+ * them atomically, and installed binaries are links through "current".
+ */
+
+#ifndef TILL_UPDATE_H
+#define TILL_UPDATE_H
+
+#include <stddef.h>
+#include "till_sha256.h"
+
+/* Pull, reuse or build the new version, switch to it and re-exec sync */
+int self_update_till(void);
+
+/* till update options (--list, --rollback, --activate, --use) */
+int till_update_command(int argc, char *argv[]);
+
+/* The build to hand to other hosts (current, else the checkout's), stored */
+int till_update_artifact(char sha[TILL_SHA256_HEX], char *commit, size_t commit_size);
+
+/* Path of a stored build's binary */
+int till_update_version_path(const char *sha, char *path, size_t size);
+
+#endif /* TILL_UPDATE_H */
@@ -75,7 +75,7 @@ else
 fi
 
 # Test 3: Command help pages
-COMMANDS="install host sync watch hold release"
+COMMANDS="install host sync watch hold release serve"
 for cmd in $COMMANDS; do
     run_test "$cmd --help"
     if $TILL $cmd --help </dev/null > /dev/null 2>&1; then
@@ -148,6 +148,36 @@ fi
 kill $PID 2>/dev/null || true
 wait $PID 2>/dev/null || true
 
+# Test 10: Machine-readable status
+run_test "Status as JSON"
+OUTPUT=$($TILL status --json </dev/null 2>/dev/null) || true
+if echo "$OUTPUT" | head -1 | grep -q '^{' && echo "$OUTPUT" | grep -q '"federation"'; then
+    pass "status --json prints only the JSON document"
+else
+    fail "status --json output not JSON" "$(echo "$OUTPUT" | head -1)"
+fi
+
+run_test "Status as JSON lines"
+OUTPUT=$($TILL status --jsonl </dev/null 2>/dev/null) || true
+if [ -n "$OUTPUT" ] && ! echo "$OUTPUT" | grep -vq '^{"type":"'; then
+    pass "status --jsonl prints one typed record per line"
+else
+    fail "status --jsonl output not typed records" "$(echo "$OUTPUT" | grep -v '^{"type":"' | head -1)"
+fi
+
+# Test 11: Status daemon
+run_test "Status served by till serve"
+$TILL serve </dev/null > /dev/null 2>&1 &
+PID=$!
+sleep 1
+if $TILL status --json </dev/null 2>/dev/null | grep -q '"served_by"'; then
+    pass "status --json answered by till serve"
+else
+    fail "status --json not answered by till serve"
+fi
+$TILL serve --stop </dev/null > /dev/null 2>&1 || kill $PID 2>/dev/null || true
+wait $PID 2>/dev/null || true
+
 # Summary
 echo
 echo "==================================="
@@ -0,0 +1,117 @@
+#!/bin/bash
+#
+# test_federation_load.sh - Load test federation push and admin processing
+#
+# Runs entirely against the local gist store (TILL_GIST_STORE), so no
+# GitHub access is needed. Seeds synthetic site gists, pushes status
+# repeatedly, then runs admin processing until every gist is consumed
+# and checks the report accounts for every site.
+#
+# Usage: ./test_federation_load.sh [gists] [pushes]
+#
+
+GISTS=${1:-10000}
+PUSHES=${2:-20}
+TILL=${TILL:-$(cd "$(dirname "$0")/.." && pwd)/till}
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+if [ ! -x "$TILL" ]; then
+    echo "till binary not found at $TILL (build first, or set TILL)"
+    exit 1
+fi
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/till-load.XXXXXX")
+trap 'rm -rf "$WORK"' EXIT
+
+# Sandbox: own HOME, own till dir, local gist store, no network
+export HOME="$WORK/home"
+export TILL_GIST_STORE="$WORK/gists"
+export TILL_FEDERATION_URL="file://$WORK/federation"
+TILL_DIR="$HOME/projects/github/till"
+mkdir -p "$HOME/.till" "$TILL_DIR/.till" "$TILL_GIST_STORE" "$WORK/federation"
+echo "ckoons" > "$TILL_GIST_STORE/.user"
+cd "$TILL_DIR" || exit 1
+
+cat > .till/federation.json <<EOF
+{"site_id": "load-test-site", "trust_level": "named", "gist_id": "", "sync_enabled": false}
+EOF
+
+TIMEFORMAT=%R
+FAILED=0
+
+echo "=== Till Federation Load Test ==="
+echo "Gists: $GISTS   Pushes: $PUSHES"
+echo
+
+# Seed synthetic status gists in the store's format
+echo -n "Seeding $GISTS gists... "
+now=$(date +%s)
+SEED_TIME=$( { time for i in $(seq 1 "$GISTS"); do
+    printf '{"id":"%032x","description":"Till Federation Status for load-%d","public":true,"files":{"status.json":{"filename":"status.json","content":"{\\"schema\\":2,\\"site_id\\":\\"load-%d\\",\\"hostname\\":\\"host-%d\\",\\"platform\\":\\"p%d\\",\\"trust_level\\":\\"named\\",\\"till_version\\":150,\\"cpu_count\\":%d,\\"installation_count\\":%d,\\"last_sync\\":%d}"}}}' \
+        "$i" "$i" "$i" "$i" $((i % 3)) $((i % 16 + 1)) $((i % 5)) "$now" \
+        > "$TILL_GIST_STORE/$(printf '%032x' "$i").json"
+done; } 2>&1 )
+echo "${SEED_TIME}s"
+
+# Push: the first creates the site gist, the rest update it
+echo -n "Pushing status $PUSHES times... "
+PUSH_TIME=$( { time for i in $(seq 1 "$PUSHES"); do
+    "$TILL" federate push --force >/dev/null 2>&1 || echo "push $i failed" >&2
+done; } 2>&1 | tail -1 )
+echo "${PUSH_TIME}s ($(awk "BEGIN { if ($PUSH_TIME > 0) printf \"%.1f\", $PUSHES / $PUSH_TIME; else print \"-\" }") pushes/s)"
+
+if ! grep -q '"gist_id":.*[0-9a-f]' .till/federation.json; then
+    echo -e "${RED}✗ FAIL${NC} push did not create a gist"
+    FAILED=1
+fi
+
+# Admin processing takes a bounded number of gists per run; run to empty
+echo "Processing..."
+RUNS=0
+PROCESSED=0
+START=$(date +%s)
+PROCESS_TIME=0
+while [ $RUNS -le $((GISTS / 1000 + 2)) ]; do
+    RUNS=$((RUNS + 1))
+    OUTPUT=$( { time "$TILL" federate admin process 2>&1; } 2>&1 )
+    ELAPSED=$(echo "$OUTPUT" | tail -1)
+    PROCESS_TIME=$(awk "BEGIN { print $PROCESS_TIME + $ELAPSED }")
+    FOUND=$(echo "$OUTPUT" | awk '/^Found:/ { print $2 }')
+    DONE=$(echo "$OUTPUT" | awk '/^Processed:/ { print $2 }')
+    echo "  Run $RUNS: found ${FOUND:-?}, processed ${DONE:-?} in ${ELAPSED}s"
+    if [ -z "$FOUND" ]; then
+        echo "$OUTPUT" | tail -5
+        FAILED=1
+        break
+    fi
+    PROCESSED=$((PROCESSED + ${DONE:-0}))
+    [ "$FOUND" -eq 0 ] && break
+done
+echo "Processed $PROCESSED gists in ${PROCESS_TIME}s over $RUNS runs" \
+     "($(awk "BEGIN { if ($PROCESS_TIME > 0) printf \"%.0f\", $PROCESSED / $PROCESS_TIME; else print \"-\" }") gists/s)"
+echo
+
+# Every synthetic site plus the pushing site should be in the report
+EXPECTED=$((GISTS + 1))
+SITES=$("$TILL" federate admin status 2>&1 | awk '/^Total Sites:/ { print $3 }')
+echo -n "Report covers all $EXPECTED sites: "
+if [ "$SITES" = "$EXPECTED" ]; then
+    echo -e "${GREEN}✓ PASS${NC}"
+else
+    echo -e "${RED}✗ FAIL${NC} (report has ${SITES:-none})"
+    FAILED=1
+fi
+
+echo -n "Store drained of status gists: "
+LEFT=$(find "$TILL_GIST_STORE" -name '*.json' | xargs grep -l 'Till Federation Status' 2>/dev/null | wc -l)
+if [ "$LEFT" -eq 0 ]; then
+    echo -e "${GREEN}✓ PASS${NC}"
+else
+    echo -e "${RED}✗ FAIL${NC} ($LEFT left)"
+    FAILED=1
+fi
+
+exit $FAILED
@@ -0,0 +1,260 @@
+/*
+ * test_arena.c - Unit tests for till_arena.c
+ *
+ * Tests cJSON trees in arena scopes, nesting, mixing with malloc'd
+ * trees, that cJSON is back on malloc once the scope ends, and that
+ * scopes belong to one thread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../../src/till_arena.h"
+#include "../../src/till_config.h"
+#include "../../src/cJSON.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_START(name) do { \
+    printf("Testing %s... ", name); \
+    tests_run++; \
+} while(0)
+
+#define TEST_PASS() do { \
+    printf("PASS\n"); \
+    tests_passed++; \
+} while(0)
+
+#define TEST_FAIL(msg) do { \
+    printf("FAIL: %s\n", msg); \
+    tests_failed++; \
+} while(0)
+
+#define ASSERT(condition, msg) do { \
+    if (!(condition)) { \
+        TEST_FAIL(msg); \
+        return; \
+    } \
+} while(0)
+
+static const char *registry_json =
+    "{\"installations\":{\"alpha\":{\"root\":\"/a\",\"port_base\":8000},"
+    "\"beta\":{\"root\":\"/b\",\"port_base\":8100}},\"holds\":{}}";
+
+/* Parse, edit, print and free inside one scope */
+void test_scope() {
+    TEST_START("till_arena parse and print in a scope");
+
+    till_arena_stats_t before, after;
+    till_arena_stats(&before);
+
+    till_arena_begin();
+    cJSON *registry = cJSON_Parse(registry_json);
+    ASSERT(registry != NULL, "Parse in arena");
+    cJSON *beta = cJSON_GetObjectItem(cJSON_GetObjectItem(registry, "installations"), "beta");
+    ASSERT(cJSON_GetNumberValue(cJSON_GetObjectItem(beta, "port_base")) == 8100, "Values intact");
+    cJSON_AddStringToObject(beta, "mode", "anonymous");
+
+    char *text = cJSON_PrintUnformatted(registry);
+    ASSERT(text != NULL && strstr(text, "\"mode\":\"anonymous\"") != NULL, "Print from arena");
+    cJSON_free(text);
+    cJSON_Delete(registry);
+    till_arena_end();
+
+    till_arena_stats(&after);
+    ASSERT(after.scopes == before.scopes + 1, "One scope counted");
+    ASSERT(after.allocations > before.allocations + 10, "Nodes came from the arena");
+    ASSERT(after.frees >= after.allocations - before.allocations, "Every free absorbed");
+    ASSERT(after.peak > 0, "Peak recorded");
+
+    TEST_PASS();
+}
+
+/* An inner scope rewinds to where it began */
+void test_nested() {
+    TEST_START("till_arena nested scopes");
+
+    till_arena_begin();
+    cJSON *outer = cJSON_CreateArray();
+
+    for (int round = 0; round < 50; round++) {
+        till_arena_stats_t before, after;
+        till_arena_stats(&before);
+
+        till_arena_begin();
+        cJSON *big = cJSON_CreateArray();
+        for (int i = 0; i < 500; i++) {
+            cJSON_AddItemToArray(big, cJSON_CreateString("a string long enough to matter"));
+        }
+        cJSON_Delete(big);
+        till_arena_end();
+
+        till_arena_stats(&after);
+        ASSERT(round == 0 || after.peak < before.peak + 1024,
+               "Rewound space is reused, not regrown");
+        cJSON_AddItemToArray(outer, cJSON_CreateNumber(round));
+    }
+
+    ASSERT(cJSON_GetArraySize(outer) == 50, "Outer tree survives inner scopes");
+    ASSERT(cJSON_GetNumberValue(cJSON_GetArrayItem(outer, 49)) == 49, "Outer values intact");
+    cJSON_Delete(outer);
+    till_arena_end();
+
+    TEST_PASS();
+}
+
+/* Trees from before the scope can be freed, or added to, inside it */
+void test_mixed() {
+    TEST_START("till_arena with malloc'd trees");
+
+    cJSON *holds = cJSON_CreateObject();
+    cJSON_AddStringToObject(holds, "tekton", "held");
+    cJSON *old = cJSON_CreateString("freed in the scope");
+
+    till_arena_begin();
+    cJSON_Delete(old);
+    cJSON *registry = cJSON_Parse(registry_json);
+    cJSON_DeleteItemFromObject(registry, "holds");
+    cJSON_AddItemReferenceToObject(registry, "holds", holds);
+    char *text = cJSON_PrintUnformatted(registry);
+    ASSERT(text != NULL && strstr(text, "\"tekton\":\"held\"") != NULL, "Reference printed");
+    cJSON_free(text);
+    cJSON_Delete(registry);
+    till_arena_end();
+
+    ASSERT(strcmp(cJSON_GetStringValue(cJSON_GetObjectItem(holds, "tekton")), "held") == 0,
+           "Referenced tree left alone");
+    cJSON_Delete(holds);
+
+    TEST_PASS();
+}
+
+/* Outside a scope cJSON uses malloc, so free() is fine again */
+void test_restored() {
+    TEST_START("till_arena passes through after the scope");
+
+    till_arena_stats_t before, after;
+    till_arena_begin();
+    till_arena_end();
+    till_arena_end();  /* Unbalanced end is ignored */
+
+    till_arena_stats(&before);
+    cJSON *item = cJSON_Parse(registry_json);
+    char *text = cJSON_Print(item);
+    ASSERT(text != NULL, "Print outside scope");
+    free(text);
+    cJSON_Delete(item);
+    till_arena_stats(&after);
+
+    ASSERT(after.allocations == before.allocations, "No arena allocations outside a scope");
+
+    TEST_PASS();
+}
+
+/* A value larger than a chunk gets a chunk of its own */
+void test_large() {
+    TEST_START("till_arena oversized allocation");
+
+    size_t size = TILL_ARENA_CHUNK * 3;
+    char *value = malloc(size);
+    ASSERT(value != NULL, "Test buffer");
+    memset(value, 'x', size - 1);
+    value[size - 1] = '\0';
+
+    till_arena_begin();
+    cJSON *item = cJSON_CreateString(value);
+    ASSERT(item != NULL && strlen(cJSON_GetStringValue(item)) == size - 1, "Large string kept");
+    cJSON_Delete(item);
+    till_arena_end();
+
+    free(value);
+    TEST_PASS();
+}
+
+/* Build, print and drop trees; with_scope runs each round in a scope */
+static void *json_worker(void *arg) {
+    int with_scope = *(int *)arg;
+    long failures = 0;
+
+    for (int i = 0; i < 2000; i++) {
+        if (with_scope) {
+            till_arena_begin();
+        }
+        cJSON *item = cJSON_Parse(registry_json);
+        char *text = cJSON_PrintUnformatted(item);
+        if (!text || strstr(text, "\"beta\"") == NULL) {
+            failures++;
+        }
+        if (with_scope) {
+            cJSON_free(text);
+        } else {
+            free(text);  /* Only safe if it didn't come from an arena */
+        }
+        cJSON_Delete(item);
+        if (with_scope) {
+            till_arena_end();
+        }
+    }
+    return (void *)failures;
+}
+
+/* A scope on one thread leaves every other thread on malloc */
+void test_threads() {
+    TEST_START("till_arena scopes are per thread");
+
+    int plain = 0, scoped = 1;
+    pthread_t threads[2];
+    till_arena_stats_t before, after;
+    void *failures[2];
+
+    till_arena_begin();
+    till_arena_stats(&before);
+    pthread_create(&threads[0], NULL, json_worker, &plain);
+    pthread_create(&threads[1], NULL, json_worker, &scoped);
+    for (int i = 0; i < 200; i++) {
+        cJSON_Delete(cJSON_Parse(registry_json));
+    }
+    pthread_join(threads[0], &failures[0]);
+    pthread_join(threads[1], &failures[1]);
+    till_arena_stats(&after);
+    till_arena_end();
+
+    ASSERT(failures[0] == NULL && failures[1] == NULL, "Workers' trees intact");
+    ASSERT(after.scopes == before.scopes, "Worker scopes not counted here");
+    ASSERT(after.allocations > before.allocations, "Main thread still on its arena");
+
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main() {
+    printf("\n=== Till Arena Tests ===\n\n");
+
+    /* Run all tests */
+    test_scope();
+    test_nested();
+    test_mixed();
+    test_restored();
+    test_large();
+    test_threads();
+
+    /* Print summary */
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\nAll tests passed!\n");
+        return 0;
+    } else {
+        printf("\nSome tests failed.\n");
+        return 1;
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * test_condition.c - Unit tests for till_condition.c
+ *
+ * Tests parsing, fact binding, comparisons and short-circuit evaluation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/till_condition.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_START(name) do { \
+    printf("Testing %s... ", name); \
+    tests_run++; \
+} while(0)
+
+#define TEST_PASS() do { \
+    printf("PASS\n"); \
+    tests_passed++; \
+} while(0)
+
+#define TEST_FAIL(msg) do { \
+    printf("FAIL: %s\n", msg); \
+    tests_failed++; \
+} while(0)
+
+#define ASSERT(condition, msg) do { \
+    if (!(condition)) { \
+        TEST_FAIL(msg); \
+        return; \
+    } \
+} while(0)
+
+static till_facts_t facts;
+
+/* Fixed facts so results don't depend on the test machine */
+static void setup_facts(void) {
+    memset(&facts, 0, sizeof(facts));
+    till_hash_init(&facts.installed);
+    strcpy(facts.platform, "linux");
+    strcpy(facts.platform_version, "Ubuntu 22.04");
+    strcpy(facts.arch, "x86_64");
+    strcpy(facts.till_version, "1.5.0");
+    strcpy(facts.trust_level, "named");
+    facts.cpu_count = 8;
+    facts.memory_mb = 16384;
+    facts.caps.has_systemd = 1;
+    till_facts_add_installed(&facts, "Tekton");
+    facts.installation_count = 1;
+}
+
+/* Compile and evaluate, -1 if it doesn't compile */
+static int check(const char *expr) {
+    char error[256];
+    till_condition_t *cond = till_condition_compile(expr, error, sizeof(error));
+    if (!cond) {
+        return -1;
+    }
+    int result = till_condition_eval(cond, &facts);
+    till_condition_free(cond);
+    return result;
+}
+
+/* Test constants and facts */
+void test_facts() {
+    TEST_START("facts and constants");
+
+    ASSERT(check("") == 1, "Empty condition holds");
+    ASSERT(check("always") == 1, "always holds");
+    ASSERT(check("never") == 0, "never fails");
+    ASSERT(check("platform == 'linux'") == 1, "String equality");
+    ASSERT(check("platform = \"LINUX\"") == 1, "Equality ignores case");
+    ASSERT(check("platform != 'darwin'") == 1, "Inequality");
+    ASSERT(check("cpu_count >= 4 && memory_mb > 8000") == 1, "Numeric comparison");
+    ASSERT(check("cpu_count < 4") == 0, "Numeric comparison false");
+    ASSERT(check("has_systemd and not has_launchd") == 1, "Capability flags");
+    ASSERT(check("installed('tekton')") == 1, "Installed component");
+    ASSERT(check("!installed(Other)") == 1, "Missing component");
+    ASSERT(check("platform_version =~ 'Ubuntu*'") == 1, "Glob match");
+    TEST_PASS();
+}
+
+/* Test version comparisons */
+void test_versions() {
+    TEST_START("version comparison");
+
+    ASSERT(check("till_version == 1.5.0") == 1, "Version equality");
+    ASSERT(check("till_version < 1.10.0") == 1, "Component-wise, not lexical");
+    ASSERT(check("till_version >= 1.5") == 1, "Missing component is zero");
+    ASSERT(check("till_version > '1.4.9'") == 1, "Quoted version");
+    ASSERT(check("till_version < 1.5") == 0, "Equal versions");
+    ASSERT(check("cpu_count == '8'") == 1, "Numeric string");
+    ASSERT(check("platform > 3") == 0, "Incomparable is false");
+    TEST_PASS();
+}
+
+/* Test precedence and short-circuit */
+void test_logic() {
+    TEST_START("precedence and short-circuit");
+
+    ASSERT(check("true || false && false") == 1, "&& binds tighter than ||");
+    ASSERT(check("(true || false) && false") == 0, "Parentheses");
+    ASSERT(check("false && (cpu_count > 1)") == 0, "&& short-circuits");
+    ASSERT(check("true or never and never") == 1, "Word operators");
+    ASSERT(check("!!(platform == 'linux')") == 1, "Double negation");
+    ASSERT(check("trust_level == 'named' || trust_level == 'trusted'") == 1, "Chained ||");
+    TEST_PASS();
+}
+
+/* Test compile errors */
+void test_errors() {
+    TEST_START("compile errors");
+
+    char error[256];
+    ASSERT(till_condition_compile("platfrom == 'linux'", error, sizeof(error)) == NULL,
+           "Unknown fact rejected");
+    ASSERT(strstr(error, "unknown fact") != NULL, "Error names the problem");
+    ASSERT(check("cpu_count >") == -1, "Missing operand");
+    ASSERT(check("(true") == -1, "Unbalanced parenthesis");
+    ASSERT(check("platform == 'linux") == -1, "Unterminated string");
+    ASSERT(check("true false") == -1, "Trailing tokens");
+    ASSERT(check("rm -rf /") == -1, "Shell is not a condition");
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main() {
+    printf("\n=== Till Condition Tests ===\n\n");
+
+    setup_facts();
+
+    /* Run all tests */
+    test_facts();
+    test_versions();
+    test_logic();
+    test_errors();
+
+    till_facts_free(&facts);
+
+    /* Print summary */
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\nAll tests passed!\n");
+        return 0;
+    } else {
+        printf("\nSome tests failed.\n");
+        return 1;
+    }
+}
@@ -0,0 +1,183 @@
+/*
+ * test_hash.c - Unit tests for till_hash.c and till_federation_stats.c
+ *
+ * Tests map operations, insertion ordering, and site aggregation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/till_hash.h"
+#include "../../src/till_federation_stats.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_START(name) do { \
+    printf("Testing %s... ", name); \
+    tests_run++; \
+} while(0)
+
+#define TEST_PASS() do { \
+    printf("PASS\n"); \
+    tests_passed++; \
+} while(0)
+
+#define TEST_FAIL(msg) do { \
+    printf("FAIL: %s\n", msg); \
+    tests_failed++; \
+} while(0)
+
+#define ASSERT(condition, msg) do { \
+    if (!(condition)) { \
+        TEST_FAIL(msg); \
+        return; \
+    } \
+} while(0)
+
+/* Test put/get/remove */
+void test_basic_ops() {
+    TEST_START("till_hash put/get/remove");
+
+    till_hash_t map;
+    till_hash_init(&map);
+
+    ASSERT(till_hash_get(&map, "missing") == NULL, "Empty map should miss");
+
+    int a = 1, b = 2;
+    ASSERT(till_hash_put(&map, "alpha", &a) == NULL, "New key returns NULL");
+    ASSERT(till_hash_put(&map, "beta", &b) == NULL, "New key returns NULL");
+    ASSERT(till_hash_get(&map, "alpha") == &a, "Should find alpha");
+    ASSERT(till_hash_get(&map, "Alpha") == NULL, "Lookup is case-sensitive");
+    ASSERT(till_hash_put(&map, "alpha", &b) == &a, "Replace returns old value");
+    ASSERT(map.count == 2, "Replace should not add");
+
+    ASSERT(till_hash_remove(&map, "alpha") == &b, "Remove returns value");
+    ASSERT(till_hash_get(&map, "alpha") == NULL, "Removed key should miss");
+    ASSERT(till_hash_get(&map, "beta") == &b, "Other keys survive remove");
+    ASSERT(map.count == 1, "Count after remove");
+
+    till_hash_free(&map, NULL);
+    TEST_PASS();
+}
+
+/* Test growth keeps entries and insertion order */
+void test_growth_order() {
+    TEST_START("till_hash growth and ordering");
+
+    till_hash_t map;
+    till_hash_init(&map);
+    char key[32];
+
+    for (int i = 0; i < 5000; i++) {
+        snprintf(key, sizeof(key), "key-%d", i);
+        till_hash_incr(&map, key, i);
+    }
+    /* Remove every other key, then add more to force compaction */
+    for (int i = 0; i < 5000; i += 2) {
+        snprintf(key, sizeof(key), "key-%d", i);
+        till_hash_remove(&map, key);
+    }
+    for (int i = 5000; i < 6000; i++) {
+        snprintf(key, sizeof(key), "key-%d", i);
+        till_hash_incr(&map, key, i);
+    }
+    ASSERT(map.count == 3500, "Count after removes and growth");
+
+    till_hash_entry_t *entry = till_hash_find(&map, "key-4999");
+    ASSERT(entry && entry->count == 4999, "Counter survives growth");
+
+    /* Iteration follows insertion order */
+    int last = -1, ordered = 1, seen = 0;
+    till_hash_foreach(&map, entry) {
+        int n = atoi(entry->key + 4);
+        if (n <= last) ordered = 0;
+        last = n;
+        seen++;
+    }
+    ASSERT(ordered, "Iteration should follow insertion order");
+    ASSERT(seen == 3500, "Iteration should skip removed entries");
+
+    till_hash_free(&map, NULL);
+    TEST_PASS();
+}
+
+/* Test site dedup keeps the latest report */
+void test_site_dedup() {
+    TEST_START("federation_stats dedup");
+
+    federation_stats_t stats;
+    federation_stats_init(&stats);
+
+    federation_site_t site;
+    memset(&site, 0, sizeof(site));
+    strcpy(site.site_id, "site-a");
+    strcpy(site.platform, "linux");
+    strcpy(site.trust_level, "named");
+    strcpy(site.till_version, "1.5");
+    site.last_sync = 200;
+    site.installation_count = 3;
+    ASSERT(federation_stats_add_site(&stats, &site) == 1, "First report is new");
+
+    site.last_sync = 100;
+    strcpy(site.platform, "darwin");
+    ASSERT(federation_stats_add_site(&stats, &site) == -1, "Older report ignored");
+
+    site.last_sync = 300;
+    ASSERT(federation_stats_add_site(&stats, &site) == 0, "Newer report replaces");
+    ASSERT(stats.sites.count == 1, "One site after duplicates");
+    ASSERT(stats.duplicates == 2, "Duplicates counted");
+
+    federation_stats_rollup(&stats, 300);
+    till_hash_entry_t *entry = till_hash_find(&stats.by_platform, "darwin");
+    ASSERT(entry && entry->count == 1, "Rollup uses latest report");
+    ASSERT(till_hash_find(&stats.by_platform, "linux") == NULL, "Superseded report not counted");
+    entry = till_hash_find(&stats.by_installations, "2-5");
+    ASSERT(entry && entry->count == 1, "Installation bucket");
+    ASSERT(stats.active_24h == 1, "Active site counted");
+
+    /* Heartbeats refresh known sites and are only counted for unknown ones */
+    federation_site_t beat;
+    memset(&beat, 0, sizeof(beat));
+    strcpy(beat.site_id, "site-a");
+    beat.heartbeat = 1;
+    beat.last_sync = 400;
+    ASSERT(federation_stats_add_site(&stats, &beat) == 0, "Heartbeat refreshes a known site");
+    federation_site_t *known = till_hash_get(&stats.sites, "site-a");
+    ASSERT(known->last_sync == 400 && strcmp(known->platform, "darwin") == 0,
+           "Heartbeat keeps the full status");
+    strcpy(beat.site_id, "site-b");
+    ASSERT(federation_stats_add_site(&stats, &beat) == -1, "Heartbeat for unknown site ignored");
+    ASSERT(stats.sites.count == 1 && stats.orphan_heartbeats == 1, "Orphan heartbeat counted");
+
+    federation_stats_free(&stats);
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main() {
+    printf("\n=== Till Hash Tests ===\n\n");
+
+    /* Run all tests */
+    test_basic_ops();
+    test_growth_order();
+    test_site_dedup();
+
+    /* Print summary */
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\nAll tests passed!\n");
+        return 0;
+    } else {
+        printf("\nSome tests failed.\n");
+        return 1;
+    }
+}
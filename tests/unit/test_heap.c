@@ -0,0 +1,172 @@
+/*
+ * test_heap.c - Unit tests for till_heap.c
+ *
+ * Tests due-time ordering, ties, growth, and cancelling jobs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/till_heap.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_START(name) do { \
+    printf("Testing %s... ", name); \
+    tests_run++; \
+} while(0)
+
+#define TEST_PASS() do { \
+    printf("PASS\n"); \
+    tests_passed++; \
+} while(0)
+
+#define TEST_FAIL(msg) do { \
+    printf("FAIL: %s\n", msg); \
+    tests_failed++; \
+} while(0)
+
+#define ASSERT(condition, msg) do { \
+    if (!(condition)) { \
+        TEST_FAIL(msg); \
+        till_heap_free(&heap); \
+        return; \
+    } \
+} while(0)
+
+/* Test push/peek/pop order */
+void test_order() {
+    TEST_START("till_heap due-time order");
+
+    till_heap_t heap;
+    till_heap_init(&heap);
+    till_heap_item_t item;
+
+    ASSERT(till_heap_peek(&heap) == NULL, "Empty heap has no next job");
+    ASSERT(till_heap_pop(&heap, &item) == -1, "Pop from empty heap fails");
+
+    till_heap_push(&heap, 300, 0, "c");
+    till_heap_push(&heap, 100, 0, "a");
+    till_heap_push(&heap, 200, 1, "b");
+    ASSERT(till_heap_peek(&heap)->due == 100, "Earliest job first");
+
+    ASSERT(till_heap_pop(&heap, &item) == 0 && strcmp(item.key, "a") == 0, "Pop a");
+    ASSERT(till_heap_pop(&heap, &item) == 0 && strcmp(item.key, "b") == 0, "Pop b");
+    ASSERT(item.kind == 1, "Kind kept");
+    ASSERT(till_heap_pop(&heap, &item) == 0 && strcmp(item.key, "c") == 0, "Pop c");
+    ASSERT(heap.count == 0, "Heap drained");
+
+    till_heap_free(&heap);
+    TEST_PASS();
+}
+
+/* Jobs due at the same time keep insertion order */
+void test_ties() {
+    TEST_START("till_heap ties in insertion order");
+
+    till_heap_t heap;
+    till_heap_init(&heap);
+    till_heap_item_t item;
+    char key[16];
+
+    for (int i = 0; i < 20; i++) {
+        snprintf(key, sizeof(key), "job%d", i);
+        till_heap_push(&heap, 50, 0, key);
+    }
+    for (int i = 0; i < 20; i++) {
+        snprintf(key, sizeof(key), "job%d", i);
+        ASSERT(till_heap_pop(&heap, &item) == 0 && strcmp(item.key, key) == 0,
+               "Same due time should pop in push order");
+    }
+
+    till_heap_free(&heap);
+    TEST_PASS();
+}
+
+/* Many jobs in scrambled order come out sorted */
+void test_growth() {
+    TEST_START("till_heap growth and sorting");
+
+    till_heap_t heap;
+    till_heap_init(&heap);
+    till_heap_item_t item;
+
+    for (int i = 0; i < 1000; i++) {
+        ASSERT(till_heap_push(&heap, (time_t)((i * 7919) % 1000), 0, NULL) == 0, "Push");
+    }
+    ASSERT(heap.count == 1000, "All jobs queued");
+
+    time_t last = -1;
+    for (int i = 0; i < 1000; i++) {
+        ASSERT(till_heap_pop(&heap, &item) == 0, "Pop");
+        ASSERT(item.due >= last, "Non-decreasing due times");
+        ASSERT(item.key[0] == '\0', "NULL key stored as empty");
+        last = item.due;
+    }
+
+    till_heap_free(&heap);
+    TEST_PASS();
+}
+
+/* Cancelling by kind and key */
+void test_remove() {
+    TEST_START("till_heap remove");
+
+    till_heap_t heap;
+    till_heap_init(&heap);
+    till_heap_item_t item;
+
+    for (int i = 0; i < 10; i++) {
+        till_heap_push(&heap, 100 - i, i % 2, i % 3 == 0 ? "x" : "y");
+    }
+
+    /* Kind 0 with key x: i = 0, 6 */
+    ASSERT(till_heap_remove(&heap, 0, "x") == 2, "Two kind-0 x jobs");
+    ASSERT(till_heap_remove(&heap, 0, "x") == 0, "Nothing left to remove");
+    /* Kind 1, any key: i = 1, 3, 5, 7, 9 */
+    ASSERT(till_heap_remove(&heap, 1, NULL) == 5, "Five kind-1 jobs");
+    ASSERT(heap.count == 3, "Three jobs left");
+
+    /* i = 8, 4, 2 remain: due 92, 96, 98 */
+    ASSERT(till_heap_pop(&heap, &item) == 0 && item.due == 92, "Still ordered after remove");
+    ASSERT(till_heap_pop(&heap, &item) == 0 && item.due == 96, "Still ordered after remove");
+    ASSERT(till_heap_pop(&heap, &item) == 0 && item.due == 98, "Still ordered after remove");
+
+    till_heap_push(&heap, 5, 0, "again");
+    ASSERT(till_heap_peek(&heap)->due == 5, "Usable after remove");
+    till_heap_clear(&heap);
+    ASSERT(till_heap_peek(&heap) == NULL, "Clear empties");
+
+    till_heap_free(&heap);
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main() {
+    printf("\n=== Till Heap Tests ===\n\n");
+
+    /* Run all tests */
+    test_order();
+    test_ties();
+    test_growth();
+    test_remove();
+
+    /* Print summary */
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\nAll tests passed!\n");
+        return 0;
+    } else {
+        printf("\nSome tests failed.\n");
+        return 1;
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ * test_json_index.c - Unit tests for till_json_index.c
+ *
+ * Tests lookups agree with cJSON's own, in small and large objects,
+ * across adds, deletes and repeated keys
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/till_json_index.h"
+#include "../../src/till_config.h"
+#include "../../src/cJSON.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_START(name) do { \
+    printf("Testing %s... ", name); \
+    tests_run++; \
+} while(0)
+
+#define TEST_PASS() do { \
+    printf("PASS\n"); \
+    tests_passed++; \
+} while(0)
+
+#define TEST_FAIL(msg) do { \
+    printf("FAIL: %s\n", msg); \
+    tests_failed++; \
+} while(0)
+
+#define ASSERT(condition, msg) do { \
+    if (!(condition)) { \
+        TEST_FAIL(msg); \
+        till_json_index_free(&index); \
+        cJSON_Delete(object); \
+        return; \
+    } \
+} while(0)
+
+/* Object with count members named Inst0, Inst1, ... */
+static cJSON *make_object(int count) {
+    cJSON *object = cJSON_CreateObject();
+    char key[32];
+
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "Inst%d", i);
+        cJSON_AddNumberToObject(object, key, i);
+    }
+    return object;
+}
+
+/* Small objects are walked, large ones hashed; both find the same */
+void test_lookup() {
+    TEST_START("till_json_index lookups");
+
+    cJSON *object = make_object(1000);
+    till_json_index_t index;
+    till_json_index_init(&index, object);
+    char key[32];
+
+    ASSERT(index.hashed, "1000 members are hashed");
+    for (int i = 0; i < 1000; i += 37) {
+        snprintf(key, sizeof(key), "Inst%d", i);
+        ASSERT(till_json_index_get(&index, key) == cJSON_GetObjectItemCaseSensitive(object, key),
+               "Case-sensitive lookup matches cJSON");
+        snprintf(key, sizeof(key), "inst%d", i);
+        ASSERT(till_json_index_get(&index, key) == NULL, "Case-sensitive misses other case");
+        ASSERT(till_json_index_get_nocase(&index, key) == cJSON_GetObjectItem(object, key),
+               "Case-insensitive lookup matches cJSON");
+    }
+    ASSERT(till_json_index_get(&index, "missing") == NULL, "Missing key");
+    till_json_index_free(&index);
+    cJSON_Delete(object);
+
+    object = make_object(3);
+    till_json_index_init(&index, object);
+    ASSERT(!index.hashed, "Small objects are not hashed");
+    ASSERT(till_json_index_get_nocase(&index, "INST2") == cJSON_GetObjectItem(object, "inst2"),
+           "Small object lookup");
+    till_json_index_free(&index);
+    cJSON_Delete(object);
+
+    object = NULL;
+    till_json_index_init(&index, object);
+    ASSERT(till_json_index_get(&index, "Inst0") == NULL, "No object, nothing found");
+
+    TEST_PASS();
+}
+
+/* Adding past the threshold starts hashing; the index stays in step */
+void test_add() {
+    TEST_START("till_json_index add");
+
+    cJSON *object = cJSON_CreateObject();
+    till_json_index_t index;
+    till_json_index_init(&index, object);
+    char key[32];
+
+    for (int i = 0; i < TILL_JSON_INDEX_MIN * 4; i++) {
+        snprintf(key, sizeof(key), "host-%d", i);
+        ASSERT(till_json_index_add(&index, key, cJSON_CreateNumber(i)) == 0, "Add");
+    }
+    ASSERT(index.hashed, "Hashed once large");
+    ASSERT(cJSON_GetArraySize(object) == TILL_JSON_INDEX_MIN * 4, "Members added to the object");
+
+    for (int i = 0; i < TILL_JSON_INDEX_MIN * 4; i++) {
+        snprintf(key, sizeof(key), "HOST-%d", i);
+        cJSON *item = till_json_index_get_nocase(&index, key);
+        ASSERT(item != NULL && item->valuedouble == i, "Added member found");
+    }
+
+    till_json_index_free(&index);
+    cJSON_Delete(object);
+    TEST_PASS();
+}
+
+/* Deleting keeps the first remaining member for a repeated key */
+void test_delete() {
+    TEST_START("till_json_index delete and repeated keys");
+
+    cJSON *object = make_object(40);
+    cJSON *first = cJSON_CreateString("first");
+    cJSON *second = cJSON_CreateString("second");
+    cJSON_AddItemToObject(object, "dup", first);
+    cJSON_AddItemToObject(object, "DUP", second);
+
+    till_json_index_t index;
+    till_json_index_init(&index, object);
+
+    ASSERT(till_json_index_get(&index, "dup") == first, "Exact key");
+    ASSERT(till_json_index_get(&index, "DUP") == second, "Exact key, other case");
+    ASSERT(till_json_index_get_nocase(&index, "Dup") == first, "First match wins, as in cJSON");
+
+    till_json_index_delete(&index, first);
+    ASSERT(till_json_index_get(&index, "dup") == NULL, "Deleted");
+    ASSERT(till_json_index_get_nocase(&index, "dup") == second, "Next match takes over");
+    ASSERT(cJSON_GetObjectItem(object, "dup") == second, "Removed from the object too");
+
+    cJSON *inst = till_json_index_get(&index, "Inst7");
+    till_json_index_delete(&index, inst);
+    ASSERT(till_json_index_get_nocase(&index, "inst7") == NULL, "Deleted member gone");
+    ASSERT(till_json_index_get(&index, "Inst8") != NULL, "Neighbours kept");
+    ASSERT(cJSON_GetArraySize(object) == 40, "40 + 2 - 2 members");
+
+    till_json_index_free(&index);
+    cJSON_Delete(object);
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main() {
+    printf("\n=== Till JSON Index Tests ===\n\n");
+
+    /* Run all tests */
+    test_lookup();
+    test_add();
+    test_delete();
+
+    /* Print summary */
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\nAll tests passed!\n");
+        return 0;
+    } else {
+        printf("\nSome tests failed.\n");
+        return 1;
+    }
+}
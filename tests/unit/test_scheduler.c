@@ -0,0 +1,132 @@
+/*
+ * test_scheduler.c - Unit tests for till_scheduler.c
+ *
+ * Tests that a reload keeps a persisted missed sync and picks up the
+ * retry a failed sync recorded after the jobs were saved
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../../src/till_config.h"
+#include "../../src/till_schedule.h"
+#include "../../src/till_scheduler.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_START(name) do { \
+    printf("Testing %s... ", name); \
+    tests_run++; \
+} while(0)
+
+#define TEST_PASS() do { \
+    printf("PASS\n"); \
+    tests_passed++; \
+} while(0)
+
+#define TEST_FAIL(msg) do { \
+    printf("FAIL: %s\n", msg); \
+    tests_failed++; \
+} while(0)
+
+#define ASSERT(condition, msg) do { \
+    if (!(condition)) { \
+        TEST_FAIL(msg); \
+        return; \
+    } \
+} while(0)
+
+static char dir[] = "/tmp/till_scheduler_test.XXXXXX";
+
+/* Serve-scheduled daily sync with the sync job persisted as due at due */
+static void write_schedule(time_t due, int failures) {
+    FILE *fp = fopen(".till/schedule.json", "w");
+    fprintf(fp,
+        "{\"sync\":{\"enabled\":true,\"scheduler\":\"serve\",\"interval_hours\":24,"
+        "\"spread_minutes\":0,\"consecutive_failures\":%d,\"history\":[]},"
+        "\"jobs\":[{\"kind\":\"sync\",\"due\":%ld}]}",
+        failures, (long)due);
+    fclose(fp);
+}
+
+/* A missed run persisted by a previous daemon is not pushed back */
+void test_persisted_due() {
+    TEST_START("reload keeps a missed sync");
+
+    time_t now = time(NULL);
+    write_schedule(now - 60, 0);
+    ASSERT(till_scheduler_load() == 1, "One job");
+    ASSERT(till_scheduler_next_due() == now - 60, "Persisted due kept");
+
+    write_schedule(now + 3600, 0);
+    till_scheduler_load();
+    ASSERT(till_scheduler_next_due() == now + 3600, "Persisted regular run kept");
+
+    TEST_PASS();
+}
+
+/* The sync child fails after the daemon saved the next regular run */
+void test_failure_retry() {
+    TEST_START("reload after a failed sync retries it");
+
+    time_t now = time(NULL);
+    time_t regular = now + 24 * 3600;
+    write_schedule(regular, 0);
+    till_scheduler_load();
+    ASSERT(till_scheduler_next_due() == regular, "Regular run pending");
+
+    ASSERT(till_watch_record_sync(0, 1, 0, 0) == 0, "Record failure");
+    till_scheduler_load();
+
+    time_t due = till_scheduler_next_due();
+    time_t first = TILL_WATCH_RETRY_MINUTES * 60;
+    ASSERT(due >= now + first, "Retry not before the first delay");
+    ASSERT(due <= time(NULL) + first + first / 2, "Retry within delay plus jitter");
+
+    ASSERT(till_watch_record_sync(1, 1, 0, 0) == 0, "Record success");
+    till_scheduler_load();
+    ASSERT(till_scheduler_next_due() > now + first * 2, "Success returns to the regular run");
+
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main() {
+    printf("\n=== Till Scheduler Tests ===\n\n");
+
+    if (!mkdtemp(dir) || chdir(dir) != 0 || mkdir(".till", 0700) != 0) {
+        perror("test directory");
+        return 1;
+    }
+    setenv("HOME", dir, 1);
+    setenv("TILL_QUIET_DISCOVERY", "1", 1);
+
+    /* Run all tests */
+    test_persisted_due();
+    test_failure_retry();
+
+    till_scheduler_stop();
+    unlink(".till/schedule.json");
+
+    /* Print summary */
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\nAll tests passed!\n");
+        return 0;
+    } else {
+        printf("\nSome tests failed.\n");
+        return 1;
+    }
+}
@@ -10,6 +10,9 @@
 #include <assert.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "../../src/till_security.h"
 #include "../../src/till_config.h"
@@ -250,6 +253,54 @@ void test_lock_file() {
     TEST_PASS();
 }
 
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void *release_later(void *arg) {
+    usleep(50000);
+    release_lock_file(*(int *)arg);
+    return NULL;
+}
+
+/* Test that a waiter gets the lock when it is released, not at the deadline */
+void test_lock_wait() {
+    TEST_START("lock_file blocking wait");
+    
+    const char *test_lock = "/tmp/test_till_lock_wait.lock";
+    unlink(test_lock);
+    
+    int fd = acquire_lock_file(test_lock, 1000);
+    ASSERT(fd >= 0, "Should acquire lock");
+    
+    pthread_t thread;
+    ASSERT(pthread_create(&thread, NULL, release_later, &fd) == 0, "Start releaser");
+    
+    double start = now_ms();
+    int fd2 = acquire_lock_file(test_lock, 5000);
+    double waited = now_ms() - start;
+    pthread_join(thread, NULL);
+    ASSERT(fd2 >= 0, "Should acquire once released");
+    ASSERT(waited < 1000, "Should wake on release, not at the deadline");
+    
+    /* Held past the deadline - gives up in about the timeout */
+    start = now_ms();
+    int fd3 = acquire_lock_file(test_lock, 200);
+    waited = now_ms() - start;
+    ASSERT(fd3 < 0 && errno == ETIMEDOUT, "Should time out");
+    ASSERT(waited >= 150 && waited < 2000, "Should give up at the deadline");
+    
+    release_lock_file(fd2);
+    fd = acquire_lock_file(test_lock, 1000);
+    ASSERT(fd >= 0, "Should acquire after the timed-out waiter lets go");
+    release_lock_file(fd);
+    unlink(test_lock);
+    
+    TEST_PASS();
+}
+
 /* Test atomic file write */
 void test_atomic_write() {
     TEST_START("write_file_atomic");
@@ -320,6 +371,7 @@ int main() {
     test_safe_strncpy();
     test_safe_strncat();
     test_lock_file();
+    test_lock_wait();
     test_atomic_write();
     test_create_dir_safe();
     
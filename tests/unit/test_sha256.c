@@ -0,0 +1,115 @@
+/*
+ * test_sha256.c - Unit tests for till_sha256.c
+ *
+ * Tests the FIPS 180-4 vectors, incremental updates, and file hashing
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../src/till_sha256.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_START(name) do { \
+    printf("Testing %s... ", name); \
+    tests_run++; \
+} while(0)
+
+#define TEST_PASS() do { \
+    printf("PASS\n"); \
+    tests_passed++; \
+} while(0)
+
+#define TEST_FAIL(msg) do { \
+    printf("FAIL: %s\n", msg); \
+    tests_failed++; \
+} while(0)
+
+#define ASSERT(condition, msg) do { \
+    if (!(condition)) { \
+        TEST_FAIL(msg); \
+        return; \
+    } \
+} while(0)
+
+/* Test SHA-256 against FIPS 180-4 vectors */
+void test_known_vectors() {
+    TEST_START("till_sha256 known vectors");
+
+    till_sha256_t ctx;
+    char hex[TILL_SHA256_HEX];
+
+    till_sha256_init(&ctx);
+    till_sha256_final(&ctx, hex);
+    ASSERT(strcmp(hex, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855") == 0,
+           "Empty input");
+
+    till_sha256_init(&ctx);
+    till_sha256_update(&ctx, "abc", 3);
+    till_sha256_final(&ctx, hex);
+    ASSERT(strcmp(hex, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad") == 0,
+           "abc");
+
+    /* 56 bytes - padding spills into a second block; fed in pieces */
+    const char *two = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    till_sha256_init(&ctx);
+    till_sha256_update(&ctx, two, 10);
+    till_sha256_update(&ctx, two + 10, strlen(two) - 10);
+    till_sha256_final(&ctx, hex);
+    ASSERT(strcmp(hex, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1") == 0,
+           "Two-block message");
+
+    TEST_PASS();
+}
+
+/* Test hashing a file matches hashing its bytes */
+void test_file() {
+    TEST_START("till_sha256_file");
+
+    char path[] = "/tmp/till_sha256_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0, "Create temp file");
+    ASSERT(write(fd, "abc", 3) == 3, "Write temp file");
+    close(fd);
+
+    char hex[TILL_SHA256_HEX];
+    int rc = till_sha256_file(path, hex);
+    unlink(path);
+    ASSERT(rc == 0, "Hash file");
+    ASSERT(strcmp(hex, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad") == 0,
+           "File digest matches abc");
+
+    ASSERT(till_sha256_file("/nonexistent/till_sha256", hex) != 0, "Missing file fails");
+
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main() {
+    printf("\n=== Till SHA-256 Tests ===\n\n");
+
+    /* Run all tests */
+    test_known_vectors();
+    test_file();
+
+    /* Print summary */
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\nAll tests passed!\n");
+        return 0;
+    } else {
+        printf("\nSome tests failed.\n");
+        return 1;
+    }
+}
@@ -0,0 +1,209 @@
+/*
+ * test_snapshot.c - Unit tests for till_snapshot.c
+ *
+ * Tests that a written snapshot reads back the registry it was built
+ * from, and that it is refused once stale, damaged or from another version
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../../src/till_snapshot.h"
+#include "../../src/till_config.h"
+#include "../../src/cJSON.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_START(name) do { \
+    printf("Testing %s... ", name); \
+    tests_run++; \
+} while(0)
+
+#define TEST_PASS() do { \
+    printf("PASS\n"); \
+    tests_passed++; \
+} while(0)
+
+#define TEST_FAIL(msg) do { \
+    printf("FAIL: %s\n", msg); \
+    tests_failed++; \
+} while(0)
+
+#define ASSERT(condition, msg) do { \
+    if (!(condition)) { \
+        TEST_FAIL(msg); \
+        till_snapshot_close(&snap); \
+        cJSON_Delete(registry); \
+        return; \
+    } \
+} while(0)
+
+static char json_path[] = "/tmp/till_snapshot_test_json.XXXXXX";
+static char snap_path[TILL_MAX_PATH];
+
+static const char *registry_json =
+    "{\"installations\":{"
+    "\"primary.tekton.development.us\":{\"root\":\"/p/Tekton\",\"main_root\":\"/p/Tekton\","
+    "\"port_base\":8000,\"ai_port_base\":45000,\"mode\":\"anonymous\"},"
+    "\"coder-a.tekton.development.us\":{\"root\":\"/p/Coder-A\",\"main_root\":\"/p/Tekton\","
+    "\"port_base\":8100,\"ai_port_base\":45100}},"
+    "\"holds\":{\"Tekton\":{\"held_at\":1700000000,\"expires_at\":0,"
+    "\"reason\":\"release freeze\",\"held_by\":\"casey\"}},"
+    "\"last_discovery\":\"2026-01-02T03:04:05\"}";
+
+/* Write text as the JSON source and return its stat */
+static void write_source(const char *text, struct stat *st) {
+    FILE *fp = fopen(json_path, "w");
+    fputs(text, fp);
+    fclose(fp);
+    stat(json_path, st);
+}
+
+/* Everything in the registry reads back */
+void test_round_trip() {
+    TEST_START("till_snapshot round trip");
+
+    till_snapshot_t snap = { 0 };
+    cJSON *registry = cJSON_Parse(registry_json);
+    struct stat st;
+    write_source(registry_json, &st);
+
+    ASSERT(till_snapshot_write(snap_path, registry, &st) == 0, "Write");
+    ASSERT(till_snapshot_open(&snap, snap_path, &st) == 0, "Open");
+    ASSERT(snap.header->installation_count == 2, "Two installations");
+
+    const till_snapshot_installation_t *inst =
+        till_snapshot_installation(&snap, "coder-a.tekton.development.us");
+    ASSERT(inst == &snap.installations[1], "Lookup keeps registry order");
+    ASSERT(strcmp(till_snapshot_string(&snap, inst->root), "/p/Coder-A") == 0, "Root");
+    ASSERT(strcmp(till_snapshot_string(&snap, inst->main_root), "/p/Tekton") == 0, "Main root");
+    ASSERT(inst->port_base == 8100 && inst->ai_port_base == 45100, "Ports");
+    ASSERT(strcmp(till_snapshot_string(&snap, inst->mode), "") == 0, "Missing string is empty");
+    ASSERT(till_snapshot_installation(&snap, "Coder-A.tekton.development.us") == NULL,
+           "Installation lookup is exact");
+
+    const till_snapshot_hold_t *hold = till_snapshot_hold(&snap, "tekton");
+    ASSERT(hold != NULL, "Hold lookup ignores case");
+    ASSERT(hold->held_at == 1700000000 && hold->expires_at == 0, "Hold times");
+    ASSERT(strcmp(till_snapshot_string(&snap, hold->reason), "release freeze") == 0, "Hold reason");
+    ASSERT(strcmp(till_snapshot_string(&snap, hold->held_by), "casey") == 0, "Held by");
+    ASSERT(till_snapshot_hold(&snap, "Coder-A") == NULL, "No hold");
+
+    ASSERT(strcmp(till_snapshot_string(&snap, snap.header->last_discovery),
+                  "2026-01-02T03:04:05") == 0, "Last discovery");
+    ASSERT(strcmp(till_snapshot_string(&snap, 0xffffffffu), "") == 0, "Bad offset is empty");
+
+    till_snapshot_close(&snap);
+    cJSON_Delete(registry);
+    TEST_PASS();
+}
+
+/* Many installations all hash to their own record */
+void test_many() {
+    TEST_START("till_snapshot with 1000 installations");
+
+    till_snapshot_t snap = { 0 };
+    cJSON *registry = cJSON_CreateObject();
+    cJSON *installations = cJSON_AddObjectToObject(registry, "installations");
+    char name[64];
+    struct stat st;
+    write_source("{}", &st);
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "inst-%d", i);
+        cJSON *inst = cJSON_AddObjectToObject(installations, name);
+        cJSON_AddNumberToObject(inst, "port_base", 8000 + i);
+    }
+
+    ASSERT(till_snapshot_write(snap_path, registry, &st) == 0, "Write");
+    ASSERT(till_snapshot_open(&snap, snap_path, &st) == 0, "Open");
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "inst-%d", i);
+        const till_snapshot_installation_t *inst = till_snapshot_installation(&snap, name);
+        ASSERT(inst != NULL && inst->port_base == 8000 + i, "Every installation found");
+    }
+    ASSERT(till_snapshot_installation(&snap, "inst-1000") == NULL, "Missing installation");
+    ASSERT(snap.header->hold_count == 0, "No holds");
+
+    till_snapshot_close(&snap);
+    cJSON_Delete(registry);
+    TEST_PASS();
+}
+
+/* A snapshot that no longer matches its JSON, or its own checksum, is refused */
+void test_refused() {
+    TEST_START("till_snapshot stale and damaged");
+
+    till_snapshot_t snap = { 0 };
+    cJSON *registry = cJSON_Parse(registry_json);
+    struct stat st, edited;
+    write_source(registry_json, &st);
+    ASSERT(till_snapshot_write(snap_path, registry, &st) == 0, "Write");
+
+    /* A hand edit that changes the size */
+    write_source("{\"installations\":{}}", &edited);
+    ASSERT(till_snapshot_open(&snap, snap_path, &edited) != 0, "Stale snapshot refused");
+    ASSERT(till_snapshot_open(&snap, snap_path, NULL) == 0, "Opens without a source to check");
+    till_snapshot_close(&snap);
+
+    /* Flip one byte of the string table */
+    struct stat snap_st;
+    stat(snap_path, &snap_st);
+    FILE *fp = fopen(snap_path, "r+b");
+    fseek(fp, snap_st.st_size - 3, SEEK_SET);
+    fputc('!', fp);
+    fclose(fp);
+    ASSERT(till_snapshot_open(&snap, snap_path, &st) != 0, "Damaged snapshot refused");
+
+    /* Truncated */
+    ASSERT(truncate(snap_path, 16) == 0, "Truncate");
+    ASSERT(till_snapshot_open(&snap, snap_path, &st) != 0, "Short snapshot refused");
+
+    unlink(snap_path);
+    ASSERT(till_snapshot_open(&snap, snap_path, &st) != 0, "Missing snapshot refused");
+
+    cJSON_Delete(registry);
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main() {
+    printf("\n=== Till Snapshot Tests ===\n\n");
+
+    int fd = mkstemp(json_path);
+    if (fd == -1) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    snprintf(snap_path, sizeof(snap_path), "%s.snap", json_path);
+
+    /* Run all tests */
+    test_round_trip();
+    test_many();
+    test_refused();
+
+    unlink(json_path);
+    unlink(snap_path);
+
+    /* Print summary */
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run:    %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\nAll tests passed!\n");
+        return 0;
+    } else {
+        printf("\nSome tests failed.\n");
+        return 1;
+    }
+}